@@ -0,0 +1,147 @@
+/**
+ * <Program>
+ * ADXL345_Accelerometer.c
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ *  Native driver of the ADXL345 accelerometer from Analog Devices.
+ * The sensor measures into its FIFO on its own, the host only
+ * drains it whenever the watermark is reached, so a rate of 1600Hz
+ * does not need 1600 wakeups per second. The stream reading the
+ * FIFO into a ring buffer is in AccelStream.c.
+ *  The driver has no Python module of its own, the stream is
+ * controlled through the cosybox module.
+ *
+ * <Sources>
+ * Accessed on 18.10.2026 - ADXL345 Datasheet:
+ *      https://www.analog.com/media/en/technical-documentation/data-sheets/ADXL345.pdf
+ */
+
+#include "ADXL345_Accelerometer.h"
+
+/**
+ * Checks the device ID, so a different device at the address is
+ * not configured by accident.
+ *
+ * @param sensor sensor ID
+ * @return I2C_OK on success, I2C_ERROR if the ID does not match,
+ *         I2C_BREAKER_OPEN if the device failed too often
+ */
+int checkAccelerometer(int sensor) {
+    uint8_t id;
+    int status = i2cTryReadReg8(sensor, ADXL345_DEVID, &id);
+    if (status == I2C_OK && id != ADXL345_DEVID_CODE) {
+        status = I2C_ERROR;
+    }
+    return status;
+}
+
+/**
+ * Puts the sensor to standby, sets the output data rate, full
+ * resolution at +-16g and the FIFO in stream mode with the
+ * watermark, maps WATERMARK to INT1 (active low) and starts to
+ * measure. The FIFO is cleared on the way through bypass mode.
+ *
+ * @param sensor sensor ID
+ * @param rate output data rate, one of the ADXL345_RATE_* codes
+ * @param watermark samples in the FIFO raising WATERMARK, 1 to 31
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int configureAccelerometer(int sensor, int rate, int watermark) {
+    const uint8_t settings[][2] = {
+            /* The settings are changed in standby */
+            {ADXL345_POWER_CTL,   0},
+            {ADXL345_DATA_FORMAT, ADXL345_FORMAT_INT_INVERT | ADXL345_FORMAT_FULL_RES | ADXL345_FORMAT_RANGE_16G},
+            {ADXL345_BW_RATE,     (uint8_t) (rate & 0x0F)},
+            {ADXL345_FIFO_CTL,    ADXL345_FIFO_BYPASS},
+            {ADXL345_FIFO_CTL,    (uint8_t) (ADXL345_FIFO_STREAM | (watermark & ADXL345_FIFO_SAMPLES_MASK))},
+            /* OVERRUN is set in INT_SOURCE without being enabled, only WATERMARK drives INT1 */
+            {ADXL345_INT_MAP,     0},
+            {ADXL345_INT_ENABLE,  ADXL345_INT_WATERMARK},
+            {ADXL345_POWER_CTL,   ADXL345_POWER_MEASURE}
+    };
+    for (size_t i = 0; i < sizeof(settings) / sizeof(settings[0]); i++) {
+        int status = i2cTryWriteReg8(sensor, settings[i][0], settings[i][1]);
+        if (status != I2C_OK) {
+            return status;
+        }
+    }
+    return I2C_OK;
+}
+
+/**
+ * Stops measuring, the sensor keeps its settings in standby.
+ *
+ * @param sensor sensor ID
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int standbyAccelerometer(int sensor) {
+    return i2cTryWriteReg8(sensor, ADXL345_POWER_CTL, 0);
+}
+
+/**
+ * Reads INT_SOURCE and the number of samples in the FIFO.
+ *
+ * @param sensor sensor ID
+ * @param entries set to the number of samples to read
+ * @param overrun set to 1 if samples were replaced before they
+ *        were read
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int readFifoState(int sensor, int *entries, int *overrun) {
+    uint8_t source;
+    uint8_t fifo;
+    int status;
+    if ((status = i2cTryReadReg8(sensor, ADXL345_INT_SOURCE, &source)) != I2C_OK ||
+        (status = i2cTryReadReg8(sensor, ADXL345_FIFO_STATUS, &fifo)) != I2C_OK) {
+        return status;
+    }
+    *entries = fifo & ADXL345_FIFO_ENTRIES_MASK;
+    *overrun = (source & ADXL345_INT_OVERRUN) != 0;
+    return I2C_OK;
+}
+
+/**
+ * Takes the oldest sample out of the FIFO with one burst read of
+ * DATAX0 to DATAZ1.
+ *
+ * @param sensor sensor ID
+ * @param data read sample
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int readAccelSample(int sensor, accelData *data) {
+    uint8_t block[ADXL345_DATA_LENGTH];
+    int status = i2cTryReadBlock(sensor, ADXL345_DATAX0, block, ADXL345_DATA_LENGTH);
+    if (status == I2C_OK) {
+        decodeAccelSample(block, data);
+    }
+    return status;
+}
+
+/**
+ * Decodes a burst read of ADXL345_DATA_LENGTH bytes from DATAX0,
+ * every axis is stored LSB first in two's complement.
+ *
+ * @param block registers 0x32 to 0x37
+ * @param data decoded sample
+ */
+void decodeAccelSample(const uint8_t *block, accelData *data) {
+    data->x = (int16_t) (block[1] << 8 | block[0]);
+    data->y = (int16_t) (block[3] << 8 | block[2]);
+    data->z = (int16_t) (block[5] << 8 | block[4]);
+}
+
+/**
+ * Returns the output data rate of a BW_RATE code.
+ *
+ * @param rate one of the ADXL345_RATE_* codes
+ * @return samples per second
+ */
+double accelRateHz(int rate) {
+    return 3200.0 / (1 << (ADXL345_RATE_3200HZ - (rate & 0x0F)));
+}
@@ -0,0 +1,152 @@
+/**
+ * <Program>
+ * ADXL345_Accelerometer.h
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ * Header file for the ADXL345 3-axis accelerometer from Analog
+ * Devices. Defines the registers needed to measure at up to 3200Hz
+ * into the 32 entry FIFO of the sensor and to drain it, for
+ * vibration and seismograph experiments.
+ *
+ * In stream mode the FIFO keeps the newest 32 samples, the
+ * WATERMARK interrupt is raised as soon as it holds the number of
+ * samples set in FIFO_CTL and released when it holds fewer again.
+ * Every burst read of the 6 data registers takes the oldest sample
+ * out of the FIFO, one burst per sample. If the FIFO is full, a new
+ * sample replaces the oldest one and OVERRUN is set until the data
+ * registers are read.
+ *
+ * <Sources>
+ * Accessed on 18.10.2026 - ADXL345 Datasheet:
+ *      https://www.analog.com/media/en/technical-documentation/data-sheets/ADXL345.pdf
+ */
+
+#ifndef SRC_ADXL345_ACCELEROMETER_H
+#define SRC_ADXL345_ACCELEROMETER_H
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include "I2CBus.h"
+
+/* --- I2C address (ALT ADDRESS pin low) --- */
+#define ADXL345_ADDRESS 0x53
+
+/* --- Registers --- */
+#define ADXL345_DEVID       0x00
+#define ADXL345_BW_RATE     0x2C
+#define ADXL345_POWER_CTL   0x2D
+#define ADXL345_INT_ENABLE  0x2E
+#define ADXL345_INT_MAP     0x2F
+#define ADXL345_INT_SOURCE  0x30
+#define ADXL345_DATA_FORMAT 0x31
+#define ADXL345_DATAX0      0x32
+#define ADXL345_FIFO_CTL    0x38
+#define ADXL345_FIFO_STATUS 0x39
+
+#define ADXL345_DEVID_CODE 0xE5
+
+/* --- Bits --- */
+#define ADXL345_POWER_MEASURE       0x08
+#define ADXL345_INT_DATA_READY      0x80
+#define ADXL345_INT_WATERMARK       0x02  /* INT_ENABLE, INT_MAP and INT_SOURCE */
+#define ADXL345_INT_OVERRUN         0x01
+#define ADXL345_FORMAT_INT_INVERT   0x20  /* interrupts active low */
+#define ADXL345_FORMAT_FULL_RES     0x08  /* 3.9mg/LSB in every range */
+#define ADXL345_FORMAT_RANGE_16G    0x03
+#define ADXL345_FIFO_MODE_MASK      0xC0
+#define ADXL345_FIFO_BYPASS         0x00
+#define ADXL345_FIFO_STREAM         0x80
+#define ADXL345_FIFO_SAMPLES_MASK   0x1F
+#define ADXL345_FIFO_ENTRIES_MASK   0x3F
+
+/* --- Output data rates (BW_RATE[3:0]), the rate doubles with every code --- */
+#define ADXL345_RATE_100HZ  0x0A
+#define ADXL345_RATE_200HZ  0x0B
+#define ADXL345_RATE_400HZ  0x0C
+#define ADXL345_RATE_800HZ  0x0D
+#define ADXL345_RATE_1600HZ 0x0E
+#define ADXL345_RATE_3200HZ 0x0F
+
+#define ADXL345_FIFO_SIZE   32
+#define ADXL345_DATA_LENGTH 6     /* X, Y and Z, each LSB first */
+#define ADXL345_MG_PER_LSB  3.9   /* full resolution */
+
+/* Used to hold a sample of the three axes, 3.9mg/LSB */
+typedef struct {
+    int16_t x;
+    int16_t y;
+    int16_t z;
+} accelData;
+
+/* METHODS */
+
+/**
+ * Checks the device ID, so a different device at the address is
+ * not configured by accident.
+ *
+ * @param sensor sensor ID
+ * @return I2C_OK on success, I2C_ERROR if the ID does not match,
+ *         I2C_BREAKER_OPEN if the device failed too often
+ */
+int checkAccelerometer(int sensor);
+/**
+ * Puts the sensor to standby, sets the output data rate, full
+ * resolution at +-16g and the FIFO in stream mode with the
+ * watermark, maps WATERMARK to INT1 (active low) and starts to
+ * measure. The FIFO is cleared on the way through bypass mode.
+ *
+ * @param sensor sensor ID
+ * @param rate output data rate, one of the ADXL345_RATE_* codes
+ * @param watermark samples in the FIFO raising WATERMARK, 1 to 31
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int configureAccelerometer(int sensor, int rate, int watermark);
+/**
+ * Stops measuring, the sensor keeps its settings in standby.
+ *
+ * @param sensor sensor ID
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int standbyAccelerometer(int sensor);
+/**
+ * Reads INT_SOURCE and the number of samples in the FIFO.
+ *
+ * @param sensor sensor ID
+ * @param entries set to the number of samples to read
+ * @param overrun set to 1 if samples were replaced before they
+ *        were read
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int readFifoState(int sensor, int *entries, int *overrun);
+/**
+ * Takes the oldest sample out of the FIFO with one burst read of
+ * DATAX0 to DATAZ1.
+ *
+ * @param sensor sensor ID
+ * @param data read sample
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int readAccelSample(int sensor, accelData *data);
+/**
+ * Decodes a burst read of ADXL345_DATA_LENGTH bytes from DATAX0,
+ * every axis is stored LSB first in two's complement.
+ *
+ * @param block registers 0x32 to 0x37
+ * @param data decoded sample
+ */
+void decodeAccelSample(const uint8_t *block, accelData *data);
+/**
+ * Returns the output data rate of a BW_RATE code.
+ *
+ * @param rate one of the ADXL345_RATE_* codes
+ * @return samples per second
+ */
+double accelRateHz(int rate);
+
+#endif //SRC_ADXL345_ACCELEROMETER_H
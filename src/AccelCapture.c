@@ -0,0 +1,196 @@
+/**
+ * <Program>
+ * AccelCapture.c
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ *  Captures the acceleration stream of the ADXL345 for the given
+ * number of seconds and reports the rate reached, the drains of the
+ * FIFO and every sample lost on the way. With -o the samples are
+ * written as CSV (time in seconds, x, y and z in g). With -s the
+ * simulated sensor of AccelSimulator.c is used instead of the bus,
+ * its sample numbers in x are checked for gaps and its exact loss
+ * is reported next to the estimate of the stream.
+ *  The INT1 pin is used with -l, otherwise the FIFO is polled; -p
+ * polls the simulated sensor as well. The run fails if a sample was
+ * lost or a read failed.
+ *  Usage: accelcapture [-s] [-p] [-r rate] [-w watermark]
+ *                      [-c chip] [-l line] [-o output] [seconds]
+ *
+ * <Sources>
+ * Accessed on 18.10.2026 - getopt(3):
+ *      https://man7.org/linux/man-pages/man3/getopt.3.html
+ */
+
+#define _GNU_SOURCE
+#include <getopt.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "AccelStream.h"
+#include "AccelSimulator.h"
+
+#define CAPTURE_READ_US 100000  /* the ring buffer is read every 100ms */
+#define CAPTURE_BATCH   4096
+
+/* Used to hold what was read from the ring buffer */
+typedef struct {
+    FILE *output;
+    uint64_t cursor;
+    uint64_t samples;
+    uint64_t lost;      /* overwritten in the ring buffer */
+    uint64_t gaps;      /* missing sample numbers of the simulator */
+    int checkGaps;
+    uint16_t lastX;
+} captureState;
+
+/**
+ * Maps a rate in Hz to its BW_RATE code.
+ *
+ * @return ADXL345_RATE_* code, -1 if the sensor has no such rate
+ */
+static int rateCode(double hz) {
+    for (int rate = ADXL345_RATE_100HZ; rate <= ADXL345_RATE_3200HZ; rate++) {
+        if (accelRateHz(rate) == hz) {
+            return rate;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Reads the samples added to the ring buffer since the last call.
+ */
+static void readSamples(accelStream *stream, captureState *state) {
+    static accelSample samples[CAPTURE_BATCH];
+    size_t count;
+    do {
+        uint64_t lost;
+        count = readRing(&stream->stream.ring, &state->cursor, samples, CAPTURE_BATCH, &lost);
+        state->lost += lost;
+        for (size_t i = 0; i < count; i++) {
+            const accelData *data = &samples[i].data;
+            if (state->checkGaps && state->samples > 0) {
+                state->gaps += (uint16_t) ((uint16_t) data->x - state->lastX - 1);
+            }
+            state->lastX = (uint16_t) data->x;
+            state->samples++;
+            if (state->output != NULL) {
+                fprintf(state->output, "%.6f,%.4f,%.4f,%.4f\n", samples[i].time / 1e6,
+                        data->x * ADXL345_MG_PER_LSB / 1000, data->y * ADXL345_MG_PER_LSB / 1000,
+                        data->z * ADXL345_MG_PER_LSB / 1000);
+            }
+        }
+    } while (count == CAPTURE_BATCH);
+}
+
+int main(int argc, char **argv) {
+    const char *chip = SI1145_GPIO_CHIP, *outputPath = NULL;
+    int simulate = 0, polled = 0, line = -1, watermark = ACCEL_STREAM_WATERMARK;
+    double hz = accelRateHz(ACCEL_STREAM_RATE), seconds = 10;
+    int option;
+
+    while ((option = getopt(argc, argv, "spr:w:c:l:o:")) != -1) {
+        switch (option) {
+            case 's':
+                simulate = 1;
+                break;
+            case 'p':
+                polled = 1;
+                break;
+            case 'r':
+                hz = atof(optarg);
+                break;
+            case 'w':
+                watermark = atoi(optarg);
+                break;
+            case 'c':
+                chip = optarg;
+                break;
+            case 'l':
+                line = atoi(optarg);
+                break;
+            case 'o':
+                outputPath = optarg;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-s] [-p] [-r rate] [-w watermark] [-c chip] [-l line] [-o output]"
+                                " [seconds]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (optind < argc) {
+        seconds = atof(argv[optind]);
+    }
+    int rate = rateCode(hz);
+    if (rate < 0 || watermark < 1 || watermark > ADXL345_FIFO_SAMPLES_MASK || seconds <= 0) {
+        fprintf(stderr, "rate must be 100 to 3200Hz in powers of two, watermark 1 to 31\n");
+        return 1;
+    }
+
+    captureState state;
+    memset(&state, 0, sizeof(state));
+    state.checkGaps = simulate;
+    if (outputPath != NULL && (state.output = fopen(outputPath, "w")) == NULL) {
+        perror(outputPath);
+        return 1;
+    }
+    if (simulate && startAccelSimulator() < 0) {
+        perror("simulator");
+        return 1;
+    }
+
+    sampleEvent event;
+    int withEvent = 0;
+    if (simulate && !polled) {
+        withEvent = openFdEvent(&event, accelSimulatorEvent()) == 0;
+    } else if (!simulate && line >= 0) {
+        if (openGpioEvent(&event, chip, line) < 0) {
+            perror(chip);
+            return 1;
+        }
+        withEvent = 1;
+    }
+
+    accelStream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (startAccelStream(&stream, rate, watermark, withEvent ? &event : NULL) < 0) {
+        fprintf(stderr, "the ADXL345 could not be started\n");
+        return 1;
+    }
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (double elapsed = 0; elapsed < seconds; elapsed += CAPTURE_READ_US / 1e6) {
+        usleep(CAPTURE_READ_US);
+        readSamples(&stream, &state);
+    }
+    stopAccelStream(&stream);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    readSamples(&stream, &state);
+
+    double duration = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    uint64_t overruns = __atomic_load_n(&stream.overruns, __ATOMIC_RELAXED);
+    uint64_t dropped = __atomic_load_n(&stream.dropped, __ATOMIC_RELAXED);
+    uint32_t errors = __atomic_load_n(&stream.stream.errors, __ATOMIC_RELAXED);
+    fprintf(stderr, "%" PRIu64 " samples in %.2fs (%.1f/s of %gHz), %" PRIu64 " drains, FIFO up to %" PRIu32
+                    " samples (%s)\n", state.samples, duration, state.samples / duration, hz, stream.drains,
+            stream.maxLevel, withEvent ? "INT1" : "polled");
+    fprintf(stderr, "%" PRIu64 " overruns, %" PRIu64 " samples dropped (estimated), %" PRIu64
+                    " lost in the ring buffer, %" PRIu32 " read errors\n", overruns, dropped, state.lost, errors);
+    if (simulate) {
+        fprintf(stderr, "simulator: %" PRIu64 " samples overwritten, %" PRIu64 " gaps in the sample numbers\n",
+                accelSimulatorLost(), state.gaps);
+        stopAccelSimulator();
+    }
+    closeRing(&stream.stream.ring);
+    if (state.output != NULL) {
+        fclose(state.output);
+    }
+    return overruns > 0 || dropped > 0 || state.lost > 0 || state.gaps > 0 || errors > 0;
+}
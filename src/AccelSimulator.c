@@ -0,0 +1,371 @@
+/**
+ * <Program>
+ * AccelSimulator.c
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ *  Simulated ADXL345 as a backend of the I2C layer. The samples are
+ * not made by a thread at the output data rate but whenever the
+ * simulator is accessed: all samples due since the last access by
+ * the monotonic clock are put into the FIFO at once, the oldest
+ * ones are overwritten if it is full. So the simulator keeps the
+ * rate exactly, however late its thread or the reader run.
+ *  The thread only updates INT1 every ACCEL_SIMULATOR_TICK_US and
+ * writes to the eventfd when it is asserted, like the falling edge
+ * of the active low pin.
+ *
+ * <Sources>
+ * Accessed on 18.10.2026 - ADXL345 Datasheet:
+ *      https://www.analog.com/media/en/technical-documentation/data-sheets/ADXL345.pdf
+ * Accessed on 18.10.2026 - eventfd(2):
+ *      https://man7.org/linux/man-pages/man2/eventfd.2.html
+ */
+
+#include <fcntl.h>
+#include <math.h>
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include "AccelSimulator.h"
+
+#define SIMULATOR_REGISTERS 64
+
+static pthread_mutex_t simulatorLock = PTHREAD_MUTEX_INITIALIZER;
+static const i2cBackend *previous = NULL;
+static pthread_t thread;
+static int running = 0;     /* accessed atomically */
+static int eventFd = -1;
+
+/* 1 for every fd opened for the simulated sensor */
+static uint8_t simulated[I2C_FD_MAX];
+
+/* State of the sensor */
+static uint8_t registers[SIMULATOR_REGISTERS];
+static accelData fifo[ADXL345_FIFO_SIZE];
+static int fifoFirst = 0;
+static int fifoCount = 0;
+static accelData output;        /* last sample taken out of the FIFO */
+static int overrun = 0;
+static int interrupt = 0;       /* INT1 asserted */
+static int64_t startUs = 0;     /* start of the measurement */
+static uint64_t produced = 0;   /* samples measured since startUs */
+static uint64_t lost = 0;
+
+static int64_t monotonicUs(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static int isSimulated(int fd) {
+    return fd >= 0 && fd < I2C_FD_MAX && simulated[fd];
+}
+
+/**
+ * Returns the n-th sample since the start of the measurement.
+ */
+static accelData makeSample(uint64_t n, double rateHz) {
+    accelData sample;
+    sample.x = (int16_t) (uint16_t) n;
+    sample.y = 0;
+    sample.z = (int16_t) (ACCEL_SIMULATOR_1G +
+                          lround(ACCEL_SIMULATOR_1G / 4.0 * sin(2 * M_PI * ACCEL_SIMULATOR_HZ * n / rateHz)));
+    return sample;
+}
+
+/**
+ * Puts the samples due by now into the FIFO. In bypass mode only
+ * the newest one is kept. Called with the lock held.
+ */
+static void measure(void) {
+    if (!(registers[ADXL345_POWER_CTL] & ADXL345_POWER_MEASURE)) {
+        return;
+    }
+    double rateHz = accelRateHz(registers[ADXL345_BW_RATE]);
+    uint64_t due = (uint64_t) ((monotonicUs() - startUs) * rateHz / 1e6);
+    int stream = (registers[ADXL345_FIFO_CTL] & ADXL345_FIFO_MODE_MASK) == ADXL345_FIFO_STREAM;
+    int size = stream ? ADXL345_FIFO_SIZE : 1;
+
+    /* Samples that would be overwritten right away are only counted */
+    if (due > produced + (uint64_t) size) {
+        uint64_t skipped = due - produced - (uint64_t) size;
+        if (stream) {
+            lost += skipped + (uint64_t) fifoCount;
+            overrun = 1;
+        }
+        produced += skipped;
+        fifoCount = 0;
+    }
+    for (; produced < due; produced++) {
+        if (fifoCount == size) {
+            fifoFirst = (fifoFirst + 1) % ADXL345_FIFO_SIZE;
+            fifoCount--;
+            if (stream) {
+                lost++;
+                overrun = 1;
+            }
+        }
+        fifo[(fifoFirst + fifoCount) % ADXL345_FIFO_SIZE] = makeSample(produced, rateHz);
+        fifoCount++;
+    }
+}
+
+/**
+ * Returns INT_SOURCE, DATA_READY is set while the FIFO holds a
+ * sample. Called with the lock held.
+ */
+static uint8_t interruptSource(void) {
+    int watermark = registers[ADXL345_FIFO_CTL] & ADXL345_FIFO_SAMPLES_MASK;
+    uint8_t source = 0;
+    if (fifoCount > 0) {
+        source |= ADXL345_INT_DATA_READY;
+    }
+    if (fifoCount >= watermark && (registers[ADXL345_FIFO_CTL] & ADXL345_FIFO_MODE_MASK) == ADXL345_FIFO_STREAM) {
+        source |= ADXL345_INT_WATERMARK;
+    }
+    if (overrun) {
+        source |= ADXL345_INT_OVERRUN;
+    }
+    return source;
+}
+
+/**
+ * Opens the simulated sensor on a /dev/null fd, so it can be closed
+ * as usual, every other device with the backend used before.
+ */
+static int simulatorSetup(int devId) {
+    if (devId != ADXL345_ADDRESS) {
+        int fd = previous->setup(devId);
+        if (fd >= 0 && fd < I2C_FD_MAX) {
+            simulated[fd] = 0;
+        }
+        return fd;
+    }
+    int fd = open("/dev/null", O_RDWR | O_CLOEXEC);
+    if (fd >= I2C_FD_MAX) {
+        close(fd);
+        return -1;
+    }
+    if (fd >= 0) {
+        simulated[fd] = 1;
+    }
+    return fd;
+}
+
+static int simulatorRead(int fd) {
+    return isSimulated(fd) ? -1 : previous->read(fd);
+}
+
+static int simulatorReadReg8(int fd, int reg) {
+    if (!isSimulated(fd)) {
+        return previous->readReg8(fd, reg);
+    }
+    if (reg < 0 || reg >= SIMULATOR_REGISTERS) {
+        return -1;
+    }
+    pthread_mutex_lock(&simulatorLock);
+    measure();
+    int value = registers[reg];
+    if (reg == ADXL345_INT_SOURCE) {
+        value = interruptSource();
+    } else if (reg == ADXL345_FIFO_STATUS) {
+        value = fifoCount;
+    }
+    pthread_mutex_unlock(&simulatorLock);
+    return value;
+}
+
+static int simulatorReadReg16(int fd, int reg) {
+    return isSimulated(fd) ? -1 : previous->readReg16(fd, reg);
+}
+
+static int simulatorWrite(int fd, int data) {
+    return isSimulated(fd) ? -1 : previous->write(fd, data);
+}
+
+/**
+ * Starting to measure clears the FIFO and starts the clock of the
+ * samples, bypass mode clears the FIFO.
+ */
+static int simulatorWriteReg8(int fd, int reg, int data) {
+    if (!isSimulated(fd)) {
+        return previous->writeReg8(fd, reg, data);
+    }
+    if (reg <= ADXL345_DEVID || reg >= SIMULATOR_REGISTERS || reg == ADXL345_INT_SOURCE ||
+        reg == ADXL345_FIFO_STATUS) {
+        return -1;
+    }
+    pthread_mutex_lock(&simulatorLock);
+    measure();
+    int measuring = registers[ADXL345_POWER_CTL] & ADXL345_POWER_MEASURE;
+    registers[reg] = (uint8_t) data;
+    if (reg == ADXL345_POWER_CTL && !measuring && (data & ADXL345_POWER_MEASURE)) {
+        startUs = monotonicUs();
+        produced = 0;
+        fifoCount = 0;
+        overrun = 0;
+    } else if (reg == ADXL345_FIFO_CTL && (data & ADXL345_FIFO_MODE_MASK) == ADXL345_FIFO_BYPASS) {
+        fifoCount = 0;
+        overrun = 0;
+    }
+    pthread_mutex_unlock(&simulatorLock);
+    return 0;
+}
+
+static int simulatorWriteReg16(int fd, int reg, int data) {
+    return isSimulated(fd) ? -1 : previous->writeReg16(fd, reg, data);
+}
+
+/**
+ * A burst read starting at DATAX0 takes the oldest sample out of
+ * the FIFO and clears OVERRUN, an empty FIFO returns the last
+ * sample again.
+ */
+static int simulatorReadBlock(int fd, int reg, uint8_t *buffer, int length) {
+    if (!isSimulated(fd)) {
+        return previous->readBlock(fd, reg, buffer, length);
+    }
+    if (reg < 0 || length < 0 || reg + length > SIMULATOR_REGISTERS) {
+        return -1;
+    }
+    pthread_mutex_lock(&simulatorLock);
+    measure();
+    if (reg == ADXL345_DATAX0) {
+        if (fifoCount > 0) {
+            output = fifo[fifoFirst];
+            fifoFirst = (fifoFirst + 1) % ADXL345_FIFO_SIZE;
+            fifoCount--;
+        }
+        overrun = 0;
+    }
+    uint8_t data[ADXL345_DATA_LENGTH] = {
+            (uint8_t) output.x, (uint8_t) ((uint16_t) output.x >> 8),
+            (uint8_t) output.y, (uint8_t) ((uint16_t) output.y >> 8),
+            (uint8_t) output.z, (uint8_t) ((uint16_t) output.z >> 8)
+    };
+    memcpy(registers + ADXL345_DATAX0, data, sizeof(data));
+    memcpy(buffer, registers + reg, (size_t) length);
+    pthread_mutex_unlock(&simulatorLock);
+    return length;
+}
+
+static const i2cBackend simulator = {
+        simulatorSetup, simulatorRead, simulatorReadReg8, simulatorReadReg16,
+        simulatorWrite, simulatorWriteReg8, simulatorWriteReg16, simulatorReadBlock
+};
+
+/**
+ * Updates INT1 every ACCEL_SIMULATOR_TICK_US and signals the
+ * eventfd when it is asserted.
+ */
+static void *raiseInterrupt(void *argument) {
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    while (__atomic_load_n(&running, __ATOMIC_ACQUIRE)) {
+        next.tv_nsec += ACCEL_SIMULATOR_TICK_US * 1000L;
+        if (next.tv_nsec >= 1000000000L) {
+            next.tv_nsec -= 1000000000L;
+            next.tv_sec++;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+
+        pthread_mutex_lock(&simulatorLock);
+        measure();
+        int asserted = (registers[ADXL345_INT_ENABLE] & interruptSource() & ADXL345_INT_WATERMARK) != 0;
+        int edge = asserted && !interrupt;
+        interrupt = asserted;
+        pthread_mutex_unlock(&simulatorLock);
+        if (edge) {
+            uint64_t one = 1;
+            if (write(eventFd, &one, sizeof(one)) < 0) {
+                continue;
+            }
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Routes the transactions of the I2C layer through the simulator
+ * and starts the thread raising INT1. Must not be called while
+ * transactions are running.
+ *
+ * @return 0 on success, -1 on failure
+ */
+int startAccelSimulator(void) {
+    if (previous != NULL) {
+        return -1;
+    }
+    eventFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (eventFd < 0) {
+        return -1;
+    }
+    pthread_mutex_lock(&simulatorLock);
+    memset(registers, 0, sizeof(registers));
+    registers[ADXL345_DEVID] = ADXL345_DEVID_CODE;
+    registers[ADXL345_BW_RATE] = ADXL345_RATE_100HZ;
+    fifoCount = 0;
+    overrun = 0;
+    interrupt = 0;
+    lost = 0;
+    pthread_mutex_unlock(&simulatorLock);
+
+    previous = i2cSetBackend(&simulator);
+    __atomic_store_n(&running, 1, __ATOMIC_RELEASE);
+    if (pthread_create(&thread, NULL, raiseInterrupt, NULL) != 0) {
+        __atomic_store_n(&running, 0, __ATOMIC_RELEASE);
+        i2cSetBackend(previous);
+        previous = NULL;
+        close(eventFd);
+        eventFd = -1;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Returns the eventfd INT1 of the simulator is signalled on, for
+ * openFdEvent.
+ *
+ * @return eventfd, -1 if the simulator does not run
+ */
+int accelSimulatorEvent(void) {
+    return eventFd;
+}
+
+/**
+ * Returns the number of samples the simulated FIFO overwrote
+ * before they were read, the exact loss the stream can only
+ * estimate.
+ *
+ * @return overwritten samples
+ */
+uint64_t accelSimulatorLost(void) {
+    pthread_mutex_lock(&simulatorLock);
+    uint64_t count = lost;
+    pthread_mutex_unlock(&simulatorLock);
+    return count;
+}
+
+/**
+ * Stops the thread and restores the backend used before. Must not
+ * be called while transactions are running.
+ */
+void stopAccelSimulator(void) {
+    if (previous == NULL) {
+        return;
+    }
+    __atomic_store_n(&running, 0, __ATOMIC_RELEASE);
+    pthread_join(thread, NULL);
+    i2cSetBackend(previous);
+    previous = NULL;
+    close(eventFd);
+    eventFd = -1;
+}
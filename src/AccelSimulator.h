@@ -0,0 +1,73 @@
+/**
+ * <Program>
+ * AccelSimulator.h
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ * Header file for the simulated ADXL345. The simulator is a backend
+ * of the I2C layer (see i2cSetBackend) answering the transactions
+ * to ADXL345_ADDRESS like the sensor, all other addresses go to the
+ * backend used before. It measures in real time from the monotonic
+ * clock at the configured output data rate into a FIFO of 32
+ * samples in stream mode, so a reader that is too slow overruns it
+ * like the real one, and raises INT1 on an eventfd whenever the
+ * FIFO reaches the watermark.
+ *
+ * The samples are made to check a stream without hardware:
+ *
+ *      x  number of the sample since the sensor started measuring
+ *         (modulo 2^16), every gap or repeated sample shows
+ *      y  0
+ *      z  1g plus a 10Hz sine of 0.25g
+ *
+ * Only the registers used by ADXL345_Accelerometer.c behave like
+ * the sensor, the others just keep what was written to them.
+ */
+
+#ifndef SRC_ACCELSIMULATOR_H
+#define SRC_ACCELSIMULATOR_H
+
+#include <inttypes.h>
+#include "ADXL345_Accelerometer.h"
+
+#define ACCEL_SIMULATOR_TICK_US 500     /* how often INT1 is updated */
+#define ACCEL_SIMULATOR_1G      256     /* LSB of 1g at full resolution */
+#define ACCEL_SIMULATOR_HZ      10.0    /* frequency of the sine on z */
+
+/* METHODS */
+
+/**
+ * Routes the transactions of the I2C layer through the simulator
+ * and starts the thread raising INT1. Must not be called while
+ * transactions are running.
+ *
+ * @return 0 on success, -1 on failure
+ */
+int startAccelSimulator(void);
+/**
+ * Returns the eventfd INT1 of the simulator is signalled on, for
+ * openFdEvent.
+ *
+ * @return eventfd, -1 if the simulator does not run
+ */
+int accelSimulatorEvent(void);
+/**
+ * Returns the number of samples the simulated FIFO overwrote
+ * before they were read, the exact loss the stream can only
+ * estimate.
+ *
+ * @return overwritten samples
+ */
+uint64_t accelSimulatorLost(void);
+/**
+ * Stops the thread and restores the backend used before. Must not
+ * be called while transactions are running.
+ */
+void stopAccelSimulator(void);
+
+#endif //SRC_ACCELSIMULATOR_H
@@ -0,0 +1,150 @@
+/**
+ * <Program>
+ * AccelStream.c
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ *  Acceleration stream of the ADXL345, a descriptor run by the stream
+ * engine (see SensorStream.h). The sensor measures into its FIFO in
+ * stream mode, the thread sleeps until the FIFO reaches the
+ * watermark and reads all samples in it one burst read after the
+ * other, then checks the FIFO again: samples measured meanwhile are
+ * read in the same wakeup until fewer than the watermark are left.
+ *  The event source is edge triggered, a missed edge would leave
+ * INT1 asserted and the thread asleep, so the thread drains the
+ * FIFO anyway if nothing happened for twice the time it takes to
+ * fill up to the watermark. Without an event source a periodic
+ * timerfd wakes it at half that time.
+ *
+ * <Sources>
+ * Accessed on 18.10.2026 - ADXL345 Datasheet:
+ *      https://www.analog.com/media/en/technical-documentation/data-sheets/ADXL345.pdf
+ */
+
+#include <math.h>
+#include "AccelStream.h"
+
+/**
+ * Reads the FIFO until fewer samples than the watermark are left,
+ * the first time whatever it holds. Every read of the FIFO state
+ * is the reference of the loss estimate of the next overrun: the
+ * samples left then plus the samples measured since.
+ */
+static void drainFifo(sensorStream *base) {
+    accelStream *stream = base->owner;
+    double periodUs = 1e6 / stream->rateHz;
+    uint64_t read = 0;
+
+    for (int first = 1;; first = 0) {
+        int entries, overrun;
+        if (readFifoState(base->fd, &entries, &overrun) != I2C_OK) {
+            streamError(base);
+            break;
+        }
+        int64_t nowUs = streamClockUs(CLOCK_MONOTONIC);
+        int64_t timeUs = streamClockUs(CLOCK_REALTIME);
+        if (overrun) {
+            __atomic_fetch_add(&stream->overruns, 1, __ATOMIC_RELAXED);
+            if (stream->lastDrainUs > 0) {
+                double lost = stream->leftover + (nowUs - stream->lastDrainUs) / periodUs - entries;
+                if (lost >= 1) {
+                    __atomic_fetch_add(&stream->dropped, (uint64_t) llround(lost), __ATOMIC_RELAXED);
+                }
+            }
+        }
+        if ((uint32_t) entries > __atomic_load_n(&stream->maxLevel, __ATOMIC_RELAXED)) {
+            __atomic_store_n(&stream->maxLevel, (uint32_t) entries, __ATOMIC_RELAXED);
+        }
+        stream->lastDrainUs = nowUs;
+        stream->leftover = entries;
+        if (entries == 0 || (!first && entries < stream->watermark)) {
+            break;
+        }
+
+        /* The newest sample was measured about now, the older ones one period apart before it */
+        for (int i = 0; i < entries; i++) {
+            accelSample sample;
+            if (readAccelSample(base->fd, &sample.data) != I2C_OK) {
+                streamError(base);
+                __atomic_fetch_add(&stream->samples, read, __ATOMIC_RELAXED);
+                return;
+            }
+            sample.time = timeUs - (int64_t) ((entries - 1 - i) * periodUs);
+            pushRing(&base->ring, &sample);
+            stream->leftover--;
+            read++;
+        }
+    }
+    if (read > 0) {
+        __atomic_fetch_add(&stream->samples, read, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&stream->drains, 1, __ATOMIC_RELAXED);
+    }
+}
+
+/* Checks the sensor and sets it up to measure into the FIFO */
+static int startAccel(sensorStream *base) {
+    accelStream *stream = base->owner;
+    int status;
+    if ((status = checkAccelerometer(base->fd)) != I2C_OK ||
+        (status = configureAccelerometer(base->fd, stream->rate, stream->watermark)) != I2C_OK) {
+        return status;
+    }
+    base->periodUs = (uint32_t) (500000.0 * stream->watermark / stream->rateHz);
+    base->timeoutMs = (int) (2000.0 * stream->watermark / stream->rateHz) + 1;
+    return I2C_OK;
+}
+
+static void stopAccel(sensorStream *base) {
+    standbyAccelerometer(base->fd);
+}
+
+/* The watermark, the timer and a silent INT1 all drain the FIFO */
+static const streamDriver accelStreamDriver = {
+        .name = "ADXL345",
+        .address = ADXL345_ADDRESS,
+        .recordSize = sizeof(accelSample),
+        .capacity = ACCEL_STREAM_CAPACITY,
+        .start = startAccel,
+        .due = drainFifo,
+        .stop = stopAccel
+};
+
+/**
+ * Opens and configures the sensor and starts the thread draining
+ * its FIFO.
+ *
+ * @param stream stream to start
+ * @param rate output data rate, one of the ADXL345_RATE_* codes
+ * @param watermark samples in the FIFO waking the thread, 1 to 31
+ * @param event source signalling the watermark (INT1), taken over
+ *        by the stream and closed by stopAccelStream, NULL to poll.
+ *        It stays with the caller if the stream does not start.
+ * @return 0 on success, -1 on failure
+ */
+int startAccelStream(accelStream *stream, int rate, int watermark, const sampleEvent *event) {
+    if (rate < ADXL345_RATE_100HZ || rate > ADXL345_RATE_3200HZ || watermark < 1 ||
+        watermark > ADXL345_FIFO_SAMPLES_MASK) {
+        return -1;
+    }
+    stream->rate = rate;
+    stream->watermark = watermark;
+    stream->rateHz = accelRateHz(rate);
+    stream->lastDrainUs = 0;
+    stream->leftover = 0;
+    return startSensorStream(&stream->stream, &accelStreamDriver, stream, event);
+}
+
+/**
+ * Stops the thread, puts the sensor to standby and closes it. The
+ * samples stay readable, a stream started again appends to them.
+ *
+ * @param stream started stream
+ */
+void stopAccelStream(accelStream *stream) {
+    stopSensorStream(&stream->stream);
+}
@@ -0,0 +1,101 @@
+/**
+ * <Program>
+ * AccelStream.h
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ * Header file for the acceleration stream of the ADXL345. The
+ * sensor measures into its FIFO at up to 3200Hz, a thread drains
+ * the FIFO into a ring buffer whenever the watermark is reached,
+ * for vibration and seismograph experiments. The thread sleeps
+ * until INT1 signals the watermark (see sampleEvent in
+ * SI1145_LightSensor.h); without the pin it polls at half the time
+ * the FIFO takes to fill up to the watermark.
+ *
+ * Every drain reads the FIFO until fewer samples than the watermark
+ * are left, so INT1 is released and signals the next watermark
+ * with a new edge. The samples are timestamped from the time of
+ * the drain and the output data rate, the newest one in the FIFO
+ * is taken as measured right then.
+ *
+ * Samples are counted as lost in two places: the FIFO overran
+ * because the thread did not drain it in time (overruns, and the
+ * number of samples estimated from the time since the last drain),
+ * or a reader of the ring buffer fell behind (see readRing).
+ *
+ * The bus has to be fast enough for the rate: every sample is a
+ * burst read of 6 bytes, about 90 bit times, so 1600Hz take a third
+ * of a 400kHz bus and do not fit on a 100kHz one.
+ *
+ * The thread also has to be woken in time: the FIFO holds 32 -
+ * watermark samples beyond the watermark, 10ms at 1600Hz with the
+ * default watermark but only 5ms at 3200Hz. On hosts with one CPU
+ * 3200Hz overran 1 to 14 times in 3 seconds against the simulator,
+ * so it is best effort. 1600Hz ran clean on one of them; on another,
+ * which overslept by up to 12ms, only with a watermark of 4 (17.5ms
+ * of slack, as in test/AccelStreamTest.c).
+ */
+
+#ifndef SRC_ACCELSTREAM_H
+#define SRC_ACCELSTREAM_H
+
+#include <inttypes.h>
+#include "ADXL345_Accelerometer.h"
+#include "SensorStream.h"
+
+#define ACCEL_STREAM_CAPACITY  65536  /* samples, about 40 seconds at 1600Hz */
+#define ACCEL_STREAM_RATE      ADXL345_RATE_1600HZ
+#define ACCEL_STREAM_WATERMARK 16     /* half of the FIFO, 10ms at 1600Hz */
+
+/* Used to hold an acceleration sample of the stream */
+typedef struct {
+    int64_t time;   /* us since epoch */
+    accelData data;
+} accelSample;
+
+/* Used to hold the stream, its settings and counters */
+typedef struct {
+    sensorStream stream;  /* accelSample records, the event source is INT1 */
+    int rate;             /* ADXL345_RATE_* code */
+    int watermark;
+    double rateHz;
+    /* Counters, accessed atomically */
+    uint64_t samples;     /* samples read from the FIFO */
+    uint64_t drains;      /* wakeups that read at least one sample */
+    uint64_t overruns;    /* drains that found the FIFO overran */
+    uint64_t dropped;     /* samples estimated to be lost in the overruns */
+    uint32_t maxLevel;    /* most samples found in the FIFO */
+    /* State of the thread */
+    int64_t lastDrainUs;  /* monotonic time the FIFO was last read */
+    int leftover;         /* samples left in the FIFO by the last drain */
+} accelStream;
+
+/* METHODS */
+
+/**
+ * Opens and configures the sensor and starts the thread draining
+ * its FIFO.
+ *
+ * @param stream stream to start
+ * @param rate output data rate, one of the ADXL345_RATE_* codes
+ * @param watermark samples in the FIFO waking the thread, 1 to 31
+ * @param event source signalling the watermark (INT1), taken over
+ *        by the stream and closed by stopAccelStream, NULL to poll.
+ *        It stays with the caller if the stream does not start.
+ * @return 0 on success, -1 on failure
+ */
+int startAccelStream(accelStream *stream, int rate, int watermark, const sampleEvent *event);
+/**
+ * Stops the thread, puts the sensor to standby and closes it. The
+ * samples stay readable, a stream started again appends to them.
+ *
+ * @param stream started stream
+ */
+void stopAccelStream(accelStream *stream);
+
+#endif //SRC_ACCELSTREAM_H
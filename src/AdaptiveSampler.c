@@ -0,0 +1,288 @@
+/**
+ * <Program>
+ * AdaptiveSampler.c
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ *  Adaptive sampling intervals. Every channel has an exponentially
+ * weighted mean and variance and the derivative between its last
+ * two values. Its interval is shortened multiplicatively while one
+ * of them is above its threshold and stretched again while both
+ * are below, so a transient is followed within a few reads and a
+ * calm room is read at the floor rate.
+ *  A group is read at the interval of its fastest channel. If the
+ * groups together would use more than the allowed share of the bus
+ * all intervals are stretched by the same factor.
+ *
+ * <Sources>
+ * Accessed on 18.10.2026 - Incremental calculation of weighted mean and variance (T. Finch):
+ *      https://fanf2.user.srcf.net/hermes/doc/antiforgery/stats.pdf
+ */
+
+#include <math.h>
+#include <string.h>
+#include "AdaptiveSampler.h"
+
+/**
+ * Initializes a sampler without groups. Every channel starts at
+ * maxMs.
+ *
+ * @param sampler sampler to initialize
+ * @param minMs shortest interval of a channel
+ * @param maxMs interval of a calm channel
+ * @param busShare share of the bus (0..1) all groups may use,
+ *        0 for no limit
+ * @return 0 on success, -1 if the arguments are invalid or the log
+ *         could not be allocated
+ */
+int openAdaptiveSampler(adaptiveSampler *sampler, uint32_t minMs, uint32_t maxMs, double busShare) {
+    memset(sampler, 0, sizeof(*sampler));
+    if (minMs == 0 || minMs > maxMs || busShare < 0 || busShare > 1) {
+        return -1;
+    }
+    sampler->minMs = minMs;
+    sampler->maxMs = maxMs;
+    sampler->busShare = busShare;
+    return openRing(&sampler->changes, sizeof(adaptiveChange), ADAPTIVE_CHANGES);
+}
+
+/**
+ * Adds a group of channels read together.
+ *
+ * @param sampler opened sampler
+ * @param name name of the group, must stay valid
+ * @param minMs shortest interval of the group
+ * @return index of the group, -1 if there are too many
+ */
+int addAdaptiveGroup(adaptiveSampler *sampler, const char *name, uint32_t minMs) {
+    if (sampler->groups >= ADAPTIVE_GROUPS_MAX) {
+        return -1;
+    }
+    adaptiveGroup *group = &sampler->group[sampler->groups];
+    memset(group, 0, sizeof(*group));
+    group->name = name;
+    group->minMs = minMs;
+    group->intervalMs = sampler->maxMs > minMs ? sampler->maxMs : minMs;
+    return sampler->groups++;
+}
+
+/**
+ * Adds a channel to a group.
+ *
+ * @param sampler opened sampler
+ * @param group index of the group
+ * @param name name of the channel, must stay valid
+ * @param rateThreshold change per second counting as active
+ * @param deviationThreshold standard deviation counting as active
+ * @return index of the channel, -1 if there are too many or the
+ *         group does not exist
+ */
+int addAdaptiveChannel(adaptiveSampler *sampler, int group, const char *name,
+                       double rateThreshold, double deviationThreshold) {
+    if (sampler->channels >= ADAPTIVE_CHANNELS_MAX || group < 0 || group >= sampler->groups) {
+        return -1;
+    }
+    adaptiveChannel *channel = &sampler->channel[sampler->channels];
+    memset(channel, 0, sizeof(*channel));
+    channel->name = name;
+    channel->group = group;
+    channel->rateThreshold = rateThreshold;
+    channel->deviationThreshold = deviationThreshold;
+    channel->intervalMs = sampler->maxMs;
+    return sampler->channels++;
+}
+
+/**
+ * Feeds a new value of a channel into its controller.
+ *
+ * @param sampler opened sampler
+ * @param channel index of the channel
+ * @param value value read
+ * @param timeUs time the value was read
+ */
+void updateAdaptiveChannel(adaptiveSampler *sampler, int channel, double value, int64_t timeUs) {
+    if (channel < 0 || channel >= sampler->channels) {
+        return;
+    }
+    adaptiveChannel *c = &sampler->channel[channel];
+    if (!c->primed || timeUs <= c->lastUs) {
+        if (!c->primed) {
+            c->mean = value;
+            c->variance = 0;
+            c->primed = 1;
+        }
+        c->last = value;
+        c->lastUs = timeUs;
+        return;
+    }
+
+    c->rate = (value - c->last) * 1e6 / (double) (timeUs - c->lastUs);
+    double difference = value - c->mean;
+    c->mean += ADAPTIVE_ALPHA * difference;
+    c->variance = (1 - ADAPTIVE_ALPHA) * (c->variance + ADAPTIVE_ALPHA * difference * difference);
+    c->last = value;
+    c->lastUs = timeUs;
+
+    double rate = c->rate < 0 ? -c->rate : c->rate;
+    int active = rate > c->rateThreshold ||
+                 c->variance > c->deviationThreshold * c->deviationThreshold;
+    /* Rounded up when stretched, so short intervals grow by at least 1ms instead of staying */
+    double interval = active ? c->intervalMs * ADAPTIVE_FASTER : ceil(c->intervalMs * ADAPTIVE_SLOWER);
+    if (interval < sampler->minMs) {
+        interval = sampler->minMs;
+    }
+    if (interval > sampler->maxMs) {
+        interval = sampler->maxMs;
+    }
+    c->intervalMs = (uint32_t) interval;
+}
+
+/**
+ * Records a read of a group, successful or not.
+ *
+ * @param sampler opened sampler
+ * @param group index of the group
+ * @param timeUs time of the read
+ * @param busUs bus time the read took
+ */
+void chargeAdaptiveGroup(adaptiveSampler *sampler, int group, int64_t timeUs, double busUs) {
+    if (group < 0 || group >= sampler->groups) {
+        return;
+    }
+    adaptiveGroup *g = &sampler->group[group];
+    g->busUs = g->reads == 0 ? busUs : g->busUs + ADAPTIVE_ALPHA * (busUs - g->busUs);
+    g->lastReadUs = timeUs;
+    g->reads++;
+}
+
+/**
+ * Sets the interval of every group from its channels and the bus
+ * limit and logs the changes. Called after the values of a read
+ * were fed in.
+ *
+ * @param sampler opened sampler
+ * @param nowUs current time
+ */
+void planAdaptiveSampler(adaptiveSampler *sampler, int64_t nowUs) {
+    double wanted[ADAPTIVE_GROUPS_MAX];
+    int cause[ADAPTIVE_GROUPS_MAX];
+    double share = 0;
+    for (int g = 0; g < sampler->groups; g++) {
+        wanted[g] = sampler->maxMs;
+        cause[g] = ADAPTIVE_BUS_LIMIT;
+        for (int c = 0; c < sampler->channels; c++) {
+            if (sampler->channel[c].group == g && (cause[g] < 0 || sampler->channel[c].intervalMs < wanted[g])) {
+                wanted[g] = sampler->channel[c].intervalMs;
+                cause[g] = c;
+            }
+        }
+        if (wanted[g] < sampler->group[g].minMs) {
+            wanted[g] = sampler->group[g].minMs;
+        }
+        share += sampler->group[g].busUs / (wanted[g] * 1000.0);
+    }
+
+    if (sampler->busShare > 0 && share > sampler->busShare) {
+        double factor = share / sampler->busShare;
+        for (int g = 0; g < sampler->groups; g++) {
+            wanted[g] = wanted[g] * factor + 1;
+            cause[g] = ADAPTIVE_BUS_LIMIT;
+        }
+        sampler->limited++;
+    }
+
+    for (int g = 0; g < sampler->groups; g++) {
+        adaptiveGroup *group = &sampler->group[g];
+        uint32_t interval = wanted[g] < UINT32_MAX ? (uint32_t) wanted[g] : UINT32_MAX;
+        if (interval != group->intervalMs) {
+            adaptiveChange change = {nowUs, g, cause[g], group->intervalMs, interval};
+            pushRing(&sampler->changes, &change);
+            group->intervalMs = interval;
+        }
+    }
+}
+
+/**
+ * Tells when a group is due.
+ *
+ * @param sampler opened sampler
+ * @param group index of the group
+ * @return time the group is due, 0 if it was never read
+ */
+int64_t adaptiveDue(const adaptiveSampler *sampler, int group) {
+    const adaptiveGroup *g = &sampler->group[group];
+    return g->lastReadUs == 0 ? 0 : g->lastReadUs + (int64_t) g->intervalMs * 1000;
+}
+
+/**
+ * Tells when the next read is due and which groups to read then.
+ *
+ * @param sampler opened sampler
+ * @param groups receives a bit (1 << group) of every group due
+ *        within ADAPTIVE_GATHER_MS of the next read
+ * @return time of the next read, 0 if a group was never read
+ */
+int64_t nextAdaptiveRead(const adaptiveSampler *sampler, unsigned int *groups) {
+    int64_t due[ADAPTIVE_GROUPS_MAX];
+    int64_t next = INT64_MAX;
+    for (int g = 0; g < sampler->groups; g++) {
+        due[g] = adaptiveDue(sampler, g);
+        if (due[g] < next) {
+            next = due[g];
+        }
+    }
+
+    *groups = 0;
+    for (int g = 0; g < sampler->groups; g++) {
+        if (due[g] <= next + ADAPTIVE_GATHER_MS * 1000) {
+            *groups |= 1u << g;
+        }
+    }
+    return next;
+}
+
+/**
+ * Returns the share of the bus the groups use at their current
+ * intervals.
+ *
+ * @param sampler opened sampler
+ * @return share of the bus (0..1)
+ */
+double adaptiveBusShare(const adaptiveSampler *sampler) {
+    double share = 0;
+    for (int g = 0; g < sampler->groups; g++) {
+        share += sampler->group[g].busUs / (sampler->group[g].intervalMs * 1000.0);
+    }
+    return share;
+}
+
+/**
+ * Copies the changes logged after the cursor, like readRing.
+ *
+ * @param sampler opened sampler
+ * @param cursor position of the reader
+ * @param changes receives the changes
+ * @param max maximum number of changes to copy
+ * @param lost receives the number of changes overwritten before they were read
+ * @return number of copied changes
+ */
+size_t readAdaptiveChanges(const adaptiveSampler *sampler, uint64_t *cursor, adaptiveChange *changes,
+                           size_t max, uint64_t *lost) {
+    return readRing(&sampler->changes, cursor, changes, max, lost);
+}
+
+/**
+ * Frees the log of a sampler.
+ *
+ * @param sampler opened sampler
+ */
+void closeAdaptiveSampler(adaptiveSampler *sampler) {
+    closeRing(&sampler->changes);
+    sampler->groups = 0;
+    sampler->channels = 0;
+}
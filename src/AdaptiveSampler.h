@@ -0,0 +1,208 @@
+/**
+ * <Program>
+ * AdaptiveSampler.h
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ * Header file for adaptive sampling. Instead of reading every
+ * sensor at a fixed period, every channel has a controller that
+ * shortens its interval while the signal moves and stretches it
+ * again while it is calm:
+ *
+ *      active  |derivative| > rateThreshold or
+ *              standard deviation > deviationThreshold
+ *              interval * ADAPTIVE_FASTER, down to minMs
+ *      calm    interval * ADAPTIVE_SLOWER rounded up, up to maxMs
+ *
+ * The derivative is taken between the last two values, mean and
+ * variance are exponentially weighted (ADAPTIVE_ALPHA), so a
+ * transient keeps the rate up for a few more reads.
+ *
+ * Channels belong to a group, the sensor they are read from. A
+ * group is read at the interval of its fastest channel, never
+ * faster than its own minMs (i. e. the data rate of the sensor).
+ * The average bus time of a read of every group is tracked, if
+ * the groups together would use more than busShare of the bus all
+ * intervals are stretched until they fit, even beyond maxMs.
+ *
+ * Every change of the interval of a group is logged into a ring
+ * buffer of adaptiveChange records.
+ */
+
+#ifndef SRC_ADAPTIVESAMPLER_H
+#define SRC_ADAPTIVESAMPLER_H
+
+#include <inttypes.h>
+#include "RingBuffer.h"
+
+#define ADAPTIVE_GROUPS_MAX   8
+#define ADAPTIVE_CHANNELS_MAX 16
+#define ADAPTIVE_CHANGES      256   /* rate changes kept in the log */
+#define ADAPTIVE_ALPHA        0.2   /* weight of a new value in mean and variance */
+#define ADAPTIVE_FASTER       0.5
+#define ADAPTIVE_SLOWER       1.25
+#define ADAPTIVE_GATHER_MS    500   /* groups due within this time are read together */
+#define ADAPTIVE_BUS_LIMIT    -1    /* channel of a change caused by the bus limit */
+
+/* Used to hold the controller of a single channel */
+typedef struct {
+    const char *name;
+    int group;
+    double rateThreshold;       /* change per second counting as active */
+    double deviationThreshold;  /* standard deviation counting as active */
+
+    int primed;                 /* 0 until the first value */
+    double last;
+    int64_t lastUs;
+    double mean;
+    double variance;
+    double rate;                /* last derivative per second */
+    uint32_t intervalMs;
+} adaptiveChannel;
+
+/* Used to hold a group of channels read together */
+typedef struct {
+    const char *name;
+    uint32_t minMs;             /* the group is never read faster */
+    uint32_t intervalMs;
+    int64_t lastReadUs;         /* 0 before the first read */
+    double busUs;               /* average bus time of a read */
+    uint64_t reads;
+} adaptiveGroup;
+
+/* Used to log a change of the interval of a group */
+typedef struct {
+    int64_t timeUs;
+    int32_t group;
+    int32_t channel;            /* fastest channel, ADAPTIVE_BUS_LIMIT if stretched to fit the bus */
+    uint32_t fromMs;
+    uint32_t toMs;
+} adaptiveChange;
+
+/* Used to hold all controllers */
+typedef struct {
+    uint32_t minMs;
+    uint32_t maxMs;
+    double busShare;            /* share of the bus all groups may use, 0 for no limit */
+    int groups;
+    int channels;
+    adaptiveGroup group[ADAPTIVE_GROUPS_MAX];
+    adaptiveChannel channel[ADAPTIVE_CHANNELS_MAX];
+    ringBuffer changes;
+    uint64_t limited;           /* plans stretched to fit the bus */
+} adaptiveSampler;
+
+/* METHODS */
+
+/**
+ * Initializes a sampler without groups. Every channel starts at
+ * maxMs.
+ *
+ * @param sampler sampler to initialize
+ * @param minMs shortest interval of a channel
+ * @param maxMs interval of a calm channel
+ * @param busShare share of the bus (0..1) all groups may use,
+ *        0 for no limit
+ * @return 0 on success, -1 if the arguments are invalid or the log
+ *         could not be allocated
+ */
+int openAdaptiveSampler(adaptiveSampler *sampler, uint32_t minMs, uint32_t maxMs, double busShare);
+/**
+ * Adds a group of channels read together.
+ *
+ * @param sampler opened sampler
+ * @param name name of the group, must stay valid
+ * @param minMs shortest interval of the group
+ * @return index of the group, -1 if there are too many
+ */
+int addAdaptiveGroup(adaptiveSampler *sampler, const char *name, uint32_t minMs);
+/**
+ * Adds a channel to a group.
+ *
+ * @param sampler opened sampler
+ * @param group index of the group
+ * @param name name of the channel, must stay valid
+ * @param rateThreshold change per second counting as active
+ * @param deviationThreshold standard deviation counting as active
+ * @return index of the channel, -1 if there are too many or the
+ *         group does not exist
+ */
+int addAdaptiveChannel(adaptiveSampler *sampler, int group, const char *name,
+                       double rateThreshold, double deviationThreshold);
+/**
+ * Feeds a new value of a channel into its controller.
+ *
+ * @param sampler opened sampler
+ * @param channel index of the channel
+ * @param value value read
+ * @param timeUs time the value was read
+ */
+void updateAdaptiveChannel(adaptiveSampler *sampler, int channel, double value, int64_t timeUs);
+/**
+ * Records a read of a group, successful or not.
+ *
+ * @param sampler opened sampler
+ * @param group index of the group
+ * @param timeUs time of the read
+ * @param busUs bus time the read took
+ */
+void chargeAdaptiveGroup(adaptiveSampler *sampler, int group, int64_t timeUs, double busUs);
+/**
+ * Sets the interval of every group from its channels and the bus
+ * limit and logs the changes. Called after the values of a read
+ * were fed in.
+ *
+ * @param sampler opened sampler
+ * @param nowUs current time
+ */
+void planAdaptiveSampler(adaptiveSampler *sampler, int64_t nowUs);
+/**
+ * Tells when a group is due.
+ *
+ * @param sampler opened sampler
+ * @param group index of the group
+ * @return time the group is due, 0 if it was never read
+ */
+int64_t adaptiveDue(const adaptiveSampler *sampler, int group);
+/**
+ * Tells when the next read is due and which groups to read then.
+ *
+ * @param sampler opened sampler
+ * @param groups receives a bit (1 << group) of every group due
+ *        within ADAPTIVE_GATHER_MS of the next read
+ * @return time of the next read, 0 if a group was never read
+ */
+int64_t nextAdaptiveRead(const adaptiveSampler *sampler, unsigned int *groups);
+/**
+ * Returns the share of the bus the groups use at their current
+ * intervals.
+ *
+ * @param sampler opened sampler
+ * @return share of the bus (0..1)
+ */
+double adaptiveBusShare(const adaptiveSampler *sampler);
+/**
+ * Copies the changes logged after the cursor, like readRing.
+ *
+ * @param sampler opened sampler
+ * @param cursor position of the reader
+ * @param changes receives the changes
+ * @param max maximum number of changes to copy
+ * @param lost receives the number of changes overwritten before they were read
+ * @return number of copied changes
+ */
+size_t readAdaptiveChanges(const adaptiveSampler *sampler, uint64_t *cursor, adaptiveChange *changes,
+                           size_t max, uint64_t *lost);
+/**
+ * Frees the log of a sampler.
+ *
+ * @param sampler opened sampler
+ */
+void closeAdaptiveSampler(adaptiveSampler *sampler);
+
+#endif //SRC_ADAPTIVESAMPLER_H
@@ -0,0 +1,166 @@
+/**
+ * <Program>
+ * AirBaseline.c
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ *  Keeps the baseline of the CCS811 in a small text file, the value
+ * in hex and the time it was saved:
+ *
+ *      a5c3 1792329600
+ *
+ *  The age is checked against the wall clock. A box without a real
+ * time clock may come up with a time before the one in the file,
+ * so the age counts in both directions.
+ *
+ * <Sources>
+ * Accessed on 18.10.2026 - CCS811 Datasheet:
+ *      https://cdn.sparkfun.com/assets/learn_tutorials/1/4/3/CCS811_Datasheet-DS000459.pdf
+ * Accessed on 18.10.2026 - rename(2):
+ *      https://man7.org/linux/man-pages/man2/rename.2.html
+ */
+
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include "CCS811_AirSensor.h"
+#include "AirBaseline.h"
+
+/**
+ * Returns the current time of the monotonic clock in microseconds.
+ */
+static int64_t monotonicUs(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/**
+ * Reads the saved baseline.
+ *
+ * @param path file the baseline is kept in
+ * @param baseline read value
+ * @param savedTime time it was saved, s since epoch
+ * @return 0 on success, -1 if there is no valid file
+ */
+int loadAirBaseline(const char *path, uint16_t *baseline, int64_t *savedTime) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        return -1;
+    }
+    unsigned int value;
+    long long time;
+    int fields = fscanf(file, "%x %lld", &value, &time);
+    fclose(file);
+    if (fields != 2 || value > 0xFFFF) {
+        return -1;
+    }
+    *baseline = (uint16_t) value;
+    *savedTime = time;
+    return 0;
+}
+
+/**
+ * Saves the baseline with the current time. The file is replaced
+ * atomically, so a power cut leaves the old or the new value.
+ *
+ * @param path file the baseline is kept in
+ * @param baseline value to save
+ * @return 0 on success, -1 on failure
+ */
+int saveAirBaseline(const char *path, uint16_t baseline) {
+    char temporary[512];
+    snprintf(temporary, sizeof(temporary), "%s.%d.tmp", path, (int) getpid());
+    FILE *file = fopen(temporary, "w");
+    if (file == NULL) {
+        return -1;
+    }
+
+    fprintf(file, "%04x %lld\n", baseline, (long long) time(NULL));
+    if (fflush(file) != 0 || fsync(fileno(file)) < 0) {
+        fclose(file);
+        unlink(temporary);
+        return -1;
+    }
+    if (fclose(file) != 0 || rename(temporary, path) < 0) {
+        unlink(temporary);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Called when the sensor was set up: writes the saved baseline to
+ * the sensor if it is recent enough.
+ *
+ * @param store state of the baseline
+ * @param sensor sensor ID
+ * @return I2C_OK on success or if nothing was restored, I2C_ERROR
+ *         or I2C_BREAKER_OPEN if the sensor could not be written
+ */
+int restoreAirBaseline(airBaselineStore *store, int sensor) {
+    store->readyUs = monotonicUs();
+    store->checkedUs = 0;
+    store->savedUs = 0;
+    store->restored = 0;
+    if (store->path == NULL) {
+        return I2C_OK;
+    }
+
+    uint16_t baseline;
+    int64_t savedTime;
+    if (loadAirBaseline(store->path, &baseline, &savedTime) < 0) {
+        return I2C_OK;
+    }
+    int64_t age = (int64_t) time(NULL) - savedTime;
+    if (age > AIR_BASELINE_MAX_AGE_S || age < -AIR_BASELINE_MAX_AGE_S) {
+        return I2C_OK;
+    }
+
+    int status = writeAirBaseline(sensor, baseline);
+    if (status == I2C_OK) {
+        store->value = baseline;
+        store->restored = 1;
+    }
+    return status;
+}
+
+/**
+ * Called after every valid result: saves the baseline of the
+ * sensor if it is due. A file that cannot be written is ignored,
+ * it is tried again next time.
+ *
+ * @param store state of the baseline
+ * @param sensor sensor ID
+ * @return I2C_OK on success or if nothing was due, I2C_ERROR or
+ *         I2C_BREAKER_OPEN if the sensor could not be read
+ */
+int keepAirBaseline(airBaselineStore *store, int sensor) {
+    int64_t now = monotonicUs();
+    if (store->path == NULL || now - store->readyUs < (int64_t) AIR_BASELINE_SETTLE_S * 1000000 ||
+        (store->checkedUs > 0 && now - store->checkedUs < (int64_t) AIR_BASELINE_SAVE_S * 1000000)) {
+        return I2C_OK;
+    }
+
+    uint16_t baseline;
+    int status = readAirBaseline(sensor, &baseline);
+    if (status != I2C_OK) {
+        return status;
+    }
+    store->checkedUs = now;
+    if (store->savedUs > 0 && baseline == store->value &&
+        now - store->savedUs < (int64_t) AIR_BASELINE_REFRESH_S * 1000000) {
+        return I2C_OK;
+    }
+    if (saveAirBaseline(store->path, baseline) == 0) {
+        store->value = baseline;
+        store->savedUs = now;
+        store->saves++;
+    }
+    return I2C_OK;
+}
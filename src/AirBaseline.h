@@ -0,0 +1,94 @@
+/**
+ * <Program>
+ * AirBaseline.h
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ * Header file for keeping the baseline of the CCS811 across
+ * restarts. The algorithm of the sensor learns its baseline again
+ * after every power up, which takes a long time until eCO2 and
+ * TVOC can be trusted. The learned BASELINE is saved to a file
+ * now and then and written back to the sensor when it is set up,
+ * if the saved value is recent enough.
+ *
+ * To spare the SD card, a value is saved at most once per
+ * AIR_BASELINE_SAVE_S, an unchanged value only once per
+ * AIR_BASELINE_REFRESH_S, and nothing is saved before the sensor
+ * ran for AIR_BASELINE_SETTLE_S, so a baseline that is not learned
+ * yet never replaces a good one.
+ *
+ * <Sources>
+ * Accessed on 18.10.2026 - CCS811 Datasheet:
+ *      https://cdn.sparkfun.com/assets/learn_tutorials/1/4/3/CCS811_Datasheet-DS000459.pdf
+ */
+
+#ifndef SRC_AIRBASELINE_H
+#define SRC_AIRBASELINE_H
+
+#include <inttypes.h>
+
+#define AIR_BASELINE_FILE      "ccs811_baseline"
+#define AIR_BASELINE_MAX_AGE_S (7 * 24 * 3600) /* older values are not restored */
+#define AIR_BASELINE_SETTLE_S  (20 * 60)       /* run time before the first save */
+#define AIR_BASELINE_SAVE_S    3600            /* minimum time between two saves */
+#define AIR_BASELINE_REFRESH_S (24 * 3600)     /* time after which an unchanged value is saved again */
+
+/* Used to hold the state of the baseline of one sensor */
+typedef struct {
+    const char *path;   /* file the baseline is kept in, NULL to keep none */
+    int64_t readyUs;    /* monotonic time the sensor was set up */
+    int64_t checkedUs;  /* monotonic time the baseline was last read, 0 if never */
+    int64_t savedUs;    /* monotonic time the baseline was last saved, 0 if never */
+    uint16_t value;     /* value last saved or restored */
+    int restored;       /* 1 if the value was restored when the sensor was set up */
+    uint32_t saves;     /* number of times the file was written */
+} airBaselineStore;
+
+/* METHODS */
+
+/**
+ * Reads the saved baseline.
+ *
+ * @param path file the baseline is kept in
+ * @param baseline read value
+ * @param savedTime time it was saved, s since epoch
+ * @return 0 on success, -1 if there is no valid file
+ */
+int loadAirBaseline(const char *path, uint16_t *baseline, int64_t *savedTime);
+/**
+ * Saves the baseline with the current time. The file is replaced
+ * atomically, so a power cut leaves the old or the new value.
+ *
+ * @param path file the baseline is kept in
+ * @param baseline value to save
+ * @return 0 on success, -1 on failure
+ */
+int saveAirBaseline(const char *path, uint16_t baseline);
+/**
+ * Called when the sensor was set up: writes the saved baseline to
+ * the sensor if it is recent enough.
+ *
+ * @param store state of the baseline
+ * @param sensor sensor ID
+ * @return I2C_OK on success or if nothing was restored, I2C_ERROR
+ *         or I2C_BREAKER_OPEN if the sensor could not be written
+ */
+int restoreAirBaseline(airBaselineStore *store, int sensor);
+/**
+ * Called after every valid result: saves the baseline of the
+ * sensor if it is due. A file that cannot be written is ignored,
+ * it is tried again next time.
+ *
+ * @param store state of the baseline
+ * @param sensor sensor ID
+ * @return I2C_OK on success or if nothing was due, I2C_ERROR or
+ *         I2C_BREAKER_OPEN if the sensor could not be read
+ */
+int keepAirBaseline(airBaselineStore *store, int sensor);
+
+#endif //SRC_AIRBASELINE_H
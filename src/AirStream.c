@@ -0,0 +1,72 @@
+/**
+ * <Program>
+ * AirStream.c
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ *  Raw stream of the CCS811 in the 250ms drive mode, a descriptor
+ * run by the stream engine (see SensorStream.h). The timer wakes
+ * the thread every 250ms, RAW_DATA is read and appended to the ring
+ * buffer with its timestamp. The timer runs independently of the sensor, so a sample may occasionally be
+ * read twice or skipped when the two drift apart; the timestamps
+ * show it.
+ *
+ * <Sources>
+ * Accessed on 18.10.2026 - CCS811 Datasheet:
+ *      https://cdn.sparkfun.com/assets/learn_tutorials/1/4/3/CCS811_Datasheet-DS000459.pdf
+ */
+
+#include "CCS811_AirSensor.h"
+#include "AirStream.h"
+
+/* Reads RAW_DATA on every expiration of the timer */
+static void readAirSample(sensorStream *stream) {
+    airRawSample sample;
+    sample.time = streamClockUs(CLOCK_REALTIME);
+    if (readAirRaw(stream->fd, &sample.raw) != I2C_OK) {
+        streamError(stream);
+        return;
+    }
+    pushRing(&stream->ring, &sample);
+}
+
+/* The sensor loop set the 250ms drive mode, there is nothing to configure */
+static int startAir(sensorStream *stream) {
+    stream->periodUs = AIR_STREAM_PERIOD_US;
+    return I2C_OK;
+}
+
+static const streamDriver airStreamDriver = {
+        .name = "CCS811 raw",
+        .address = CCS811_ADDRESS,
+        .recordSize = sizeof(airRawSample),
+        .capacity = AIR_STREAM_CAPACITY,
+        .start = startAir,
+        .due = readAirSample
+};
+
+/**
+ * Opens the sensor and starts the thread reading RAW_DATA every
+ * AIR_STREAM_PERIOD_US.
+ *
+ * @param stream stream to start
+ * @return 0 on success, -1 on failure
+ */
+int startAirStream(airStream *stream) {
+    return startSensorStream(&stream->stream, &airStreamDriver, stream, NULL);
+}
+
+/**
+ * Stops the thread and closes the sensor. The thread notices it
+ * with the next expiration of its timer.
+ *
+ * @param stream started stream
+ */
+void stopAirStream(airStream *stream) {
+    stopSensorStream(&stream->stream);
+}
@@ -0,0 +1,58 @@
+/**
+ * <Program>
+ * AirStream.h
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ * Header file for the raw stream of the CCS811. While the sensor
+ * runs in the 250ms drive mode, a thread reads RAW_DATA every
+ * 250ms into a ring buffer, so fast VOC transients are captured
+ * independently of how often the sensor loop runs. The thread
+ * opens the sensor on its own file descriptor, the sensor loop
+ * stays in charge of the setup and the drive mode.
+ */
+
+#ifndef SRC_AIRSTREAM_H
+#define SRC_AIRSTREAM_H
+
+#include <inttypes.h>
+#include "SensorStream.h"
+
+#define AIR_STREAM_CAPACITY  4096   /* samples, about 17 minutes */
+#define AIR_STREAM_PERIOD_US 250000
+
+/* Used to hold a raw sample of the stream */
+typedef struct {
+    int64_t time;   /* us since epoch */
+    uint16_t raw;   /* RAW_DATA, see CCS811_RAW_CURRENT and CCS811_RAW_VOLTAGE */
+} airRawSample;
+
+/* Used to hold the stream */
+typedef struct {
+    sensorStream stream;  /* airRawSample records */
+} airStream;
+
+/* METHODS */
+
+/**
+ * Opens the sensor and starts the thread reading RAW_DATA every
+ * AIR_STREAM_PERIOD_US.
+ *
+ * @param stream stream to start
+ * @return 0 on success, -1 on failure
+ */
+int startAirStream(airStream *stream);
+/**
+ * Stops the thread and closes the sensor. The samples stay
+ * readable, a stream started again appends to them.
+ *
+ * @param stream started stream
+ */
+void stopAirStream(airStream *stream);
+
+#endif //SRC_AIRSTREAM_H
@@ -14,7 +14,9 @@
  * It is capable of reading the compensation parameters,
  * read raw temperature, humidity and pressure and
  * calculate the real world values using the compensation
- * params.
+ * params. The IIR filter and the standby time of the normal
+ * mode are set in the config register, presets give the
+ * recommended modes of operation of the datasheet.
  *  Additionally this class holds the methods to communicate
  * with Python software using the CPython library. Although
  * just real world values can be fetched that way.
@@ -28,7 +30,11 @@
  *      https://github.com/andreiva/raspberry-pi-bme280
  */
 
+#ifndef SENSOR_NO_PYTHON
 #include <Python.h>
+#endif
+#include <stdio.h>
+#include <unistd.h>
 #include "BME280_TempSensor.h"
 
 /**
@@ -36,20 +42,56 @@
  * 0x60 for the BME280 sensor.
  *
  * @param sensor sensor ID
+ * @param chipID read chip ID
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
  */
-int8_t readChipID(int sensor) {
-    int8_t chipID = (int8_t) wiringPiI2CReadReg8(sensor, CHIPID);
-    return chipID;
+int readChipID(int sensor, uint8_t *chipID) {
+    return i2cTryReadReg8(sensor, CHIPID, chipID);
 }
 
 /**
  * Read the Version from register 0xD1.
  *
  * @param sensor sensor ID
+ * @param version read version
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
  */
-int8_t readVersion(int sensor) {
-    int8_t version = (int8_t) wiringPiI2CReadReg8(sensor, VERSION);
-    return version;
+int readVersion(int sensor, uint8_t *version) {
+    return i2cTryReadReg8(sensor, VERSION, version);
+}
+
+/**
+ * Reads an 8 bit parameter unless an earlier read already failed,
+ * so all parameters can be read in a row and checked once.
+ *
+ * @param sensor sensor ID
+ * @param reg register of the parameter
+ * @param status status of the earlier reads, updated on failure
+ * @return read value, 0 on failure
+ */
+static uint8_t readParam8(int sensor, int reg, int *status) {
+    uint8_t value = 0;
+    if (*status == I2C_OK) {
+        *status = i2cTryReadReg8(sensor, reg, &value);
+    }
+    return value;
+}
+
+/**
+ * Reads a 16 bit parameter (LSB first) unless an earlier read
+ * already failed.
+ *
+ * @param sensor sensor ID
+ * @param reg register of the parameter
+ * @param status status of the earlier reads, updated on failure
+ * @return read value, 0 on failure
+ */
+static uint16_t readParam16(int sensor, int reg, int *status) {
+    uint16_t value = 0;
+    if (*status == I2C_OK) {
+        *status = i2cTryReadReg16(sensor, reg, &value);
+    }
+    return value;
 }
 
 /**
@@ -60,51 +102,53 @@ int8_t readVersion(int sensor) {
  * and 0xE1 to 0xE7. Parameters taken from BME280 data sheet page 22.
  *
  * @param sensor sensor ID
+ * @param data read compensation parameters
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
  */
-compParam readCompensationParam(int sensor) {
-    compParam data;
+int readCompensationParam(int sensor, compParam *data) {
+    int status = I2C_OK;
 
     /*
      * Temperature parameters
      */
-    data.dig_T1 = (uint16_t) wiringPiI2CReadReg16(sensor, DIG_T1);
-    data.dig_T2 = (int16_t) wiringPiI2CReadReg16(sensor, DIG_T2);
-    data.dig_T3 = (int16_t) wiringPiI2CReadReg16(sensor, DIG_T3);
+    data->dig_T1 = (uint16_t) readParam16(sensor, DIG_T1, &status);
+    data->dig_T2 = (int16_t) readParam16(sensor, DIG_T2, &status);
+    data->dig_T3 = (int16_t) readParam16(sensor, DIG_T3, &status);
 
     /*
      * Pressure parameters
      */
-    data.dig_P1 = (uint16_t) wiringPiI2CReadReg16(sensor, DIG_P1);
-    data.dig_P2 = (int16_t) wiringPiI2CReadReg16(sensor, DIG_P2);
-    data.dig_P3 = (uint16_t) wiringPiI2CReadReg16(sensor, DIG_P3);
-    data.dig_P4 = (uint16_t) wiringPiI2CReadReg16(sensor, DIG_P4);
-    data.dig_P5 = (uint16_t) wiringPiI2CReadReg16(sensor, DIG_P5);
-    data.dig_P6 = (uint16_t) wiringPiI2CReadReg16(sensor, DIG_P6);
-    data.dig_P7 = (uint16_t) wiringPiI2CReadReg16(sensor, DIG_P7);
-    data.dig_P8 = (uint16_t) wiringPiI2CReadReg16(sensor, DIG_P8);
-    data.dig_P9 = (uint16_t) wiringPiI2CReadReg16(sensor, DIG_P9);
+    data->dig_P1 = (uint16_t) readParam16(sensor, DIG_P1, &status);
+    data->dig_P2 = (int16_t) readParam16(sensor, DIG_P2, &status);
+    data->dig_P3 = (uint16_t) readParam16(sensor, DIG_P3, &status);
+    data->dig_P4 = (uint16_t) readParam16(sensor, DIG_P4, &status);
+    data->dig_P5 = (uint16_t) readParam16(sensor, DIG_P5, &status);
+    data->dig_P6 = (uint16_t) readParam16(sensor, DIG_P6, &status);
+    data->dig_P7 = (uint16_t) readParam16(sensor, DIG_P7, &status);
+    data->dig_P8 = (uint16_t) readParam16(sensor, DIG_P8, &status);
+    data->dig_P9 = (uint16_t) readParam16(sensor, DIG_P9, &status);
 
     /*
      * Humidity parameters
      */
-    data.dig_H1 = (uint8_t) wiringPiI2CReadReg8(sensor, DIG_H1);
-    data.dig_H2 = (int16_t) wiringPiI2CReadReg16(sensor, DIG_H2);
-    data.dig_H3 = (uint8_t) wiringPiI2CReadReg8(sensor, DIG_H3);
+    data->dig_H1 = readParam8(sensor, DIG_H1, &status);
+    data->dig_H2 = (int16_t) readParam16(sensor, DIG_H2, &status);
+    data->dig_H3 = readParam8(sensor, DIG_H3, &status);
 
     /*
      * Each, H4 and H5, are saved in two different memory addresses
      * and it is necessary to bitshift ([3:0], [11:4]) to get the
      * right value.
      */
-    data.dig_H4 = wiringPiI2CReadReg8(sensor, DIG_H4) << 4;
-    data.dig_H4 = data.dig_H4 | wiringPiI2CReadReg8(sensor, DIG_H4 + 1) & 0xF;
+    data->dig_H4 = readParam8(sensor, DIG_H4, &status) << 4;
+    data->dig_H4 = data->dig_H4 | (readParam8(sensor, DIG_H4 + 1, &status) & 0xF);
 
-    data.dig_H5 = wiringPiI2CReadReg8(sensor, DIG_H5);
-    data.dig_H5 = data.dig_H5 | wiringPiI2CReadReg8(sensor, DIG_H5 + 1) << 4;
+    data->dig_H5 = readParam8(sensor, DIG_H5, &status);
+    data->dig_H5 = data->dig_H5 | readParam8(sensor, DIG_H5 + 1, &status) << 4;
 
-    data.dig_H6 = (int8_t) wiringPiI2CReadReg8(sensor, DIG_H6);
+    data->dig_H6 = (int8_t) readParam8(sensor, DIG_H6, &status);
 
-    return data;
+    return status;
 }
 
 /**
@@ -120,12 +164,165 @@ compParam readCompensationParam(int sensor) {
  * @param tempOs temperature oversampling value
  * @param pressOs pressure oversampling value
  * @param mode setting mode value
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
  */
-void setOversampling(int sensor, int humOs, int tempOs, int pressOs, int mode) {
-    wiringPiI2CWriteReg8(sensor, CONTROLHUMID, humOs);
+int setOversampling(int sensor, int humOs, int tempOs, int pressOs, int mode) {
+    int status = i2cTryWriteReg8(sensor, CONTROLHUMID, humOs);
+    if (status != I2C_OK) {
+        return status;
+    }
 
     int controlMeas = tempOs << 5 | pressOs << 2 | mode;
-    wiringPiI2CWriteReg8(sensor, CONTROL_MEAS, controlMeas);
+    return i2cTryWriteReg8(sensor, CONTROL_MEAS, controlMeas);
+}
+
+/**
+ * Sets the standby time of the normal mode and the coefficient of
+ * the IIR filter in the config register 0xF5. Writes to it may be
+ * ignored in normal mode (see p. 30), use applySettings to change
+ * it in normal mode.
+ *
+ * @param sensor sensor ID
+ * @param standby standby time, one of the STANDBY_* values
+ * @param filter filter coefficient, one of the FILTER_* values
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int setConfig(int sensor, int standby, int filter) {
+    /* spi3w_en (bit 0) stays off */
+    int config = (standby & 0x07) << 5 | (filter & 0x07) << 2;
+    return i2cTryWriteReg8(sensor, CONFIG, config);
+}
+
+/**
+ * Writes all measurement settings. The sensor is put to sleep
+ * first, so the config register is taken in any mode. In normal
+ * mode the sensor starts measuring continuously, in forced mode it
+ * keeps sleeping until startForcedMeasurement.
+ *
+ * @param sensor sensor ID
+ * @param settings settings to write
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int applySettings(int sensor, const envSettings *settings) {
+    int status = setOversampling(sensor, settings->humOs, settings->tempOs, settings->pressOs, MODE_SLEEP);
+    if (status != I2C_OK) {
+        return status;
+    }
+    if ((status = setConfig(sensor, settings->standby, settings->filter)) != I2C_OK) {
+        return status;
+    }
+    if (settings->mode == MODE_NORMAL) {
+        status = setOversampling(sensor, settings->humOs, settings->tempOs, settings->pressOs, MODE_NORMAL);
+    }
+    return status;
+}
+
+/**
+ * Fills in the settings of one of the recommended modes of
+ * operation of the datasheet.
+ *
+ * @param preset one of the PRESET_* values
+ * @param settings receives the settings
+ * @return 0 on success, -1 if the preset is unknown
+ */
+int presetSettings(int preset, envSettings *settings) {
+    /* Oversampling of humidity, temperature and pressure, filter, standby and mode of section 3.5 */
+    static const envSettings presets[] = {
+            {1, 1, 1, FILTER_OFF, STANDBY_1000MS, MODE_FORCED},
+            {1, 1, 0, FILTER_OFF, STANDBY_1000MS, MODE_FORCED},
+            {1, 2, 5, FILTER_16,  STANDBY_0_5MS,  MODE_NORMAL},
+            {0, 1, 3, FILTER_16,  STANDBY_0_5MS,  MODE_NORMAL}
+    };
+    if (preset < 0 || preset >= (int) (sizeof(presets) / sizeof(presets[0]))) {
+        return -1;
+    }
+    *settings = presets[preset];
+    return 0;
+}
+
+/**
+ * Standby time of the normal mode.
+ *
+ * @param standby one of the STANDBY_* values
+ * @return standby time in us
+ */
+uint32_t standbyTime(int standby) {
+    static const uint32_t times[] = {500, 62500, 125000, 250000, 500000, 1000000, 10000, 20000};
+    return times[standby & 0x07];
+}
+
+/**
+ * Time between two measurements in normal mode, the measurement
+ * time plus the standby time (see p. 50).
+ *
+ * @param settings settings of the sensor
+ * @return period in us
+ */
+uint32_t outputPeriod(const envSettings *settings) {
+    return measurementTime(settings->humOs, settings->tempOs, settings->pressOs) + standbyTime(settings->standby);
+}
+
+/**
+ * Factor of an oversampling value, 0 if the measurement is skipped.
+ */
+static uint32_t oversamplingFactor(int os) {
+    return os <= 0 ? 0 : 1u << ((os > 5 ? 5 : os) - 1);
+}
+
+/**
+ * Maximum time a measurement takes with the given oversampling
+ * values (see appendix B of the BME280 datasheet, p. 51).
+ *
+ * @param humOs humidity oversampling value
+ * @param tempOs temperature oversampling value
+ * @param pressOs pressure oversampling value
+ * @return measurement time in us
+ */
+uint32_t measurementTime(int humOs, int tempOs, int pressOs) {
+    uint32_t time = 1250 + 2300 * oversamplingFactor(tempOs);
+    if (pressOs > 0) {
+        time += 2300 * oversamplingFactor(pressOs) + 575;
+    }
+    if (humOs > 0) {
+        time += 2300 * oversamplingFactor(humOs) + 575;
+    }
+    return time;
+}
+
+/**
+ * Starts a single measurement in forced mode, the sensor goes
+ * back to sleep afterwards.
+ *
+ * @param sensor sensor ID
+ * @param humOs humidity oversampling value
+ * @param tempOs temperature oversampling value
+ * @param pressOs pressure oversampling value
+ * @param waitUs set to the time until the measurement is done
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int startForcedMeasurement(int sensor, int humOs, int tempOs, int pressOs, uint32_t *waitUs) {
+    int status = setOversampling(sensor, humOs, tempOs, pressOs, MODE_FORCED);
+    if (status == I2C_OK) {
+        *waitUs = measurementTime(humOs, tempOs, pressOs);
+    }
+    return status;
+}
+
+/**
+ * Reads the measuring bit of the status register 0xF3, it is set
+ * while a conversion is running.
+ *
+ * @param sensor sensor ID
+ * @param measuring set to 1 while a conversion is running
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int isMeasuring(int sensor, int *measuring) {
+    uint8_t status;
+    int result = i2cTryReadReg8(sensor, STATUS, &status);
+    if (result == I2C_OK) {
+        *measuring = (status & STATUS_MEASURING) != 0;
+    }
+    return result;
 }
 
 /**
@@ -134,14 +331,16 @@ void setOversampling(int sensor, int humOs, int tempOs, int pressOs, int mode) {
  * world values using the compensation parameters (calcPress).
  *
  * @param sensor sensor ID
+ * @param rawPress read raw pressure
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
  */
-uint32_t readRawPress(int sensor) {
-
-    uint32_t rawPress = wiringPiI2CReadReg8(sensor, PRESSUREDATA) << 8;
-    rawPress = (rawPress | wiringPiI2CReadReg8(sensor, PRESSUREDATA + 1)) << 8;
-    rawPress = (rawPress | wiringPiI2CReadReg8(sensor, PRESSUREDATA + 2)) >> 4;
-
-    return rawPress;
+int readRawPress(int sensor, uint32_t *rawPress) {
+    uint8_t block[3];
+    int status = i2cTryReadBlock(sensor, PRESSUREDATA, block, sizeof(block));
+    if (status == I2C_OK) {
+        *rawPress = ((uint32_t) block[0] << 16 | (uint32_t) block[1] << 8 | block[2]) >> 4;
+    }
+    return status;
 }
 
 /**
@@ -192,14 +391,16 @@ uint32_t calcPress(uint32_t rawPress, compParam comp, int32_t tempFine) {
  * world values using the compensation parameters (calcTemp).
  *
  * @param sensor sensor ID
+ * @param rawTemp read raw temperature
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
  */
-uint32_t readRawTemp(int sensor) {
-
-    uint32_t rawTemp = wiringPiI2CReadReg8(sensor, TEMPDATA) << 8;
-    rawTemp = (rawTemp | wiringPiI2CReadReg8(sensor, TEMPDATA + 1)) << 8;
-    rawTemp = (rawTemp | wiringPiI2CReadReg8(sensor, TEMPDATA + 2)) >> 4;
-
-    return rawTemp;
+int readRawTemp(int sensor, uint32_t *rawTemp) {
+    uint8_t block[3];
+    int status = i2cTryReadBlock(sensor, TEMPDATA, block, sizeof(block));
+    if (status == I2C_OK) {
+        *rawTemp = ((uint32_t) block[0] << 16 | (uint32_t) block[1] << 8 | block[2]) >> 4;
+    }
+    return status;
 }
 
 /**
@@ -234,13 +435,73 @@ int32_t calcTemp(int32_t rawTemp, compParam comp, int32_t *tempFine) {
  * world values using the compensation parameters (calcHumidity).
  *
  * @param sensor sensor ID
+ * @param rawHum read raw humidity
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
  */
-uint32_t readRawHum(int sensor) {
+int readRawHum(int sensor, uint32_t *rawHum) {
+    uint8_t block[2];
+    int status = i2cTryReadBlock(sensor, HUMIDDATA, block, sizeof(block));
+    if (status == I2C_OK) {
+        *rawHum = (uint32_t) block[0] << 8 | block[1];
+    }
+    return status;
+}
 
-    uint32_t rawHum = wiringPiI2CReadReg8(sensor, HUMIDDATA) << 8;
-    rawHum = rawHum | wiringPiI2CReadReg8(sensor, HUMIDDATA + 1);
+/**
+ * Reads raw pressure, temperature and humidity (0xF7 to 0xFE)
+ * with a single burst read. The sensor shadows the data registers
+ * during a burst read, so all values belong to the same
+ * measurement (see p. 25).
+ *
+ * @param sensor sensor ID
+ * @param raw read raw values
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int readRawData(int sensor, envData *raw) {
+    uint8_t block[ENVDATA_LENGTH];
+    int status = i2cTryReadBlock(sensor, PRESSUREDATA, block, sizeof(block));
+    if (status == I2C_OK) {
+        decodeRawData(block, raw);
+    }
+    return status;
+}
 
-    return rawHum;
+/**
+ * Decodes the raw values of a burst read of ENVDATA_LENGTH bytes
+ * from PRESSUREDATA. Pressure and temperature are 20 bit values
+ * stored MSB first, humidity a 16 bit value.
+ *
+ * @param block registers 0xF7 to 0xFE
+ * @param raw decoded raw values
+ */
+void decodeRawData(const uint8_t *block, envData *raw) {
+    const uint8_t *press = block;
+    const uint8_t *temp = block + (TEMPDATA - PRESSUREDATA);
+    const uint8_t *hum = block + (HUMIDDATA - PRESSUREDATA);
+    raw->pressure = ((uint32_t) press[0] << 16 | (uint32_t) press[1] << 8 | press[2]) >> 4;
+    raw->temperature = (int32_t) (((uint32_t) temp[0] << 16 | (uint32_t) temp[1] << 8 | temp[2]) >> 4);
+    raw->humidity = (uint32_t) hum[0] << 8 | hum[1];
+}
+
+/**
+ * Reads raw pressure and temperature (0xF7 to 0xFC) with a single
+ * burst read, the humidity is left out. Used to read pressure at
+ * high rates, the temperature is needed to compensate it.
+ *
+ * @param sensor sensor ID
+ * @param raw read raw values, humidity is not changed
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int readRawPressTemp(int sensor, envData *raw) {
+    uint8_t block[HUMIDDATA - PRESSUREDATA];
+    int status = i2cTryReadBlock(sensor, PRESSUREDATA, block, sizeof(block));
+    if (status == I2C_OK) {
+        uint8_t *press = block;
+        uint8_t *temp = block + (TEMPDATA - PRESSUREDATA);
+        raw->pressure = ((uint32_t) press[0] << 16 | (uint32_t) press[1] << 8 | press[2]) >> 4;
+        raw->temperature = (int32_t) (((uint32_t) temp[0] << 16 | (uint32_t) temp[1] << 8 | temp[2]) >> 4);
+    }
+    return status;
 }
 
 /**
@@ -278,30 +539,77 @@ uint32_t calcHum(uint32_t rawHum, compParam comp, int32_t tempFine) {
     return (uint32_t) humidity;
 }
 
+#ifndef SENSOR_NO_PYTHON
+/* Sensor kept configured between calls, its compensation parameters and settings */
+static int environmentSensor = -1;
+static compParam environmentComp;
+static envSettings environmentSettings = {1, 1, 1, FILTER_OFF, STANDBY_0_5MS, MODE_NORMAL};
+
+/**
+ * Setup the sensor once: fetch the compensation parameters and
+ * start measuring in normal mode, so later calls just read the
+ * latest measurement.
+ *
+ * @return sensor ID, -1 if the sensor was not found or did not respond
+ */
+static int setupEnvironmentSensor(void) {
+    if (environmentSensor < 0) {
+        int sensor = i2cSetup(BME280_ADDRESS);
+        if (sensor < 0) {
+            printf("sensor not found!\n");
+            return -1;
+        }
+        if (readCompensationParam(sensor, &environmentComp) != I2C_OK ||
+            applySettings(sensor, &environmentSettings) != I2C_OK) {
+            printf("sensor not responding!\n");
+            close(sensor);
+            return -1;
+        }
+        environmentSensor = sensor;
+    }
+    return environmentSensor;
+}
+
+/**
+ * Reads the latest raw values and calculates the temperature fine.
+ * After a failed read the sensor is set up again on the next call
+ * (i. e. after it lost power), unless the circuit breaker is open.
+ *
+ * @param raw read raw values
+ * @param tempFine calculated temperature fine
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+static int readEnvironment(envData *raw, int32_t *tempFine) {
+    if (setupEnvironmentSensor() < 0) {
+        return I2C_ERROR;
+    }
+    int status = readRawData(environmentSensor, raw);
+    if (status == I2C_ERROR) {
+        close(environmentSensor);
+        environmentSensor = -1;
+    }
+    if (status == I2C_OK) {
+        calcTemp(raw->temperature, environmentComp, tempFine);
+    }
+    return status;
+}
+
 /**
  * Setup the sensor, fetch the compensation parameters and
  * read the current temperature from the device.
  *
  * @param self python instance the method is called on
  * @param args passed arguments from calling python method
- * @return real world temperature value
+ * @return real world temperature value or None on failure
  */
 static PyObject *get_temperature(PyObject *self, PyObject *args) {
-    int32_t sensor;
-    sensor = wiringPiI2CSetup(ADDRESS);
-    if (sensor < 0) {
-        printf("sensor not found!\n");
-        return NULL;
+    envData rawData;
+    envData calcData;
+    if (readEnvironment(&rawData, &calcData.tempFine) != I2C_OK) {
+        Py_RETURN_NONE;
     }
 
-    compParam comp = readCompensationParam(sensor);
-    setOversampling(sensor, 1, 1, 1, 3);
-
-    measData rawData;
-    rawData.temperature = readRawTemp(sensor);
-
-    measData calcData;
-    calcData.temperature = calcTemp(rawData.temperature, comp, &calcData.tempFine);
+    calcData.temperature = calcTemp(rawData.temperature, environmentComp, &calcData.tempFine);
 
     return Py_BuildValue("f", (calcData.temperature / 100.0));
 }
@@ -313,27 +621,17 @@ static PyObject *get_temperature(PyObject *self, PyObject *args) {
  *
  * @param self python instance the method is called on
  * @param args passed arguments from calling python method
- * @return real world humidity value
+ * @return real world humidity value or None on failure
  */
 static PyObject *get_humidity(PyObject *self, PyObject *args) {
-    int32_t sensor;
-    sensor = wiringPiI2CSetup(ADDRESS);
-    if (sensor < 0) {
-        printf("sensor not found!\n");
-        return NULL;
+    envData rawData;
+    envData calcData;
+    /* Calculate and save tempFine by getting the temperature */
+    if (readEnvironment(&rawData, &calcData.tempFine) != I2C_OK) {
+        Py_RETURN_NONE;
     }
 
-    compParam comp = readCompensationParam(sensor);
-    setOversampling(sensor, 1, 1, 1, 3);
-
-    measData rawData;
-    rawData.temperature = readRawTemp(sensor);
-    rawData.humidity = readRawHum(sensor);
-
-    measData calcData;
-    /* Calculate and save tempFine by getting the temperature */
-    calcTemp(rawData.temperature, comp, &calcData.tempFine);
-    calcData.humidity = calcHum(rawData.humidity, comp, calcData.tempFine);
+    calcData.humidity = calcHum(rawData.humidity, environmentComp, calcData.tempFine);
 
     return Py_BuildValue("f", (calcData.humidity / 1024.0));
 }
@@ -345,31 +643,50 @@ static PyObject *get_humidity(PyObject *self, PyObject *args) {
  *
  * @param self python instance the method is called on
  * @param args passed arguments from calling python method
- * @return real world pressure value
+ * @return real world pressure value or None on failure
  */
 static PyObject *get_pressure(PyObject *self, PyObject *args) {
-    int32_t sensor;
-    sensor = wiringPiI2CSetup(ADDRESS);
-    if (sensor < 0) {
-        printf("sensor not found!\n");
-        return NULL;
+    envData rawData;
+    envData calcData;
+    /* Calculate and save tempFine by getting the temperature */
+    if (readEnvironment(&rawData, &calcData.tempFine) != I2C_OK) {
+        Py_RETURN_NONE;
     }
 
-    compParam comp = readCompensationParam(sensor);
-    setOversampling(sensor, 1, 1, 1, 3);
-
-    measData rawData;
-    rawData.pressure = readRawPress(sensor);
-    rawData.temperature = readRawTemp(sensor);
-
-    measData calcData;
-    /* Calculate and save tempFine by getting the temperature */
-    calcTemp(rawData.temperature, comp, &calcData.tempFine);
-    calcData.pressure = calcPress(rawData.pressure, comp, calcData.tempFine);
+    calcData.pressure = calcPress(rawData.pressure, environmentComp, calcData.tempFine);
 
     return Py_BuildValue("f", (calcData.pressure / 256.0 / 100.0));
 }
 
+/**
+ * Set the oversampling, IIR filter and standby time the sensor
+ * measures with in normal mode.
+ *
+ * @param self python instance the method is called on
+ * @param args oversampling of humidity, temperature and pressure
+ *             (0 = skipped to 5 = x16), filter (FILTER_*) and
+ *             standby time (STANDBY_*)
+ * @return status (0 = ok)
+ */
+static PyObject *configure(PyObject *self, PyObject *args) {
+    envSettings settings = {0, 0, 0, 0, 0, MODE_NORMAL};
+    if (!PyArg_ParseTuple(args, "iiiii", &settings.humOs, &settings.tempOs, &settings.pressOs,
+                          &settings.filter, &settings.standby)) {
+        return NULL;
+    }
+    if (settings.humOs < 0 || settings.humOs > 5 || settings.tempOs < 1 || settings.tempOs > 5 ||
+        settings.pressOs < 0 || settings.pressOs > 5 || settings.filter < FILTER_OFF || settings.filter > FILTER_16 ||
+        settings.standby < STANDBY_0_5MS || settings.standby > STANDBY_20MS) {
+        PyErr_SetString(PyExc_ValueError, "invalid settings");
+        return NULL;
+    }
+    environmentSettings = settings;
+    if (environmentSensor < 0) {
+        return PyInt_FromLong(setupEnvironmentSensor() < 0 ? I2C_ERROR : I2C_OK);
+    }
+    return PyInt_FromLong(applySettings(environmentSensor, &environmentSettings));
+}
+
 /**
  * Method definitions that are visible in Python afterwards
  */
@@ -377,6 +694,7 @@ static PyMethodDef environmentSensor_methods[] = {
         {"get_temperature", get_temperature, METH_VARARGS},
         {"get_humidity",    get_humidity,    METH_VARARGS},
         {"get_pressure",    get_pressure,    METH_VARARGS},
+        {"configure",       configure,       METH_VARARGS},
         {NULL, NULL, 0, NULL} /* Sentinel */
 };
 
@@ -386,9 +704,28 @@ static PyMethodDef environmentSensor_methods[] = {
  */
 void initenvironmentSensor(void) {
     PyImport_AddModule("environmentSensor");
-    Py_InitModule("environmentSensor", environmentSensor_methods);
+    PyObject *module = Py_InitModule("environmentSensor", environmentSensor_methods);
+    if (module == NULL) {
+        return;
+    }
+    PyModule_AddIntConstant(module, "FILTER_OFF", FILTER_OFF);
+    PyModule_AddIntConstant(module, "FILTER_2", FILTER_2);
+    PyModule_AddIntConstant(module, "FILTER_4", FILTER_4);
+    PyModule_AddIntConstant(module, "FILTER_8", FILTER_8);
+    PyModule_AddIntConstant(module, "FILTER_16", FILTER_16);
+    PyModule_AddIntConstant(module, "STANDBY_0_5MS", STANDBY_0_5MS);
+    PyModule_AddIntConstant(module, "STANDBY_62_5MS", STANDBY_62_5MS);
+    PyModule_AddIntConstant(module, "STANDBY_125MS", STANDBY_125MS);
+    PyModule_AddIntConstant(module, "STANDBY_250MS", STANDBY_250MS);
+    PyModule_AddIntConstant(module, "STANDBY_500MS", STANDBY_500MS);
+    PyModule_AddIntConstant(module, "STANDBY_1000MS", STANDBY_1000MS);
+    PyModule_AddIntConstant(module, "STANDBY_10MS", STANDBY_10MS);
+    PyModule_AddIntConstant(module, "STANDBY_20MS", STANDBY_20MS);
 }
+#endif
 
+/* Left out when the driver is linked into another module (i. e. sensorLoop) */
+#ifndef SENSOR_NO_MAIN
 int main(int argc, char **argv) {
     /* Initialize the Python interpreter. */
     Py_Initialize();
@@ -396,32 +733,37 @@ int main(int argc, char **argv) {
     initenvironmentSensor();
 
 /*
-    int sensor = wiringPiI2CSetup(ADDRESS);
+    int sensor = i2cSetup(BME280_ADDRESS);
     if (sensor < 0) {
         printf("sensor not found!\n");
         return 1;
     }
 
-    int chipID = readChipID(sensor);
-    int version = readVersion(sensor);
+    uint8_t chipID, version;
+    readChipID(sensor, &chipID);
+    readVersion(sensor, &version);
     printf("CHIP-ID: %i\n"
            "VERSION: %i\n", chipID, version);
 
-    compParam comp =  readCompensationParam(sensor);
-    setOversampling(sensor, 1, 1, 1, 3);
-
-    measData rawData;
+    compParam comp;
+    if (readCompensationParam(sensor, &comp) != I2C_OK ||
+        setOversampling(sensor, 1, 1, 1, MODE_NORMAL) != I2C_OK) {
+        printf("sensor not responding!\n");
+        return 1;
+    }
 
-    rawData.pressure = readRawPress(sensor);
-    rawData.temperature = readRawTemp(sensor);
-    rawData.humidity = readRawHum(sensor);
+    envData rawData;
+    if (readRawData(sensor, &rawData) != I2C_OK) {
+        printf("sensor not responding!\n");
+        return 1;
+    }
 
     printf("Raw Pressure: %i\n"
            "Raw Temperature: %i\n"
            "Raw Humidity: %i\n", rawData.pressure, rawData.temperature, rawData.humidity);
 
 
-    measData calcData;
+    envData calcData;
     calcData.temperature = calcTemp(rawData.temperature, comp, &calcData.tempFine );
     calcData.pressure = calcPress(rawData.pressure, comp, calcData.tempFine );
     calcData.humidity = calcHum(rawData.humidity, comp, calcData.tempFine );
@@ -436,3 +778,4 @@ int main(int argc, char **argv) {
     return 0;
 */
 }
+#endif
@@ -27,10 +27,10 @@
 
 #include <inttypes.h>
 #include <stdlib.h>
-#include "wiringPiI2C.h"
+#include "I2CBus.h"
 
 /* --- I2C address --- */
-#define ADDRESS       0x76
+#define BME280_ADDRESS 0x76
 
 /* --- Compensation Parameters --- */
 /* Temperature */
@@ -63,12 +63,44 @@
 
 /* --- Oversampling Addresses --- */
 #define CONTROLHUMID  0xF2
+#define STATUS        0xF3
 #define CONTROL_MEAS  0xF4
+#define CONFIG        0xF5
+
+/* --- Modes and Status --- */
+#define MODE_SLEEP       0
+#define MODE_FORCED      1
+#define MODE_NORMAL      3
+#define STATUS_MEASURING 0x08
+
+/* --- IIR filter coefficients (config register, p. 30) --- */
+#define FILTER_OFF       0
+#define FILTER_2         1
+#define FILTER_4         2
+#define FILTER_8         3
+#define FILTER_16        4
+
+/* --- Standby times in normal mode (config register, p. 30) --- */
+#define STANDBY_0_5MS    0
+#define STANDBY_62_5MS   1
+#define STANDBY_125MS    2
+#define STANDBY_250MS    3
+#define STANDBY_500MS    4
+#define STANDBY_1000MS   5
+#define STANDBY_10MS     6
+#define STANDBY_20MS     7
+
+/* --- Recommended modes of operation (p. 19f) --- */
+#define PRESET_WEATHER           0  /* forced, x1 oversampling, no filter */
+#define PRESET_HUMIDITY          1  /* forced, no pressure, no filter */
+#define PRESET_INDOOR_NAVIGATION 2  /* normal at about 25 Hz, pressure x16, filter 16 */
+#define PRESET_GAMING            3  /* normal at about 83 Hz, no humidity, pressure x4, filter 16 */
 
 /* --- Sensor Data --- */
 #define PRESSUREDATA  0xF7
 #define TEMPDATA      0xFA
 #define HUMIDDATA     0xFD
+#define ENVDATA_LENGTH (HUMIDDATA + 2 - PRESSUREDATA) /* burst of pressure, temperature and humidity */
 
 
 /* Used to hold compensation parameters */
@@ -95,6 +127,16 @@ typedef struct {
     int8_t dig_H6;
 } compParam;
 
+/* Used to hold the measurement settings */
+typedef struct {
+    int humOs;
+    int tempOs;
+    int pressOs;
+    int filter;     /* FILTER_* */
+    int standby;    /* STANDBY_*, only used in normal mode */
+    int mode;       /* MODE_FORCED or MODE_NORMAL */
+} envSettings;
+
 /* Used to hold raw or real world sensor values */
 typedef struct {
     int32_t temperature;
@@ -102,7 +144,7 @@ typedef struct {
     uint32_t pressure;
     uint32_t humidity;
 
-} measData;
+} envData;
 
 /* METHODS */
 
@@ -111,14 +153,18 @@ typedef struct {
  * 0x60 for the BME280 sensor.
  *
  * @param sensor sensor ID
+ * @param chipID read chip ID
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
  */
-int8_t readChipID(int sensor);
+int readChipID(int sensor, uint8_t *chipID);
 /**
  * Read the Version from register 0xD1.
  *
  * @param sensor sensor ID
+ * @param version read version
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
  */
-int8_t readVersion(int sensor);
+int readVersion(int sensor, uint8_t *version);
 /**
  * To get real world values it is necessary to get the compensation
  * parameters first. These parameters are saved in the non-volatile
@@ -127,8 +173,10 @@ int8_t readVersion(int sensor);
  * and 0xE1 to 0xE7. Parameters taken from BME280 data sheet page 22.
  *
  * @param sensor sensor ID
+ * @param data read compensation parameters
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
  */
-compParam readCompensationParam(int sensor);
+int readCompensationParam(int sensor, compParam *data);
 /**
  * Sets the oversampling used by the sensor to de-/activate and
  * the precision of all measurements. Can be set from
@@ -142,16 +190,97 @@ compParam readCompensationParam(int sensor);
  * @param tempOs temperature oversampling value
  * @param pressOs pressure oversampling value
  * @param mode setting mode value
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int setOversampling(int sensor, int humOs, int tempOs, int pressOs, int mode);
+/**
+ * Sets the standby time of the normal mode and the coefficient of
+ * the IIR filter in the config register 0xF5. Writes to it may be
+ * ignored in normal mode (see p. 30), use applySettings to change
+ * it in normal mode.
+ *
+ * @param sensor sensor ID
+ * @param standby standby time, one of the STANDBY_* values
+ * @param filter filter coefficient, one of the FILTER_* values
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int setConfig(int sensor, int standby, int filter);
+/**
+ * Writes all measurement settings. The sensor is put to sleep
+ * first, so the config register is taken in any mode. In normal
+ * mode the sensor starts measuring continuously, in forced mode it
+ * keeps sleeping until startForcedMeasurement.
+ *
+ * @param sensor sensor ID
+ * @param settings settings to write
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int applySettings(int sensor, const envSettings *settings);
+/**
+ * Fills in the settings of one of the recommended modes of
+ * operation of the datasheet.
+ *
+ * @param preset one of the PRESET_* values
+ * @param settings receives the settings
+ * @return 0 on success, -1 if the preset is unknown
+ */
+int presetSettings(int preset, envSettings *settings);
+/**
+ * Standby time of the normal mode.
+ *
+ * @param standby one of the STANDBY_* values
+ * @return standby time in us
  */
-void setOversampling(int sensor, int humOs, int tempOs, int pressOs, int mode);
+uint32_t standbyTime(int standby);
+/**
+ * Time between two measurements in normal mode, the measurement
+ * time plus the standby time (see p. 50).
+ *
+ * @param settings settings of the sensor
+ * @return period in us
+ */
+uint32_t outputPeriod(const envSettings *settings);
+/**
+ * Maximum time a measurement takes with the given oversampling
+ * values (see appendix B of the BME280 datasheet, p. 51).
+ *
+ * @param humOs humidity oversampling value
+ * @param tempOs temperature oversampling value
+ * @param pressOs pressure oversampling value
+ * @return measurement time in us
+ */
+uint32_t measurementTime(int humOs, int tempOs, int pressOs);
+/**
+ * Starts a single measurement in forced mode, the sensor goes
+ * back to sleep afterwards.
+ *
+ * @param sensor sensor ID
+ * @param humOs humidity oversampling value
+ * @param tempOs temperature oversampling value
+ * @param pressOs pressure oversampling value
+ * @param waitUs set to the time until the measurement is done
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int startForcedMeasurement(int sensor, int humOs, int tempOs, int pressOs, uint32_t *waitUs);
+/**
+ * Reads the measuring bit of the status register 0xF3, it is set
+ * while a conversion is running.
+ *
+ * @param sensor sensor ID
+ * @param measuring set to 1 while a conversion is running
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int isMeasuring(int sensor, int *measuring);
 /**
  * Reads the raw pressure value saved in the sensor memory at
  * address 0xF7 to 0xF9. The value needs to be converted to real
  * world values using the compensation parameters (calcPress).
  *
  * @param sensor sensor ID
+ * @param rawPress read raw pressure
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
  */
-uint32_t readRawPress(int sensor);
+int readRawPress(int sensor, uint32_t *rawPress);
 /**
  * Real world pressure calculated using the compensation parameters
  * and temperature fine. Formula used from the BME280 datasheet
@@ -172,8 +301,10 @@ uint32_t calcPress(uint32_t rawPress, compParam comp, int32_t tempFine);
  * world values using the compensation parameters (calcTemp).
  *
  * @param sensor sensor ID
+ * @param rawTemp read raw temperature
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
  */
-uint32_t readRawTemp(int sensor);
+int readRawTemp(int sensor, uint32_t *rawTemp);
 /**
  * Real world temperature calculated using the compensation parameters.
  * Temperature fine is calculated here. Formula used from the BME280
@@ -192,8 +323,40 @@ int32_t calcTemp(int32_t rawTemp, compParam comp, int32_t *tempFine);
  * world values using the compensation parameters (calcHumidity).
  *
  * @param sensor sensor ID
+ * @param rawHum read raw humidity
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int readRawHum(int sensor, uint32_t *rawHum);
+/**
+ * Reads raw pressure, temperature and humidity (0xF7 to 0xFE)
+ * with a single burst read. The sensor shadows the data registers
+ * during a burst read, so all values belong to the same
+ * measurement (see p. 25).
+ *
+ * @param sensor sensor ID
+ * @param raw read raw values
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int readRawData(int sensor, envData *raw);
+/**
+ * Decodes the raw values of a burst read of ENVDATA_LENGTH bytes
+ * from PRESSUREDATA. Pressure and temperature are 20 bit values
+ * stored MSB first, humidity a 16 bit value.
+ *
+ * @param block registers 0xF7 to 0xFE
+ * @param raw decoded raw values
+ */
+void decodeRawData(const uint8_t *block, envData *raw);
+/**
+ * Reads raw pressure and temperature (0xF7 to 0xFC) with a single
+ * burst read, the humidity is left out. Used to read pressure at
+ * high rates, the temperature is needed to compensate it.
+ *
+ * @param sensor sensor ID
+ * @param raw read raw values, humidity is not changed
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
  */
-uint32_t readRawHum(int sensor);
+int readRawPressTemp(int sensor, envData *raw);
 /**
  * Real world humidity calculated using the compensation parameters
  * and temperature fine. Formula used from the BME280 datasheet
@@ -0,0 +1,327 @@
+/**
+ * <Program>
+ * BoxSensors.c
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ *  Driver descriptors of the sensors of the box (see SensorDriver.h)
+ * and the hooks for what their tables can not describe. The
+ * register routines and decoders are the ones of the drivers
+ * themselves, the state shared with the caller (settings, drive
+ * mode, baseline) is kept in the sensor loop.
+ *
+ *      BME280  calibration and settings by hooks, forced mode
+ *              triggered by a hook (the wait depends on the
+ *              oversampling), read when the measuring bit is clear,
+ *              in normal mode read without waiting
+ *      SI1145  reset -> 10ms -> unlock, UV coefficients, channels;
+ *              ALS force, read when the ALS interrupt bit is set
+ *      CCS811  application started and drive mode set by hooks,
+ *              read when DATA_READY is set, in the 250ms mode only
+ *              RAW_DATA is read, in the slow modes the last result
+ *              is returned while it is current
+ *
+ * A new sensor only needs a descriptor here, added to boxDrivers.
+ * The streams of these sensors and of the ADXL345 are described in
+ * their own modules, see SensorStream.h.
+ *
+ * <Sources>
+ * Accessed on 11.01.2018 - BME280 Datasheet:
+ *      https://ae-bst.resource.bosch.com/media/_tech/media/datasheets/BST-BME280_DS001-12.pdf
+ * Accessed on 11.01.2018 - SI1145 Datasheet:
+ *      https://www.silabs.com/documents/public/data-sheets/Si1145-46-47.pdf
+ * Accessed on 18.10.2026 - CCS811 Datasheet:
+ *      https://cdn.sparkfun.com/assets/learn_tutorials/1/4/3/CCS811_Datasheet-DS000459.pdf
+ */
+
+#include <time.h>
+#include "SensorDriver.h"
+
+/**
+ * Returns the monotonic time in microseconds.
+ */
+static int64_t monotonicUs(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/* --- BME280 --- */
+
+/* Channels in the order of the descriptor */
+#define BME280_TEMPERATURE 0
+#define BME280_HUMIDITY    1
+#define BME280_PRESSURE    2
+
+static int calibrateBME280(sensorTask *task, uint32_t *waitUs) {
+    return readCompensationParam(task->fd, &task->loop->comp);
+}
+
+/* Sleep until the first forced measurement, or measure continuously in normal mode */
+static int configureBME280(sensorTask *task, uint32_t *waitUs) {
+    return applySettings(task->fd, &task->loop->env);
+}
+
+static int triggerBME280(sensorTask *task, uint32_t *waitUs) {
+    const envSettings *env = &task->loop->env;
+    if (env->mode == MODE_NORMAL) {
+        *waitUs = 0;
+        return I2C_OK;
+    }
+    return startForcedMeasurement(task->fd, env->humOs, env->tempOs, env->pressOs, waitUs);
+}
+
+/* In normal mode the burst read always returns the last complete measurement */
+static int planBME280(const sensorTask *task) {
+    return task->loop->env.mode == MODE_NORMAL ? 1 : 0;
+}
+
+static int decodeBME280(sensorTask *task, int plan, const uint8_t *raw) {
+    sensorLoop *loop = task->loop;
+    envData data;
+    int32_t tempFine;
+    decodeRawData(raw, &data);
+    driverKeepRaw(task, BME280_TEMPERATURE, calcTemp(data.temperature, loop->comp, &tempFine));
+    driverKeepRaw(task, BME280_PRESSURE, calcPress(data.pressure, loop->comp, tempFine));
+    driverKeepRaw(task, BME280_HUMIDITY, calcHum(data.humidity, loop->comp, tempFine));
+    return I2C_OK;
+}
+
+/*
+ * A skipped measurement leaves 0x80000 (0x8000 for humidity) in its
+ * data registers (see section 3.3 of the datasheet), compensated it
+ * would look like a valid value. Without temperature there is no
+ * t_fine to compensate the others with.
+ */
+static unsigned int yieldsBME280(const sensorTask *task, int plan) {
+    const envSettings *env = &task->loop->env;
+    if (env->tempOs == 0) {
+        return 0;
+    }
+    return 1u << BME280_TEMPERATURE | (env->humOs != 0 ? 1u << BME280_HUMIDITY : 0) |
+           (env->pressOs != 0 ? 1u << BME280_PRESSURE : 0);
+}
+
+static const driverStep bme280Init[] = {
+        {DRIVER_CALL, .call = calibrateBME280},
+        {DRIVER_CALL, .call = configureBME280},
+        {DRIVER_END}
+};
+
+static const driverStep bme280Trigger[] = {
+        {DRIVER_CALL, .call = triggerBME280},
+        {DRIVER_END}
+};
+
+static const sensorDriver bme280Driver = {
+        .name = "BME280",
+        .field = "env",
+        .address = BME280_ADDRESS,
+        .startupUs = 10000, /* forced measurement of the weather preset */
+        .init = bme280Init,
+        .trigger = bme280Trigger,
+        .plans = 2,
+        .plan = {
+                {STATUS, STATUS_MEASURING, 0, 0, LOOP_POLL_US, 1, {{PRESSUREDATA, ENVDATA_LENGTH}}, 0x7},
+                {DRIVER_NO_STATUS, 0, 0, 0, 0, 1, {{PRESSUREDATA, ENVDATA_LENGTH}}, 0x7}
+        },
+        .selectPlan = planBME280,
+        .decode = decodeBME280,
+        .yields = yieldsBME280,
+        .channels = 3,
+        .channel = {
+                [BME280_TEMPERATURE] = {"temperature", "C",   "temperature in C",       0, 100,   0.01, 0.1, 0.05},
+                [BME280_HUMIDITY]    = {"humidity",    "%RH", "relative humidity in %", 0, 1024,  0.05, 0.5, 0.2},
+                [BME280_PRESSURE]    = {"pressure",    "hPa", "pressure in hPa",        0, 25600, 0.1,  0.3, 0.05}
+        }
+};
+
+/* --- SI1145 --- */
+
+/* Channels in the order of the descriptor */
+#define SI1145_UV  0
+#define SI1145_IR  1
+#define SI1145_VIS 2
+
+static int decodeSI1145(sensorTask *task, int plan, const uint8_t *raw) {
+    lightData light;
+    decodeLightSample(raw, &light);
+    driverKeepRaw(task, SI1145_UV, light.uv);
+    driverKeepRaw(task, SI1145_IR, light.ir);
+    driverKeepRaw(task, SI1145_VIS, light.vis);
+    return I2C_OK;
+}
+
+static const driverStep si1145Init[] = {
+        {DRIVER_RUN,   .run = startReset},
+        {DRIVER_WAIT,  .us = SI1145_RESET_US},
+        {DRIVER_WRITE, SI1145_REG_HWKEY, 0x17},
+        {DRIVER_RUN,   .run = calibrateUV},
+        {DRIVER_RUN,   .run = enableForcedMeas},
+        {DRIVER_END}
+};
+
+static const driverStep si1145Trigger[] = {
+        {DRIVER_RUN,  .run = startForcedMeas},
+        {DRIVER_WAIT, .us = SI1145_FORCE_WAIT_US},
+        {DRIVER_END}
+};
+
+static const sensorDriver si1145Driver = {
+        .name = "SI1145",
+        .field = "light",
+        .address = SI1145_ADDRESS,
+        .startupUs = SI1145_RESET_US + SI1145_FORCE_WAIT_US,
+        .init = si1145Init,
+        .trigger = si1145Trigger,
+        .plans = 1,
+        .plan = {
+                {SI1145_REG_IRQSTAT, SI1145_REG_IRQSTAT_ALS, SI1145_REG_IRQSTAT_ALS, 0, LOOP_POLL_US, 1,
+                        {{LIGHTDATA, LIGHTDATA_LENGTH}}, 0x7}
+        },
+        .decode = decodeSI1145,
+        .channels = 3,
+        .channel = {
+                [SI1145_UV]  = {"uv",  "index",  "UV index",       0, 100, 0.05, 0.5, 0.05},
+                [SI1145_IR]  = {"ir",  "counts", "infrared light", 1, 1,   20,   50,  5},
+                [SI1145_VIS] = {"vis", "counts", "visible light",  1, 1,   20,   50,  5}
+        }
+};
+
+/* --- CCS811 --- */
+
+#define CCS811_PLAN_ALGORITHM 0
+#define CCS811_PLAN_RAW       1
+
+/* Channels in the order of the descriptor */
+#define CCS811_ECO2 0
+#define CCS811_TVOC 1
+
+/**
+ * Keeps an algorithm result in the round.
+ */
+static void keepAirResult(sensorTask *task, const airData *air) {
+    driverKeepRaw(task, CCS811_ECO2, air->eCO2);
+    driverKeepRaw(task, CCS811_TVOC, air->TVOC);
+}
+
+/* If the application already runs, there is nothing to wait for */
+static int startCCS811(sensorTask *task, uint32_t *waitUs) {
+    int started;
+    int status = startAirSensor(task->fd, &started);
+    if (status == I2C_OK && started) {
+        *waitUs = CCS811_APP_START_US;
+    }
+    return status;
+}
+
+static int finishCCS811(sensorTask *task, uint32_t *waitUs) {
+    sensorLoop *loop = task->loop;
+    int status;
+    if ((status = finishAirSensor(task->fd, loop->driveMode)) != I2C_OK ||
+        (status = restoreAirBaseline(&loop->baseline, task->fd)) != I2C_OK) {
+        return status;
+    }
+    loop->airMode = loop->driveMode;
+    loop->lastAirUs = 0;
+    return I2C_OK;
+}
+
+/**
+ * The CCS811 measures on its own in the configured drive mode,
+ * there is nothing to trigger. A drive mode that could not be set
+ * when it was requested is set now. The result is read right away
+ * if one is ready, otherwise DATA_READY is polled.
+ */
+static int triggerCCS811(sensorTask *task, uint32_t *waitUs) {
+    sensorLoop *loop = task->loop;
+    *waitUs = 0;
+    if (loop->airMode != loop->driveMode) {
+        int status = setDriveMode(task->fd, loop->driveMode);
+        if (status != I2C_OK) {
+            return status;
+        }
+        loop->airMode = loop->driveMode;
+    }
+    return I2C_OK;
+}
+
+/* The algorithm does not run in the 250ms mode, RAW_DATA is always current */
+static int planCCS811(const sensorTask *task) {
+    return task->loop->airMode == CCS811_MODE_250MS ? CCS811_PLAN_RAW : CCS811_PLAN_ALGORITHM;
+}
+
+/* The slow modes have a result less often than a round may take, the last one is still current */
+static int pendingCCS811(sensorTask *task, int plan, uint32_t *waitUs) {
+    sensorLoop *loop = task->loop;
+    int64_t now = monotonicUs();
+    if ((loop->airMode == CCS811_MODE_10S || loop->airMode == CCS811_MODE_60S) && loop->lastAirUs > 0 &&
+        now - loop->lastAirUs < driveModeIntervalUs(loop->airMode)) {
+        keepAirResult(task, &loop->lastAir);
+        task->sampleUs = loop->lastAirUs;
+        return 1;
+    }
+    return 0;
+}
+
+static int decodeCCS811(sensorTask *task, int plan, const uint8_t *raw) {
+    sensorLoop *loop = task->loop;
+    if (plan == CCS811_PLAN_RAW) {
+        loop->lastAir.raw = (uint16_t) (raw[0] << 8 | raw[1]);
+        return I2C_OK;
+    }
+    airData air;
+    int status = decodeAlgorithmResult(raw, &air);
+    if (status != I2C_OK) {
+        return status;
+    }
+    keepAirResult(task, &air);
+    loop->lastAir = air;
+    loop->lastAirUs = monotonicUs();
+    /* The result stays valid even if the baseline could not be read, a failing sensor shows with the next status */
+    keepAirBaseline(&loop->baseline, task->fd);
+    return I2C_OK;
+}
+
+static const driverStep ccs811Init[] = {
+        {DRIVER_CALL, .call = startCCS811},
+        {DRIVER_CALL, .call = finishCCS811},
+        {DRIVER_END}
+};
+
+static const driverStep ccs811Trigger[] = {
+        {DRIVER_CALL, .call = triggerCCS811},
+        {DRIVER_END}
+};
+
+static const sensorDriver ccs811Driver = {
+        .name = "CCS811",
+        .field = "air",
+        .address = CCS811_ADDRESS,
+        .startupUs = CCS811_APP_START_US + 1000000, /* first result in the 1s mode */
+        .init = ccs811Init,
+        .trigger = ccs811Trigger,
+        .plans = 2,
+        .plan = {
+                {CCS811_STATUS, CCS811_STATUS_DATA_READY, CCS811_STATUS_DATA_READY, CCS811_STATUS_ERROR,
+                        LOOP_CCS811_POLL_US, 1, {{CCS811_ALG_RESULT_DATA, CCS811_ALG_RESULT_LENGTH}}, 0x3},
+                {CCS811_STATUS, 0, 0, CCS811_STATUS_ERROR, 0, 1, {{CCS811_RAW_DATA, 2}}, 0}
+        },
+        .selectPlan = planCCS811,
+        .pending = pendingCCS811,
+        .decode = decodeCCS811,
+        .channels = 2,
+        .channel = {
+                [CCS811_ECO2] = {"eCO2", "ppm", "equivalent CO2 in ppm",                   1, 1, 2, 50, 10},
+                [CCS811_TVOC] = {"TVOC", "ppb", "total volatile organic compounds in ppb", 1, 1, 1, 30, 3}
+        }
+};
+
+/* Drivers of the box in the order of the LOOP_* indices */
+const sensorDriver *const boxDrivers[] = {&bme280Driver, &si1145Driver, &ccs811Driver};
+const int boxSensors = sizeof(boxDrivers) / sizeof(boxDrivers[0]);
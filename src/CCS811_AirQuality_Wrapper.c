@@ -5,6 +5,8 @@
 #include <Python.h>
 #include <unistd.h>
 #include "CCS811_AirQuality.c"
+#include "I2CBus.h"
+#include "AirBaseline.h"
 
 /* I2C */
 #define ADDRESS       0x5A
@@ -12,9 +14,14 @@
 
 int isInit = 0;
 
+/* The library keeps its handle to itself, the baseline is read and written through a second one */
+int baselineSensor = -1;
+airBaselineStore baseline = {AIR_BASELINE_FILE};
+
 /**
  * Initialize the sensor once at the beginning of reading data,
- * or to reconfigure the sensor.
+ * or to reconfigure the sensor. The saved baseline is restored,
+ * so the algorithm does not have to learn it again.
  */
 void initSensor() {
     if (isInit == 0) {
@@ -24,6 +31,12 @@ void initSensor() {
             printf("sensor not found!\n");
         } else {
             isInit = 1;
+            if (baselineSensor < 0) {
+                baselineSensor = i2cSetup(ADDRESS);
+            }
+            if (baselineSensor >= 0 && restoreAirBaseline(&baseline, baselineSensor) != I2C_OK) {
+                printf("baseline not restored!\n");
+            }
         }
     }
 }
@@ -48,6 +61,9 @@ static PyObject *get_eCO2(PyObject *self, PyObject *args) {
         initSensor();
         return Py_BuildValue("i", -1);
     }
+    if (baselineSensor >= 0) {
+        keepAirBaseline(&baseline, baselineSensor);
+    }
 
     return Py_BuildValue("i", eCO2);
 }
@@ -72,6 +88,9 @@ static PyObject *get_TVOC(PyObject *self, PyObject *args) {
         initSensor();
         return Py_BuildValue("i", -1);
     }
+    if (baselineSensor >= 0) {
+        keepAirBaseline(&baseline, baselineSensor);
+    }
 
     return Py_BuildValue("i", TVOC);
 }
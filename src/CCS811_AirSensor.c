@@ -0,0 +1,218 @@
+/**
+ * <Program>
+ * CCS811_AirSensor.c
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ *  Native driver for the CCS811 air quality sensor. Unlike the
+ * wrapper around the external library it talks to the sensor
+ * through the I2C access layer, so errors are reported explicitly
+ * and the transactions show up in the bus statistics. It has no
+ * Python module of its own, it is linked into the sensor loop.
+ *
+ * <Sources>
+ * Accessed on 18.10.2026 - CCS811 Datasheet:
+ *      https://cdn.sparkfun.com/assets/learn_tutorials/1/4/3/CCS811_Datasheet-DS000459.pdf
+ */
+
+#include <unistd.h>
+#include "CCS811_AirSensor.h"
+
+/**
+ * First half of the initialization: checks the hardware ID and
+ * starts the application firmware if the sensor is still in boot
+ * mode. The boot mode is left by writing APP_START without data
+ * (see p. 24).
+ *
+ * @param sensor sensor ID
+ * @param started set to 1 if the application was started, 0 if it was running
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int startAirSensor(int sensor, int *started) {
+    uint8_t hardwareId;
+    uint8_t status;
+    int result;
+    *started = 0;
+    if ((result = i2cTryReadReg8(sensor, CCS811_HW_ID, &hardwareId)) != I2C_OK ||
+        (result = readAirStatus(sensor, &status)) != I2C_OK) {
+        return result;
+    }
+    if (hardwareId != CCS811_HW_ID_CODE || !(status & CCS811_STATUS_APP_VALID)) {
+        return I2C_ERROR;
+    }
+
+    if (!(status & CCS811_STATUS_FW_MODE)) {
+        if ((result = i2cTryWrite(sensor, CCS811_APP_START)) != I2C_OK) {
+            return result;
+        }
+        *started = 1;
+    }
+    return I2C_OK;
+}
+
+/**
+ * Second half of the initialization, CCS811_APP_START_US after the
+ * application was started: checks that it runs and sets the drive
+ * mode.
+ *
+ * @param sensor sensor ID
+ * @param driveMode one of the CCS811_MODE_* values
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int finishAirSensor(int sensor, int driveMode) {
+    uint8_t status;
+    int result;
+    if ((result = readAirStatus(sensor, &status)) != I2C_OK) {
+        return result;
+    }
+    if (!(status & CCS811_STATUS_FW_MODE)) {
+        return I2C_ERROR;
+    }
+    return setDriveMode(sensor, driveMode);
+}
+
+/**
+ * Checks the hardware ID, starts the application firmware if the
+ * sensor is still in boot mode and sets the drive mode.
+ *
+ * @param sensor sensor ID
+ * @param driveMode one of the CCS811_MODE_* values
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int initAirSensor(int sensor, int driveMode) {
+    int started;
+    int result = startAirSensor(sensor, &started);
+    if (result != I2C_OK) {
+        return result;
+    }
+    if (started) {
+        usleep(CCS811_APP_START_US);
+    }
+    return finishAirSensor(sensor, driveMode);
+}
+
+/**
+ * Sets the drive mode in MEAS_MODE, the interrupt stays disabled
+ * (see p. 16).
+ *
+ * @param sensor sensor ID
+ * @param driveMode one of the CCS811_MODE_* values
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int setDriveMode(int sensor, int driveMode) {
+    return i2cTryWriteReg8(sensor, CCS811_MEAS_MODE, (driveMode & 0x7) << 4);
+}
+
+/**
+ * Returns the interval the sensor measures in with the given
+ * drive mode (see p. 16).
+ *
+ * @param driveMode one of the CCS811_MODE_* values
+ * @return interval in us, 0 for idle or an invalid mode
+ */
+uint32_t driveModeIntervalUs(int driveMode) {
+    static const uint32_t intervals[] = {0, 1000000, 10000000, 60000000, 250000};
+    if (driveMode < CCS811_MODE_IDLE || driveMode > CCS811_MODE_250MS) {
+        return 0;
+    }
+    return intervals[driveMode];
+}
+
+/**
+ * Reads the status register 0x00 (see p. 15).
+ *
+ * @param sensor sensor ID
+ * @param status read status
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int readAirStatus(int sensor, uint8_t *status) {
+    return i2cTryReadReg8(sensor, CCS811_STATUS, status);
+}
+
+/**
+ * Reads eCO2, TVOC and the status of the last result with one
+ * burst read of ALG_RESULT_DATA (see p. 18). All values are
+ * stored MSB first. Reading clears DATA_READY.
+ *
+ * @param sensor sensor ID
+ * @param data read values
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int readAlgorithmResult(int sensor, airData *data) {
+    uint8_t block[CCS811_ALG_RESULT_LENGTH];
+    int status = i2cTryReadBlock(sensor, CCS811_ALG_RESULT_DATA, block, sizeof(block));
+    if (status != I2C_OK) {
+        return status;
+    }
+    return decodeAlgorithmResult(block, data);
+}
+
+/**
+ * Decodes a burst read of CCS811_ALG_RESULT_LENGTH bytes from
+ * ALG_RESULT_DATA, the values are stored MSB first.
+ *
+ * @param block ALG_RESULT_DATA
+ * @param data decoded values
+ * @return I2C_OK, I2C_ERROR if the status has the error bit set
+ */
+int decodeAlgorithmResult(const uint8_t *block, airData *data) {
+    data->eCO2 = (uint16_t) (block[0] << 8 | block[1]);
+    data->TVOC = (uint16_t) (block[2] << 8 | block[3]);
+    data->status = block[4];
+    data->errorId = block[5];
+    data->raw = (uint16_t) (block[6] << 8 | block[7]);
+    return (data->status & CCS811_STATUS_ERROR) ? I2C_ERROR : I2C_OK;
+}
+
+/**
+ * Reads RAW_DATA (see p. 19), stored MSB first. In the 250ms drive
+ * mode it is updated every 250ms while ALG_RESULT_DATA is not.
+ *
+ * @param sensor sensor ID
+ * @param raw read value, see CCS811_RAW_CURRENT and CCS811_RAW_VOLTAGE
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int readAirRaw(int sensor, uint16_t *raw) {
+    uint8_t block[2];
+    int status = i2cTryReadBlock(sensor, CCS811_RAW_DATA, block, sizeof(block));
+    if (status != I2C_OK) {
+        return status;
+    }
+    *raw = (uint16_t) (block[0] << 8 | block[1]);
+    return I2C_OK;
+}
+
+/**
+ * Reads BASELINE (see p. 21), stored MSB first. The value is only
+ * meaningful to the sensor itself.
+ *
+ * @param sensor sensor ID
+ * @param baseline read value
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int readAirBaseline(int sensor, uint16_t *baseline) {
+    uint8_t block[2];
+    int status = i2cTryReadBlock(sensor, CCS811_BASELINE, block, sizeof(block));
+    if (status != I2C_OK) {
+        return status;
+    }
+    *baseline = (uint16_t) (block[0] << 8 | block[1]);
+    return I2C_OK;
+}
+
+/**
+ * Writes BASELINE (see p. 21). SMBus words are sent LSB first, the
+ * sensor expects the MSB first, so the bytes are swapped.
+ *
+ * @param sensor sensor ID
+ * @param baseline value read with readAirBaseline before
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int writeAirBaseline(int sensor, uint16_t baseline) {
+    return i2cTryWriteReg16(sensor, CCS811_BASELINE, (baseline >> 8) | (baseline & 0xFF) << 8);
+}
@@ -0,0 +1,186 @@
+/**
+ * <Program>
+ * CCS811_AirSensor.h
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ * Header file for the native CCS811 driver from ams. Defines the
+ * registers needed to start the application, select the drive
+ * mode and read the algorithm results (eCO2 and TVOC) without
+ * the external CCS811 library, so the sensor can be driven by the
+ * sensor loop together with the other sensors.
+ *
+ * In the 250ms drive mode the sensor does not run its algorithm,
+ * only RAW_DATA is updated: the current through the sensor and
+ * the voltage across it, from which the host computes the
+ * resistance of the metal oxide.
+ *
+ * <Sources>
+ * Accessed on 18.10.2026 - CCS811 Datasheet:
+ *      https://cdn.sparkfun.com/assets/learn_tutorials/1/4/3/CCS811_Datasheet-DS000459.pdf
+ */
+
+#ifndef SRC_CCS811_AIRSENSOR_H
+#define SRC_CCS811_AIRSENSOR_H
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include "I2CBus.h"
+
+/* --- I2C address --- */
+#define CCS811_ADDRESS 0x5A
+
+/* --- Registers --- */
+#define CCS811_STATUS          0x00
+#define CCS811_MEAS_MODE       0x01
+#define CCS811_ALG_RESULT_DATA 0x02
+#define CCS811_RAW_DATA        0x03
+#define CCS811_ENV_DATA        0x05
+#define CCS811_BASELINE        0x11
+#define CCS811_HW_ID           0x20
+#define CCS811_ERROR_ID        0xE0
+#define CCS811_APP_START       0xF4
+#define CCS811_SW_RESET        0xFF
+
+#define CCS811_HW_ID_CODE      0x81
+
+/* --- Status bits --- */
+#define CCS811_STATUS_ERROR      0x01
+#define CCS811_STATUS_DATA_READY 0x08
+#define CCS811_STATUS_APP_VALID  0x10
+#define CCS811_STATUS_FW_MODE    0x80
+
+/* --- Drive modes (MEAS_MODE[6:4]) --- */
+#define CCS811_MODE_IDLE  0
+#define CCS811_MODE_1S    1
+#define CCS811_MODE_10S   2
+#define CCS811_MODE_60S   3
+#define CCS811_MODE_250MS 4
+
+/* ALG_RESULT_DATA: eCO2, TVOC, STATUS, ERROR_ID, RAW_DATA */
+#define CCS811_ALG_RESULT_LENGTH 8
+
+/* RAW_DATA: current in uA (bits 15:10), voltage ADC (bits 9:0, 1023 = 1.65V) */
+#define CCS811_RAW_CURRENT(raw) ((raw) >> 10)
+#define CCS811_RAW_VOLTAGE(raw) ((raw) & 0x3FF)
+#define CCS811_RAW_VOLTAGE_FULL_SCALE 1.65
+
+/* Time the application needs to start (tAPP_START, p. 9) in us */
+#define CCS811_APP_START_US 1000
+
+/* Used to hold the algorithm results */
+typedef struct {
+    uint16_t eCO2;
+    uint16_t TVOC;
+    uint8_t status;
+    uint8_t errorId;
+    uint16_t raw;
+} airData;
+
+/* METHODS */
+
+/**
+ * First half of the initialization: checks the hardware ID and
+ * starts the application firmware if the sensor is still in boot
+ * mode. If it was started, the sensor needs CCS811_APP_START_US
+ * before finishAirSensor is called.
+ *
+ * @param sensor sensor ID
+ * @param started set to 1 if the application was started, 0 if it was running
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int startAirSensor(int sensor, int *started);
+/**
+ * Second half of the initialization: checks that the application
+ * runs and sets the drive mode.
+ *
+ * @param sensor sensor ID
+ * @param driveMode one of the CCS811_MODE_* values
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int finishAirSensor(int sensor, int driveMode);
+/**
+ * Checks the hardware ID, starts the application firmware if the
+ * sensor is still in boot mode and sets the drive mode.
+ *
+ * @param sensor sensor ID
+ * @param driveMode one of the CCS811_MODE_* values
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int initAirSensor(int sensor, int driveMode);
+/**
+ * Sets the drive mode in MEAS_MODE, the interrupt stays disabled.
+ *
+ * @param sensor sensor ID
+ * @param driveMode one of the CCS811_MODE_* values
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int setDriveMode(int sensor, int driveMode);
+/**
+ * Returns the interval the sensor measures in with the given
+ * drive mode.
+ *
+ * @param driveMode one of the CCS811_MODE_* values
+ * @return interval in us, 0 for idle or an invalid mode
+ */
+uint32_t driveModeIntervalUs(int driveMode);
+/**
+ * Reads the status register 0x00.
+ *
+ * @param sensor sensor ID
+ * @param status read status
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int readAirStatus(int sensor, uint8_t *status);
+/**
+ * Reads eCO2, TVOC and the status of the last result with one
+ * burst read of ALG_RESULT_DATA. Reading clears DATA_READY.
+ *
+ * @param sensor sensor ID
+ * @param data read values
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int readAlgorithmResult(int sensor, airData *data);
+/**
+ * Decodes a burst read of CCS811_ALG_RESULT_LENGTH bytes from
+ * ALG_RESULT_DATA, the values are stored MSB first.
+ *
+ * @param block ALG_RESULT_DATA
+ * @param data decoded values
+ * @return I2C_OK, I2C_ERROR if the status has the error bit set
+ */
+int decodeAlgorithmResult(const uint8_t *block, airData *data);
+/**
+ * Reads RAW_DATA, the current through the sensor and the voltage
+ * across it, the only result of the 250ms drive mode.
+ *
+ * @param sensor sensor ID
+ * @param raw read value, see CCS811_RAW_CURRENT and CCS811_RAW_VOLTAGE
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int readAirRaw(int sensor, uint16_t *raw);
+/**
+ * Reads BASELINE, the encoded reference resistance the algorithm
+ * learned.
+ *
+ * @param sensor sensor ID
+ * @param baseline read value
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int readAirBaseline(int sensor, uint16_t *baseline);
+/**
+ * Writes BASELINE, so the algorithm continues with a reference it
+ * learned before instead of learning it again.
+ *
+ * @param sensor sensor ID
+ * @param baseline value read with readAirBaseline before
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int writeAirBaseline(int sensor, uint16_t baseline);
+
+#endif //SRC_CCS811_AIRSENSOR_H
@@ -0,0 +1,665 @@
+/**
+ * <Program>
+ * Collector.c
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ *  Server collecting the samples of a cluster of boxes. The I/O
+ * thread waits on the UDP socket, the TCP listening socket and all
+ * TCP connections with one epoll instance. Received frames are
+ * queued to the worker owning the box, the workers decode the
+ * frames and append the samples to one segmented log per box.
+ *  Usage: collector [-p port] [-w workers] [-d directory]
+ *
+ * <Sources>
+ * Accessed on 18.10.2026 - recvmmsg(2), eventfd(2), signalfd(2):
+ *      https://man7.org/linux/man-pages/man2/recvmmsg.2.html
+ *      https://man7.org/linux/man-pages/man2/eventfd.2.html
+ *      https://man7.org/linux/man-pages/man2/signalfd.2.html
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/timerfd.h>
+#include "Collector.h"
+
+#define COUNT(counter, value) __atomic_fetch_add(&(counter), (value), __ATOMIC_RELAXED)
+#define LOAD(counter) __atomic_load_n(&(counter), __ATOMIC_RELAXED)
+
+/* Used by the I/O thread to receive a batch of datagrams */
+static uint8_t (*datagrams)[FRAME_BYTES_MAX];
+
+/**
+ * Returns the current time of the monotonic clock in milliseconds.
+ */
+static int64_t monotonicMs(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t) now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+/**
+ * Spreads consecutive box IDs over the table (Fibonacci hashing).
+ */
+static size_t hashBox(uint32_t boxId) {
+    return (size_t) (boxId * 2654435761u);
+}
+
+/**
+ * Doubles the box table of a worker and inserts all boxes again.
+ *
+ * @return 0 on success, -1 if there is not enough memory
+ */
+static int growBoxes(collectorWorker *worker) {
+    size_t capacity = worker->boxCapacity == 0 ? 64 : worker->boxCapacity * 2;
+    boxLog *boxes = calloc(capacity, sizeof(boxLog));
+    if (boxes == NULL) {
+        return -1;
+    }
+    for (size_t i = 0; i < worker->boxCapacity; i++) {
+        if (worker->boxes[i].log != NULL) {
+            size_t slot = hashBox(worker->boxes[i].boxId) & (capacity - 1);
+            while (boxes[slot].log != NULL) {
+                slot = (slot + 1) & (capacity - 1);
+            }
+            boxes[slot] = worker->boxes[i];
+        }
+    }
+    free(worker->boxes);
+    worker->boxes = boxes;
+    worker->boxCapacity = capacity;
+    return 0;
+}
+
+/**
+ * Returns the log of a box, it is opened on the first frame of
+ * the box. The table is kept at most 70% full.
+ *
+ * @return opened log, NULL on failure
+ */
+static sensorLog *boxLogFor(collectorWorker *worker, uint32_t boxId) {
+    if ((worker->boxCount + 1) * 10 > worker->boxCapacity * 7 && growBoxes(worker) < 0) {
+        return NULL;
+    }
+
+    size_t slot = hashBox(boxId) & (worker->boxCapacity - 1);
+    while (worker->boxes[slot].log != NULL) {
+        if (worker->boxes[slot].boxId == boxId) {
+            return worker->boxes[slot].log;
+        }
+        slot = (slot + 1) & (worker->boxCapacity - 1);
+    }
+
+    char name[LOG_NAME_MAX + 16];
+    logConfig config;
+    defaultLogConfig(&config);
+    config.segmentSize = 1024 * 1024;
+    config.chunkSize = COLLECTOR_CHUNK_SIZE;
+    snprintf(name, sizeof(name), "%s/box%08" PRIx32, worker->collector->directory, boxId);
+
+    sensorLog *log = malloc(sizeof(sensorLog));
+    if (log == NULL || openSensorLog(log, name, COLLECTOR_HEADER, &config) < 0) {
+        fprintf(stderr, "log %s could not be opened: %s\n", name, strerror(errno));
+        free(log);
+        return NULL;
+    }
+    worker->boxes[slot].boxId = boxId;
+    worker->boxes[slot].log = log;
+    worker->boxCount++;
+    COUNT(worker->collector->stats.boxes, 1);
+    return log;
+}
+
+/**
+ * Decodes a frame and appends its samples to the log of the box.
+ */
+static void writeFrame(collectorWorker *worker, const queuedFrame *frame) {
+    collectorStats *stats = &worker->collector->stats;
+    frameHeader header;
+    frameSample samples[FRAME_SAMPLES_MAX];
+
+    long count = decodeFrame(frame->data, frame->length, &header, samples);
+    if (count < 0) {
+        COUNT(stats->invalidFrames, 1);
+        return;
+    }
+    sensorLog *log = boxLogFor(worker, header.boxId);
+    if (log == NULL) {
+        COUNT(stats->writeErrors, (uint64_t) count);
+        return;
+    }
+
+    uint64_t written = 0;
+    for (long i = 0; i < count; i++) {
+        const frameSample *sample = &samples[i];
+        char row[LOG_ROW_MAX];
+        snprintf(row, sizeof(row), "%.2f;%.2f;%.2f;%.2f;%u;%u;%u;%u;%u",
+                 sample->temperature / 100.0, sample->humidity / 1024.0, sample->pressure / 256.0 / 100.0,
+                 sample->uv / 100.0, sample->ir, sample->vis, sample->eCO2, sample->TVOC, sample->status);
+        if (appendSensorLog(log, sample->time / 1000000, row) < 0) {
+            COUNT(stats->writeErrors, 1);
+        } else {
+            written++;
+        }
+    }
+    COUNT(stats->samples, written);
+}
+
+/**
+ * Worker thread, writes the frames of its queue until the
+ * collector stops and the queue is empty.
+ */
+static void *runWorker(void *argument) {
+    collectorWorker *worker = argument;
+    collector *server = worker->collector;
+
+    for (;;) {
+        pthread_mutex_lock(&worker->lock);
+        while (worker->depth == 0 && server->running) {
+            pthread_cond_wait(&worker->available, &worker->lock);
+        }
+        if (worker->depth == 0) {
+            pthread_mutex_unlock(&worker->lock);
+            break;
+        }
+        queuedFrame frame = worker->queue[worker->head];
+        worker->head = (worker->head + 1) % COLLECTOR_QUEUE;
+        worker->depth--;
+        int resume = worker->blocked && worker->depth <= COLLECTOR_QUEUE / 2;
+        if (resume) {
+            worker->blocked = 0;
+        }
+        pthread_mutex_unlock(&worker->lock);
+
+        if (resume) {
+            uint64_t one = 1;
+            if (write(server->resumeFd, &one, sizeof(one)) < 0) {
+                perror("resume");
+            }
+        }
+        writeFrame(worker, &frame);
+        free(frame.data);
+    }
+
+    for (size_t i = 0; i < worker->boxCapacity; i++) {
+        if (worker->boxes[i].log != NULL) {
+            closeSensorLog(worker->boxes[i].log);
+            free(worker->boxes[i].log);
+        }
+    }
+    free(worker->boxes);
+    worker->boxes = NULL;
+    return NULL;
+}
+
+/**
+ * Queues a frame to the worker owning the box.
+ *
+ * @param fromConnection 1 if the frame came over TCP, it is kept by
+ *                       the caller instead of dropped if the queue is full
+ * @return 1 if the frame was consumed (queued, invalid or dropped),
+ *         0 if the connection has to wait for the worker
+ */
+static int queueFrame(collector *server, const uint8_t *data, size_t length, int fromConnection) {
+    uint32_t boxId;
+    if (peekFrameBox(data, length, &boxId) < 0) {
+        COUNT(server->stats.invalidFrames, 1);
+        return 1;
+    }
+    collectorWorker *worker = &server->workers[hashBox(boxId) % (size_t) server->workerCount];
+
+    pthread_mutex_lock(&worker->lock);
+    if (worker->depth == COLLECTOR_QUEUE) {
+        if (fromConnection) {
+            worker->blocked = 1;
+        }
+        pthread_mutex_unlock(&worker->lock);
+        if (!fromConnection) {
+            COUNT(server->stats.droppedFrames, 1);
+        }
+        return !fromConnection;
+    }
+    pthread_mutex_unlock(&worker->lock);
+
+    /* Only the I/O thread adds frames, so the queue can not fill up meanwhile */
+    uint8_t *copy = malloc(length);
+    if (copy == NULL) {
+        COUNT(server->stats.droppedFrames, 1);
+        return 1;
+    }
+    memcpy(copy, data, length);
+
+    pthread_mutex_lock(&worker->lock);
+    worker->queue[(worker->head + worker->depth) % COLLECTOR_QUEUE] = (queuedFrame) {copy, (uint32_t) length};
+    worker->depth++;
+    if (worker->depth > worker->maxDepth) {
+        worker->maxDepth = worker->depth;
+    }
+    pthread_cond_signal(&worker->available);
+    pthread_mutex_unlock(&worker->lock);
+
+    COUNT(server->stats.frames, 1);
+    COUNT(server->stats.bytes, length);
+    return 1;
+}
+
+/**
+ * Receives datagrams in batches, every datagram is one frame.
+ */
+static void receiveDatagrams(collector *server) {
+    struct mmsghdr messages[COLLECTOR_RECEIVE_BATCH];
+    struct iovec vectors[COLLECTOR_RECEIVE_BATCH];
+    int received;
+
+    do {
+        memset(messages, 0, sizeof(messages));
+        for (int i = 0; i < COLLECTOR_RECEIVE_BATCH; i++) {
+            vectors[i].iov_base = datagrams[i];
+            vectors[i].iov_len = FRAME_BYTES_MAX;
+            messages[i].msg_hdr.msg_iov = &vectors[i];
+            messages[i].msg_hdr.msg_iovlen = 1;
+        }
+        received = recvmmsg(server->udpFd, messages, COLLECTOR_RECEIVE_BATCH, MSG_DONTWAIT, NULL);
+        for (int i = 0; i < received; i++) {
+            if (messages[i].msg_hdr.msg_flags & MSG_TRUNC) {
+                COUNT(server->stats.invalidFrames, 1);
+                continue;
+            }
+            queueFrame(server, datagrams[i], messages[i].msg_len, 0);
+        }
+    } while (received == COLLECTOR_RECEIVE_BATCH);
+}
+
+/**
+ * Closes a TCP connection, a partly received frame is lost.
+ */
+static void closeConnection(collector *server, collectorConnection *connection) {
+    epoll_ctl(server->epollFd, EPOLL_CTL_DEL, connection->fd, NULL);
+    close(connection->fd);
+    server->connections[connection->fd] = NULL;
+    free(connection);
+}
+
+/**
+ * Queues all complete frames of the connection buffer.
+ *
+ * @return 1 if all were queued, 0 if a queue is full, -1 if the
+ *         stream is broken (frame length out of range)
+ */
+static int queueBuffered(collector *server, collectorConnection *connection) {
+    size_t offset = 0;
+    int result = 1;
+    while (connection->used - offset >= 4) {
+        uint32_t length;
+        memcpy(&length, connection->buffer + offset, sizeof(length));
+        if (length < FRAME_BYTES_MIN || length > FRAME_BYTES_MAX) {
+            COUNT(server->stats.invalidFrames, 1);
+            return -1;
+        }
+        if (connection->used - offset < 4 + length) {
+            break;
+        }
+        if (!queueFrame(server, connection->buffer + offset + 4, length, 1)) {
+            result = 0;
+            break;
+        }
+        offset += 4 + length;
+    }
+    memmove(connection->buffer, connection->buffer + offset, connection->used - offset);
+    connection->used -= offset;
+    return result;
+}
+
+/**
+ * Reads from a connection until the socket is drained or a queue
+ * is full. In the latter case the connection is paused: it is not
+ * watched any more until a worker signals that it caught up.
+ */
+static void readConnection(collector *server, collectorConnection *connection) {
+    for (;;) {
+        int queued = queueBuffered(server, connection);
+        if (queued < 0) {
+            closeConnection(server, connection);
+            return;
+        }
+        if (queued == 0) {
+            struct epoll_event event = {0, {.fd = connection->fd}};
+            connection->paused = 1;
+            epoll_ctl(server->epollFd, EPOLL_CTL_MOD, connection->fd, &event);
+            COUNT(server->stats.pauses, 1);
+            return;
+        }
+
+        ssize_t length = recv(connection->fd, connection->buffer + connection->used,
+                              sizeof(connection->buffer) - connection->used, MSG_DONTWAIT);
+        if (length < 0 && errno == EINTR) {
+            continue;
+        }
+        if (length < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return;
+        }
+        if (length <= 0) {
+            closeConnection(server, connection);
+            return;
+        }
+        connection->used += (size_t) length;
+    }
+}
+
+/**
+ * Accepts all pending TCP connections.
+ */
+static void acceptConnections(collector *server) {
+    for (;;) {
+        int fd = accept4(server->listenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            return;
+        }
+        collectorConnection *connection = fd < COLLECTOR_CONNECTIONS_MAX ? malloc(sizeof(collectorConnection)) : NULL;
+        struct epoll_event event = {EPOLLIN, {.fd = fd}};
+        if (connection == NULL || epoll_ctl(server->epollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+            free(connection);
+            close(fd);
+            continue;
+        }
+        connection->fd = fd;
+        connection->paused = 0;
+        connection->used = 0;
+        server->connections[fd] = connection;
+        COUNT(server->stats.connections, 1);
+    }
+}
+
+/**
+ * Continues reading all paused connections after a worker drained
+ * its queue. Connections of other, still full queues pause again.
+ */
+static void resumeConnections(collector *server) {
+    uint64_t count;
+    if (read(server->resumeFd, &count, sizeof(count)) < 0) {
+        return;
+    }
+    for (int fd = 0; fd < COLLECTOR_CONNECTIONS_MAX; fd++) {
+        collectorConnection *connection = server->connections[fd];
+        if (connection != NULL && connection->paused) {
+            struct epoll_event event = {EPOLLIN, {.fd = fd}};
+            connection->paused = 0;
+            epoll_ctl(server->epollFd, EPOLL_CTL_MOD, fd, &event);
+            readConnection(server, connection);
+        }
+    }
+}
+
+/**
+ * Prints the throughput since the last report.
+ */
+static void report(collector *server, collectorStats *last, int64_t *lastMs) {
+    uint64_t expirations;
+    if (read(server->reportFd, &expirations, sizeof(expirations)) < 0) {
+        return;
+    }
+
+    collectorStats now = {
+            LOAD(server->stats.frames), LOAD(server->stats.bytes), LOAD(server->stats.samples),
+            LOAD(server->stats.invalidFrames), LOAD(server->stats.droppedFrames), LOAD(server->stats.pauses),
+            LOAD(server->stats.writeErrors), LOAD(server->stats.boxes), LOAD(server->stats.connections)
+    };
+    int64_t nowMs = monotonicMs();
+    double seconds = (nowMs - *lastMs) / 1000.0;
+
+    size_t maxDepth = 0;
+    for (int i = 0; i < server->workerCount; i++) {
+        collectorWorker *worker = &server->workers[i];
+        pthread_mutex_lock(&worker->lock);
+        if (worker->maxDepth > maxDepth) {
+            maxDepth = worker->maxDepth;
+        }
+        worker->maxDepth = worker->depth;
+        pthread_mutex_unlock(&worker->lock);
+    }
+
+    printf("%.0f frames/s, %.0f samples/s, %.2f MB/s, boxes %" PRIu64 ", dropped %" PRIu64
+           ", invalid %" PRIu64 ", pauses %" PRIu64 ", max queue %zu/%d\n",
+           (now.frames - last->frames) / seconds, (now.samples - last->samples) / seconds,
+           (now.bytes - last->bytes) / seconds / 1e6, now.boxes, now.droppedFrames - last->droppedFrames,
+           now.invalidFrames - last->invalidFrames, now.pauses - last->pauses, maxDepth, COLLECTOR_QUEUE);
+    fflush(stdout);
+    *last = now;
+    *lastMs = nowMs;
+}
+
+/**
+ * Adds a file descriptor to the epoll instance.
+ *
+ * @return 0 on success, -1 on failure
+ */
+static int watch(collector *server, int fd) {
+    struct epoll_event event = {EPOLLIN, {.fd = fd}};
+    return fd < 0 ? -1 : epoll_ctl(server->epollFd, EPOLL_CTL_ADD, fd, &event);
+}
+
+/**
+ * Opens the sockets and starts the workers.
+ *
+ * @param server collector to initialize
+ * @param port UDP and TCP port
+ * @param workers number of worker threads
+ * @param directory directory the box logs are written to
+ * @return 0 on success, -1 on failure (errno is set)
+ */
+int openCollector(collector *server, int port, int workers, const char *directory) {
+    memset(server, 0, sizeof(collector));
+    server->epollFd = server->udpFd = server->listenFd = -1;
+    server->resumeFd = server->reportFd = server->signalFd = -1;
+    if (workers < 1 || workers > COLLECTOR_WORKERS_MAX || strlen(directory) >= LOG_NAME_MAX - 16) {
+        errno = EINVAL;
+        return -1;
+    }
+    strcpy(server->directory, directory);
+    server->running = 1;
+
+    datagrams = malloc(sizeof(*datagrams) * COLLECTOR_RECEIVE_BATCH);
+    if (datagrams == NULL) {
+        return -1;
+    }
+
+    /* The signals are received through the signalfd, the workers inherit the mask */
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons((uint16_t) port);
+    int one = 1;
+    int receiveBuffer = 8 * 1024 * 1024;
+
+    server->epollFd = epoll_create1(EPOLL_CLOEXEC);
+    server->udpFd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    server->listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (server->epollFd < 0 || server->udpFd < 0 || server->listenFd < 0) {
+        return -1;
+    }
+    setsockopt(server->udpFd, SOL_SOCKET, SO_RCVBUF, &receiveBuffer, sizeof(receiveBuffer));
+    setsockopt(server->listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (bind(server->udpFd, (struct sockaddr *) &address, sizeof(address)) < 0 ||
+        bind(server->listenFd, (struct sockaddr *) &address, sizeof(address)) < 0 ||
+        listen(server->listenFd, SOMAXCONN) < 0) {
+        return -1;
+    }
+
+    struct itimerspec interval = {{COLLECTOR_REPORT_MS / 1000, 0}, {COLLECTOR_REPORT_MS / 1000, 0}};
+    server->resumeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    server->reportFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    server->signalFd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (watch(server, server->udpFd) < 0 || watch(server, server->listenFd) < 0 ||
+        watch(server, server->resumeFd) < 0 || watch(server, server->reportFd) < 0 ||
+        watch(server, server->signalFd) < 0 || timerfd_settime(server->reportFd, 0, &interval, NULL) < 0) {
+        return -1;
+    }
+
+    for (int i = 0; i < workers; i++) {
+        collectorWorker *worker = &server->workers[i];
+        worker->collector = server;
+        pthread_mutex_init(&worker->lock, NULL);
+        pthread_cond_init(&worker->available, NULL);
+        int error = pthread_create(&worker->thread, NULL, runWorker, worker);
+        if (error != 0) {
+            errno = error;
+            return -1;
+        }
+        server->workerCount++;
+    }
+    return 0;
+}
+
+/**
+ * Receives frames until SIGINT or SIGTERM, printing the throughput
+ * every COLLECTOR_REPORT_MS.
+ *
+ * @param server opened collector
+ * @return 0 on a clean shutdown, -1 on failure
+ */
+int runCollector(collector *server) {
+    collectorStats last;
+    memset(&last, 0, sizeof(last));
+    int64_t lastMs = monotonicMs();
+
+    for (;;) {
+        struct epoll_event events[64];
+        int ready = epoll_wait(server->epollFd, events, 64, -1);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+
+        for (int i = 0; i < ready; i++) {
+            int fd = events[i].data.fd;
+            if (fd == server->udpFd) {
+                receiveDatagrams(server);
+            } else if (fd == server->listenFd) {
+                acceptConnections(server);
+            } else if (fd == server->resumeFd) {
+                resumeConnections(server);
+            } else if (fd == server->reportFd) {
+                report(server, &last, &lastMs);
+            } else if (fd == server->signalFd) {
+                return 0;
+            } else if (server->connections[fd] != NULL) {
+                readConnection(server, server->connections[fd]);
+            }
+        }
+    }
+}
+
+/**
+ * Stops the workers after their queues are empty, closes all logs
+ * and sockets and prints a summary.
+ *
+ * @param server opened collector
+ */
+void closeCollector(collector *server) {
+    for (int i = 0; i < server->workerCount; i++) {
+        collectorWorker *worker = &server->workers[i];
+        pthread_mutex_lock(&worker->lock);
+        server->running = 0;
+        pthread_cond_signal(&worker->available);
+        pthread_mutex_unlock(&worker->lock);
+    }
+    for (int i = 0; i < server->workerCount; i++) {
+        pthread_join(server->workers[i].thread, NULL);
+    }
+
+    for (int fd = 0; fd < COLLECTOR_CONNECTIONS_MAX; fd++) {
+        if (server->connections[fd] != NULL) {
+            closeConnection(server, server->connections[fd]);
+        }
+    }
+    int fds[] = {server->epollFd, server->udpFd, server->listenFd, server->resumeFd, server->reportFd,
+                 server->signalFd};
+    for (size_t i = 0; i < sizeof(fds) / sizeof(fds[0]); i++) {
+        if (fds[i] >= 0) {
+            close(fds[i]);
+        }
+    }
+    free(datagrams);
+    datagrams = NULL;
+
+    collectorStats *stats = &server->stats;
+    printf("frames %" PRIu64 ", samples %" PRIu64 ", bytes %" PRIu64 ", boxes %" PRIu64 ", connections %" PRIu64
+           ", dropped %" PRIu64 ", invalid %" PRIu64 ", pauses %" PRIu64 ", write errors %" PRIu64 "\n",
+           stats->frames, stats->samples, stats->bytes, stats->boxes, stats->connections, stats->droppedFrames,
+           stats->invalidFrames, stats->pauses, stats->writeErrors);
+}
+
+int main(int argc, char **argv) {
+    int port = COLLECTOR_PORT;
+    int workers = COLLECTOR_WORKERS;
+    const char *directory = ".";
+    int option;
+
+    while ((option = getopt(argc, argv, "p:w:d:")) != -1) {
+        switch (option) {
+            case 'p':
+                port = atoi(optarg);
+                break;
+            case 'w':
+                workers = atoi(optarg);
+                break;
+            case 'd':
+                directory = optarg;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-p port] [-w workers] [-d directory]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    /* Every box needs a catalog, segment and index file */
+    struct rlimit files;
+    if (getrlimit(RLIMIT_NOFILE, &files) == 0) {
+        files.rlim_cur = files.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &files);
+    }
+    mkdir(directory, 0755);
+
+    static collector server;
+    if (openCollector(&server, port, workers, directory) < 0) {
+        perror("collector");
+        closeCollector(&server);
+        return 1;
+    }
+    printf("collecting on port %i with %i workers into %s\n", port, workers, directory);
+    fflush(stdout);
+
+    int result = runCollector(&server);
+    closeCollector(&server);
+    return result < 0 ? 1 : 0;
+}
@@ -0,0 +1,142 @@
+/**
+ * <Program>
+ * Collector.h
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ * Header file for the collector, the server boxes of a cluster
+ * send their samples to. Frames are received over UDP and TCP by
+ * one I/O thread and handed to a fixed number of workers, the
+ * worker is picked by the box ID so all frames of a box are
+ * written in order by the same thread. Every box gets its own
+ * segmented sensor log (see SensorLog.h).
+ *
+ * Every worker has a bounded queue. If it is full, UDP frames
+ * are dropped and TCP connections are not read any more until the
+ * worker caught up to half of the queue, so TCP senders are
+ * slowed down by the kernel's flow control instead of losing data.
+ */
+
+#ifndef SRC_COLLECTOR_H
+#define SRC_COLLECTOR_H
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include "SensorFrame.h"
+#include "SensorLog.h"
+
+#define COLLECTOR_PORT            7311
+#define COLLECTOR_WORKERS         4
+#define COLLECTOR_WORKERS_MAX     64
+#define COLLECTOR_QUEUE           256    /* frames per worker */
+#define COLLECTOR_CONNECTIONS_MAX 4096
+#define COLLECTOR_RECEIVE_BATCH   64     /* datagrams per recvmmsg */
+#define COLLECTOR_REPORT_MS       5000
+#define COLLECTOR_CHUNK_SIZE      (16 * 1024) /* write buffer per box log */
+#define COLLECTOR_HEADER          "Temperature;Humidity;Pressure;UV;IR;VIS;eCO2;TVOC;Status"
+
+/* Used to count what the collector did, all counters are updated atomically */
+typedef struct {
+    uint64_t frames;         /* frames accepted into a queue */
+    uint64_t bytes;
+    uint64_t samples;        /* samples written to a log */
+    uint64_t invalidFrames;  /* frames that could not be decoded */
+    uint64_t droppedFrames;  /* UDP frames dropped because the queue was full */
+    uint64_t pauses;         /* TCP connections paused because the queue was full */
+    uint64_t writeErrors;    /* samples the log refused (i. e. out of order) */
+    uint64_t boxes;
+    uint64_t connections;
+} collectorStats;
+
+/* A received frame waiting for its worker */
+typedef struct {
+    uint8_t *data;
+    uint32_t length;
+} queuedFrame;
+
+/* The log of a single box, kept by the worker the box belongs to */
+typedef struct {
+    uint32_t boxId;
+    sensorLog *log;
+} boxLog;
+
+struct collector;
+
+/* Used to hold a worker thread and its queue */
+typedef struct {
+    struct collector *collector;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t available;
+    queuedFrame queue[COLLECTOR_QUEUE];
+    size_t head;
+    size_t depth;
+    size_t maxDepth;
+    int blocked;        /* a connection waits for this queue */
+
+    /* Open addressing table of the boxes of this worker */
+    boxLog *boxes;
+    size_t boxCount;
+    size_t boxCapacity;
+} collectorWorker;
+
+/* Used to hold a TCP connection, frames are read into the buffer */
+typedef struct {
+    int fd;
+    int paused;
+    size_t used;
+    uint8_t buffer[4 + FRAME_BYTES_MAX];
+} collectorConnection;
+
+/* Used to hold the whole server */
+typedef struct collector {
+    char directory[LOG_NAME_MAX];
+    int workerCount;
+    collectorWorker workers[COLLECTOR_WORKERS_MAX];
+    collectorStats stats;
+    volatile int running;
+
+    int epollFd;
+    int udpFd;
+    int listenFd;
+    int resumeFd;   /* eventfd, written by workers when a blocked queue drained */
+    int reportFd;   /* timerfd for the periodic report */
+    int signalFd;
+    collectorConnection *connections[COLLECTOR_CONNECTIONS_MAX];
+} collector;
+
+/* METHODS */
+
+/**
+ * Opens the sockets and starts the workers.
+ *
+ * @param server collector to initialize
+ * @param port UDP and TCP port
+ * @param workers number of worker threads
+ * @param directory directory the box logs are written to
+ * @return 0 on success, -1 on failure (errno is set)
+ */
+int openCollector(collector *server, int port, int workers, const char *directory);
+/**
+ * Receives frames until SIGINT or SIGTERM, printing the throughput
+ * every COLLECTOR_REPORT_MS.
+ *
+ * @param server opened collector
+ * @return 0 on a clean shutdown, -1 on failure
+ */
+int runCollector(collector *server);
+/**
+ * Stops the workers after their queues are empty, closes all logs
+ * and sockets and prints a summary.
+ *
+ * @param server opened collector
+ */
+void closeCollector(collector *server);
+
+#endif //SRC_COLLECTOR_H
@@ -0,0 +1,1745 @@
+/**
+ * <Program>
+ * CosyBox.c
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ *  Python module cosybox, giving access to all channels of the box
+ * with a single call. snapshot() runs one round of the sensor
+ * loop, so every sensor is read with one coordinated bus sequence,
+ * and returns all values, their timestamps and the status of every
+ * sensor as a struct sequence (like time.struct_time).
+ *  The struct sequence is kept between calls and filled in again
+ * if the caller did not keep a reference to the last one, so a
+ * sampling loop does not allocate a new object every round.
+ *  startup_times() tells how long the cold start of every sensor
+ * took, up to its first valid sample.
+ *  set_air_mode() switches the drive mode of the CCS811 at runtime.
+ * In the 250ms mode the raw current and voltage are streamed into
+ * a ring buffer, air_raw() returns the samples since its last call.
+ *  set_env_mode() and set_env_config() change the oversampling, IIR
+ * filter and standby time of the BME280. In normal mode pressure
+ * and temperature are streamed at the output rate of the sensor
+ * into a ring buffer, env_pressure() returns the samples since its
+ * last call.
+ *  accel_stream() starts the acceleration stream of the ADXL345 at
+ * up to 3200Hz (1600Hz without loss, see AccelStream.h), for
+ * vibration and seismograph experiments: the sensor measures into
+ * its FIFO, which is drained into a ring buffer whenever it reaches
+ * the watermark. accel_samples() returns the samples since its last
+ * call, accel_status() counts the drains and every sample lost on
+ * the way.
+ *  flicker_stream() lends the SI1145 to the flicker stream: the
+ * sensor measures VIS and IR every millisecond (on a 400kHz bus, on
+ * the default 100kHz one every 1.9ms with INT), a thread analyzes
+ * the samples with an FFT and reports the dominant flicker
+ * frequency, percent flicker, flicker index and band energies every
+ * few seconds (see FlickerStream.h). flicker_reports() returns the
+ * reports since its last call. The rounds skip the SI1145 until
+ * stop_flicker_stream() gives it back to them.
+ *  The baseline of the CCS811 is kept in AIR_BASELINE_FILE in the
+ * working directory, set_air_baseline_file() moves or disables it.
+ *  Every snapshot is published to the shared memory object
+ * SHARE_NAME, so other processes can read the latest values with
+ * the sampleshare module instead of opening the sensors again.
+ * share_samples() moves or disables it.
+ *  adaptive_snapshot() reads every sensor at an interval that
+ * follows its channels: short while they change fast, long while
+ * they are calm, within a share of the bus (see AdaptiveSampler.h).
+ * It sleeps until the next sensor is due and reads only the sensors
+ * due then. adaptive_sampling() sets the limits, rate_changes()
+ * returns the changes of the intervals.
+ *  set_outlier_filter() runs every value through a Hampel filter of
+ * its channel before it is returned, outliers are named in the
+ * outliers field of the snapshot and replaced by the median of
+ * their window if asked to. The shared sample gets the values as
+ * they were read.
+ *  periodic_snapshot() reads all sensors at a fixed period on an
+ * absolute timeline, so the time a round takes is not added to the
+ * period like with sleep() in between. Both it and
+ * adaptive_snapshot() record when every sensor was due and when it
+ * was read (see ScheduleStats.h), schedule_stats() returns the
+ * statistics and they are summarized on stderr when Python exits,
+ * also if it is stopped by SIGTERM or SIGHUP (i. e. when the service
+ * running save_sensor_data.r2py is stopped).
+ *
+ * <Sources>
+ * Accessed on 18.10.2026 - Struct Sequence Objects:
+ *      https://docs.python.org/2/c-api/tuple.html#struct-sequence-objects
+ * Accesses on 11.01.2018 - Extending Python with C
+ *      https://docs.python.org/2/extending/extending.html
+ */
+
+#include <Python.h>
+#include <structseq.h>
+#include <signal.h>
+#include "SensorDriver.h"
+#include "AirStream.h"
+#include "EnvStream.h"
+#include "AccelStream.h"
+#include "AccelSimulator.h"
+#include "FlickerStream.h"
+#include "SampleShare.h"
+#include "AdaptiveSampler.h"
+#include "OutlierFilter.h"
+#include "ScheduleStats.h"
+
+/*
+ * Position of the fields in the snapshot: time and duration, then
+ * the channels of boxDrivers in their order, the status and the
+ * time of every sensor in the order of the loop and the outliers.
+ * The fields from SNAPSHOT_VALUES on are laid out by snapshotLayout.
+ */
+#define SNAPSHOT_TIME       0
+#define SNAPSHOT_DURATION   1
+#define SNAPSHOT_VALUES     2
+#define SNAPSHOT_FIELDS_MAX (SNAPSHOT_VALUES + LOOP_CHANNELS_MAX + 2 * LOOP_SENSORS_MAX + 1)
+
+/* Modes of the outlier filter */
+#define OUTLIERS_OFF     0
+#define OUTLIERS_FLAG    1  /* outliers are kept and named in the outliers field */
+#define OUTLIERS_REPLACE 2  /* outliers are replaced by the median of their window as well */
+
+/* Fields of the snapshot, filled in by snapshotLayout */
+static PyStructSequence_Field snapshotFields[SNAPSHOT_FIELDS_MAX + 1] = {
+        {"time",        "start of the round (seconds since epoch)"},
+        {"duration_ms", "duration of the round"}
+};
+static char sensorFieldNames[LOOP_SENSORS_MAX][2][32];
+static char sensorFieldDocs[LOOP_SENSORS_MAX][2][64];
+
+/* Position of the fields after the values, and the number of fields */
+static int snapshotChannels = 0;
+static int snapshotStatus = 0;
+static int snapshotSensorTime = 0;
+static int snapshotOutliers = 0;
+static int snapshotFieldCount = 0;
+
+static PyStructSequence_Desc snapshotDesc = {
+        "cosybox.snapshot_result",
+        "Values of all channels read in one round. Values of a sensor\n"
+        "that failed are None, its status tells why.",
+        snapshotFields,
+        0
+};
+
+static PyTypeObject snapshotType;
+
+/* Loop kept open between calls and the last snapshot returned */
+static sensorLoop loop;
+static int loopOpen = 0;
+static PyObject *lastSnapshot = NULL;
+
+/* Raw stream of the CCS811 and the position of air_raw in it */
+static airStream airRawStream;
+static int streamRunning = 0;
+static uint64_t streamCursor = 0;
+
+/* Pressure stream of the BME280 in normal mode and the position of env_pressure in it */
+static envStream pressureStream;
+static int pressureRunning = 0;
+static uint64_t pressureCursor = 0;
+
+/* Acceleration stream of the ADXL345 and the position of accel_samples in it */
+static accelStream accelerationStream;
+static int accelRunning = 0;
+static int accelSimulated = 0;
+static uint64_t accelCursor = 0;
+
+/* Flicker stream of the SI1145 and the position of flicker_reports in it */
+static flickerStream lightFlicker;
+static int flickerRunning = 0;
+static uint64_t flickerCursor = 0;
+
+/* File the baseline of the CCS811 is kept in, empty to keep none */
+static char baselinePath[256] = AIR_BASELINE_FILE;
+
+/* Shared memory the snapshots are published to, empty to publish none */
+static char shareName[256] = SHARE_NAME;
+static sampleShare share;
+static int shareOpen = 0;
+static sharedSample shared; /* last values of every sensor */
+
+/*
+ * Channels of the drivers in the order of their snapshot fields
+ * from SNAPSHOT_VALUES, with the change per second and the standard
+ * deviation counting as active for the adaptive sampling. Both
+ * start with the hints of the descriptor and can be changed.
+ */
+static struct {
+    const driverChannel *channel;
+    int sensor;
+    double rate;
+    double deviation;
+} channelSettings[LOOP_CHANNELS_MAX];
+
+/* Outlier filter of every channel, the mode is one of the OUTLIERS_* values */
+static outlierFilter outlierFilters[LOOP_CHANNELS_MAX];
+static int outlierMode = OUTLIERS_OFF;
+
+/* Adaptive sampling of adaptive_snapshot and the position of rate_changes in its log */
+static adaptiveSampler sampler;
+static int samplerOpen = 0;
+static uint64_t changeCursor = 0;
+static uint32_t adaptiveMinMs = 2000;
+static uint32_t adaptiveMaxMs = 120000;
+static double adaptiveBus = 0.01;
+
+/* How well adaptive_snapshot and periodic_snapshot keep their schedule, one channel per sensor */
+static scheduleStats schedule;
+static int64_t periodicNextUs = 0; /* monotonic, see scheduleClockUs */
+static int64_t periodicPeriodUs = 0;
+
+/**
+ * Returns the value if the sensor was read, None otherwise.
+ */
+static PyObject *valueOrNone(PyObject *value, int valid) {
+    if (!valid) {
+        Py_DECREF(value);
+        Py_INCREF(Py_None);
+        value = Py_None;
+    }
+    return value;
+}
+
+/**
+ * Returns the last snapshot if nobody else holds a reference to
+ * it, after dropping its values, or a new one.
+ */
+static PyObject *snapshotObject(void) {
+    if (lastSnapshot != NULL && Py_REFCNT(lastSnapshot) == 1) {
+        for (int i = 0; i < snapshotFieldCount; i++) {
+            Py_CLEAR(((PyStructSequence *) lastSnapshot)->ob_item[i]);
+        }
+        return lastSnapshot;
+    }
+
+    PyObject *snapshot = PyStructSequence_New(&snapshotType);
+    if (snapshot == NULL) {
+        return NULL;
+    }
+    Py_XDECREF(lastSnapshot);
+    lastSnapshot = snapshot;
+    return snapshot;
+}
+
+/**
+ * Lays out the shared sample after the sensors and channels of the
+ * opened loop.
+ *
+ * @return 0 on success, -1 if the loop has too many of them
+ */
+static int shareLayout(sharedLayout *layout) {
+    memset(layout, 0, sizeof(*layout));
+    if (loop.sensors > SHARE_SENSORS_MAX || loop.channels > SHARE_CHANNELS_MAX) {
+        return -1;
+    }
+    layout->sensors = loop.sensors;
+    for (int i = 0; i < loop.sensors; i++) {
+        const sensorDriver *driver = loop.tasks[i].driver;
+        snprintf(layout->sensor[i].name, sizeof(layout->sensor[i].name), "%s", driver->name);
+        snprintf(layout->sensor[i].field, sizeof(layout->sensor[i].field), "%s", driver->field);
+    }
+    layout->channels = loop.channels;
+    for (int i = 0; i < loop.channels; i++) {
+        sharedChannel *described = &layout->channel[i];
+        int sensor;
+        const driverChannel *channel = boxChannel(i, &sensor);
+        snprintf(described->name, sizeof(described->name), "%s", channel->name);
+        snprintf(described->unit, sizeof(described->unit), "%s", channel->unit);
+        described->sensor = sensor;
+        described->integer = channel->integer;
+    }
+    return 0;
+}
+
+/**
+ * Publishes the values of a round, sensors that failed keep their
+ * last values. A sensor that was read has no value for the channels
+ * it did not measure (i. e. the humidity with its oversampling
+ * skipped). The object is opened with the first round.
+ */
+static void publishRound(const sensorRound *round) {
+    if (!shareOpen) {
+        sharedLayout layout;
+        if (shareName[0] == '\0') {
+            return;
+        }
+        if (shareLayout(&layout) < 0 || openSampleShare(&share, shareName, &layout) < 0) {
+            printf("shared memory %s could not be opened!\n", shareName);
+            shareName[0] = '\0';
+            return;
+        }
+        shareOpen = 1;
+    }
+
+    shared.roundTime = round->time;
+    shared.durationUs = round->durationUs;
+    for (int i = 0; i < loop.sensors; i++) {
+        const sensorTask *task = &loop.tasks[i];
+        if (round->status[i] == LOOP_SKIPPED) {
+            continue;
+        }
+        shared.status[i] = round->status[i];
+        if (round->status[i] != I2C_OK) {
+            continue;
+        }
+        shared.sampleTime[i] = round->time + round->latencyUs[i];
+        for (int channel = task->firstChannel; channel < task->firstChannel + task->driver->channels; channel++) {
+            shared.value[channel] = round->value[channel];
+            shared.valid = (shared.valid & ~(1u << channel)) | (round->valid & (1u << channel));
+        }
+    }
+    publishSample(&share, &shared);
+}
+
+/**
+ * Opens the sensor loop with the first call.
+ *
+ * @return 0 on success, -1 if the loop could not be opened
+ */
+static int openLoop(void) {
+    if (!loopOpen) {
+        if (openSensorLoop(&loop) < 0) {
+            printf("sensor loop could not be opened!\n");
+            return -1;
+        }
+        loop.baseline.path = baselinePath[0] != '\0' ? baselinePath : NULL;
+        openScheduleStats(&schedule);
+        for (int i = 0; i < loop.sensors; i++) {
+            addScheduleChannel(&schedule, loop.tasks[i].name);
+        }
+        loopOpen = 1;
+    }
+    return 0;
+}
+
+/**
+ * Runs the values of a round through the outlier filter of their
+ * channel.
+ *
+ * @param values values of the channels, outliers are replaced by
+ *        the median in OUTLIERS_REPLACE
+ * @param valid bit (1 << channel) of every value that was read
+ * @return bit (1 << channel) of every outlier
+ */
+static unsigned int filterValues(double values[LOOP_CHANNELS_MAX], unsigned int valid) {
+    unsigned int outliers = 0;
+    if (outlierMode == OUTLIERS_OFF) {
+        return 0;
+    }
+    for (int i = 0; i < snapshotChannels; i++) {
+        double median;
+        if ((valid & (1u << i)) && filterOutlier(&outlierFilters[i], values[i], &median)) {
+            outliers |= 1u << i;
+            if (outlierMode == OUTLIERS_REPLACE) {
+                values[i] = median;
+            }
+        }
+    }
+    return outliers;
+}
+
+/**
+ * Fills a snapshot with the values of a round.
+ *
+ * @param round round that was run
+ * @return snapshot struct sequence, NULL on failure
+ */
+static PyObject *roundSnapshot(const sensorRound *round) {
+    PyObject *sample = snapshotObject();
+    if (sample == NULL) {
+        return NULL;
+    }
+
+    PyObject *values[SNAPSHOT_FIELDS_MAX];
+    double channels[LOOP_CHANNELS_MAX] = {0};
+    for (int i = 0; i < snapshotChannels; i++) {
+        if (round->valid & (1u << i)) {
+            channels[i] = round->value[i];
+        }
+    }
+    unsigned int outliers = filterValues(channels, round->valid);
+    values[SNAPSHOT_TIME] = PyFloat_FromDouble(round->time / 1e6);
+    values[SNAPSHOT_DURATION] = PyFloat_FromDouble(round->durationUs / 1000.0);
+    for (int i = 0; i < snapshotChannels; i++) {
+        PyObject *value = channelSettings[i].channel->integer ? PyInt_FromLong((long) channels[i])
+                                                              : PyFloat_FromDouble(channels[i]);
+        values[SNAPSHOT_VALUES + i] = valueOrNone(value, (round->valid >> i) & 1);
+    }
+    for (int i = 0; i < loop.sensors; i++) {
+        values[snapshotStatus + i] = PyInt_FromLong(round->status[i]);
+        values[snapshotSensorTime + i] = valueOrNone(PyFloat_FromDouble((round->time + round->latencyUs[i]) / 1e6),
+                                                     round->status[i] == I2C_OK);
+    }
+    values[snapshotOutliers] = PyTuple_New(__builtin_popcount(outliers));
+    for (int i = 0, n = 0; values[snapshotOutliers] != NULL && i < snapshotChannels; i++) {
+        if (outliers & (1u << i)) {
+            PyTuple_SET_ITEM(values[snapshotOutliers], n++, PyString_FromString(channelSettings[i].channel->name));
+        }
+    }
+    for (int i = 0; i < snapshotFieldCount; i++) {
+        PyStructSequence_SET_ITEM(sample, i, values[i]);
+    }
+
+    Py_INCREF(sample);
+    return sample;
+}
+
+/**
+ * Read all channels of the box in one round.
+ *
+ * @param self python instance the method is called on
+ * @param args optional timeout of the round in ms
+ * @return snapshot struct sequence or None if the round failed
+ */
+static PyObject *snapshot(PyObject *self, PyObject *args) {
+    int timeoutMs = LOOP_ROUND_TIMEOUT_MS;
+    if (!PyArg_ParseTuple(args, "|i", &timeoutMs)) {
+        return NULL;
+    }
+    if (openLoop() < 0) {
+        Py_RETURN_NONE;
+    }
+
+    sensorRound round;
+    int result;
+    Py_BEGIN_ALLOW_THREADS
+    result = runSensorRound(&loop, &round, timeoutMs);
+    Py_END_ALLOW_THREADS
+    if (result < 0) {
+        Py_RETURN_NONE;
+    }
+    publishRound(&round);
+    return roundSnapshot(&round);
+}
+
+/**
+ * Converts a time of the cold start to ms, None if not reached yet.
+ */
+static PyObject *startupMs(int64_t us) {
+    return valueOrNone(PyFloat_FromDouble(us / 1000.0), us >= 0);
+}
+
+/**
+ * Get the timing of the cold start of every sensor, in ms since
+ * the first snapshot opened the sensor loop.
+ *
+ * @param self python instance the method is called on
+ * @param args passed arguments from calling python method
+ * @return dict of sensor name to a dict with the time the device
+ *         was opened, the setup was finished, the time spent in
+ *         the setup steps and the time_to_first_valid_sample (None
+ *         if not reached yet), and boot_ms, the uptime of the box
+ *         when the loop was opened. None before the first snapshot.
+ */
+static PyObject *startup_times(PyObject *self, PyObject *args) {
+    if (!loopOpen) {
+        Py_RETURN_NONE;
+    }
+
+    PyObject *result = PyDict_New();
+    if (result == NULL) {
+        return NULL;
+    }
+    for (int i = 0; i < loop.sensors; i++) {
+        const sensorStartup *startup = &loop.tasks[i].startup;
+        PyObject *times = Py_BuildValue("{s:N,s:N,s:N,s:N}",
+                                        "opened_ms", startupMs(startup->openedUs),
+                                        "ready_ms", startupMs(startup->readyUs),
+                                        "setup_busy_ms", startupMs(startup->setupBusyUs),
+                                        "time_to_first_valid_sample_ms", startupMs(startup->firstValidUs));
+        if (times == NULL || PyDict_SetItemString(result, loop.tasks[i].name, times) < 0) {
+            Py_XDECREF(times);
+            Py_DECREF(result);
+            return NULL;
+        }
+        Py_DECREF(times);
+    }
+    PyObject *boot = PyFloat_FromDouble(loop.openedBootUs / 1000.0);
+    if (boot == NULL || PyDict_SetItemString(result, "boot_ms", boot) < 0) {
+        Py_XDECREF(boot);
+        Py_DECREF(result);
+        return NULL;
+    }
+    Py_DECREF(boot);
+    return result;
+}
+
+/**
+ * Switch the drive mode of the CCS811. If the sensor is not set up
+ * yet, a round is run to set it up. The 250ms mode starts the raw
+ * stream, every other mode stops it.
+ *
+ * @param self python instance the method is called on
+ * @param args drive mode, one of AIR_MODE_1S, AIR_MODE_10S,
+ *             AIR_MODE_60S and AIR_MODE_250MS
+ * @return status of the CCS811 (0 = ok)
+ */
+static PyObject *set_air_mode(PyObject *self, PyObject *args) {
+    int driveMode;
+    if (!PyArg_ParseTuple(args, "i", &driveMode)) {
+        return NULL;
+    }
+    if (driveMode < CCS811_MODE_1S || driveMode > CCS811_MODE_250MS) {
+        PyErr_SetString(PyExc_ValueError, "unknown drive mode");
+        return NULL;
+    }
+    if (openLoop() < 0) {
+        Py_RETURN_NONE;
+    }
+
+    int status;
+    Py_BEGIN_ALLOW_THREADS
+    status = setAirDriveMode(&loop, driveMode);
+    if (loop.tasks[LOOP_CCS811].fd < 0) {
+        sensorRound round;
+        runSensorRound(&loop, &round, LOOP_ROUND_TIMEOUT_MS);
+        status = round.status[LOOP_CCS811];
+    }
+    if (driveMode == CCS811_MODE_250MS && !streamRunning && status == I2C_OK) {
+        streamRunning = startAirStream(&airRawStream) == 0;
+        status = streamRunning ? I2C_OK : I2C_ERROR;
+    } else if (driveMode != CCS811_MODE_250MS && streamRunning) {
+        stopAirStream(&airRawStream);
+        streamRunning = 0;
+    }
+    Py_END_ALLOW_THREADS
+    return PyInt_FromLong(status);
+}
+
+/**
+ * Reads the records of a stream since the last call into a list.
+ *
+ * @param args optional maximum number of records
+ * @param stream stream the records are taken from
+ * @param cursor position of the caller in the records
+ * @param record builds the object of a record, a new reference
+ * @return tuple of the list and the number of records lost because
+ *         they were overwritten before they were read
+ */
+static PyObject *readStream(PyObject *args, const sensorStream *stream, uint64_t *cursor,
+                            PyObject *(*record)(const void *)) {
+    int max = 0;
+    if (!PyArg_ParseTuple(args, "|i", &max)) {
+        return NULL;
+    }
+    if (stream->ring.records == NULL) {
+        return Py_BuildValue("([]i)", 0);
+    }
+    if (max <= 0 || (uint64_t) max > stream->ring.capacity) {
+        max = (int) stream->ring.capacity;
+    }
+
+    uint8_t *records = malloc(max * stream->ring.recordSize);
+    if (records == NULL) {
+        return PyErr_NoMemory();
+    }
+    uint64_t lost;
+    size_t count = readRing(&stream->ring, cursor, records, (size_t) max, &lost);
+
+    PyObject *list = PyList_New((Py_ssize_t) count);
+    for (size_t i = 0; list != NULL && i < count; i++) {
+        PyObject *item = record(records + i * stream->ring.recordSize);
+        if (item == NULL) {
+            Py_CLEAR(list);
+            break;
+        }
+        PyList_SET_ITEM(list, i, item);
+    }
+    free(records);
+    if (list == NULL) {
+        return NULL;
+    }
+    return Py_BuildValue("(NK)", list, (unsigned PY_LONG_LONG) lost);
+}
+
+/**
+ * Builds the (time, current in uA, voltage in V) tuple of a raw
+ * sample of the CCS811.
+ */
+static PyObject *airRawRecord(const void *record) {
+    const airRawSample *sample = record;
+    return Py_BuildValue("(dId)", sample->time / 1e6, (unsigned int) CCS811_RAW_CURRENT(sample->raw),
+                         CCS811_RAW_VOLTAGE(sample->raw) * CCS811_RAW_VOLTAGE_FULL_SCALE / 1023);
+}
+
+/**
+ * Get the raw samples streamed in the 250ms mode since the last call.
+ *
+ * @param self python instance the method is called on
+ * @param args optional maximum number of samples
+ * @return tuple of a list of (time, current in uA, voltage in V)
+ *         tuples and the number of samples lost because they were
+ *         overwritten before they were read
+ */
+static PyObject *air_raw(PyObject *self, PyObject *args) {
+    return readStream(args, &airRawStream.stream, &streamCursor, airRawRecord);
+}
+
+/**
+ * Writes the settings of the BME280, setting the sensor up with a
+ * round if it is not yet. The pressure stream runs in normal mode
+ * only. Called without the GIL.
+ *
+ * @param settings new settings
+ * @return status of the BME280
+ */
+static int applyEnvSettings(const envSettings *settings) {
+    if (pressureRunning) {
+        stopEnvStream(&pressureStream);
+        pressureRunning = 0;
+    }
+    int status = setEnvSettings(&loop, settings);
+    if (loop.tasks[LOOP_BME280].fd < 0) {
+        sensorRound round;
+        runSensors(&loop, &round, LOOP_ROUND_TIMEOUT_MS, 1u << LOOP_BME280);
+        status = round.status[LOOP_BME280];
+    }
+    /* Without pressure (pressOs 0) there is nothing to stream, the rounds still read temperature and humidity */
+    if (settings->mode == MODE_NORMAL && settings->pressOs != 0 && status == I2C_OK) {
+        pressureRunning = startEnvStream(&pressureStream, &loop.comp, settings) == 0;
+        status = pressureRunning ? I2C_OK : I2C_ERROR;
+    }
+    return status;
+}
+
+/**
+ * Switch the BME280 to one of the recommended modes of operation of
+ * its datasheet. ENV_INDOOR_NAVIGATION and ENV_GAMING measure in
+ * normal mode and start the pressure stream, the others stop it.
+ *
+ * @param self python instance the method is called on
+ * @param args preset, one of ENV_WEATHER, ENV_HUMIDITY,
+ *             ENV_INDOOR_NAVIGATION and ENV_GAMING
+ * @return status of the BME280 (0 = ok)
+ */
+static PyObject *set_env_mode(PyObject *self, PyObject *args) {
+    int preset;
+    envSettings settings;
+    if (!PyArg_ParseTuple(args, "i", &preset)) {
+        return NULL;
+    }
+    if (presetSettings(preset, &settings) < 0) {
+        PyErr_SetString(PyExc_ValueError, "unknown preset");
+        return NULL;
+    }
+    if (openLoop() < 0) {
+        Py_RETURN_NONE;
+    }
+
+    int status;
+    Py_BEGIN_ALLOW_THREADS
+    status = applyEnvSettings(&settings);
+    Py_END_ALLOW_THREADS
+    return PyInt_FromLong(status);
+}
+
+/**
+ * Set the oversampling, IIR filter and standby time of the BME280.
+ * With a standby time it measures in normal mode and the pressure
+ * stream runs, without one every round triggers a measurement. A
+ * skipped humidity or pressure is None in the snapshots, without
+ * pressure the stream does not run.
+ *
+ * @param self python instance the method is called on
+ * @param args oversampling of humidity, temperature and pressure
+ *             (0 = skipped to 5 = x16), filter (0 = off to 4 = 16)
+ *             and optionally the standby time (0 = 0.5ms to 7, see
+ *             the datasheet)
+ * @return status of the BME280 (0 = ok)
+ */
+static PyObject *set_env_config(PyObject *self, PyObject *args) {
+    envSettings settings = {0, 0, 0, 0, STANDBY_0_5MS, MODE_FORCED};
+    PyObject *standby = Py_None;
+    if (!PyArg_ParseTuple(args, "iiii|O", &settings.humOs, &settings.tempOs, &settings.pressOs,
+                          &settings.filter, &standby)) {
+        return NULL;
+    }
+    if (standby != Py_None) {
+        settings.standby = (int) PyInt_AsLong(standby);
+        settings.mode = MODE_NORMAL;
+        if (PyErr_Occurred()) {
+            return NULL;
+        }
+    }
+    if (settings.humOs < 0 || settings.humOs > 5 || settings.tempOs < 1 || settings.tempOs > 5 ||
+        settings.pressOs < 0 || settings.pressOs > 5 || settings.filter < FILTER_OFF || settings.filter > FILTER_16 ||
+        settings.standby < STANDBY_0_5MS || settings.standby > STANDBY_20MS) {
+        PyErr_SetString(PyExc_ValueError, "invalid settings");
+        return NULL;
+    }
+    if (openLoop() < 0) {
+        Py_RETURN_NONE;
+    }
+
+    int status;
+    Py_BEGIN_ALLOW_THREADS
+    status = applyEnvSettings(&settings);
+    Py_END_ALLOW_THREADS
+    return PyInt_FromLong(status);
+}
+
+/**
+ * Builds the (time, pressure in hPa, temperature in C) tuple of a
+ * pressure sample of the BME280.
+ */
+static PyObject *envPressureRecord(const void *record) {
+    const envPressureSample *sample = record;
+    return Py_BuildValue("(ddd)", sample->time / 1e6, sample->pressure / 256.0 / 100.0, sample->temperature / 100.0);
+}
+
+/**
+ * Get the pressure samples streamed in normal mode since the last
+ * call.
+ *
+ * @param self python instance the method is called on
+ * @param args optional maximum number of samples
+ * @return tuple of a list of (time, pressure in hPa, temperature
+ *         in C) tuples and the number of samples lost because they
+ *         were overwritten before they were read
+ */
+static PyObject *env_pressure(PyObject *self, PyObject *args) {
+    return readStream(args, &pressureStream.stream, &pressureCursor, envPressureRecord);
+}
+
+/**
+ * Start the acceleration stream of the ADXL345: the sensor measures
+ * into its FIFO, a thread drains it into a ring buffer whenever the
+ * watermark is reached. A running stream is restarted with the new
+ * settings. The simulated sensor (see AccelSimulator.h) stays in
+ * place of the real one from the first call asking for it on.
+ *
+ * @param self python instance the method is called on
+ * @param args optionally the rate in Hz (100 to 3200 in powers of
+ *             two, 1600, 3200 may overrun), the watermark (1 to
+ *             31, 16, lower leaves more time to drain), the GPIO
+ *             line of INT1 (-1 to poll the FIFO), the gpiochip of
+ *             the line and 1 to simulate the sensor
+ * @return True if the stream runs
+ */
+static PyObject *accel_stream(PyObject *self, PyObject *args) {
+    double hz = accelRateHz(ACCEL_STREAM_RATE);
+    int watermark = ACCEL_STREAM_WATERMARK, line = -1, simulate = 0;
+    const char *chip = SI1145_GPIO_CHIP;
+    if (!PyArg_ParseTuple(args, "|diisi", &hz, &watermark, &line, &chip, &simulate)) {
+        return NULL;
+    }
+    int rate = ADXL345_RATE_100HZ;
+    while (rate < ADXL345_RATE_3200HZ && accelRateHz(rate) < hz) {
+        rate++;
+    }
+    if (accelRateHz(rate) != hz || watermark < 1 || watermark > ADXL345_FIFO_SAMPLES_MASK) {
+        PyErr_SetString(PyExc_ValueError, "invalid rate or watermark");
+        return NULL;
+    }
+
+    int started = 0;
+    Py_BEGIN_ALLOW_THREADS
+    if (accelRunning) {
+        stopAccelStream(&accelerationStream);
+        accelRunning = 0;
+    }
+    if (simulate && !accelSimulated) {
+        accelSimulated = startAccelSimulator() == 0;
+    }
+    sampleEvent event;
+    int withEvent = 0;
+    if (accelSimulated && line < 0) {
+        withEvent = openFdEvent(&event, accelSimulatorEvent()) == 0;
+    } else if (line >= 0) {
+        withEvent = openGpioEvent(&event, chip, line) == 0;
+    }
+    if (line < 0 || withEvent) {
+        accelRunning = startAccelStream(&accelerationStream, rate, watermark, withEvent ? &event : NULL) == 0;
+        if (!accelRunning && withEvent) {
+            event.close(&event);
+        }
+    }
+    started = accelRunning;
+    Py_END_ALLOW_THREADS
+    return PyBool_FromLong(started);
+}
+
+/**
+ * Stop the acceleration stream, the samples stay readable.
+ *
+ * @param self python instance the method is called on
+ * @param args no arguments
+ * @return None
+ */
+static PyObject *stop_accel_stream(PyObject *self, PyObject *args) {
+    if (accelRunning) {
+        Py_BEGIN_ALLOW_THREADS
+        stopAccelStream(&accelerationStream);
+        Py_END_ALLOW_THREADS
+        accelRunning = 0;
+    }
+    Py_RETURN_NONE;
+}
+
+/**
+ * Builds the (time, x, y, z in g) tuple of an acceleration sample.
+ */
+static PyObject *accelRecord(const void *record) {
+    const accelSample *sample = record;
+    return Py_BuildValue("(dddd)", sample->time / 1e6, sample->data.x * ADXL345_MG_PER_LSB / 1000,
+                         sample->data.y * ADXL345_MG_PER_LSB / 1000, sample->data.z * ADXL345_MG_PER_LSB / 1000);
+}
+
+/**
+ * Get the acceleration samples streamed since the last call.
+ *
+ * @param self python instance the method is called on
+ * @param args optional maximum number of samples
+ * @return tuple of a list of (time, x, y, z in g) tuples and the
+ *         number of samples lost because they were overwritten
+ *         before they were read
+ */
+static PyObject *accel_samples(PyObject *self, PyObject *args) {
+    return readStream(args, &accelerationStream.stream, &accelCursor, accelRecord);
+}
+
+/**
+ * Get the counters of the acceleration stream. Samples are lost if
+ * the FIFO overran before it was drained (dropped is estimated from
+ * the time since the last drain) or if accel_samples() was not
+ * called often enough (returned by it).
+ *
+ * @param self python instance the method is called on
+ * @param args no arguments
+ * @return dict of the rate, the watermark, the samples read, the
+ *         drains of the FIFO, the overruns, the dropped samples, the
+ *         read errors and the most samples found in the FIFO, None
+ *         if the stream was never started
+ */
+static PyObject *accel_status(PyObject *self, PyObject *args) {
+    if (accelerationStream.stream.ring.records == NULL) {
+        Py_RETURN_NONE;
+    }
+    accelStream *s = &accelerationStream;
+    return Py_BuildValue("{s:O,s:d,s:i,s:K,s:K,s:K,s:K,s:I,s:I,s:O}",
+                         "running", accelRunning ? Py_True : Py_False,
+                         "rate", s->rateHz,
+                         "watermark", s->watermark,
+                         "samples", (unsigned PY_LONG_LONG) __atomic_load_n(&s->samples, __ATOMIC_RELAXED),
+                         "drains", (unsigned PY_LONG_LONG) __atomic_load_n(&s->drains, __ATOMIC_RELAXED),
+                         "overruns", (unsigned PY_LONG_LONG) __atomic_load_n(&s->overruns, __ATOMIC_RELAXED),
+                         "dropped", (unsigned PY_LONG_LONG) __atomic_load_n(&s->dropped, __ATOMIC_RELAXED),
+                         "errors", (unsigned int) __atomic_load_n(&s->stream.errors, __ATOMIC_RELAXED),
+                         "max_level", (unsigned int) __atomic_load_n(&s->maxLevel, __ATOMIC_RELAXED),
+                         "simulated", accelSimulated ? Py_True : Py_False);
+}
+
+/**
+ * Start the flicker stream of the SI1145. The sensor is taken from
+ * the sensor loop, whose rounds skip it until stop_flicker_stream().
+ * A running stream is restarted with the new settings.
+ *
+ * @param self python instance the method is called on
+ * @param args optionally the sampling period in ms (up to 2047, 0
+ *             for 1 or the shortest the bus allows if that is
+ *             longer, see FlickerStream.h), the seconds per report
+ *             (2), the GPIO line of INT (-1 to poll IRQSTAT), the
+ *             gpiochip of the line and the clock of the bus in kHz
+ *             (100)
+ * @return True if the stream runs, None if the loop could not be
+ *         opened
+ */
+static PyObject *flicker_stream(PyObject *self, PyObject *args) {
+    double periodMs = 0, reportS = 2, busKHz = FLICKER_STREAM_BUS_HZ / 1000.0;
+    int line = -1;
+    const char *chip = SI1145_GPIO_CHIP;
+    if (!PyArg_ParseTuple(args, "|ddisd", &periodMs, &reportS, &line, &chip, &busKHz)) {
+        return NULL;
+    }
+    if (busKHz < 1 || busKHz > 5000 || reportS <= 0) {
+        PyErr_SetString(PyExc_ValueError, "invalid report interval or bus clock");
+        return NULL;
+    }
+    uint32_t busHz = (uint32_t) lround(busKHz * 1000);
+    int minRate = flickerStreamMinRate(busHz, line >= 0);
+    long measRate = periodMs > 0 ? lround(periodMs * 32) :
+                    FLICKER_STREAM_MEAS_RATE > minRate ? FLICKER_STREAM_MEAS_RATE : minRate;
+    if (measRate < minRate || measRate > 0xFFFF) {
+        char message[64];
+        snprintf(message, sizeof(message), "period must be %.3f to 2047ms on this bus%s", minRate / 32.0,
+                 line >= 0 ? "" : " without INT");
+        PyErr_SetString(PyExc_ValueError, message);
+        return NULL;
+    }
+    periodMs = measRate / 32.0;
+    long reportWindows = lround(reportS * 1000 / periodMs / FLICKER_HOP);
+    if (openLoop() < 0) {
+        Py_RETURN_NONE;
+    }
+
+    int started;
+    Py_BEGIN_ALLOW_THREADS
+    if (flickerRunning) {
+        stopFlickerStream(&lightFlicker);
+        flickerRunning = 0;
+    }
+    lendSensor(&loop, LOOP_SI1145);
+    sampleEvent event;
+    int withEvent = line >= 0 && openGpioEvent(&event, chip, line) == 0;
+    if (line < 0 || withEvent) {
+        flickerRunning = startFlickerStream(&lightFlicker, (int) measRate, reportWindows > 0 ? (int) reportWindows : 1,
+                                            busHz, withEvent ? &event : NULL) == 0;
+        if (!flickerRunning && withEvent) {
+            event.close(&event);
+        }
+    }
+    if (!flickerRunning) {
+        returnSensor(&loop, LOOP_SI1145);
+    }
+    started = flickerRunning;
+    Py_END_ALLOW_THREADS
+    return PyBool_FromLong(started);
+}
+
+/**
+ * Stop the flicker stream and give the SI1145 back to the sensor
+ * loop, the next round sets it up again. The reports stay readable.
+ *
+ * @param self python instance the method is called on
+ * @param args no arguments
+ * @return None
+ */
+static PyObject *stop_flicker_stream(PyObject *self, PyObject *args) {
+    if (flickerRunning) {
+        Py_BEGIN_ALLOW_THREADS
+        stopFlickerStream(&lightFlicker);
+        returnSensor(&loop, LOOP_SI1145);
+        Py_END_ALLOW_THREADS
+        flickerRunning = 0;
+    }
+    Py_RETURN_NONE;
+}
+
+/**
+ * Builds the dict of a channel of a flicker report.
+ *
+ * @return new reference, NULL on failure
+ */
+static PyObject *flickerChannelDict(const flickerChannel *channel) {
+    return Py_BuildValue("{s:d,s:d,s:d,s:d,s:(dddd)}",
+                         "mean", channel->mean,
+                         "percent", channel->percent,
+                         "index", channel->index,
+                         "frequency", channel->frequency,
+                         "bands", channel->band[0], channel->band[1], channel->band[2], channel->band[3]);
+}
+
+/**
+ * Builds the dict of a flicker report.
+ */
+static PyObject *flickerRecord(const void *record) {
+    const flickerReport *report = record;
+    return Py_BuildValue("{s:d,s:d,s:I,s:N,s:N}",
+                         "time", report->time / 1e6,
+                         "rate", report->rateHz,
+                         "windows", (unsigned int) report->windows,
+                         "vis", flickerChannelDict(&report->channel[FLICKER_VIS]),
+                         "ir", flickerChannelDict(&report->channel[FLICKER_IR]));
+}
+
+/**
+ * Get the flicker reports since the last call. Every channel has the
+ * mean counts above the dark level, the percent flicker, the flicker
+ * index, the dominant frequency in Hz (0 for constant light) and the
+ * variance of the counts in the bands 1-10Hz, 10-80Hz, 80-200Hz and
+ * 200Hz up to half the sampling rate.
+ *
+ * @param self python instance the method is called on
+ * @param args optional maximum number of reports
+ * @return tuple of a list of dicts of the time, the sampling rate
+ *         reached, the windows averaged and the channels vis and ir,
+ *         and the number of reports lost because they were
+ *         overwritten before they were read
+ */
+static PyObject *flicker_reports(PyObject *self, PyObject *args) {
+    return readStream(args, &lightFlicker.stream, &flickerCursor, flickerRecord);
+}
+
+/**
+ * Get the counters of the flicker stream. Samples are missed if the
+ * thread did not read them before the next measurement, reports are
+ * lost if flicker_reports() was not called often enough (returned by
+ * it).
+ *
+ * @param self python instance the method is called on
+ * @param args no arguments
+ * @return dict of the sampling period in ms, the samples read, the
+ *         samples missed, the read errors and the reports made, None
+ *         if the stream was never started
+ */
+static PyObject *flicker_status(PyObject *self, PyObject *args) {
+    if (lightFlicker.stream.ring.records == NULL) {
+        Py_RETURN_NONE;
+    }
+    flickerStream *s = &lightFlicker;
+    return Py_BuildValue("{s:O,s:d,s:K,s:K,s:I,s:I}",
+                         "running", flickerRunning ? Py_True : Py_False,
+                         "period_ms", s->periodUs / 1000,
+                         "samples", (unsigned PY_LONG_LONG) __atomic_load_n(&s->samples, __ATOMIC_RELAXED),
+                         "missed", (unsigned PY_LONG_LONG) __atomic_load_n(&s->missed, __ATOMIC_RELAXED),
+                         "errors", (unsigned int) __atomic_load_n(&s->stream.errors, __ATOMIC_RELAXED),
+                         "reports", (unsigned int) __atomic_load_n(&s->reports, __ATOMIC_RELAXED));
+}
+
+/**
+ * Set the file the baseline of the CCS811 is kept in. It is
+ * restored from there the next time the sensor is set up.
+ *
+ * @param self python instance the method is called on
+ * @param args path of the file, None to keep no baseline
+ * @return None
+ */
+static PyObject *set_air_baseline_file(PyObject *self, PyObject *args) {
+    const char *path;
+    if (!PyArg_ParseTuple(args, "z", &path)) {
+        return NULL;
+    }
+    if (path != NULL && strlen(path) >= sizeof(baselinePath)) {
+        PyErr_SetString(PyExc_ValueError, "path too long");
+        return NULL;
+    }
+    snprintf(baselinePath, sizeof(baselinePath), "%s", path != NULL ? path : "");
+    if (loopOpen) {
+        loop.baseline.path = path != NULL ? baselinePath : NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+/**
+ * Get the state of the baseline of the CCS811.
+ *
+ * @param self python instance the method is called on
+ * @param args passed arguments from calling python method
+ * @return dict with the value last saved or restored (None if
+ *         neither happened yet), whether it was restored when the
+ *         sensor was set up and the number of saves. None before
+ *         the first snapshot.
+ */
+static PyObject *air_baseline(PyObject *self, PyObject *args) {
+    if (!loopOpen) {
+        Py_RETURN_NONE;
+    }
+    const airBaselineStore *store = &loop.baseline;
+    return Py_BuildValue("{s:N,s:N,s:I}",
+                         "value", valueOrNone(PyInt_FromLong(store->value), store->restored || store->saves > 0),
+                         "restored", PyBool_FromLong(store->restored),
+                         "saves", (unsigned int) store->saves);
+}
+
+/**
+ * Set the shared memory object the snapshots are published to.
+ *
+ * @param self python instance the method is called on
+ * @param args name of the object (starting with /), None to
+ *             publish nothing
+ * @return None
+ */
+static PyObject *share_samples(PyObject *self, PyObject *args) {
+    const char *name;
+    if (!PyArg_ParseTuple(args, "z", &name)) {
+        return NULL;
+    }
+    if (name != NULL && strlen(name) >= sizeof(shareName)) {
+        PyErr_SetString(PyExc_ValueError, "name too long");
+        return NULL;
+    }
+    if (shareOpen) {
+        closeSampleShare(&share);
+        shareOpen = 0;
+    }
+    snprintf(shareName, sizeof(shareName), "%s", name != NULL ? name : "");
+    Py_RETURN_NONE;
+}
+
+/**
+ * Returns the interval the CCS811 updates its values at in the
+ * requested drive mode.
+ */
+static uint32_t airIntervalMs(void) {
+    switch (loop.driveMode) {
+        case CCS811_MODE_10S:
+            return 10000;
+        case CCS811_MODE_60S:
+            return 60000;
+        default:
+            return 1000;
+    }
+}
+
+/**
+ * Returns the bus time spent on the device of a sensor so far.
+ */
+static uint64_t sensorBusUs(const sensorTask *task) {
+    uint64_t total = 0;
+    const i2cDeviceStats *stats;
+    for (int i = 0; (stats = i2cDeviceStatistics(i)) != NULL; i++) {
+        if (stats->address == task->address || (task->fd >= 0 && stats->fd == task->fd)) {
+            total += stats->totalUs;
+        }
+    }
+    return total;
+}
+
+/**
+ * Sets up the adaptive sampling with a group for every sensor of
+ * the opened loop, in the order of the loop.
+ *
+ * @return 0 on success, -1 if the sampler could not be opened
+ */
+static int openSampler(void) {
+    if (openAdaptiveSampler(&sampler, adaptiveMinMs, adaptiveMaxMs, adaptiveBus) < 0) {
+        return -1;
+    }
+    for (int i = 0; i < loop.sensors; i++) {
+        addAdaptiveGroup(&sampler, loop.tasks[i].name, i == LOOP_CCS811 ? airIntervalMs() : adaptiveMinMs);
+    }
+    for (int i = 0; i < snapshotChannels; i++) {
+        addAdaptiveChannel(&sampler, channelSettings[i].sensor, channelSettings[i].channel->name,
+                           channelSettings[i].rate, channelSettings[i].deviation);
+    }
+    changeCursor = 0;
+    restartSchedule(&schedule);
+    samplerOpen = 1;
+    return 0;
+}
+
+/**
+ * Configure the adaptive sampling of adaptive_snapshot. It starts
+ * over with the next adaptive_snapshot, every sensor at the
+ * longest interval.
+ *
+ * @param self python instance the method is called on
+ * @param args optional shortest interval in s (2), interval of a
+ *             calm channel in s (120) and share of the bus all
+ *             sensors may use (0.01, 0 for no limit)
+ * @return None
+ */
+static PyObject *adaptive_sampling(PyObject *self, PyObject *args) {
+    double minS = adaptiveMinMs / 1000.0;
+    double maxS = adaptiveMaxMs / 1000.0;
+    double busShare = adaptiveBus;
+    if (!PyArg_ParseTuple(args, "|ddd", &minS, &maxS, &busShare)) {
+        return NULL;
+    }
+    if (minS < 0.001 || maxS < minS || maxS > 86400 || busShare < 0 || busShare > 1) {
+        PyErr_SetString(PyExc_ValueError, "invalid intervals or bus share");
+        return NULL;
+    }
+    adaptiveMinMs = (uint32_t) (minS * 1000);
+    adaptiveMaxMs = (uint32_t) (maxS * 1000);
+    adaptiveBus = busShare;
+    if (samplerOpen) {
+        closeAdaptiveSampler(&sampler);
+        samplerOpen = 0;
+    }
+    Py_RETURN_NONE;
+}
+
+/**
+ * Set when a channel counts as active and is read faster.
+ *
+ * @param self python instance the method is called on
+ * @param args name of the channel (a field of the snapshot), change
+ *             per second and standard deviation counting as active
+ * @return None
+ */
+static PyObject *set_adaptive_threshold(PyObject *self, PyObject *args) {
+    const char *name;
+    double rate;
+    double deviation;
+    if (!PyArg_ParseTuple(args, "sdd", &name, &rate, &deviation)) {
+        return NULL;
+    }
+    for (int i = 0; i < snapshotChannels; i++) {
+        if (strcmp(channelSettings[i].channel->name, name) == 0) {
+            channelSettings[i].rate = rate;
+            channelSettings[i].deviation = deviation;
+            if (samplerOpen) {
+                sampler.channel[i].rateThreshold = rate;
+                sampler.channel[i].deviationThreshold = deviation;
+            }
+            Py_RETURN_NONE;
+        }
+    }
+    PyErr_SetString(PyExc_ValueError, "unknown channel");
+    return NULL;
+}
+
+/**
+ * Handles a signal interrupting sleepUntil with the GIL: the Python
+ * handlers and the stop queued by onStopSignal run right away
+ * instead of at the next due time.
+ *
+ * @param context thread state saved by sleepUntil
+ * @return 0 to sleep on, -1 if a handler raised an exception
+ */
+static int handleSleepSignal(void *context) {
+    PyThreadState **state = context;
+    PyEval_RestoreThread(*state);
+    int result = PyErr_CheckSignals() < 0 || Py_MakePendingCalls() < 0 ? -1 : 0;
+    *state = PyEval_SaveThread();
+    return result;
+}
+
+/**
+ * Sleeps until an absolute time of the monotonic clock, signals
+ * are handled in between.
+ *
+ * @param us time to wake up, see scheduleClockUs
+ * @return 0 on success, -1 if a signal handler raised an exception
+ */
+static int sleepUntil(int64_t us) {
+    if (PyErr_CheckSignals() < 0) {
+        return -1;
+    }
+    PyThreadState *state = PyEval_SaveThread();
+    int result = sleepUntilScheduled(us, handleSleepSignal, &state);
+    PyEval_RestoreThread(state);
+    return result;
+}
+
+/**
+ * Wait until the next sensor is due and read the sensors due then.
+ * Every sensor is read at the interval of its fastest channel, see
+ * adaptive_sampling. Sensors that were not read have the status
+ * SKIPPED and their values are None.
+ *
+ * @param self python instance the method is called on
+ * @param args optional timeout of the round in ms
+ * @return snapshot struct sequence or None if the round failed
+ */
+static PyObject *adaptive_snapshot(PyObject *self, PyObject *args) {
+    int timeoutMs = LOOP_ROUND_TIMEOUT_MS;
+    if (!PyArg_ParseTuple(args, "|i", &timeoutMs)) {
+        return NULL;
+    }
+    if (openLoop() < 0) {
+        Py_RETURN_NONE;
+    }
+    if (!samplerOpen && openSampler() < 0) {
+        return PyErr_NoMemory();
+    }
+    sampler.group[LOOP_CCS811].minMs = airIntervalMs();
+
+    unsigned int sensors;
+    if (sleepUntil(nextAdaptiveRead(&sampler, &sensors)) < 0) {
+        return NULL;
+    }
+
+    uint64_t busUs[LOOP_SENSORS_MAX];
+    int64_t dueUs[LOOP_SENSORS_MAX];
+    int64_t intervalUs[LOOP_SENSORS_MAX];
+    for (int i = 0; i < loop.sensors; i++) {
+        busUs[i] = sensorBusUs(&loop.tasks[i]);
+        dueUs[i] = adaptiveDue(&sampler, i);
+        intervalUs[i] = (int64_t) sampler.group[i].intervalMs * 1000;
+    }
+    sensorRound round;
+    int result;
+    Py_BEGIN_ALLOW_THREADS
+    result = runSensors(&loop, &round, timeoutMs, sensors);
+    Py_END_ALLOW_THREADS
+
+    /* Failed reads are charged as well, the sensor is retried at its interval */
+    for (int i = 0; i < loop.sensors; i++) {
+        if (sensors & (1u << i)) {
+            chargeAdaptiveGroup(&sampler, i, round.startUs, (double) (sensorBusUs(&loop.tasks[i]) - busUs[i]));
+            if (dueUs[i] != 0) {
+                recordScheduledRun(&schedule, i, dueUs[i], round.startUs, intervalUs[i], round.durationUs);
+            }
+        }
+    }
+    /* The sampler gets the values before the outlier filter, so a glitch is checked by reading again soon */
+    for (int i = 0; i < snapshotChannels; i++) {
+        if (round.valid & (1u << i)) {
+            updateAdaptiveChannel(&sampler, (int) i, round.value[i],
+                                  round.startUs + round.latencyUs[channelSettings[i].sensor]);
+        }
+    }
+    planAdaptiveSampler(&sampler, round.startUs);
+
+    if (result < 0) {
+        Py_RETURN_NONE;
+    }
+    publishRound(&round);
+    return roundSnapshot(&round);
+}
+
+/**
+ * Get the changes of the sampling intervals since the last call.
+ *
+ * @param self python instance the method is called on
+ * @param args passed arguments from calling python method
+ * @return tuple of a list of (time in s since epoch, sensor,
+ *         channel, old interval in s, new interval in s) tuples,
+ *         the time taken from the monotonic clock of the sampler
+ *         with the current wall clock, channel being the
+ *         fastest channel of the sensor or None if all sensors were
+ *         slowed down to stay within the bus share, and the number
+ *         of changes lost because they were overwritten before they
+ *         were read
+ */
+static PyObject *rate_changes(PyObject *self, PyObject *args) {
+    if (!samplerOpen) {
+        return Py_BuildValue("([]i)", 0);
+    }
+
+    adaptiveChange changes[ADAPTIVE_CHANGES];
+    uint64_t lost;
+    size_t count = readAdaptiveChanges(&sampler, &changeCursor, changes, ADAPTIVE_CHANGES, &lost);
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    int64_t epochUs = (int64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000 - scheduleClockUs();
+
+    PyObject *list = PyList_New((Py_ssize_t) count);
+    for (size_t i = 0; list != NULL && i < count; i++) {
+        const adaptiveChange *change = &changes[i];
+        PyObject *channel = change->channel >= 0 ? PyString_FromString(sampler.channel[change->channel].name)
+                                                 : (Py_INCREF(Py_None), Py_None);
+        PyObject *item = Py_BuildValue("(dsNdd)", (change->timeUs + epochUs) / 1e6, sampler.group[change->group].name,
+                                       channel, change->fromMs / 1000.0, change->toMs / 1000.0);
+        if (item == NULL) {
+            Py_CLEAR(list);
+            break;
+        }
+        PyList_SET_ITEM(list, i, item);
+    }
+    if (list == NULL) {
+        return NULL;
+    }
+    return Py_BuildValue("(NK)", list, (unsigned PY_LONG_LONG) lost);
+}
+
+/**
+ * Get the state of the adaptive sampling.
+ *
+ * @param self python instance the method is called on
+ * @param args passed arguments from calling python method
+ * @return dict of sensor name to its interval in s, bus_share, the
+ *         share of the bus used at these intervals, and limited, the
+ *         number of times the intervals were stretched to stay
+ *         within the bus share. None before the first
+ *         adaptive_snapshot.
+ */
+static PyObject *adaptive_status(PyObject *self, PyObject *args) {
+    if (!samplerOpen) {
+        Py_RETURN_NONE;
+    }
+    return Py_BuildValue("{s:d,s:d,s:d,s:d,s:K}",
+                         sampler.group[LOOP_BME280].name, sampler.group[LOOP_BME280].intervalMs / 1000.0,
+                         sampler.group[LOOP_SI1145].name, sampler.group[LOOP_SI1145].intervalMs / 1000.0,
+                         sampler.group[LOOP_CCS811].name, sampler.group[LOOP_CCS811].intervalMs / 1000.0,
+                         "bus_share", adaptiveBusShare(&sampler),
+                         "limited", (unsigned PY_LONG_LONG) sampler.limited);
+}
+
+/**
+ * Set the outlier filter all values run through before they are
+ * returned. A value is an outlier if it is further than threshold
+ * times the scale from the median of the values before it (Hampel
+ * identifier, the scale is the MAD, see OutlierFilter.h).
+ *
+ * @param self python instance the method is called on
+ * @param args mode, one of OUTLIERS_OFF, OUTLIERS_FLAG and
+ *             OUTLIERS_REPLACE, optionally the window (7) and the
+ *             threshold (3)
+ * @return None
+ */
+static PyObject *set_outlier_filter(PyObject *self, PyObject *args) {
+    int mode;
+    int window = 7;
+    double threshold = 3;
+    if (!PyArg_ParseTuple(args, "i|id", &mode, &window, &threshold)) {
+        return NULL;
+    }
+    if (mode < OUTLIERS_OFF || mode > OUTLIERS_REPLACE || window < 3 || window > OUTLIER_WINDOW_MAX ||
+        threshold <= 0) {
+        PyErr_SetString(PyExc_ValueError, "invalid mode, window or threshold");
+        return NULL;
+    }
+    if (outlierMode != OUTLIERS_OFF) {
+        for (int i = 0; i < snapshotChannels; i++) {
+            closeOutlierFilter(&outlierFilters[i]);
+        }
+        outlierMode = OUTLIERS_OFF;
+    }
+    if (mode == OUTLIERS_OFF) {
+        Py_RETURN_NONE;
+    }
+    for (int i = 0; i < snapshotChannels; i++) {
+        if (openOutlierFilter(&outlierFilters[i], window, threshold, channelSettings[i].channel->resolution) < 0) {
+            while (i-- > 0) {
+                closeOutlierFilter(&outlierFilters[i]);
+            }
+            return PyErr_NoMemory();
+        }
+    }
+    outlierMode = mode;
+    Py_RETURN_NONE;
+}
+
+/**
+ * Get the statistics of the outlier filter.
+ *
+ * @param self python instance the method is called on
+ * @param args passed arguments from calling python method
+ * @return dict of channel name to a dict with the number of
+ *         samples and outliers, the mean and maximum time filtering
+ *         a sample took (latency_us, max_latency_us) and the delay
+ *         of the filtered values in samples (always 0, a value is
+ *         tested against the values before it). None while the
+ *         filter is off.
+ */
+static PyObject *outlier_status(PyObject *self, PyObject *args) {
+    if (outlierMode == OUTLIERS_OFF) {
+        Py_RETURN_NONE;
+    }
+
+    PyObject *result = PyDict_New();
+    if (result == NULL) {
+        return NULL;
+    }
+    for (int i = 0; i < snapshotChannels; i++) {
+        const outlierFilter *filter = &outlierFilters[i];
+        PyObject *status = Py_BuildValue("{s:K,s:K,s:d,s:d,s:i}",
+                                         "samples", (unsigned PY_LONG_LONG) filter->samples,
+                                         "outliers", (unsigned PY_LONG_LONG) filter->outliers,
+                                         "latency_us", filter->samples > 0
+                                                       ? filter->totalNs / 1000.0 / filter->samples : 0.0,
+                                         "max_latency_us", filter->maxNs / 1000.0,
+                                         "delay_samples", 0);
+        if (status == NULL || PyDict_SetItemString(result, channelSettings[i].channel->name, status) < 0) {
+            Py_XDECREF(status);
+            Py_DECREF(result);
+            return NULL;
+        }
+        Py_DECREF(status);
+    }
+    return result;
+}
+
+/**
+ * Read all sensors at a fixed period. The rounds are due at the
+ * time of the first call plus multiples of the period, so the
+ * duration of a round does not shift the following ones. The
+ * schedule is kept on the monotonic clock, a step of the wall
+ * clock does not shift it either, only the timestamps. If a
+ * round ends after the next one was due, the periods already over
+ * are skipped. A call with a different period starts over.
+ *
+ * @param self python instance the method is called on
+ * @param args period in s, optional timeout of the round in ms
+ * @return snapshot struct sequence or None if the round failed
+ */
+static PyObject *periodic_snapshot(PyObject *self, PyObject *args) {
+    double periodS;
+    int timeoutMs = LOOP_ROUND_TIMEOUT_MS;
+    if (!PyArg_ParseTuple(args, "d|i", &periodS, &timeoutMs)) {
+        return NULL;
+    }
+    if (periodS < 0.001 || periodS > 86400) {
+        PyErr_SetString(PyExc_ValueError, "invalid period");
+        return NULL;
+    }
+    if (openLoop() < 0) {
+        Py_RETURN_NONE;
+    }
+
+    int64_t periodUs = (int64_t) (periodS * 1e6);
+    if (periodUs != periodicPeriodUs) {
+        periodicNextUs = scheduleClockUs();
+        periodicPeriodUs = periodUs;
+        restartSchedule(&schedule);
+    }
+    int64_t dueUs = periodicNextUs;
+    if (sleepUntil(dueUs) < 0) {
+        return NULL;
+    }
+
+    sensorRound round;
+    int result;
+    Py_BEGIN_ALLOW_THREADS
+    result = runSensorRound(&loop, &round, timeoutMs);
+    Py_END_ALLOW_THREADS
+
+    int64_t nowUs = scheduleClockUs();
+    uint64_t missed = nowUs > dueUs + periodUs ? (uint64_t) ((nowUs - dueUs) / periodUs) : 0;
+    for (int i = 0; i < loop.sensors; i++) {
+        recordScheduledRun(&schedule, i, dueUs, round.startUs, periodUs, round.durationUs);
+        recordMissedPeriods(&schedule, i, missed);
+    }
+    periodicNextUs = dueUs + (int64_t) (missed + 1) * periodUs;
+
+    if (result < 0) {
+        Py_RETURN_NONE;
+    }
+    publishRound(&round);
+    return roundSnapshot(&round);
+}
+
+/**
+ * Get how well adaptive_snapshot and periodic_snapshot kept their
+ * schedule.
+ *
+ * @param self python instance the method is called on
+ * @param args passed arguments from calling python method
+ * @return dict of sensor name to a dict with the number of runs,
+ *         early runs (gathered with an earlier one), overruns (the
+ *         round ended after the next one was due), missed periods,
+ *         the drift in s (how far the last run was behind the
+ *         first run plus the intended periods) and percentiles
+ *         (bucket bounds, at most the maximum) and maximum of the
+ *         lateness and the period jitter in us. None before the
+ *         sensors were opened.
+ */
+static PyObject *schedule_stats(PyObject *self, PyObject *args) {
+    if (!loopOpen) {
+        Py_RETURN_NONE;
+    }
+
+    PyObject *result = PyDict_New();
+    if (result == NULL) {
+        return NULL;
+    }
+    for (int i = 0; i < schedule.channels; i++) {
+        const scheduleChannel *c = &schedule.channel[i];
+        PyObject *stats = Py_BuildValue("{s:K,s:K,s:K,s:K,s:d,s:K,s:K,s:L,s:K,s:K,s:L}",
+                                        "runs", (unsigned PY_LONG_LONG) c->runs,
+                                        "early", (unsigned PY_LONG_LONG) c->early,
+                                        "overruns", (unsigned PY_LONG_LONG) c->overruns,
+                                        "missed", (unsigned PY_LONG_LONG) c->missed,
+                                        "drift_s", c->driftUs / 1e6,
+                                        "late_p50_us",
+                                        (unsigned PY_LONG_LONG) schedulePercentile(c->lateHistogram, c->maxLateUs, 50),
+                                        "late_p99_us",
+                                        (unsigned PY_LONG_LONG) schedulePercentile(c->lateHistogram, c->maxLateUs, 99),
+                                        "late_max_us", (PY_LONG_LONG) c->maxLateUs,
+                                        "jitter_p50_us",
+                                        (unsigned PY_LONG_LONG) schedulePercentile(c->jitterHistogram, c->maxJitterUs,
+                                                                                   50),
+                                        "jitter_p99_us",
+                                        (unsigned PY_LONG_LONG) schedulePercentile(c->jitterHistogram, c->maxJitterUs,
+                                                                                   99),
+                                        "jitter_max_us", (PY_LONG_LONG) c->maxJitterUs);
+        if (stats == NULL || PyDict_SetItemString(result, c->name, stats) < 0) {
+            Py_XDECREF(stats);
+            Py_DECREF(result);
+            return NULL;
+        }
+        Py_DECREF(stats);
+    }
+    return result;
+}
+
+/**
+ * Write the schedule statistics in the Prometheus text format.
+ *
+ * @param self python instance the method is called on
+ * @param args target file
+ * @return 0 on success, -1 on failure
+ */
+static PyObject *dump_schedule_stats(PyObject *self, PyObject *args) {
+    const char *path;
+    if (!PyArg_ParseTuple(args, "s", &path)) {
+        return NULL;
+    }
+    if (!loopOpen) {
+        return Py_BuildValue("i", -1);
+    }
+
+    return Py_BuildValue("i", writeScheduleStatistics(&schedule, path));
+}
+
+/**
+ * Reset the schedule statistics.
+ *
+ * @param self python instance the method is called on
+ * @param args passed arguments from calling python method
+ * @return None
+ */
+static PyObject *reset_schedule_stats(PyObject *self, PyObject *args) {
+    if (loopOpen) {
+        resetScheduleStats(&schedule);
+    }
+    Py_RETURN_NONE;
+}
+
+/* Signal stopping Python, 0 if none came, and the thread running Python */
+static volatile sig_atomic_t stopSignal = 0;
+static pthread_t pythonThread;
+static int summaryPrinted = 0;
+
+/**
+ * Summarizes the schedule statistics on stderr when Python exits.
+ */
+static void printScheduleAtExit(void) {
+    if (loopOpen && !summaryPrinted) {
+        printScheduleSummary(&schedule, stderr);
+        summaryPrinted = 1;
+    }
+}
+
+/**
+ * Prints the summary and lets the signal stopping Python take its
+ * default action, run by the main thread holding the GIL.
+ */
+static int stopOnSignal(void *unused) {
+    int number = stopSignal;
+    printScheduleAtExit();
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = SIG_DFL;
+    sigaction(number, &action, NULL);
+    raise(number);
+    return 0;
+}
+
+/**
+ * Handler of the signals stopping Python. Only a pending call is
+ * queued, like the signal module does, the summary is not written
+ * within the handler. A signal caught by another thread (i. e. of a
+ * stream) is passed on to the thread running Python, so it
+ * interrupts a sleep there.
+ */
+static void onStopSignal(int number) {
+    if (!pthread_equal(pthread_self(), pythonThread)) {
+        pthread_kill(pythonThread, number);
+        return;
+    }
+    stopSignal = number;
+    Py_AddPendingCall(stopOnSignal, NULL);
+}
+
+/**
+ * Catches a signal stopping Python, unless a handler is installed
+ * for it already. A SIGINT handled by Python raises
+ * KeyboardInterrupt and reaches printScheduleAtExit on its own.
+ */
+static void catchStopSignal(int number) {
+    struct sigaction action;
+    if (sigaction(number, NULL, &action) == 0 && action.sa_handler == SIG_DFL) {
+        memset(&action, 0, sizeof(action));
+        action.sa_handler = onStopSignal;
+        sigemptyset(&action.sa_mask);
+        sigaction(number, &action, NULL);
+    }
+}
+
+/**
+ * Method definitions that are visible in Python afterwards
+ */
+static PyMethodDef cosybox_methods[] = {
+        {"snapshot",               snapshot,               METH_VARARGS},
+        {"startup_times",          startup_times,          METH_VARARGS},
+        {"set_air_mode",           set_air_mode,           METH_VARARGS},
+        {"air_raw",                air_raw,                METH_VARARGS},
+        {"set_env_mode",           set_env_mode,           METH_VARARGS},
+        {"set_env_config",         set_env_config,         METH_VARARGS},
+        {"env_pressure",           env_pressure,           METH_VARARGS},
+        {"accel_stream",           accel_stream,           METH_VARARGS},
+        {"stop_accel_stream",      stop_accel_stream,      METH_VARARGS},
+        {"accel_samples",          accel_samples,          METH_VARARGS},
+        {"accel_status",           accel_status,           METH_VARARGS},
+        {"flicker_stream",         flicker_stream,         METH_VARARGS},
+        {"stop_flicker_stream",    stop_flicker_stream,    METH_VARARGS},
+        {"flicker_reports",        flicker_reports,        METH_VARARGS},
+        {"flicker_status",         flicker_status,         METH_VARARGS},
+        {"set_air_baseline_file",  set_air_baseline_file,  METH_VARARGS},
+        {"air_baseline",           air_baseline,           METH_VARARGS},
+        {"share_samples",          share_samples,          METH_VARARGS},
+        {"adaptive_sampling",      adaptive_sampling,      METH_VARARGS},
+        {"set_adaptive_threshold", set_adaptive_threshold, METH_VARARGS},
+        {"adaptive_snapshot",      adaptive_snapshot,      METH_VARARGS},
+        {"rate_changes",           rate_changes,           METH_VARARGS},
+        {"adaptive_status",        adaptive_status,        METH_VARARGS},
+        {"set_outlier_filter",     set_outlier_filter,     METH_VARARGS},
+        {"outlier_status",         outlier_status,         METH_VARARGS},
+        {"periodic_snapshot",      periodic_snapshot,      METH_VARARGS},
+        {"schedule_stats",         schedule_stats,         METH_VARARGS},
+        {"dump_schedule_stats",    dump_schedule_stats,    METH_VARARGS},
+        {"reset_schedule_stats",   reset_schedule_stats,   METH_VARARGS},
+        {NULL, NULL, 0, NULL} /* Sentinel */
+};
+
+/**
+ * Lays out the snapshot after the descriptors of boxDrivers: a field
+ * for every channel, named after it, then the status and time of
+ * every sensor, named after its field prefix (i. e. env_status).
+ */
+static void snapshotLayout(void) {
+    const driverChannel *channel;
+    int field = SNAPSHOT_VALUES;
+    for (int i = 0; (channel = boxChannel(i, &channelSettings[i].sensor)) != NULL; i++) {
+        channelSettings[i].channel = channel;
+        channelSettings[i].rate = channel->rate;
+        channelSettings[i].deviation = channel->deviation;
+        snapshotFields[field].name = (char *) channel->name;
+        snapshotFields[field++].doc = (char *) channel->description;
+        snapshotChannels++;
+    }
+    snapshotStatus = field;
+    snapshotSensorTime = field + boxSensors;
+    for (int i = 0; i < boxSensors; i++) {
+        const sensorDriver *driver = boxDrivers[i];
+        snprintf(sensorFieldNames[i][0], sizeof(sensorFieldNames[i][0]), "%s_status", driver->field);
+        snprintf(sensorFieldDocs[i][0], sizeof(sensorFieldDocs[i][0]), "status of the %s (0 = ok)", driver->name);
+        snprintf(sensorFieldNames[i][1], sizeof(sensorFieldNames[i][1]), "%s_time", driver->field);
+        snprintf(sensorFieldDocs[i][1], sizeof(sensorFieldDocs[i][1]), "time the %s values were read", driver->name);
+        snapshotFields[snapshotStatus + i].name = sensorFieldNames[i][0];
+        snapshotFields[snapshotStatus + i].doc = sensorFieldDocs[i][0];
+        snapshotFields[snapshotSensorTime + i].name = sensorFieldNames[i][1];
+        snapshotFields[snapshotSensorTime + i].doc = sensorFieldDocs[i][1];
+    }
+    snapshotOutliers = snapshotSensorTime + boxSensors;
+    snapshotFields[snapshotOutliers].name = "outliers";
+    snapshotFields[snapshotOutliers].doc = "names of the values the outlier filter flagged";
+    snapshotFieldCount = snapshotOutliers + 1;
+    snapshotDesc.n_in_sequence = snapshotFieldCount;
+}
+
+/**
+ * Initializes the module and methods that can be called
+ * from python.
+ */
+void initcosybox(void) {
+    PyImport_AddModule("cosybox");
+    PyObject *module = Py_InitModule("cosybox", cosybox_methods);
+    if (module == NULL) {
+        return;
+    }
+    if (snapshotType.tp_name == NULL) {
+        snapshotLayout();
+        PyStructSequence_InitType(&snapshotType, &snapshotDesc);
+        Py_AtExit(printScheduleAtExit);
+        pythonThread = pthread_self();
+        catchStopSignal(SIGTERM);
+        catchStopSignal(SIGHUP);
+        catchStopSignal(SIGINT);
+    }
+    Py_INCREF(&snapshotType);
+    PyModule_AddObject(module, "snapshot_result", (PyObject *) &snapshotType);
+    PyModule_AddIntConstant(module, "AIR_MODE_1S", CCS811_MODE_1S);
+    PyModule_AddIntConstant(module, "AIR_MODE_10S", CCS811_MODE_10S);
+    PyModule_AddIntConstant(module, "AIR_MODE_60S", CCS811_MODE_60S);
+    PyModule_AddIntConstant(module, "AIR_MODE_250MS", CCS811_MODE_250MS);
+    PyModule_AddIntConstant(module, "ENV_WEATHER", PRESET_WEATHER);
+    PyModule_AddIntConstant(module, "ENV_HUMIDITY", PRESET_HUMIDITY);
+    PyModule_AddIntConstant(module, "ENV_INDOOR_NAVIGATION", PRESET_INDOOR_NAVIGATION);
+    PyModule_AddIntConstant(module, "ENV_GAMING", PRESET_GAMING);
+    PyModule_AddIntConstant(module, "SKIPPED", LOOP_SKIPPED);
+    PyModule_AddIntConstant(module, "OUTLIERS_OFF", OUTLIERS_OFF);
+    PyModule_AddIntConstant(module, "OUTLIERS_FLAG", OUTLIERS_FLAG);
+    PyModule_AddIntConstant(module, "OUTLIERS_REPLACE", OUTLIERS_REPLACE);
+}
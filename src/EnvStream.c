@@ -0,0 +1,85 @@
+/**
+ * <Program>
+ * EnvStream.c
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ *  Pressure stream of the BME280 in normal mode, a descriptor run by
+ * the stream engine (see SensorStream.h). The timer wakes the thread
+ * once per output period, pressure and temperature
+ * are read with one burst read of 6 bytes, compensated and appended
+ * to the ring buffer with their timestamp. The period is the
+ * maximum measurement time plus the standby time, so the thread
+ * runs slightly slower than the sensor and a measurement is skipped
+ * now and then rather than read twice; the timestamps show it.
+ *
+ * <Sources>
+ * Accessed on 18.10.2026 - BME280 Datasheet:
+ *      https://ae-bst.resource.bosch.com/media/_tech/media/datasheets/BST-BME280_DS001-12.pdf
+ */
+
+#include "EnvStream.h"
+
+/* Reads pressure and temperature on every expiration of the timer */
+static void readEnvSample(sensorStream *stream) {
+    envStream *env = stream->owner;
+    envData raw;
+    int64_t timeUs = streamClockUs(CLOCK_REALTIME);
+    if (readRawPressTemp(stream->fd, &raw) != I2C_OK) {
+        streamError(stream);
+        return;
+    }
+    envPressureSample sample;
+    int32_t tempFine;
+    sample.time = timeUs;
+    sample.temperature = calcTemp(raw.temperature, env->comp, &tempFine);
+    sample.pressure = calcPress(raw.pressure, env->comp, tempFine);
+    pushRing(&stream->ring, &sample);
+}
+
+/* The sensor loop set normal mode, the timer follows its output period */
+static int startEnv(sensorStream *stream) {
+    envStream *env = stream->owner;
+    stream->periodUs = outputPeriod(&env->settings);
+    return I2C_OK;
+}
+
+static const streamDriver envStreamDriver = {
+        .name = "BME280 pressure",
+        .address = BME280_ADDRESS,
+        .recordSize = sizeof(envPressureSample),
+        .capacity = ENV_STREAM_CAPACITY,
+        .start = startEnv,
+        .due = readEnvSample
+};
+
+/**
+ * Opens the sensor and starts the thread reading pressure and
+ * temperature once per output period of the settings. The sensor
+ * has to measure in normal mode with these settings already.
+ *
+ * @param stream stream to start
+ * @param comp compensation parameters of the sensor
+ * @param settings settings the sensor measures with
+ * @return 0 on success, -1 on failure
+ */
+int startEnvStream(envStream *stream, const compParam *comp, const envSettings *settings) {
+    stream->comp = *comp;
+    stream->settings = *settings;
+    return startSensorStream(&stream->stream, &envStreamDriver, stream, NULL);
+}
+
+/**
+ * Stops the thread and closes the sensor. The thread notices it
+ * with the next expiration of its timer.
+ *
+ * @param stream started stream
+ */
+void stopEnvStream(envStream *stream) {
+    stopSensorStream(&stream->stream);
+}
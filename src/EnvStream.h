@@ -0,0 +1,65 @@
+/**
+ * <Program>
+ * EnvStream.h
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ * Header file for the pressure stream of the BME280. While the
+ * sensor measures in normal mode (i. e. with PRESET_INDOOR_NAVIGATION
+ * or PRESET_GAMING), a thread reads pressure and temperature once
+ * per output period into a ring buffer, for height and movement
+ * experiments. The thread opens the sensor on its own file
+ * descriptor, the sensor loop stays in charge of the setup and the
+ * settings.
+ */
+
+#ifndef SRC_ENVSTREAM_H
+#define SRC_ENVSTREAM_H
+
+#include <inttypes.h>
+#include "BME280_TempSensor.h"
+#include "SensorStream.h"
+
+#define ENV_STREAM_CAPACITY 32768   /* samples, about 7.5 minutes at the rate of PRESET_GAMING */
+
+/* Used to hold a pressure sample of the stream */
+typedef struct {
+    int64_t time;         /* us since epoch */
+    uint32_t pressure;    /* Pa in Q24.8 */
+    int32_t temperature;  /* C * 100 */
+} envPressureSample;
+
+/* Used to hold the stream and what it compensates the samples with */
+typedef struct {
+    sensorStream stream;    /* envPressureSample records, the period is the output period */
+    compParam comp;
+    envSettings settings;
+} envStream;
+
+/* METHODS */
+
+/**
+ * Opens the sensor and starts the thread reading pressure and
+ * temperature once per output period of the settings. The sensor
+ * has to measure in normal mode with these settings already.
+ *
+ * @param stream stream to start
+ * @param comp compensation parameters of the sensor
+ * @param settings settings the sensor measures with
+ * @return 0 on success, -1 on failure
+ */
+int startEnvStream(envStream *stream, const compParam *comp, const envSettings *settings);
+/**
+ * Stops the thread and closes the sensor. The samples stay
+ * readable, a stream started again appends to them.
+ *
+ * @param stream started stream
+ */
+void stopEnvStream(envStream *stream);
+
+#endif //SRC_ENVSTREAM_H
@@ -0,0 +1,384 @@
+/**
+ * <Program>
+ * FlickerAnalysis.c
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ *  Flicker analysis of the VIS and IR channels of the SI1145. Every
+ * window of FLICKER_WINDOW samples is reduced to its time domain
+ * statistics and its power spectrum, both summed up until the report
+ * is due. The FFT is an iterative radix 2 transform: the input is put
+ * into bit reversed order, then every stage combines pairs of halves
+ * of size h with the twiddle factors exp(-i * pi * j / h), stored at
+ * [h, 2h) of the tables so every stage reads them one after the
+ * other. From h = 4 on the butterflies of 4 neighbouring j are one
+ * vector operation, the first two stages are left scalar.
+ *  VIS and IR are real, so both fit into one complex transform
+ * z = vis + i * ir, with VIS[k] = (Z[k] + conj(Z[N - k])) / 2 and
+ * IR[k] = (Z[k] - conj(Z[N - k])) / 2i. The mirrored bins are loaded
+ * as a vector and reversed with a shuffle.
+ *  The power of a bin is scaled to 2 |X|^2 / (N * sum(w^2)), the
+ * one sided spectrum of the variance, so the bins of a band add up
+ * to the variance of the counts in it whatever the window.
+ *
+ * <Sources>
+ * Accessed on 18.10.2026 - Using Vector Instructions through Built-in Functions:
+ *      https://gcc.gnu.org/onlinedocs/gcc/Vector-Extensions.html
+ * Accessed on 18.10.2026 - Cooley-Tukey FFT algorithm:
+ *      https://en.wikipedia.org/wiki/Cooley%E2%80%93Tukey_FFT_algorithm
+ * Accessed on 18.10.2026 - Welch's method:
+ *      https://en.wikipedia.org/wiki/Welch%27s_method
+ * Accessed on 18.10.2026 - Flicker index and percent flicker (IES Lighting Handbook):
+ *      https://www.energy.gov/eere/ssl/flicker
+ * Accessed on 18.10.2026 - Quadratic interpolation of spectral peaks:
+ *      https://ccrma.stanford.edu/~jos/sasp/Quadratic_Interpolation_Spectral_Peaks.html
+ */
+
+#include <math.h>
+#include <string.h>
+#include "FlickerAnalysis.h"
+
+#define FLICKER_LANES 4
+
+typedef float flickerVector __attribute__((vector_size(16)));
+typedef int32_t flickerMask __attribute__((vector_size(16)));
+
+/**
+ * Loads 4 floats, the address needs no alignment.
+ */
+static inline flickerVector loadVector(const float *values) {
+    flickerVector vector;
+    memcpy(&vector, values, sizeof(vector));
+    return vector;
+}
+
+/**
+ * Stores 4 floats, the address needs no alignment.
+ */
+static inline void storeVector(float *values, flickerVector vector) {
+    memcpy(values, &vector, sizeof(vector));
+}
+
+/**
+ * Returns the lanes of a where the mask is set and those of b elsewhere.
+ */
+static inline flickerVector selectVector(flickerMask mask, flickerVector a, flickerVector b) {
+    return (flickerVector) (((flickerMask) a & mask) | ((flickerMask) b & ~mask));
+}
+
+/**
+ * Returns the sum of the lanes.
+ */
+static inline float sumVector(flickerVector vector) {
+    return vector[0] + vector[1] + vector[2] + vector[3];
+}
+
+/**
+ * Initializes the analyzer with its tables and an empty window.
+ *
+ * @param analyzer analyzer to initialize
+ * @param dark counts of both channels in the dark, i. e. FLICKER_DARK
+ * @param reportWindows windows averaged into a report, at least 1
+ */
+void openFlickerAnalyzer(flickerAnalyzer *analyzer, double dark, int reportWindows) {
+    memset(analyzer, 0, sizeof(*analyzer));
+    analyzer->dark = dark;
+    analyzer->reportWindows = reportWindows > 0 ? reportWindows : 1;
+
+    for (int i = 0; i < FLICKER_WINDOW; i++) {
+        double weight = 0.5 - 0.5 * cos(2 * M_PI * i / FLICKER_WINDOW);
+        analyzer->hann[i] = (float) weight;
+        analyzer->hannPower += weight * weight;
+    }
+    for (int h = 1; h < FLICKER_WINDOW; h *= 2) {
+        for (int j = 0; j < h; j++) {
+            analyzer->twiddleRe[h + j] = (float) cos(M_PI * j / h);
+            analyzer->twiddleIm[h + j] = (float) -sin(M_PI * j / h);
+        }
+    }
+    int bits = 0;
+    while ((1 << bits) < FLICKER_WINDOW) {
+        bits++;
+    }
+    for (int i = 0; i < FLICKER_WINDOW; i++) {
+        int reversed = 0;
+        for (int bit = 0; bit < bits; bit++) {
+            reversed |= ((i >> bit) & 1) << (bits - 1 - bit);
+        }
+        analyzer->reversed[i] = (uint16_t) reversed;
+    }
+}
+
+/**
+ * Transforms a complex signal in place with a radix 2 FFT of
+ * FLICKER_WINDOW points, using the tables of the analyzer.
+ *
+ * @param analyzer opened analyzer
+ * @param re real parts, FLICKER_WINDOW values
+ * @param im imaginary parts, FLICKER_WINDOW values
+ */
+void flickerFFT(const flickerAnalyzer *analyzer, float *re, float *im) {
+    for (int i = 0; i < FLICKER_WINDOW; i++) {
+        int j = analyzer->reversed[i];
+        if (i < j) {
+            float swap = re[i];
+            re[i] = re[j];
+            re[j] = swap;
+            swap = im[i];
+            im[i] = im[j];
+            im[j] = swap;
+        }
+    }
+
+    for (int h = 1; h < FLICKER_WINDOW; h *= 2) {
+        const float *twiddleRe = analyzer->twiddleRe + h;
+        const float *twiddleIm = analyzer->twiddleIm + h;
+        for (int k = 0; k < FLICKER_WINDOW; k += 2 * h) {
+            float *lowRe = re + k, *lowIm = im + k;
+            float *highRe = lowRe + h, *highIm = lowIm + h;
+            if (h < FLICKER_LANES) {
+                for (int j = 0; j < h; j++) {
+                    float tRe = twiddleRe[j] * highRe[j] - twiddleIm[j] * highIm[j];
+                    float tIm = twiddleRe[j] * highIm[j] + twiddleIm[j] * highRe[j];
+                    highRe[j] = lowRe[j] - tRe;
+                    highIm[j] = lowIm[j] - tIm;
+                    lowRe[j] += tRe;
+                    lowIm[j] += tIm;
+                }
+                continue;
+            }
+            for (int j = 0; j < h; j += FLICKER_LANES) {
+                flickerVector wRe = loadVector(twiddleRe + j), wIm = loadVector(twiddleIm + j);
+                flickerVector xRe = loadVector(highRe + j), xIm = loadVector(highIm + j);
+                flickerVector tRe = wRe * xRe - wIm * xIm;
+                flickerVector tIm = wRe * xIm + wIm * xRe;
+                flickerVector yRe = loadVector(lowRe + j), yIm = loadVector(lowIm + j);
+                storeVector(highRe + j, yRe - tRe);
+                storeVector(highIm + j, yIm - tIm);
+                storeVector(lowRe + j, yRe + tRe);
+                storeVector(lowIm + j, yIm + tIm);
+            }
+        }
+    }
+}
+
+/**
+ * Sums up mean, percent flicker and flicker index of a channel of
+ * the window.
+ *
+ * @return mean of the window, to be removed before the transform
+ */
+static float addTimeDomain(flickerAnalyzer *analyzer, int channel) {
+    const float *samples = analyzer->samples[channel];
+    flickerVector low = loadVector(samples), high = low, sum = {0, 0, 0, 0};
+    for (int i = 0; i < FLICKER_WINDOW; i += FLICKER_LANES) {
+        flickerVector x = loadVector(samples + i);
+        low = selectVector(x < low, x, low);
+        high = selectVector(x > high, x, high);
+        sum += x;
+    }
+    float total = sumVector(sum);
+    float mean = total / FLICKER_WINDOW;
+    float minimum = fminf(fminf(low[0], low[1]), fminf(low[2], low[3]));
+    float maximum = fmaxf(fmaxf(high[0], high[1]), fmaxf(high[2], high[3]));
+
+    /* Area above the mean */
+    flickerVector means = {mean, mean, mean, mean}, zero = {0, 0, 0, 0}, above = zero;
+    for (int i = 0; i < FLICKER_WINDOW; i += FLICKER_LANES) {
+        flickerVector deviation = loadVector(samples + i) - means;
+        above += selectVector(deviation > zero, deviation, zero);
+    }
+
+    analyzer->meanSum[channel] += mean;
+    if (maximum + minimum > 0) {
+        analyzer->percentSum[channel] += 100.0 * (maximum - minimum) / (maximum + minimum);
+    }
+    if (total > 0) {
+        analyzer->indexSum[channel] += sumVector(above) / total;
+    }
+    return mean;
+}
+
+/**
+ * Adds the power of bin k of VIS and IR, separated from the bins k
+ * and N - k of the transform.
+ */
+static void addBin(flickerAnalyzer *analyzer, int k, float scale) {
+    int mirror = (FLICKER_WINDOW - k) % FLICKER_WINDOW;
+    float sumRe = analyzer->re[k] + analyzer->re[mirror], differenceRe = analyzer->re[k] - analyzer->re[mirror];
+    float sumIm = analyzer->im[k] + analyzer->im[mirror], differenceIm = analyzer->im[k] - analyzer->im[mirror];
+    analyzer->power[FLICKER_VIS][k] += scale * (sumRe * sumRe + differenceIm * differenceIm);
+    analyzer->power[FLICKER_IR][k] += scale * (sumIm * sumIm + differenceRe * differenceRe);
+}
+
+/**
+ * Analyzes the full window and sums up the results.
+ */
+static void analyzeWindow(flickerAnalyzer *analyzer) {
+    float mean[FLICKER_CHANNELS];
+    for (int channel = 0; channel < FLICKER_CHANNELS; channel++) {
+        mean[channel] = addTimeDomain(analyzer, channel);
+    }
+    int64_t spanUs = analyzer->timeUs[FLICKER_WINDOW - 1] - analyzer->timeUs[0];
+    if (spanUs > 0) {
+        analyzer->rateSum += (FLICKER_WINDOW - 1) * 1e6 / spanUs;
+    }
+
+    /* z = vis + i * ir without the mean, weighted with the window */
+    flickerVector visMean = {mean[FLICKER_VIS], mean[FLICKER_VIS], mean[FLICKER_VIS], mean[FLICKER_VIS]};
+    flickerVector irMean = {mean[FLICKER_IR], mean[FLICKER_IR], mean[FLICKER_IR], mean[FLICKER_IR]};
+    for (int i = 0; i < FLICKER_WINDOW; i += FLICKER_LANES) {
+        flickerVector weight = loadVector(analyzer->hann + i);
+        storeVector(analyzer->re + i, (loadVector(analyzer->samples[FLICKER_VIS] + i) - visMean) * weight);
+        storeVector(analyzer->im + i, (loadVector(analyzer->samples[FLICKER_IR] + i) - irMean) * weight);
+    }
+    flickerFFT(analyzer, analyzer->re, analyzer->im);
+
+    /*
+     * One sided power, the separation's 1/4 included: 2 / 4 for the
+     * bins between, 1 / 4 for DC and Nyquist, which have no mirror
+     */
+    float scale = (float) (0.5 / (FLICKER_WINDOW * analyzer->hannPower));
+    flickerVector scales = {scale, scale, scale, scale};
+    flickerMask reverse = {3, 2, 1, 0};
+    int k = 1;
+    for (; k + FLICKER_LANES <= FLICKER_WINDOW / 2; k += FLICKER_LANES) {
+        int mirror = FLICKER_WINDOW - k - (FLICKER_LANES - 1);
+        flickerVector re = loadVector(analyzer->re + k), im = loadVector(analyzer->im + k);
+        flickerVector mirrorRe = __builtin_shuffle(loadVector(analyzer->re + mirror), reverse);
+        flickerVector mirrorIm = __builtin_shuffle(loadVector(analyzer->im + mirror), reverse);
+        flickerVector sumRe = re + mirrorRe, differenceRe = re - mirrorRe;
+        flickerVector sumIm = im + mirrorIm, differenceIm = im - mirrorIm;
+        float *vis = analyzer->power[FLICKER_VIS] + k, *ir = analyzer->power[FLICKER_IR] + k;
+        storeVector(vis, loadVector(vis) + scales * (sumRe * sumRe + differenceIm * differenceIm));
+        storeVector(ir, loadVector(ir) + scales * (sumIm * sumIm + differenceRe * differenceRe));
+    }
+    for (; k < FLICKER_WINDOW / 2; k++) {
+        addBin(analyzer, k, scale);
+    }
+    addBin(analyzer, 0, scale / 2);
+    addBin(analyzer, FLICKER_WINDOW / 2, scale / 2);
+    analyzer->windows++;
+}
+
+/**
+ * Finds the dominant frequency of the averaged spectrum of a channel,
+ * interpolated with a parabola through the logarithmic power of the
+ * peak and its neighbours.
+ *
+ * @return frequency in Hz, 0 if the light is constant
+ */
+static double dominantFrequency(const float *power, int firstBin, double binHz) {
+    int peak = -1;
+    for (int k = firstBin; k < FLICKER_WINDOW / 2; k++) {
+        if (power[k] > 0 && (peak < 0 || power[k] > power[peak])) {
+            peak = k;
+        }
+    }
+    if (peak < 0) {
+        return 0;
+    }
+    double offset = 0;
+    if (power[peak - 1] > 0 && power[peak + 1] > 0) {
+        double left = log(power[peak - 1]), center = log(power[peak]), right = log(power[peak + 1]);
+        double curvature = left - 2 * center + right;
+        if (curvature < 0) {
+            offset = 0.5 * (left - right) / curvature;
+        }
+    }
+    return (peak + offset) * binHz;
+}
+
+/**
+ * Averages the windows of the report and starts the next one.
+ */
+static void finishReport(flickerAnalyzer *analyzer, flickerReport *report) {
+    static const double edges[FLICKER_BANDS] = FLICKER_BAND_EDGES;
+    double windows = analyzer->windows;
+
+    memset(report, 0, sizeof(*report));
+    report->windows = (uint32_t) analyzer->windows;
+    report->rateHz = analyzer->rateSum / windows;
+    double binHz = report->rateHz / FLICKER_WINDOW;
+    int firstBin = binHz > 0 ? (int) ceil(FLICKER_MIN_HZ / binHz) : 1;
+    if (firstBin < 1) {
+        firstBin = 1;
+    }
+
+    for (int channel = 0; channel < FLICKER_CHANNELS; channel++) {
+        flickerChannel *result = &report->channel[channel];
+        const float *power = analyzer->power[channel];
+        result->mean = analyzer->meanSum[channel] / windows;
+        result->percent = analyzer->percentSum[channel] / windows;
+        result->index = analyzer->indexSum[channel] / windows;
+        if (binHz > 0) {
+            result->frequency = dominantFrequency(power, firstBin, binHz);
+        }
+        int band = 0;
+        for (int k = firstBin; k < FLICKER_BINS; k++) {
+            while (band + 1 < FLICKER_BANDS && k * binHz >= edges[band + 1]) {
+                band++;
+            }
+            result->band[band] += power[k] / windows;
+        }
+    }
+
+    analyzer->windows = 0;
+    analyzer->rateSum = 0;
+    memset(analyzer->power, 0, sizeof(analyzer->power));
+    memset(analyzer->meanSum, 0, sizeof(analyzer->meanSum));
+    memset(analyzer->percentSum, 0, sizeof(analyzer->percentSum));
+    memset(analyzer->indexSum, 0, sizeof(analyzer->indexSum));
+}
+
+/**
+ * Adds a sample, analyzes the window if it is full and finishes the
+ * report if it has all its windows.
+ *
+ * @param analyzer opened analyzer
+ * @param timeUs monotonic time the sample was read
+ * @param vis VIS counts
+ * @param ir IR counts
+ * @param report receives the report, its time is left to the caller
+ * @return 1 if a report was finished, 0 otherwise
+ */
+int addFlickerSample(flickerAnalyzer *analyzer, int64_t timeUs, uint16_t vis, uint16_t ir, flickerReport *report) {
+    int i = analyzer->filled++;
+    analyzer->samples[FLICKER_VIS][i] = vis > analyzer->dark ? (float) (vis - analyzer->dark) : 0;
+    analyzer->samples[FLICKER_IR][i] = ir > analyzer->dark ? (float) (ir - analyzer->dark) : 0;
+    analyzer->timeUs[i] = timeUs;
+    if (analyzer->filled < FLICKER_WINDOW) {
+        return 0;
+    }
+
+    analyzeWindow(analyzer);
+    /* The second half is the first half of the next window */
+    for (int channel = 0; channel < FLICKER_CHANNELS; channel++) {
+        memmove(analyzer->samples[channel], analyzer->samples[channel] + FLICKER_HOP,
+                (FLICKER_WINDOW - FLICKER_HOP) * sizeof(float));
+    }
+    memmove(analyzer->timeUs, analyzer->timeUs + FLICKER_HOP, (FLICKER_WINDOW - FLICKER_HOP) * sizeof(int64_t));
+    analyzer->filled = FLICKER_WINDOW - FLICKER_HOP;
+
+    if (analyzer->windows < analyzer->reportWindows) {
+        return 0;
+    }
+    finishReport(analyzer, report);
+    return 1;
+}
+
+/**
+ * Drops the samples of the window being filled, i. e. after a gap in
+ * the samples too long to be bridged. The windows already analyzed
+ * stay in the report.
+ *
+ * @param analyzer opened analyzer
+ */
+void dropFlickerWindow(flickerAnalyzer *analyzer) {
+    analyzer->filled = 0;
+}
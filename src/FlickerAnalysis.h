@@ -0,0 +1,150 @@
+/**
+ * <Program>
+ * FlickerAnalysis.h
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ * Header file for the flicker analysis of a high rate stream of the
+ * VIS and IR channels of the SI1145. The samples are collected in
+ * windows of FLICKER_WINDOW samples overlapping by half, every
+ * window is analyzed as soon as it is full:
+ *
+ *      time domain  mean, percent flicker 100 * (max - min) /
+ *                   (max + min) and flicker index (area above the
+ *                   mean / total area) of the counts above the dark
+ *                   level, as defined by the IES
+ *      spectrum     the mean is removed, the window weighted with a
+ *                   Hann window and transformed with an FFT; VIS and
+ *                   IR are the real and imaginary part of the same
+ *                   transform and separated afterwards
+ *
+ * A report averages the windows of an interval (Welch's method):
+ * the dominant frequency is the peak of the averaged power spectrum
+ * above FLICKER_MIN_HZ, interpolated between the bins, and the
+ * band energies are the shares of the variance of the counts in
+ * the bands of FLICKER_BAND_EDGES, so all bands add up to the
+ * variance. The frequencies are taken from the rate the samples
+ * really came in at, measured over every window.
+ *
+ * The kernels (window, butterflies, power spectrum and the time
+ * domain statistics) work on 4 floats at a time with the vector
+ * extensions of GCC, which are compiled to SSE on x86 and to NEON
+ * on AArch64. On 32 bit ARMv7 CMakeLists.txt builds this file with
+ * -mfpu=neon -funsafe-math-optimizations for NEON, without them the
+ * vectors are split into scalar VFP instructions. The SI1145 counts
+ * are far from the denormals NEON flushes to 0.
+ */
+
+#ifndef SRC_FLICKERANALYSIS_H
+#define SRC_FLICKERANALYSIS_H
+
+#include <inttypes.h>
+
+#define FLICKER_WINDOW   1024  /* samples per transform, a power of two */
+#define FLICKER_HOP      (FLICKER_WINDOW / 2)
+#define FLICKER_BINS     (FLICKER_WINDOW / 2 + 1)
+#define FLICKER_CHANNELS 2     /* VIS and IR */
+#define FLICKER_VIS      0
+#define FLICKER_IR       1
+#define FLICKER_BANDS    4
+#define FLICKER_MIN_HZ   1.0   /* slower changes are not flicker */
+#define FLICKER_DARK     256   /* counts of VIS and IR in the dark */
+
+/*
+ * Lower edges of the bands in Hz, the last one reaches up to half
+ * the rate: slow fluctuation, visible flicker, mains frequency
+ * and its harmonics (100 and 120Hz), PWM dimming
+ */
+#define FLICKER_BAND_EDGES {FLICKER_MIN_HZ, 10.0, 80.0, 200.0}
+
+/* Used to hold the result of a channel in a report */
+typedef struct {
+    double mean;                /* counts above the dark level */
+    double percent;             /* percent flicker */
+    double index;               /* flicker index */
+    double frequency;           /* dominant frequency in Hz */
+    double band[FLICKER_BANDS]; /* variance of the counts in the band */
+} flickerChannel;
+
+/* Used to hold a report over the windows of an interval */
+typedef struct {
+    int64_t time;       /* end of the interval, set by the caller */
+    double rateHz;      /* rate the samples came in at */
+    uint32_t windows;   /* windows averaged */
+    flickerChannel channel[FLICKER_CHANNELS];
+} flickerReport;
+
+/* Used to hold the samples of the current window and the averages of the report */
+typedef struct {
+    double dark;
+    int reportWindows;
+    int filled;                                 /* samples in the window */
+    float samples[FLICKER_CHANNELS][FLICKER_WINDOW];
+    int64_t timeUs[FLICKER_WINDOW];             /* monotonic time every sample was read */
+
+    /* Tables */
+    float hann[FLICKER_WINDOW];
+    double hannPower;                           /* sum of the squared window */
+    float twiddleRe[FLICKER_WINDOW];            /* of the stage with half size h at [h, 2h) */
+    float twiddleIm[FLICKER_WINDOW];
+    uint16_t reversed[FLICKER_WINDOW];          /* bit reversed index */
+
+    /* Transform */
+    float re[FLICKER_WINDOW];
+    float im[FLICKER_WINDOW];
+
+    /* Sums over the windows of the report */
+    int windows;
+    float power[FLICKER_CHANNELS][FLICKER_BINS];
+    double rateSum;
+    double meanSum[FLICKER_CHANNELS];
+    double percentSum[FLICKER_CHANNELS];
+    double indexSum[FLICKER_CHANNELS];
+} flickerAnalyzer;
+
+/* METHODS */
+
+/**
+ * Initializes the analyzer with its tables and an empty window.
+ *
+ * @param analyzer analyzer to initialize
+ * @param dark counts of both channels in the dark, i. e. FLICKER_DARK
+ * @param reportWindows windows averaged into a report, at least 1
+ */
+void openFlickerAnalyzer(flickerAnalyzer *analyzer, double dark, int reportWindows);
+/**
+ * Adds a sample, analyzes the window if it is full and finishes the
+ * report if it has all its windows.
+ *
+ * @param analyzer opened analyzer
+ * @param timeUs monotonic time the sample was read
+ * @param vis VIS counts
+ * @param ir IR counts
+ * @param report receives the report, its time is left to the caller
+ * @return 1 if a report was finished, 0 otherwise
+ */
+int addFlickerSample(flickerAnalyzer *analyzer, int64_t timeUs, uint16_t vis, uint16_t ir, flickerReport *report);
+/**
+ * Drops the samples of the window being filled, i. e. after a gap in
+ * the samples too long to be bridged. The windows already analyzed
+ * stay in the report.
+ *
+ * @param analyzer opened analyzer
+ */
+void dropFlickerWindow(flickerAnalyzer *analyzer);
+/**
+ * Transforms a complex signal in place with a radix 2 FFT of
+ * FLICKER_WINDOW points, using the tables of the analyzer.
+ *
+ * @param analyzer opened analyzer
+ * @param re real parts, FLICKER_WINDOW values
+ * @param im imaginary parts, FLICKER_WINDOW values
+ */
+void flickerFFT(const flickerAnalyzer *analyzer, float *re, float *im);
+
+#endif //SRC_FLICKERANALYSIS_H
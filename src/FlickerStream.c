@@ -0,0 +1,176 @@
+/**
+ * <Program>
+ * FlickerStream.c
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ *  Flicker stream of the SI1145, a descriptor run by the stream
+ * engine (see SensorStream.h). The thread sleeps until INT signals
+ * a sample, reads VIS and IR and clears the interrupt, which releases
+ * INT for the next one. The sample is timestamped right after it was
+ * read; the analysis takes its frequencies from these times, so a
+ * sensor clock a few percent off does not shift them.
+ *  The event source is edge triggered, a missed edge would leave INT
+ * asserted and the thread asleep, so IRQSTAT is checked on the bus
+ * if nothing happened for FLICKER_STREAM_TIMEOUT_MS. Without an event
+ * source a periodic timerfd checks it at half the sampling period,
+ * backed off to half the shortest period polling allows on the bus,
+ * so a failing INT does not saturate the bus with a period that only
+ * fits with INT. Samples the slower checks miss are counted.
+ *
+ * <Sources>
+ * Accessed on 18.10.2026 - Si1145/46/47 Datasheet:
+ *      https://www.silabs.com/documents/public/data-sheets/Si1145-46-47.pdf
+ */
+
+#include <math.h>
+#include "FlickerStream.h"
+
+/**
+ * Analyzes a sample, a finished report goes into the ring buffer.
+ */
+static void analyzeFlickerSample(flickerStream *stream, int64_t timeUs, const lightData *data) {
+    flickerReport report;
+    if (addFlickerSample(&stream->analyzer, timeUs, data->vis, data->ir, &report)) {
+        report.time = streamClockUs(CLOCK_REALTIME);
+        pushRing(&stream->stream.ring, &report);
+        __atomic_fetch_add(&stream->reports, 1, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * Reads the sample of the last measurement, clears the interrupt and
+ * analyzes it. Missed samples before it are replaced by the last one
+ * if there are only a few.
+ */
+static void readFlickerSample(sensorStream *base) {
+    flickerStream *stream = base->owner;
+    lightData data;
+    int status = readVisIrSample(base->fd, &data);
+    /* Writing 1 clears the status bit and releases INT (p. 39) */
+    if (i2cTryWriteReg8(base->fd, SI1145_REG_IRQSTAT, SI1145_REG_IRQSTAT_ALS) != I2C_OK || status != I2C_OK) {
+        streamError(base);
+        return;
+    }
+    int64_t nowUs = streamClockUs(CLOCK_MONOTONIC);
+    if (stream->lastSampleUs > 0 && nowUs - stream->lastSampleUs > 1.5 * stream->periodUs) {
+        long missed = lround((nowUs - stream->lastSampleUs) / stream->periodUs) - 1;
+        __atomic_fetch_add(&stream->missed, (uint64_t) missed, __ATOMIC_RELAXED);
+        if (missed > FLICKER_STREAM_MAX_FILL) {
+            dropFlickerWindow(&stream->analyzer);
+        }
+        for (long i = 1; i <= missed && missed <= FLICKER_STREAM_MAX_FILL; i++) {
+            analyzeFlickerSample(stream, stream->lastSampleUs + (int64_t) (i * stream->periodUs), &stream->last);
+        }
+    }
+    stream->lastSampleUs = nowUs;
+    stream->last = data;
+    __atomic_fetch_add(&stream->samples, 1, __ATOMIC_RELAXED);
+    analyzeFlickerSample(stream, nowUs, &data);
+}
+
+/**
+ * Reads the sample if IRQSTAT says there is one.
+ */
+static void checkFlickerSample(sensorStream *base) {
+    int ready;
+    if (isSampleReady(base->fd, &ready) != I2C_OK) {
+        streamError(base);
+    } else if (ready) {
+        readFlickerSample(base);
+    }
+}
+
+/* Resets the sensor and lets it measure VIS and IR in auto run */
+static int startFlicker(sensorStream *base) {
+    flickerStream *stream = base->owner;
+    int status;
+    openFlickerAnalyzer(&stream->analyzer, FLICKER_DARK, stream->reportWindows);
+    if ((status = resetSensor(base->fd)) != I2C_OK ||
+        (status = enableStreamMeas(base->fd, stream->measRate)) != I2C_OK) {
+        return status;
+    }
+    int pollRate = flickerStreamMinRate(stream->busHz, 0);
+    base->periodUs = (uint32_t) ((stream->measRate > pollRate ? stream->measRate : pollRate) * 31.25 / 2);
+    base->timeoutMs = FLICKER_STREAM_TIMEOUT_MS;
+    return I2C_OK;
+}
+
+static void stopFlicker(sensorStream *base) {
+    pauseMeas(base->fd);
+}
+
+/* INT means a sample is there, the timer and a silent INT check IRQSTAT first */
+static const streamDriver flickerStreamDriver = {
+        .name = "SI1145 flicker",
+        .address = SI1145_ADDRESS,
+        .recordSize = sizeof(flickerReport),
+        .capacity = FLICKER_STREAM_CAPACITY,
+        .start = startFlicker,
+        .signalled = readFlickerSample,
+        .due = checkFlickerSample,
+        .stop = stopFlicker
+};
+
+/**
+ * Returns the shortest sampling period that keeps the stream within
+ * FLICKER_STREAM_BUS_SHARE of the bus.
+ *
+ * @param busHz clock of the I2C bus
+ * @param withEvent 1 if INT signals the samples, 0 to poll
+ * @return MEASRATE in 31.25us, at least FLICKER_STREAM_MIN_RATE or
+ *         FLICKER_STREAM_POLL_RATE when polling
+ */
+int flickerStreamMinRate(uint32_t busHz, int withEvent) {
+    /* Polling reads IRQSTAT at half the period */
+    int bits = withEvent ? FLICKER_STREAM_SAMPLE_BITS : FLICKER_STREAM_SAMPLE_BITS + 2 * FLICKER_STREAM_CHECK_BITS;
+    double periodUs = bits * 1e6 / busHz / FLICKER_STREAM_BUS_SHARE;
+    int measRate = (int) ceil(periodUs / 31.25);
+    int minRate = withEvent ? FLICKER_STREAM_MIN_RATE : FLICKER_STREAM_POLL_RATE;
+    return measRate > minRate ? measRate : minRate;
+}
+
+/**
+ * Opens and resets the sensor, lets it measure VIS and IR in auto
+ * run and starts the thread reading and analyzing the samples.
+ *
+ * @param stream stream to start
+ * @param measRate sampling period in 31.25us, flickerStreamMinRate
+ *        to 65535
+ * @param reportWindows windows of FLICKER_HOP samples averaged into
+ *        a report
+ * @param busHz clock of the I2C bus, i. e. FLICKER_STREAM_BUS_HZ
+ * @param event source signalling the samples (INT), taken over by
+ *        the stream and closed by stopFlickerStream, NULL to poll.
+ *        It stays with the caller if the stream does not start.
+ * @return 0 on success, -1 on failure
+ */
+int startFlickerStream(flickerStream *stream, int measRate, int reportWindows, uint32_t busHz,
+                       const sampleEvent *event) {
+    if (busHz == 0 || measRate < flickerStreamMinRate(busHz, event != NULL) || measRate > 0xFFFF ||
+        reportWindows < 1) {
+        return -1;
+    }
+    stream->measRate = measRate;
+    stream->reportWindows = reportWindows;
+    stream->busHz = busHz;
+    stream->periodUs = measRate * 31.25;
+    stream->lastSampleUs = 0;
+    return startSensorStream(&stream->stream, &flickerStreamDriver, stream, event);
+}
+
+/**
+ * Stops the thread and the auto run of the sensor and closes it.
+ * The reports stay readable, a stream started again appends to
+ * them. The window being filled is dropped.
+ *
+ * @param stream started stream
+ */
+void stopFlickerStream(flickerStream *stream) {
+    stopSensorStream(&stream->stream);
+}
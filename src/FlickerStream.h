@@ -0,0 +1,122 @@
+/**
+ * <Program>
+ * FlickerStream.h
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ * Header file for the flicker stream of the SI1145. The sensor
+ * measures VIS and IR on its own (ALS auto run) as fast as it can,
+ * every measRate * 31.25us, and signals every sample on INT. A
+ * thread reads each sample, feeds it into the flicker analysis (see
+ * FlickerAnalysis.h) and puts a report into a ring buffer every few
+ * seconds, so only the reports leave the thread.
+ *
+ * The sampling period has to be short enough for the flicker of
+ * interest: the 8ms the sensor loop uses alias the 100 and 120Hz of
+ * mains powered lights, 1ms sees them and their harmonics up to
+ * 500Hz. It also has to leave the bus to the other sensors: every
+ * sample is a burst read of 4 bytes and the write clearing the
+ * interrupt, about FLICKER_STREAM_SAMPLE_BITS bit times, and without
+ * INT IRQSTAT is read twice per period on top of it. The stream may
+ * use FLICKER_STREAM_BUS_SHARE of the bus (see flickerStreamMinRate):
+ *
+ *               with INT   polled
+ *      100kHz   1.9ms      3.4ms
+ *      400kHz   0.5ms      1ms
+ *
+ * So 1ms need the 400kHz bus (dtparam=i2c_arm_baudrate=400000 on the
+ * Raspberry Pi), on the default 100kHz one a sample takes almost a
+ * millisecond of bus time. Polling never goes below 1ms, the timer
+ * would wake the thread every half millisecond.
+ *
+ * While the stream runs the sensor belongs to it, the sensor loop
+ * has to leave it alone (see lendSensor in SensorLoop.h).
+ *
+ * Samples are counted as missed if the time between two of them is
+ * more than 1.5 sampling periods, i. e. because the thread was not
+ * scheduled in time and the next measurement cleared the interrupt.
+ * The FFT needs evenly spaced samples: up to FLICKER_STREAM_MAX_FILL
+ * missed samples are replaced by the last one read, a longer gap
+ * drops the window being filled.
+ */
+
+#ifndef SRC_FLICKERSTREAM_H
+#define SRC_FLICKERSTREAM_H
+
+#include <inttypes.h>
+#include "SI1145_LightSensor.h"
+#include "FlickerAnalysis.h"
+#include "SensorStream.h"
+
+#define FLICKER_STREAM_CAPACITY    1024    /* reports */
+#define FLICKER_STREAM_MEAS_RATE   32      /* 1ms, used if the bus allows it */
+#define FLICKER_STREAM_MIN_RATE    16      /* 0.5ms, about the time VIS and IR take */
+#define FLICKER_STREAM_POLL_RATE   32      /* 1ms, shortest period without INT */
+#define FLICKER_STREAM_BUS_HZ      100000  /* default clock of the I2C bus */
+#define FLICKER_STREAM_BUS_SHARE   0.5     /* share of the bus the stream may use */
+#define FLICKER_STREAM_SAMPLE_BITS 95      /* bit times of reading a sample and clearing INT */
+#define FLICKER_STREAM_CHECK_BITS  38      /* bit times of reading IRQSTAT */
+#define FLICKER_STREAM_TIMEOUT_MS  100     /* INT is checked on the bus if no edge came */
+#define FLICKER_STREAM_MAX_FILL    8       /* missed samples replaced by the last one */
+
+/* Used to hold the stream, its settings and counters */
+typedef struct {
+    sensorStream stream;  /* flickerReport records, the event source is INT */
+    int measRate;         /* MEASRATE1:MEASRATE0 */
+    int reportWindows;
+    uint32_t busHz;       /* clock of the I2C bus */
+    double periodUs;
+    /* Counters, accessed atomically */
+    uint64_t samples;     /* samples read */
+    uint64_t missed;      /* samples measured but not read */
+    uint32_t reports;     /* reports put into the ring buffer */
+    /* State of the thread */
+    int64_t lastSampleUs; /* monotonic time the last sample was read */
+    lightData last;       /* VIS and IR of the last sample */
+    flickerAnalyzer analyzer;
+} flickerStream;
+
+/* METHODS */
+
+/**
+ * Returns the shortest sampling period that keeps the stream within
+ * FLICKER_STREAM_BUS_SHARE of the bus.
+ *
+ * @param busHz clock of the I2C bus
+ * @param withEvent 1 if INT signals the samples, 0 to poll
+ * @return MEASRATE in 31.25us, at least FLICKER_STREAM_MIN_RATE or
+ *         FLICKER_STREAM_POLL_RATE when polling
+ */
+int flickerStreamMinRate(uint32_t busHz, int withEvent);
+/**
+ * Opens and resets the sensor, lets it measure VIS and IR in auto
+ * run and starts the thread reading and analyzing the samples.
+ *
+ * @param stream stream to start
+ * @param measRate sampling period in 31.25us, flickerStreamMinRate
+ *        to 65535
+ * @param reportWindows windows of FLICKER_HOP samples averaged into
+ *        a report
+ * @param busHz clock of the I2C bus, i. e. FLICKER_STREAM_BUS_HZ
+ * @param event source signalling the samples (INT), taken over by
+ *        the stream and closed by stopFlickerStream, NULL to poll.
+ *        It stays with the caller if the stream does not start.
+ * @return 0 on success, -1 on failure
+ */
+int startFlickerStream(flickerStream *stream, int measRate, int reportWindows, uint32_t busHz,
+                       const sampleEvent *event);
+/**
+ * Stops the thread and the auto run of the sensor and closes it.
+ * The reports stay readable, a stream started again appends to
+ * them. The window being filled is dropped.
+ *
+ * @param stream started stream
+ */
+void stopFlickerStream(flickerStream *stream);
+
+#endif //SRC_FLICKERSTREAM_H
@@ -0,0 +1,300 @@
+/**
+ * <Program>
+ * I2CBroker.c
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ *  Client side of the I2C broker. It is a backend of the I2C layer:
+ * every transaction of the drivers is sent to the broker as a batch
+ * of its own and the calling thread waits for the reply. The
+ * retries and circuit breakers of the I2C layer work as before, a
+ * broker that cannot be reached makes the transactions fail.
+ *  Every priority class has a connection of its own, shared by all
+ * threads of a process using the class, a request and its reply are
+ * exchanged under the lock of the connection. The broker keeps one
+ * waiting batch per connection, so a control batch of one thread is
+ * queued next to a bulk batch of another thread of the same process
+ * and runs first. A connection that broke (i. e. the broker was
+ * restarted) is opened again with the next transaction.
+ *  A device is opened locally on /dev/null, so the drivers can
+ * close it as usual, only its address is sent to the broker.
+ *
+ * <Sources>
+ * Accessed on 18.10.2026 - unix(7):
+ *      https://man7.org/linux/man-pages/man7/unix.7.html
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "I2CBroker.h"
+
+/* Connection of every priority class, -1 until it is used */
+static int brokerFd[BROKER_CLASSES] = {-1, -1, -1};
+static pthread_mutex_t brokerLock[BROKER_CLASSES] = {
+        PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER
+};
+static char brokerPath[sizeof(((struct sockaddr_un *) 0)->sun_path)];
+static int defaultPriority = BROKER_REALTIME;
+static __thread int threadPriority = -1;
+static uint32_t nextId = 0;
+
+/* Address + 1 of every local fd, 0 if unknown */
+static uint8_t brokerAddress[I2C_FD_MAX];
+/* Backend used before the broker */
+static const i2cBackend *previous = NULL;
+
+/**
+ * Opens the connection of a priority class to the broker.
+ *
+ * @param priority class of the connection
+ * @return 0 on success, -1 on failure
+ */
+static int brokerConnect(int priority) {
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    memcpy(address.sun_path, brokerPath, sizeof(address.sun_path));
+
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (connect(fd, (struct sockaddr *) &address, sizeof(address)) < 0) {
+        close(fd);
+        return -1;
+    }
+    brokerFd[priority] = fd;
+    return 0;
+}
+
+/**
+ * Sends a batch on the connection of the class of the calling
+ * thread and waits for its reply. The connection is closed if it
+ * broke, so the next exchange opens it again.
+ *
+ * @param request batch, the id and priority are filled in
+ * @param reply receives the reply
+ * @return size of the reply, -1 on failure
+ */
+static ssize_t exchange(brokerRequest *request, brokerReply *reply) {
+    ssize_t received = -1;
+    int priority = threadPriority >= 0 ? threadPriority : defaultPriority;
+    pthread_mutex_lock(&brokerLock[priority]);
+    request->id = __atomic_add_fetch(&nextId, 1, __ATOMIC_RELAXED);
+    request->priority = (uint8_t) priority;
+    request->reserved = 0;
+    if (brokerFd[priority] >= 0 || brokerConnect(priority) == 0) {
+        int fd = brokerFd[priority];
+        if (send(fd, request, BROKER_REQUEST_SIZE(request->count), MSG_NOSIGNAL) >= 0) {
+            do {
+                received = recv(fd, reply, sizeof(*reply), 0);
+            } while ((received < 0 && errno == EINTR) ||
+                     (received >= (ssize_t) sizeof(uint32_t) && reply->id != request->id));
+        }
+        if (received < (ssize_t) BROKER_REPLY_SIZE(0)) {
+            close(fd);
+            brokerFd[priority] = -1;
+            received = -1;
+        }
+    }
+    pthread_mutex_unlock(&brokerLock[priority]);
+    return received;
+}
+
+/**
+ * Runs a single transaction on the broker.
+ *
+ * @return result of the transaction, -1 on failure
+ */
+static int single(int fd, int op, int reg, int data, uint8_t *buffer, int length) {
+    if (fd < 0 || fd >= I2C_FD_MAX || brokerAddress[fd] == 0) {
+        return -1;
+    }
+    brokerOp transaction = {(uint8_t) op, (uint8_t) (brokerAddress[fd] - 1), (uint8_t) reg, (uint8_t) length, data};
+    brokerResult result;
+    if (runI2CBatch(&transaction, 1, &result) < 0) {
+        return -1;
+    }
+    if (buffer != NULL && result.result > 0) {
+        memcpy(buffer, result.block, (size_t) result.result);
+    }
+    return result.result;
+}
+
+static int brokerSetup(int devId) {
+    if (devId < 0 || devId >= BROKER_ADDRESSES) {
+        return -1;
+    }
+    int fd = open("/dev/null", O_RDWR | O_CLOEXEC);
+    if (fd >= I2C_FD_MAX) {
+        close(fd);
+        return -1;
+    }
+    if (fd >= 0) {
+        brokerAddress[fd] = (uint8_t) (devId + 1);
+    }
+    return fd;
+}
+
+static int brokerRead(int fd) {
+    return single(fd, BROKER_READ, 0, 0, NULL, 0);
+}
+
+static int brokerReadReg8(int fd, int reg) {
+    return single(fd, BROKER_READ8, reg, 0, NULL, 0);
+}
+
+static int brokerReadReg16(int fd, int reg) {
+    return single(fd, BROKER_READ16, reg, 0, NULL, 0);
+}
+
+static int brokerWrite(int fd, int data) {
+    return single(fd, BROKER_WRITE, 0, data, NULL, 0);
+}
+
+static int brokerWriteReg8(int fd, int reg, int data) {
+    return single(fd, BROKER_WRITE8, reg, data, NULL, 0);
+}
+
+static int brokerWriteReg16(int fd, int reg, int data) {
+    return single(fd, BROKER_WRITE16, reg, data, NULL, 0);
+}
+
+static int brokerReadBlock(int fd, int reg, uint8_t *buffer, int length) {
+    if (length < 0 || length > I2C_BLOCK_MAX) {
+        return -1;
+    }
+    return single(fd, BROKER_BLOCK, reg, 0, buffer, length);
+}
+
+static const i2cBackend broker = {
+        brokerSetup, brokerRead, brokerReadReg8, brokerReadReg16,
+        brokerWrite, brokerWriteReg8, brokerWriteReg16, brokerReadBlock
+};
+
+/**
+ * Connects to the broker and routes all transactions of the I2C
+ * layer to it. Must not be called while transactions are running.
+ *
+ * @param path socket of the broker, i. e. BROKER_SOCKET
+ * @param priority class of all transactions of threads that did
+ *        not set their own
+ * @return 0 on success, -1 on failure (errno is set)
+ */
+int connectI2CBroker(const char *path, int priority) {
+    if (previous != NULL || priority < 0 || priority >= BROKER_CLASSES || strlen(path) >= sizeof(brokerPath)) {
+        errno = EINVAL;
+        return -1;
+    }
+    snprintf(brokerPath, sizeof(brokerPath), "%s", path);
+    if (brokerConnect(priority) < 0) {
+        return -1;
+    }
+    defaultPriority = priority;
+    memset(brokerAddress, 0, sizeof(brokerAddress));
+    previous = i2cSetBackend(&broker);
+    return 0;
+}
+
+/**
+ * Sets the priority class of the transactions of the calling
+ * thread. They are sent on the connection of the class, so a batch
+ * of another thread of a lower class waiting in the broker does
+ * not hold them up.
+ *
+ * @param priority one of the BROKER_* classes, -1 for the class
+ *        given to connectI2CBroker
+ */
+void setI2CBrokerPriority(int priority) {
+    threadPriority = priority >= 0 && priority < BROKER_CLASSES ? priority : -1;
+}
+
+/**
+ * Runs a batch of transactions without any transaction of another
+ * client in between.
+ *
+ * @param ops transactions to run
+ * @param count number of transactions, at most BROKER_BATCH_MAX
+ * @param results receives the result of every transaction
+ * @return number of transactions run, the batch stops at the first
+ *         failing one, -1 if the broker could not be reached
+ */
+int runI2CBatch(const brokerOp *ops, int count, brokerResult *results) {
+    brokerRequest request;
+    brokerReply reply;
+    if (count <= 0 || count > BROKER_BATCH_MAX) {
+        return -1;
+    }
+    request.count = (uint8_t) count;
+    memcpy(request.ops, ops, (size_t) count * sizeof(brokerOp));
+
+    ssize_t received = exchange(&request, &reply);
+    if (received < 0 || reply.count > count || (size_t) received < BROKER_REPLY_SIZE(reply.count)) {
+        return -1;
+    }
+    for (int i = 0; i < count; i++) {
+        results[i].result = -1;
+        if (i < reply.count) {
+            results[i] = reply.results[i];
+        }
+    }
+    return reply.count;
+}
+
+/**
+ * Fetches the report of the broker: queue wait per class and
+ * client and the bus utilization, in the Prometheus text format.
+ *
+ * @param text receives the report
+ * @param size size of text
+ * @return length of the report, -1 if the broker could not be reached
+ */
+long readI2CBrokerReport(char *text, size_t size) {
+    brokerRequest request;
+    brokerReply reply;
+    request.count = 1;
+    memset(&request.ops[0], 0, sizeof(brokerOp));
+    request.ops[0].op = BROKER_REPORT;
+
+    ssize_t received = exchange(&request, &reply);
+    if (received < 0 || size == 0) {
+        return -1;
+    }
+    size_t length = (size_t) received - offsetof(brokerReply, report);
+    if (length >= size) {
+        length = size - 1;
+    }
+    memcpy(text, reply.report, length);
+    text[length] = '\0';
+    return (long) length;
+}
+
+/**
+ * Closes the connections, the transactions go to the backend used
+ * before connectI2CBroker again.
+ */
+void disconnectI2CBroker(void) {
+    if (previous != NULL) {
+        i2cSetBackend(previous);
+        previous = NULL;
+    }
+    for (int i = 0; i < BROKER_CLASSES; i++) {
+        pthread_mutex_lock(&brokerLock[i]);
+        if (brokerFd[i] >= 0) {
+            close(brokerFd[i]);
+            brokerFd[i] = -1;
+        }
+        pthread_mutex_unlock(&brokerLock[i]);
+    }
+}
@@ -0,0 +1,176 @@
+/**
+ * <Program>
+ * I2CBroker.h
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ * Header file for the I2C broker. The broker (i2cbroker) is the
+ * only process opening the bus, every other process sends it
+ * batches of transactions over a Unix socket. A batch runs on the
+ * bus without anything in between, so processes sharing the box
+ * no longer interleave their transactions.
+ *
+ * Every batch has a priority class. The broker always runs the
+ * oldest batch of the highest class waiting:
+ *
+ *      BROKER_CONTROL   setup, mode changes, commands
+ *      BROKER_REALTIME  sampling
+ *      BROKER_BULK      everything that can wait
+ *
+ * A batch is never interrupted, so a control batch waits at most
+ * for the batch on the bus. A device stays reserved for the client
+ * that used it last for BROKER_HOLD_US: a command handshake of the
+ * unmodified drivers (i. e. writing the SI1145 COMMAND register and
+ * polling RESPONSE) is made of single transactions in quick
+ * succession, other clients wait until it is done. A client using
+ * a device all the time keeps it for at most BROKER_HOLD_MAX_US
+ * while others wait for it, so a bulk client cannot hold back a
+ * control batch for longer.
+ *
+ * The client side replaces the backend of the I2C layer, so the
+ * drivers use the broker without any change. Every transaction is
+ * sent as a batch of its own, runI2CBatch() sends several at once.
+ * A client process opens a connection per priority class it uses,
+ * the broker keeps one waiting batch per connection. Reservations
+ * of devices are per process, its connections do not wait for each
+ * other.
+ *
+ * The messages are SOCK_SEQPACKET datagrams in host byte order,
+ * both ends run on the same box: a brokerRequest with count
+ * operations, answered by a brokerReply with a result for every
+ * operation run, or with the report of the broker for a single
+ * BROKER_REPORT operation.
+ *
+ * <Sources>
+ * Accessed on 18.10.2026 - unix(7):
+ *      https://man7.org/linux/man-pages/man7/unix.7.html
+ */
+
+#ifndef SRC_I2CBROKER_H
+#define SRC_I2CBROKER_H
+
+#include <inttypes.h>
+#include <stddef.h>
+#include "I2CBus.h"
+
+#define BROKER_SOCKET      "/run/cosybox-i2c.sock"
+#define BROKER_BATCH_MAX   16
+#define BROKER_HOLD_US     2000   /* time a device stays reserved for the client that used it last */
+#define BROKER_HOLD_MAX_US 20000  /* a reservation others wait for is not extended beyond this */
+#define BROKER_REPORT_MAX  32768
+#define BROKER_ADDRESSES   128
+
+/* --- Priority classes, a lower class runs first --- */
+#define BROKER_CONTROL  0
+#define BROKER_REALTIME 1
+#define BROKER_BULK     2
+#define BROKER_CLASSES  3
+
+/* --- Operations, like the routines of the I2C layer --- */
+#define BROKER_READ    1
+#define BROKER_READ8   2
+#define BROKER_READ16  3
+#define BROKER_WRITE   4
+#define BROKER_WRITE8  5
+#define BROKER_WRITE16 6
+#define BROKER_BLOCK   7
+#define BROKER_REPORT  8  /* only operation of its batch, the reply carries the report */
+
+/* Used to hold a single transaction of a batch */
+typedef struct {
+    uint8_t op;
+    uint8_t address;
+    uint8_t reg;
+    uint8_t length;   /* bytes of a block read, 0 otherwise */
+    int32_t data;     /* written value, 0 for reads */
+} brokerOp;
+
+/* Used to send a batch to the broker, only count operations are sent */
+typedef struct {
+    uint32_t id;
+    uint8_t priority;
+    uint8_t count;
+    uint16_t reserved;
+    brokerOp ops[BROKER_BATCH_MAX];
+} brokerRequest;
+
+/* Used to hold the result of a transaction, like the return value of the I2C layer */
+typedef struct {
+    int32_t result;
+    uint8_t block[I2C_BLOCK_MAX];
+} brokerResult;
+
+/*
+ * Used to answer a batch. A batch stops at the first failing
+ * transaction, count tells how many were run, only their results
+ * are sent.
+ */
+typedef struct {
+    uint32_t id;
+    uint8_t count;
+    uint8_t reserved[3];
+    uint32_t waitUs;  /* time the batch waited in the queue */
+    uint32_t busUs;   /* time the batch took on the bus */
+    union {
+        brokerResult results[BROKER_BATCH_MAX];
+        char report[BROKER_REPORT_MAX];
+    };
+} brokerReply;
+
+#define BROKER_REQUEST_SIZE(count) (offsetof(brokerRequest, ops) + (size_t) (count) * sizeof(brokerOp))
+#define BROKER_REPLY_SIZE(count) (offsetof(brokerReply, results) + (size_t) (count) * sizeof(brokerResult))
+
+/* METHODS */
+
+/**
+ * Connects to the broker and routes all transactions of the I2C
+ * layer to it. Must not be called while transactions are running.
+ *
+ * @param path socket of the broker, i. e. BROKER_SOCKET
+ * @param priority class of all transactions of threads that did
+ *        not set their own
+ * @return 0 on success, -1 on failure (errno is set)
+ */
+int connectI2CBroker(const char *path, int priority);
+/**
+ * Sets the priority class of the transactions of the calling
+ * thread. They are sent on the connection of the class, so a batch
+ * of another thread of a lower class waiting in the broker does
+ * not hold them up.
+ *
+ * @param priority one of the BROKER_* classes, -1 for the class
+ *        given to connectI2CBroker
+ */
+void setI2CBrokerPriority(int priority);
+/**
+ * Runs a batch of transactions without any transaction of another
+ * client in between.
+ *
+ * @param ops transactions to run
+ * @param count number of transactions, at most BROKER_BATCH_MAX
+ * @param results receives the result of every transaction
+ * @return number of transactions run, the batch stops at the first
+ *         failing one, -1 if the broker could not be reached
+ */
+int runI2CBatch(const brokerOp *ops, int count, brokerResult *results);
+/**
+ * Fetches the report of the broker: queue wait per class and
+ * client and the bus utilization, in the Prometheus text format.
+ *
+ * @param text receives the report
+ * @param size size of text
+ * @return length of the report, -1 if the broker could not be reached
+ */
+long readI2CBrokerReport(char *text, size_t size);
+/**
+ * Closes the connections, the transactions go to the backend used
+ * before connectI2CBroker again.
+ */
+void disconnectI2CBroker(void);
+
+#endif //SRC_I2CBROKER_H
@@ -0,0 +1,726 @@
+/**
+ * <Program>
+ * I2CBrokerDaemon.c
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ *  The I2C broker, the only process using the bus of the box. The
+ * clients connect to a Unix socket and send batches of transactions
+ * (see I2CBroker.h), every client has at most one batch waiting.
+ * A process has a connection per priority class it uses, they count
+ * as one client for the reservation of devices.
+ * One thread waits for the clients with epoll and runs a single
+ * batch between two checks, so a batch of a higher class that
+ * arrives meanwhile is the next one on the bus.
+ *  The transactions are run through the I2C layer, so its
+ * statistics are kept for the broker as a whole. The broker adds
+ * the time every batch waited in the queue, per priority class and
+ * client, and how busy the bus is. The report is answered to
+ * BROKER_REPORT requests and, with -r, written to a file in the
+ * Prometheus text format every BROKER_REPORT_MS.
+ *  Usage: i2cbroker [-s socket] [-r report] [-h hold us]
+ *
+ * <Sources>
+ * Accessed on 18.10.2026 - unix(7), epoll(7):
+ *      https://man7.org/linux/man-pages/man7/unix.7.html
+ *      https://man7.org/linux/man-pages/man7/epoll.7.html
+ * Accessed on 18.10.2026 - Prometheus text exposition format:
+ *      https://prometheus.io/docs/instrumenting/exposition_formats/
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <getopt.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/timerfd.h>
+#include <sys/un.h>
+#include "I2CBroker.h"
+
+#define BROKER_CLIENTS_MAX 32
+#define BROKER_REPORT_MS   10000
+
+static const char *className[BROKER_CLASSES] = {"control", "realtime", "bulk"};
+
+/* Used to hold a connected client and its waiting batch */
+typedef struct {
+    int fd;                 /* -1 if the slot is free */
+    int pid;
+    char name[16];          /* command of the process */
+
+    int pending;            /* 1 while a batch waits */
+    brokerRequest request;
+    int64_t arrivedUs;
+    uint64_t arrival;       /* order of arrival, the oldest batch of a class runs first */
+
+    uint64_t batches;
+    uint64_t transactions;
+    uint64_t failures;
+    uint64_t waitUs;
+    uint64_t waitMaxUs;
+    uint64_t busUs;
+} brokerClient;
+
+/* Used to hold the queue wait of a priority class */
+typedef struct {
+    uint64_t batches;
+    uint64_t waitUs;
+    uint64_t waitMaxUs;
+} brokerClassStats;
+
+/* Used to hold the state of the broker */
+typedef struct {
+    int epollFd;
+    int listenFd;
+    int signalFd;
+    int reportFd;
+    const char *socketPath;
+    const char *reportPath;
+    uint32_t holdUs;
+
+    brokerClient clients[BROKER_CLIENTS_MAX];
+    int deviceFd[BROKER_ADDRESSES];       /* opened lazily, -1 until then */
+    int holder[BROKER_ADDRESSES];         /* client the device is reserved for, -1 if none */
+    int64_t holdUntilUs[BROKER_ADDRESSES];
+    int64_t holdSinceUs[BROKER_ADDRESSES];  /* start of the reservation of the current holder */
+    uint64_t arrivals;
+
+    int64_t startUs;
+    uint64_t busyUs;
+    int64_t intervalStartUs;     /* start of the current report interval */
+    uint64_t intervalBusyUs;
+    double utilization;          /* share of the last report interval the bus was busy */
+    brokerClassStats classes[BROKER_CLASSES];
+} broker;
+
+/**
+ * Returns the current time of the monotonic clock in microseconds.
+ */
+static int64_t monotonicUs(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/**
+ * Closes the connection of a client, the devices it reserved are
+ * released.
+ */
+static void dropClient(broker *server, int slot) {
+    brokerClient *client = &server->clients[slot];
+    epoll_ctl(server->epollFd, EPOLL_CTL_DEL, client->fd, NULL);
+    close(client->fd);
+    client->fd = -1;
+    client->pending = 0;
+    for (int address = 0; address < BROKER_ADDRESSES; address++) {
+        if (server->holder[address] == slot) {
+            server->holder[address] = -1;
+        }
+    }
+}
+
+/**
+ * Changes whether the requests of a client are read. A client with
+ * a waiting batch is not read until it got its reply, a hangup is
+ * noticed anyway.
+ */
+static void listenToClient(broker *server, int slot, int reading) {
+    struct epoll_event event = {(reading ? EPOLLIN : 0) | EPOLLRDHUP, {.fd = server->clients[slot].fd}};
+    epoll_ctl(server->epollFd, EPOLL_CTL_MOD, server->clients[slot].fd, &event);
+}
+
+/**
+ * Accepts all waiting connections. The process of a client is
+ * named in the report.
+ */
+static void acceptClients(broker *server) {
+    int fd;
+    while ((fd = accept4(server->listenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+        int slot = 0;
+        while (slot < BROKER_CLIENTS_MAX && server->clients[slot].fd >= 0) {
+            slot++;
+        }
+        if (slot == BROKER_CLIENTS_MAX) {
+            fprintf(stderr, "too many clients, connection refused\n");
+            close(fd);
+            continue;
+        }
+
+        brokerClient *client = &server->clients[slot];
+        memset(client, 0, sizeof(*client));
+        client->fd = fd;
+        struct ucred credentials;
+        socklen_t length = sizeof(credentials);
+        if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &length) == 0) {
+            client->pid = credentials.pid;
+        }
+        char path[32];
+        snprintf(path, sizeof(path), "/proc/%d/comm", client->pid);
+        FILE *comm = fopen(path, "r");
+        if (comm == NULL || fgets(client->name, sizeof(client->name), comm) == NULL) {
+            strcpy(client->name, "unknown");
+        }
+        if (comm != NULL) {
+            fclose(comm);
+        }
+        client->name[strcspn(client->name, "\n\"\\")] = '\0';
+
+        struct epoll_event event = {EPOLLIN | EPOLLRDHUP, {.fd = fd}};
+        if (epoll_ctl(server->epollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+            close(fd);
+            client->fd = -1;
+        }
+    }
+}
+
+/**
+ * Writes the report: queue wait per class and client and the bus
+ * utilization.
+ */
+static void writeReport(broker *server, FILE *file) {
+    int64_t now = monotonicUs();
+    fprintf(file, "# HELP cosybox_i2c_broker_uptime_seconds Time since the broker started.\n");
+    fprintf(file, "# TYPE cosybox_i2c_broker_uptime_seconds counter\n");
+    fprintf(file, "cosybox_i2c_broker_uptime_seconds %g\n", (now - server->startUs) / 1e6);
+    fprintf(file, "# HELP cosybox_i2c_broker_bus_busy_seconds_total Time the bus ran batches.\n");
+    fprintf(file, "# TYPE cosybox_i2c_broker_bus_busy_seconds_total counter\n");
+    fprintf(file, "cosybox_i2c_broker_bus_busy_seconds_total %g\n", server->busyUs / 1e6);
+    fprintf(file, "# HELP cosybox_i2c_broker_bus_utilization Share of the last report interval the bus was busy.\n");
+    fprintf(file, "# TYPE cosybox_i2c_broker_bus_utilization gauge\n");
+    fprintf(file, "cosybox_i2c_broker_bus_utilization %.4f\n", server->utilization);
+
+    fprintf(file, "# HELP cosybox_i2c_broker_batches_total Batches run per priority class.\n");
+    fprintf(file, "# TYPE cosybox_i2c_broker_batches_total counter\n");
+    fprintf(file, "# HELP cosybox_i2c_broker_queue_wait_seconds_total Time batches waited per priority class.\n");
+    fprintf(file, "# TYPE cosybox_i2c_broker_queue_wait_seconds_total counter\n");
+    fprintf(file, "# HELP cosybox_i2c_broker_queue_wait_max_seconds Longest wait of a batch per priority class.\n");
+    fprintf(file, "# TYPE cosybox_i2c_broker_queue_wait_max_seconds gauge\n");
+    for (int i = 0; i < BROKER_CLASSES; i++) {
+        const brokerClassStats *stats = &server->classes[i];
+        fprintf(file, "cosybox_i2c_broker_batches_total{class=\"%s\"} %" PRIu64 "\n", className[i], stats->batches);
+        fprintf(file, "cosybox_i2c_broker_queue_wait_seconds_total{class=\"%s\"} %g\n", className[i],
+                stats->waitUs / 1e6);
+        fprintf(file, "cosybox_i2c_broker_queue_wait_max_seconds{class=\"%s\"} %g\n", className[i],
+                stats->waitMaxUs / 1e6);
+    }
+
+    fprintf(file, "# HELP cosybox_i2c_broker_client_batches_total Batches run per connected client.\n");
+    fprintf(file, "# TYPE cosybox_i2c_broker_client_batches_total counter\n");
+    fprintf(file, "# HELP cosybox_i2c_broker_client_transactions_total Transactions run per connected client.\n");
+    fprintf(file, "# TYPE cosybox_i2c_broker_client_transactions_total counter\n");
+    fprintf(file, "# HELP cosybox_i2c_broker_client_failures_total Failed transactions per connected client.\n");
+    fprintf(file, "# TYPE cosybox_i2c_broker_client_failures_total counter\n");
+    fprintf(file, "# HELP cosybox_i2c_broker_client_queue_wait_seconds_total Time the batches of a client waited.\n");
+    fprintf(file, "# TYPE cosybox_i2c_broker_client_queue_wait_seconds_total counter\n");
+    fprintf(file, "# HELP cosybox_i2c_broker_client_queue_wait_max_seconds Longest wait of a batch of a client.\n");
+    fprintf(file, "# TYPE cosybox_i2c_broker_client_queue_wait_max_seconds gauge\n");
+    fprintf(file, "# HELP cosybox_i2c_broker_client_bus_seconds_total Time the bus ran batches of a client.\n");
+    fprintf(file, "# TYPE cosybox_i2c_broker_client_bus_seconds_total counter\n");
+    for (int slot = 0; slot < BROKER_CLIENTS_MAX; slot++) {
+        const brokerClient *client = &server->clients[slot];
+        if (client->fd < 0) {
+            continue;
+        }
+        char labels[96];
+        snprintf(labels, sizeof(labels), "pid=\"%d\",name=\"%s\",class=\"%s\"", client->pid, client->name,
+                 className[client->request.priority]);
+        fprintf(file, "cosybox_i2c_broker_client_batches_total{%s} %" PRIu64 "\n", labels, client->batches);
+        fprintf(file, "cosybox_i2c_broker_client_transactions_total{%s} %" PRIu64 "\n", labels,
+                client->transactions);
+        fprintf(file, "cosybox_i2c_broker_client_failures_total{%s} %" PRIu64 "\n", labels, client->failures);
+        fprintf(file, "cosybox_i2c_broker_client_queue_wait_seconds_total{%s} %g\n", labels, client->waitUs / 1e6);
+        fprintf(file, "cosybox_i2c_broker_client_queue_wait_max_seconds{%s} %g\n", labels,
+                client->waitMaxUs / 1e6);
+        fprintf(file, "cosybox_i2c_broker_client_bus_seconds_total{%s} %g\n", labels, client->busUs / 1e6);
+    }
+}
+
+/**
+ * Answers a BROKER_REPORT request right away, it does not need the bus.
+ *
+ * @return 0 on success, -1 if the reply could not be sent
+ */
+static int answerReport(broker *server, brokerClient *client) {
+    static brokerReply reply;
+    reply.id = client->request.id;
+    reply.count = 0;
+    reply.waitUs = reply.busUs = 0;
+
+    FILE *file = fmemopen(reply.report, sizeof(reply.report), "w");
+    if (file == NULL) {
+        return -1;
+    }
+    writeReport(server, file);
+    long length = ftell(file);
+    fclose(file);
+    if (length < 0 || length >= (long) sizeof(reply.report)) {
+        length = (long) sizeof(reply.report) - 1;
+    }
+    return send(client->fd, &reply, offsetof(brokerReply, report) + (size_t) length, MSG_DONTWAIT | MSG_NOSIGNAL)
+           < 0 ? -1 : 0;
+}
+
+/**
+ * Checks a received batch.
+ *
+ * @return 1 if it is valid, 0 otherwise
+ */
+static int validBatch(const brokerRequest *request, ssize_t size) {
+    if (size < (ssize_t) BROKER_REQUEST_SIZE(1) || request->count < 1 || request->count > BROKER_BATCH_MAX ||
+        size != (ssize_t) BROKER_REQUEST_SIZE(request->count) || request->priority >= BROKER_CLASSES) {
+        return 0;
+    }
+    for (int i = 0; i < request->count; i++) {
+        const brokerOp *op = &request->ops[i];
+        if (op->op < BROKER_READ || op->op > BROKER_REPORT || op->address >= BROKER_ADDRESSES ||
+            (op->op == BROKER_BLOCK && (op->length == 0 || op->length > I2C_BLOCK_MAX)) ||
+            (op->op == BROKER_REPORT && request->count != 1)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * Receives the batch of a client. A client sending something that
+ * is not a valid batch is disconnected.
+ */
+static void readClient(broker *server, int slot) {
+    brokerClient *client = &server->clients[slot];
+    ssize_t size = recv(client->fd, &client->request, sizeof(client->request), MSG_DONTWAIT);
+    if (size < 0 && (errno == EAGAIN || errno == EINTR)) {
+        return;
+    }
+    if (size <= 0 || !validBatch(&client->request, size)) {
+        dropClient(server, slot);
+        return;
+    }
+
+    if (client->request.ops[0].op == BROKER_REPORT) {
+        if (answerReport(server, client) < 0) {
+            dropClient(server, slot);
+        }
+        return;
+    }
+    client->pending = 1;
+    client->arrivedUs = monotonicUs();
+    client->arrival = server->arrivals++;
+    listenToClient(server, slot, 0);
+}
+
+/**
+ * Checks whether two clients are connections of the same process,
+ * which share the reservations of their devices.
+ */
+static int sameProcess(const broker *server, int slot, int other) {
+    return slot == other || (other >= 0 && server->clients[slot].pid > 0 &&
+                             server->clients[slot].pid == server->clients[other].pid);
+}
+
+/**
+ * Checks whether all devices of a batch are free for the client.
+ */
+static int devicesFree(const broker *server, int slot, int64_t now) {
+    const brokerRequest *request = &server->clients[slot].request;
+    for (int i = 0; i < request->count; i++) {
+        int address = request->ops[i].address;
+        if (server->holder[address] >= 0 && !sameProcess(server, slot, server->holder[address]) &&
+            server->holdUntilUs[address] > now) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * Checks whether a client other than the holder waits for a device.
+ */
+static int deviceWanted(const broker *server, int address, int holder) {
+    for (int slot = 0; slot < BROKER_CLIENTS_MAX; slot++) {
+        const brokerClient *client = &server->clients[slot];
+        if (sameProcess(server, slot, holder) || client->fd < 0 || !client->pending) {
+            continue;
+        }
+        for (int i = 0; i < client->request.count; i++) {
+            if (client->request.ops[i].address == address) {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * Reserves the devices of a batch for its client. A reservation
+ * others wait for is not extended beyond holdMaxUs, the device goes
+ * to the next batch by priority then.
+ */
+static void holdDevices(broker *server, int slot, const brokerRequest *request, int count, int64_t end) {
+    for (int i = 0; i < count; i++) {
+        int address = request->ops[i].address;
+        if (!sameProcess(server, slot, server->holder[address]) || server->holdUntilUs[address] < end) {
+            server->holdSinceUs[address] = end;
+        }
+        server->holder[address] = slot;
+        if (end - server->holdSinceUs[address] >= BROKER_HOLD_MAX_US && deviceWanted(server, address, slot)) {
+            server->holder[address] = -1;
+        } else {
+            server->holdUntilUs[address] = end + server->holdUs;
+        }
+    }
+}
+
+/**
+ * Picks the oldest batch of the highest class whose devices are
+ * free.
+ *
+ * @param server broker
+ * @param now current monotonic time
+ * @param waitMs receives the time until a reserved device is free
+ *        again if a batch waits for it, -1 otherwise
+ * @return slot of the client, -1 if no batch can run now
+ */
+static int nextBatch(const broker *server, int64_t now, int *waitMs) {
+    int best = -1;
+    int64_t freeUs = -1;
+    for (int slot = 0; slot < BROKER_CLIENTS_MAX; slot++) {
+        const brokerClient *client = &server->clients[slot];
+        if (client->fd < 0 || !client->pending) {
+            continue;
+        }
+        if (!devicesFree(server, slot, now)) {
+            for (int i = 0; i < client->request.count; i++) {
+                int64_t until = server->holdUntilUs[client->request.ops[i].address];
+                if (until > now && (freeUs < 0 || until < freeUs)) {
+                    freeUs = until;
+                }
+            }
+            continue;
+        }
+        const brokerClient *other = best >= 0 ? &server->clients[best] : NULL;
+        if (other == NULL || client->request.priority < other->request.priority ||
+            (client->request.priority == other->request.priority && client->arrival < other->arrival)) {
+            best = slot;
+        }
+    }
+    *waitMs = freeUs < 0 ? -1 : (int) ((freeUs - now + 999) / 1000);
+    return best;
+}
+
+/**
+ * Returns the I2C fd of a device, it is opened on first use.
+ */
+static int deviceFd(broker *server, int address) {
+    if (server->deviceFd[address] < 0) {
+        server->deviceFd[address] = i2cSetup(address);
+    }
+    return server->deviceFd[address];
+}
+
+/**
+ * Runs a single transaction through the I2C layer.
+ *
+ * @return result like the routines of the I2C layer
+ */
+static int runTransaction(broker *server, const brokerOp *op, brokerResult *result) {
+    int fd = deviceFd(server, op->address);
+    if (fd < 0) {
+        return -1;
+    }
+    switch (op->op) {
+        case BROKER_READ:
+            return i2cRead(fd);
+        case BROKER_READ8:
+            return i2cReadReg8(fd, op->reg);
+        case BROKER_READ16:
+            return i2cReadReg16(fd, op->reg);
+        case BROKER_WRITE:
+            return i2cWrite(fd, op->data);
+        case BROKER_WRITE8:
+            return i2cWriteReg8(fd, op->reg, op->data);
+        case BROKER_WRITE16:
+            return i2cWriteReg16(fd, op->reg, op->data);
+        case BROKER_BLOCK:
+            return i2cReadBlock(fd, op->reg, result->block, op->length);
+        default:
+            return -1;
+    }
+}
+
+/**
+ * Runs the batch of a client, reserves its devices and sends the
+ * reply.
+ */
+static void runBatch(broker *server, int slot) {
+    static brokerReply reply;
+    brokerClient *client = &server->clients[slot];
+    const brokerRequest *request = &client->request;
+    int64_t start = monotonicUs();
+
+    int count = 0;
+    while (count < request->count) {
+        brokerResult *result = &reply.results[count];
+        result->result = runTransaction(server, &request->ops[count], result);
+        count++;
+        if (result->result < 0) {
+            client->failures++;
+            break;
+        }
+    }
+    int64_t end = monotonicUs();
+
+    holdDevices(server, slot, request, count, end);
+    uint64_t waitUs = (uint64_t) (start - client->arrivedUs);
+    uint64_t busUs = (uint64_t) (end - start);
+    brokerClassStats *stats = &server->classes[request->priority];
+    stats->batches++;
+    stats->waitUs += waitUs;
+    stats->waitMaxUs = waitUs > stats->waitMaxUs ? waitUs : stats->waitMaxUs;
+    client->batches++;
+    client->transactions += (uint64_t) count;
+    client->waitUs += waitUs;
+    client->waitMaxUs = waitUs > client->waitMaxUs ? waitUs : client->waitMaxUs;
+    client->busUs += busUs;
+    server->busyUs += busUs;
+    server->intervalBusyUs += busUs;
+
+    reply.id = request->id;
+    reply.count = (uint8_t) count;
+    reply.waitUs = (uint32_t) waitUs;
+    reply.busUs = (uint32_t) busUs;
+    client->pending = 0;
+    if (send(client->fd, &reply, BROKER_REPLY_SIZE(count), MSG_DONTWAIT | MSG_NOSIGNAL) < 0) {
+        dropClient(server, slot);
+        return;
+    }
+    listenToClient(server, slot, 1);
+}
+
+/**
+ * Ends a report interval and writes the report file if one is set.
+ * It is replaced atomically, so a scraper never reads half of it.
+ */
+static void reportInterval(broker *server) {
+    uint64_t expirations;
+    if (read(server->reportFd, &expirations, sizeof(expirations)) < 0) {
+        return;
+    }
+    int64_t now = monotonicUs();
+    server->utilization = now > server->intervalStartUs ?
+                          (double) server->intervalBusyUs / (double) (now - server->intervalStartUs) : 0;
+    server->intervalStartUs = now;
+    server->intervalBusyUs = 0;
+    if (server->reportPath == NULL) {
+        return;
+    }
+
+    char temporary[512];
+    snprintf(temporary, sizeof(temporary), "%s.%d.tmp", server->reportPath, (int) getpid());
+    FILE *file = fopen(temporary, "w");
+    if (file == NULL) {
+        return;
+    }
+    writeReport(server, file);
+    if (fclose(file) != 0 || rename(temporary, server->reportPath) < 0) {
+        unlink(temporary);
+    }
+}
+
+/**
+ * Adds a file descriptor to the epoll instance.
+ *
+ * @return 0 on success, -1 on failure
+ */
+static int watch(broker *server, int fd) {
+    struct epoll_event event = {EPOLLIN, {.fd = fd}};
+    return fd < 0 ? -1 : epoll_ctl(server->epollFd, EPOLL_CTL_ADD, fd, &event);
+}
+
+/**
+ * Opens the listening socket. A socket file left by a broker that
+ * is not running any more is replaced.
+ *
+ * @param server broker to initialize
+ * @return 0 on success, -1 on failure (errno is set)
+ */
+static int openBroker(broker *server) {
+    server->epollFd = server->listenFd = server->signalFd = server->reportFd = -1;
+    for (int slot = 0; slot < BROKER_CLIENTS_MAX; slot++) {
+        server->clients[slot].fd = -1;
+    }
+    for (int address = 0; address < BROKER_ADDRESSES; address++) {
+        server->deviceFd[address] = -1;
+        server->holder[address] = -1;
+    }
+    server->startUs = server->intervalStartUs = monotonicUs();
+
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(server->socketPath) >= sizeof(address.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    strcpy(address.sun_path, server->socketPath);
+
+    int probe = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (probe >= 0 && connect(probe, (struct sockaddr *) &address, sizeof(address)) == 0) {
+        close(probe);
+        errno = EADDRINUSE;
+        return -1;
+    }
+    if (probe >= 0) {
+        close(probe);
+    }
+    unlink(server->socketPath);
+
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    sigprocmask(SIG_BLOCK, &signals, NULL);
+
+    struct itimerspec interval = {{BROKER_REPORT_MS / 1000, 0}, {BROKER_REPORT_MS / 1000, 0}};
+    server->epollFd = epoll_create1(EPOLL_CLOEXEC);
+    server->listenFd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    server->signalFd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    server->reportFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (server->epollFd < 0 || server->listenFd < 0 ||
+        bind(server->listenFd, (struct sockaddr *) &address, sizeof(address)) < 0 ||
+        chmod(server->socketPath, 0666) < 0 || listen(server->listenFd, SOMAXCONN) < 0 ||
+        watch(server, server->listenFd) < 0 || watch(server, server->signalFd) < 0 ||
+        watch(server, server->reportFd) < 0 || timerfd_settime(server->reportFd, 0, &interval, NULL) < 0) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Serves the clients until SIGINT or SIGTERM. Between two batches
+ * the clients are checked without waiting, so the next batch is
+ * always picked from everything that arrived.
+ *
+ * @param server opened broker
+ * @return 0 on a clean shutdown, -1 on failure
+ */
+static int runBroker(broker *server) {
+    for (;;) {
+        int waitMs;
+        int slot = nextBatch(server, monotonicUs(), &waitMs);
+
+        struct epoll_event events[BROKER_CLIENTS_MAX + 3];
+        int ready = epoll_wait(server->epollFd, events, BROKER_CLIENTS_MAX + 3, slot >= 0 ? 0 : waitMs);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        for (int i = 0; i < ready; i++) {
+            int fd = events[i].data.fd;
+            if (fd == server->listenFd) {
+                acceptClients(server);
+            } else if (fd == server->signalFd) {
+                return 0;
+            } else if (fd == server->reportFd) {
+                reportInterval(server);
+            } else {
+                for (int client = 0; client < BROKER_CLIENTS_MAX; client++) {
+                    if (server->clients[client].fd != fd) {
+                        continue;
+                    }
+                    if (events[i].events & EPOLLIN) {
+                        readClient(server, client);
+                    } else if (events[i].events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+                        dropClient(server, client);
+                    }
+                    break;
+                }
+            }
+        }
+
+        slot = nextBatch(server, monotonicUs(), &waitMs);
+        if (slot >= 0) {
+            runBatch(server, slot);
+        }
+    }
+}
+
+/**
+ * Disconnects all clients, closes the devices and removes the socket.
+ *
+ * @param server opened broker
+ */
+static void closeBroker(broker *server) {
+    for (int slot = 0; slot < BROKER_CLIENTS_MAX; slot++) {
+        if (server->clients[slot].fd >= 0) {
+            dropClient(server, slot);
+        }
+    }
+    for (int address = 0; address < BROKER_ADDRESSES; address++) {
+        if (server->deviceFd[address] >= 0) {
+            close(server->deviceFd[address]);
+        }
+    }
+    int fds[] = {server->epollFd, server->listenFd, server->signalFd, server->reportFd};
+    for (size_t i = 0; i < sizeof(fds) / sizeof(fds[0]); i++) {
+        if (fds[i] >= 0) {
+            close(fds[i]);
+        }
+    }
+    if (server->listenFd >= 0) {
+        unlink(server->socketPath);
+    }
+
+    printf("bus busy %.3f s, batches control %" PRIu64 ", realtime %" PRIu64 ", bulk %" PRIu64 "\n",
+           server->busyUs / 1e6, server->classes[BROKER_CONTROL].batches, server->classes[BROKER_REALTIME].batches,
+           server->classes[BROKER_BULK].batches);
+}
+
+int main(int argc, char **argv) {
+    static broker server;
+    server.socketPath = BROKER_SOCKET;
+    server.holdUs = BROKER_HOLD_US;
+    int option;
+
+    while ((option = getopt(argc, argv, "s:r:h:")) != -1) {
+        switch (option) {
+            case 's':
+                server.socketPath = optarg;
+                break;
+            case 'r':
+                server.reportPath = optarg;
+                break;
+            case 'h':
+                server.holdUs = (uint32_t) atoi(optarg);
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-s socket] [-r report] [-h hold us]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    if (openBroker(&server) < 0) {
+        perror("i2cbroker");
+        closeBroker(&server);
+        return 1;
+    }
+    printf("brokering the I2C bus on %s\n", server.socketPath);
+    fflush(stdout);
+
+    int result = runBroker(&server);
+    closeBroker(&server);
+    return result < 0 ? 1 : 0;
+}
@@ -0,0 +1,1031 @@
+/**
+ * <Program>
+ * I2CBus.c
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ *  I2C access layer used by the drivers of the COSY-Lab-IoT-Box.
+ * Every call goes through to the simplified routines of wiringPi
+ * (or the SMBus ioctl of the kernel for block reads) and is timed
+ * and counted per device and register, so it is visible how much
+ * of a sample round is spent on the bus. On top of that the
+ * i2cTry* routines retry failed transactions within a time budget
+ * and keep a circuit breaker per device, so a dead sensor fails
+ * fast instead of stalling every round.
+ *  The transactions themselves are run by a backend, the hardware
+ * unless a trace is recorded or replayed or the bus is shared
+ * through the I2C broker.
+ *  Additionally this class holds the methods to read the
+ * statistics from Python software using the CPython library.
+ *
+ * <Sources>
+ * Accessed on 18.10.2026 - Linux kernel SMBus protocol summary:
+ *      https://www.kernel.org/doc/html/latest/i2c/smbus-protocol.html
+ * Accessed on 18.10.2026 - wiringPiI2C.c
+ *      https://github.com/WiringPi/WiringPi/blob/master/wiringPi/wiringPiI2C.c
+ * Accessed on 18.10.2026 - Prometheus text exposition format:
+ *      https://prometheus.io/docs/instrumenting/exposition_formats/
+ * Accesses on 11.01.2018 - Extending Python with C
+ *      https://docs.python.org/2/extending/extending.html
+ */
+
+#ifndef SENSOR_NO_PYTHON
+#include <Python.h>
+#endif
+#include <pthread.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+#include "I2CBus.h"
+#include "I2CTrace.h"
+#include "I2CBroker.h"
+
+/* Kind of a transaction, used for the register counters */
+#define I2C_READ  0
+#define I2C_WRITE 1
+
+static i2cDeviceStats devices[I2C_DEVICES_MAX];
+static int deviceCount = 0;
+/* Position in devices + 1 for every fd, 0 if unknown */
+static uint8_t deviceByFd[I2C_FD_MAX];
+static pthread_mutex_t deviceLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t breakerLock = PTHREAD_MUTEX_INITIALIZER;
+
+static i2cRetryPolicy retryPolicy = {
+        I2C_RETRY_BUDGET_US, I2C_RETRY_BACKOFF_US, I2C_BREAKER_THRESHOLD, I2C_BREAKER_PROBE_MS
+};
+
+/* Transactions that can be retried */
+#define I2C_OP_READ8   0
+#define I2C_OP_READ16  1
+#define I2C_OP_WRITE8  2
+#define I2C_OP_BLOCK   3
+#define I2C_OP_WRITE   4
+#define I2C_OP_WRITE16 5
+
+/**
+ * Reads a block of registers with the SMBus ioctl of the kernel,
+ * wiringPi has no routine for it.
+ *
+ * @return number of bytes read, -1 on failure
+ */
+static int hardwareReadBlock(int fd, int reg, uint8_t *buffer, int length) {
+    union i2c_smbus_data data;
+    struct i2c_smbus_ioctl_data args;
+
+    /* For I2C block reads the first byte holds the requested length */
+    data.block[0] = (uint8_t) length;
+    args.read_write = I2C_SMBUS_READ;
+    args.command = (uint8_t) reg;
+    args.size = I2C_SMBUS_I2C_BLOCK_DATA;
+    args.data = &data;
+
+    if (ioctl(fd, I2C_SMBUS, &args) < 0) {
+        return -1;
+    }
+    memcpy(buffer, &data.block[1], (size_t) data.block[0]);
+    return data.block[0];
+}
+
+#ifdef SENSOR_NO_HARDWARE
+/* Built without wiringPi (i. e. to replay traces on a PC), there is no bus to talk to */
+static int noBus1(int value) {
+    return -1;
+}
+
+static int noBus2(int fd, int value) {
+    return -1;
+}
+
+static int noBus3(int fd, int reg, int data) {
+    return -1;
+}
+
+static const i2cBackend hardware = {noBus1, noBus1, noBus2, noBus2, noBus2, noBus3, noBus3, hardwareReadBlock};
+#else
+static const i2cBackend hardware = {
+        wiringPiI2CSetup, wiringPiI2CRead, wiringPiI2CReadReg8, wiringPiI2CReadReg16,
+        wiringPiI2CWrite, wiringPiI2CWriteReg8, wiringPiI2CWriteReg16, hardwareReadBlock
+};
+#endif
+static const i2cBackend *backend = &hardware;
+
+/**
+ * Returns the current time of the monotonic clock in microseconds.
+ */
+static uint64_t monotonicUs(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/* The hardware runs in real time, the device does not matter */
+static uint64_t realNowUs(int fd) {
+    return monotonicUs();
+}
+
+static void realSleepUs(uint32_t us) {
+    usleep(us);
+}
+
+static const i2cClock realClock = {realNowUs, realSleepUs};
+static const i2cClock *busClock = &realClock;
+
+/**
+ * Returns the statistics slot of a device, registering it if it
+ * is not known yet. Devices only known by their fd get the
+ * address -1.
+ *
+ * @param fd file descriptor of the device
+ * @param address I2C address or -1
+ * @return statistics slot or NULL if all slots are used
+ */
+static i2cDeviceStats *deviceSlot(int fd, int address) {
+    if (fd < 0 || fd >= I2C_FD_MAX) {
+        return NULL;
+    }
+    int slot = __atomic_load_n(&deviceByFd[fd], __ATOMIC_ACQUIRE);
+    if (slot > 0 && (address < 0 || devices[slot - 1].address == address)) {
+        return &devices[slot - 1];
+    }
+
+    pthread_mutex_lock(&deviceLock);
+    i2cDeviceStats *stats = NULL;
+    /* A reused fd or a device opened twice keeps its old slot */
+    for (int i = 0; i < deviceCount; i++) {
+        if ((address >= 0 && devices[i].address == address) || (address < 0 && devices[i].fd == fd)) {
+            stats = &devices[i];
+            break;
+        }
+    }
+    if (stats == NULL && deviceCount < I2C_DEVICES_MAX) {
+        stats = &devices[deviceCount++];
+        stats->address = address;
+    }
+    if (stats != NULL) {
+        stats->fd = fd;
+        __atomic_store_n(&deviceByFd[fd], (uint8_t) (stats - devices + 1), __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&deviceLock);
+    return stats;
+}
+
+/**
+ * Maps a time to its histogram bucket. The first 8 buckets are 1us
+ * wide, after that every power of two is split into
+ * I2C_HISTOGRAM_SUB buckets. Used for the schedule histograms as
+ * well (see ScheduleStats.h).
+ *
+ * @param us time in microseconds
+ * @return bucket index
+ */
+int i2cHistogramBucket(uint64_t us) {
+    if (us < I2C_HISTOGRAM_SUB) {
+        return (int) us;
+    }
+    int shift = 63 - __builtin_clzll(us) - I2C_HISTOGRAM_SUB_BITS;
+    int bucket = (shift + 1) * I2C_HISTOGRAM_SUB + (int) ((us >> shift) - I2C_HISTOGRAM_SUB);
+    return bucket < I2C_HISTOGRAM_BUCKETS ? bucket : I2C_HISTOGRAM_BUCKETS - 1;
+}
+
+/**
+ * Returns the first time not included in a bucket anymore.
+ *
+ * @param bucket bucket index
+ * @return exclusive upper bound in microseconds
+ */
+uint64_t i2cHistogramUpperBound(int bucket) {
+    if (bucket < I2C_HISTOGRAM_SUB) {
+        return (uint64_t) bucket + 1;
+    }
+    int shift = bucket / I2C_HISTOGRAM_SUB - 1;
+    return ((uint64_t) (I2C_HISTOGRAM_SUB + bucket % I2C_HISTOGRAM_SUB) + 1) << shift;
+}
+
+/**
+ * Records a finished transaction.
+ *
+ * @param fd file descriptor of the device
+ * @param reg register or I2C_NO_REGISTER
+ * @param kind I2C_READ or I2C_WRITE
+ * @param result return value of the transaction, negative on failure
+ * @param bytes number of transferred data bytes
+ * @param start start time in microseconds
+ */
+static void record(int fd, int reg, int kind, int result, int bytes, uint64_t start) {
+    uint64_t elapsed = monotonicUs() - start;
+    i2cDeviceStats *stats = deviceSlot(fd, -1);
+    if (stats == NULL) {
+        return;
+    }
+    i2cRegisterStats *registerStats = &stats->registers[reg & 0xFF];
+    if (reg == I2C_NO_REGISTER) {
+        registerStats = &stats->registers[I2C_NO_REGISTER];
+    }
+
+    __atomic_fetch_add(&stats->transactions, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&stats->totalUs, elapsed, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&stats->histogram[i2cHistogramBucket(elapsed)], 1, __ATOMIC_RELAXED);
+    uint64_t max = __atomic_load_n(&stats->maxUs, __ATOMIC_RELAXED);
+    while (elapsed > max && !__atomic_compare_exchange_n(&stats->maxUs, &max, elapsed, 1, __ATOMIC_RELAXED,
+                                                         __ATOMIC_RELAXED)) {
+    }
+    __atomic_fetch_add(kind == I2C_READ ? &registerStats->reads : &registerStats->writes, 1, __ATOMIC_RELAXED);
+    if (result < 0) {
+        __atomic_fetch_add(&stats->errors, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&registerStats->errors, 1, __ATOMIC_RELAXED);
+    } else {
+        __atomic_fetch_add(&stats->bytes, (uint64_t) bytes, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * Opens the I2C device like wiringPiI2CSetup and registers the
+ * address for the statistics.
+ *
+ * @param devId I2C address of the device
+ * @return file descriptor, -1 on failure
+ */
+int i2cSetup(const int devId) {
+    int fd = backend->setup(devId);
+    if (fd >= 0) {
+        deviceSlot(fd, devId);
+    }
+    return fd;
+}
+
+/**
+ * Reads a byte without register address (wiringPiI2CRead).
+ *
+ * @param fd file descriptor returned by i2cSetup
+ * @return read byte, -1 on failure
+ */
+int i2cRead(int fd) {
+    uint64_t start = monotonicUs();
+    int result = backend->read(fd);
+    record(fd, I2C_NO_REGISTER, I2C_READ, result, 1, start);
+    return result;
+}
+
+/**
+ * Reads an 8 bit register (wiringPiI2CReadReg8).
+ *
+ * @param fd file descriptor returned by i2cSetup
+ * @param reg register
+ * @return register value, -1 on failure
+ */
+int i2cReadReg8(int fd, int reg) {
+    uint64_t start = monotonicUs();
+    int result = backend->readReg8(fd, reg);
+    record(fd, reg, I2C_READ, result, 1, start);
+    return result;
+}
+
+/**
+ * Reads a 16 bit register, LSB first (wiringPiI2CReadReg16).
+ *
+ * @param fd file descriptor returned by i2cSetup
+ * @param reg register
+ * @return register value, -1 on failure
+ */
+int i2cReadReg16(int fd, int reg) {
+    uint64_t start = monotonicUs();
+    int result = backend->readReg16(fd, reg);
+    record(fd, reg, I2C_READ, result, 2, start);
+    return result;
+}
+
+/**
+ * Writes a byte without register address (wiringPiI2CWrite).
+ *
+ * @param fd file descriptor returned by i2cSetup
+ * @param data byte to write
+ * @return 0 on success, -1 on failure
+ */
+int i2cWrite(int fd, int data) {
+    uint64_t start = monotonicUs();
+    int result = backend->write(fd, data);
+    record(fd, I2C_NO_REGISTER, I2C_WRITE, result, 1, start);
+    return result;
+}
+
+/**
+ * Writes an 8 bit register (wiringPiI2CWriteReg8).
+ *
+ * @param fd file descriptor returned by i2cSetup
+ * @param reg register
+ * @param data value to write
+ * @return 0 on success, -1 on failure
+ */
+int i2cWriteReg8(int fd, int reg, int data) {
+    uint64_t start = monotonicUs();
+    int result = backend->writeReg8(fd, reg, data);
+    record(fd, reg, I2C_WRITE, result, 1, start);
+    return result;
+}
+
+/**
+ * Writes a 16 bit register, LSB first (wiringPiI2CWriteReg16).
+ *
+ * @param fd file descriptor returned by i2cSetup
+ * @param reg register
+ * @param data value to write
+ * @return 0 on success, -1 on failure
+ */
+int i2cWriteReg16(int fd, int reg, int data) {
+    uint64_t start = monotonicUs();
+    int result = backend->writeReg16(fd, reg, data);
+    record(fd, reg, I2C_WRITE, result, 2, start);
+    return result;
+}
+
+/**
+ * Reads consecutive registers starting at reg in a single
+ * combined transaction (write register, repeated start, read
+ * length bytes). The device has to auto-increment the register
+ * address, which all sensors of the box do.
+ *
+ * @param fd file descriptor returned by i2cSetup
+ * @param reg first register
+ * @param buffer receives the register values
+ * @param length number of registers, at most I2C_BLOCK_MAX
+ * @return number of bytes read, -1 on failure
+ */
+int i2cReadBlock(int fd, int reg, uint8_t *buffer, int length) {
+    if (length <= 0 || length > I2C_BLOCK_MAX) {
+        return -1;
+    }
+
+    uint64_t start = monotonicUs();
+    int result = backend->readBlock(fd, reg, buffer, length);
+    record(fd, reg, I2C_READ, result, result < 0 ? 0 : result, start);
+    return result < 0 ? -1 : result;
+}
+
+/**
+ * Runs a single try of a transaction.
+ *
+ * @return value read or 0 for writes, negative on failure
+ */
+static int attempt(int fd, int op, int reg, int data, uint8_t *buffer, int length) {
+    switch (op) {
+        case I2C_OP_READ8:
+            return i2cReadReg8(fd, reg);
+        case I2C_OP_READ16:
+            return i2cReadReg16(fd, reg);
+        case I2C_OP_WRITE8:
+            return i2cWriteReg8(fd, reg, data);
+        case I2C_OP_WRITE:
+            return i2cWrite(fd, data);
+        case I2C_OP_WRITE16:
+            return i2cWriteReg16(fd, reg, data);
+        default:
+            return i2cReadBlock(fd, reg, buffer, length) == length ? 0 : -1;
+    }
+}
+
+/**
+ * Checks the circuit breaker before a transaction. An open
+ * breaker rejects the transaction until the probe interval has
+ * passed, then exactly one caller gets through as probe.
+ *
+ * @param stats device of the transaction
+ * @param now current time in microseconds
+ * @param probe set to 1 if the transaction is the probe
+ * @return 1 if the transaction may run, 0 if it is rejected
+ */
+static int admit(i2cDeviceStats *stats, uint64_t now, int *probe) {
+    int allowed = 1;
+    *probe = 0;
+    pthread_mutex_lock(&breakerLock);
+    if (stats->breaker == I2C_BREAKER_TRIPPED &&
+        now - stats->openedUs >= (uint64_t) retryPolicy.probeMs * 1000) {
+        stats->breaker = I2C_BREAKER_HALF_OPEN;
+        *probe = 1;
+    } else if (stats->breaker != I2C_BREAKER_CLOSED) {
+        stats->rejected++;
+        allowed = 0;
+    }
+    pthread_mutex_unlock(&breakerLock);
+    return allowed;
+}
+
+/**
+ * Updates the circuit breaker after a transaction. A success
+ * closes it, a failed probe or too many consecutive failures
+ * open it.
+ *
+ * @param stats device of the transaction
+ * @param success 1 if the transaction succeeded
+ * @param probe 1 if the transaction was the probe
+ */
+static void settle(i2cDeviceStats *stats, int success, int probe) {
+    pthread_mutex_lock(&breakerLock);
+    if (success) {
+        stats->consecutiveFailures = 0;
+        stats->breaker = I2C_BREAKER_CLOSED;
+    } else {
+        stats->consecutiveFailures++;
+        if (probe || stats->consecutiveFailures >= retryPolicy.threshold) {
+            if (stats->breaker != I2C_BREAKER_HALF_OPEN) {
+                stats->trips++;
+            }
+            stats->breaker = I2C_BREAKER_TRIPPED;
+            stats->openedUs = busClock->nowUs(-1);
+        }
+    }
+    pthread_mutex_unlock(&breakerLock);
+}
+
+/**
+ * Runs a transaction with retries. Between the tries the pause
+ * is doubled, no new try is started if it would end after the
+ * retry budget. A probe of an open breaker is not retried, neither
+ * is a transaction asked to run once.
+ *
+ * @return value read or 0 for writes, I2C_ERROR or I2C_BREAKER_OPEN
+ */
+static int guarded(int fd, int op, int reg, int data, uint8_t *buffer, int length, int retry) {
+    i2cDeviceStats *stats = deviceSlot(fd, -1);
+    uint64_t start = busClock->nowUs(fd);
+    int probe = 0;
+
+    if (stats != NULL && !admit(stats, start, &probe)) {
+        return I2C_BREAKER_OPEN;
+    }
+
+    uint64_t deadline = start + retryPolicy.budgetUs;
+    uint32_t backoff = retryPolicy.backoffUs;
+    for (;;) {
+        int result = attempt(fd, op, reg, data, buffer, length);
+        if (result >= 0) {
+            if (stats != NULL) {
+                settle(stats, 1, probe);
+            }
+            return result;
+        }
+        if (probe || !retry || busClock->nowUs(-1) + backoff > deadline) {
+            break;
+        }
+        busClock->sleepUs(backoff);
+        backoff *= 2;
+        if (stats != NULL) {
+            __atomic_fetch_add(&stats->retries, 1, __ATOMIC_RELAXED);
+        }
+    }
+
+    if (stats != NULL) {
+        settle(stats, 0, probe);
+    }
+    return I2C_ERROR;
+}
+
+/**
+ * Reads an 8 bit register with retries and circuit breaker.
+ *
+ * @param fd file descriptor returned by i2cSetup
+ * @param reg register
+ * @param value receives the register value
+ * @return I2C_OK, I2C_ERROR or I2C_BREAKER_OPEN
+ */
+int i2cTryReadReg8(int fd, int reg, uint8_t *value) {
+    int result = guarded(fd, I2C_OP_READ8, reg, 0, NULL, 0, 1);
+    if (result < 0) {
+        return result;
+    }
+    *value = (uint8_t) result;
+    return I2C_OK;
+}
+
+/**
+ * Reads a 16 bit register (LSB first) with retries and circuit
+ * breaker.
+ *
+ * @param fd file descriptor returned by i2cSetup
+ * @param reg register
+ * @param value receives the register value
+ * @return I2C_OK, I2C_ERROR or I2C_BREAKER_OPEN
+ */
+int i2cTryReadReg16(int fd, int reg, uint16_t *value) {
+    int result = guarded(fd, I2C_OP_READ16, reg, 0, NULL, 0, 1);
+    if (result < 0) {
+        return result;
+    }
+    *value = (uint16_t) result;
+    return I2C_OK;
+}
+
+/**
+ * Writes an 8 bit register with retries and circuit breaker.
+ *
+ * @param fd file descriptor returned by i2cSetup
+ * @param reg register
+ * @param data value to write
+ * @return I2C_OK, I2C_ERROR or I2C_BREAKER_OPEN
+ */
+int i2cTryWriteReg8(int fd, int reg, int data) {
+    int result = guarded(fd, I2C_OP_WRITE8, reg, data, NULL, 0, 1);
+    return result < 0 ? result : I2C_OK;
+}
+
+/**
+ * Writes an 8 bit register once, guarded by the circuit breaker
+ * but without retries, for writes that must not be repeated (i. e.
+ * a command that would run twice). A failure counts towards
+ * opening the breaker like the ones of the other i2cTry* routines.
+ *
+ * @param fd file descriptor returned by i2cSetup
+ * @param reg register
+ * @param data value to write
+ * @return I2C_OK, I2C_ERROR or I2C_BREAKER_OPEN
+ */
+int i2cTryWriteReg8Once(int fd, int reg, int data) {
+    int result = guarded(fd, I2C_OP_WRITE8, reg, data, NULL, 0, 0);
+    return result < 0 ? result : I2C_OK;
+}
+
+/**
+ * Writes a 16 bit register with retries and circuit breaker.
+ *
+ * @param fd file descriptor returned by i2cSetup
+ * @param reg register
+ * @param data value to write, sent LSB first
+ * @return I2C_OK, I2C_ERROR or I2C_BREAKER_OPEN
+ */
+int i2cTryWriteReg16(int fd, int reg, int data) {
+    int result = guarded(fd, I2C_OP_WRITE16, reg, data, NULL, 0, 1);
+    return result < 0 ? result : I2C_OK;
+}
+
+/**
+ * Writes a byte without register address with retries and circuit
+ * breaker.
+ *
+ * @param fd file descriptor returned by i2cSetup
+ * @param data byte to write
+ * @return I2C_OK, I2C_ERROR or I2C_BREAKER_OPEN
+ */
+int i2cTryWrite(int fd, int data) {
+    int result = guarded(fd, I2C_OP_WRITE, I2C_NO_REGISTER, data, NULL, 0, 1);
+    return result < 0 ? result : I2C_OK;
+}
+
+/**
+ * Reads a block of registers with retries and circuit breaker.
+ * Reading less than length bytes counts as failure.
+ *
+ * @param fd file descriptor returned by i2cSetup
+ * @param reg first register
+ * @param buffer receives the register values
+ * @param length number of registers, at most I2C_BLOCK_MAX
+ * @return I2C_OK, I2C_ERROR or I2C_BREAKER_OPEN
+ */
+int i2cTryReadBlock(int fd, int reg, uint8_t *buffer, int length) {
+    int result = guarded(fd, I2C_OP_BLOCK, reg, 0, buffer, length, 1);
+    return result < 0 ? result : I2C_OK;
+}
+
+/**
+ * Replaces the retry and circuit breaker settings.
+ *
+ * @param policy new settings
+ */
+void i2cSetRetryPolicy(const i2cRetryPolicy *policy) {
+    pthread_mutex_lock(&breakerLock);
+    retryPolicy = *policy;
+    if (retryPolicy.threshold == 0) {
+        retryPolicy.threshold = 1;
+    }
+    pthread_mutex_unlock(&breakerLock);
+}
+
+/**
+ * Replaces the backend all transactions go through. Must not be
+ * called while transactions are running.
+ *
+ * @param replacement new backend, NULL for the hardware
+ * @return previous backend
+ */
+const i2cBackend *i2cSetBackend(const i2cBackend *replacement) {
+    const i2cBackend *previous = backend;
+    backend = replacement != NULL ? replacement : &hardware;
+    return previous;
+}
+
+/**
+ * Replaces the clock of the retries and circuit breakers. Must not
+ * be called while transactions are running.
+ *
+ * @param replacement new clock, NULL for the monotonic clock
+ * @return previous clock
+ */
+const i2cClock *i2cSetClock(const i2cClock *replacement) {
+    const i2cClock *previous = busClock;
+    busClock = replacement != NULL ? replacement : &realClock;
+    return previous;
+}
+
+/**
+ * Closes the circuit breakers of all devices and forgets their
+ * failures, i. e. before a replay starts over.
+ */
+void i2cCloseBreakers(void) {
+    pthread_mutex_lock(&deviceLock);
+    pthread_mutex_lock(&breakerLock);
+    for (int i = 0; i < deviceCount; i++) {
+        devices[i].breaker = I2C_BREAKER_CLOSED;
+        devices[i].consecutiveFailures = 0;
+        devices[i].openedUs = 0;
+    }
+    pthread_mutex_unlock(&breakerLock);
+    pthread_mutex_unlock(&deviceLock);
+}
+
+/**
+ * Returns the statistics of the n-th known device.
+ *
+ * @param index position of the device, starting at 0
+ * @return statistics or NULL if there are no more devices
+ */
+const i2cDeviceStats *i2cDeviceStatistics(int index) {
+    if (index < 0 || index >= __atomic_load_n(&deviceCount, __ATOMIC_ACQUIRE)) {
+        return NULL;
+    }
+    return &devices[index];
+}
+
+/**
+ * Estimates a percentile from a histogram with the buckets of
+ * i2cHistogramBucket.
+ *
+ * @param histogram I2C_HISTOGRAM_BUCKETS counts
+ * @param percentile value between 0 and 100
+ * @return upper bound of the bucket holding the percentile in us
+ */
+uint64_t i2cHistogramPercentile(const uint64_t *histogram, double percentile) {
+    uint64_t total = 0, seen = 0;
+    for (int i = 0; i < I2C_HISTOGRAM_BUCKETS; i++) {
+        total += histogram[i];
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    uint64_t wanted = (uint64_t) (total * percentile / 100.0 + 0.5);
+    if (wanted == 0) {
+        wanted = 1;
+    }
+    for (int i = 0; i < I2C_HISTOGRAM_BUCKETS; i++) {
+        seen += histogram[i];
+        if (seen >= wanted) {
+            return i2cHistogramUpperBound(i);
+        }
+    }
+    return i2cHistogramUpperBound(I2C_HISTOGRAM_BUCKETS - 1);
+}
+
+/**
+ * Estimates a latency percentile of a device from its histogram.
+ *
+ * @param stats statistics of the device
+ * @param percentile value between 0 and 100
+ * @return upper bound of the bucket holding the percentile in us,
+ *         at most the longest transaction (maxUs)
+ */
+uint64_t i2cLatencyPercentile(const i2cDeviceStats *stats, double percentile) {
+    uint64_t bound = i2cHistogramPercentile(stats->histogram, percentile);
+    uint64_t max = __atomic_load_n(&stats->maxUs, __ATOMIC_RELAXED);
+    return bound < max ? bound : max;
+}
+
+/**
+ * Writes the metrics of a single device.
+ *
+ * @param file target file
+ * @param stats statistics of the device
+ */
+static void writeDevice(FILE *file, const i2cDeviceStats *stats) {
+    char device[16];
+    if (stats->address >= 0) {
+        snprintf(device, sizeof(device), "0x%02x", stats->address);
+    } else {
+        snprintf(device, sizeof(device), "fd%d", stats->fd);
+    }
+
+    for (int reg = 0; reg < I2C_REGISTERS; reg++) {
+        const i2cRegisterStats *registerStats = &stats->registers[reg];
+        char name[8];
+        if (registerStats->reads == 0 && registerStats->writes == 0) {
+            continue;
+        }
+        if (reg == I2C_NO_REGISTER) {
+            strcpy(name, "none");
+        } else {
+            snprintf(name, sizeof(name), "0x%02x", reg);
+        }
+        fprintf(file, "cosybox_i2c_transactions_total{device=\"%s\",register=\"%s\",op=\"read\"} %" PRIu32 "\n",
+                device, name, registerStats->reads);
+        fprintf(file, "cosybox_i2c_transactions_total{device=\"%s\",register=\"%s\",op=\"write\"} %" PRIu32 "\n",
+                device, name, registerStats->writes);
+        fprintf(file, "cosybox_i2c_errors_total{device=\"%s\",register=\"%s\"} %" PRIu32 "\n",
+                device, name, registerStats->errors);
+    }
+    fprintf(file, "cosybox_i2c_bytes_total{device=\"%s\"} %" PRIu64 "\n", device, stats->bytes);
+    fprintf(file, "cosybox_i2c_retries_total{device=\"%s\"} %" PRIu64 "\n", device, stats->retries);
+    fprintf(file, "cosybox_i2c_breaker_trips_total{device=\"%s\"} %" PRIu64 "\n", device, stats->trips);
+    fprintf(file, "cosybox_i2c_breaker_rejected_total{device=\"%s\"} %" PRIu64 "\n", device, stats->rejected);
+    fprintf(file, "cosybox_i2c_breaker_open{device=\"%s\"} %d\n", device,
+            stats->breaker != I2C_BREAKER_CLOSED);
+
+    /*
+     * Bucket bounds are the powers of two, which are exact bucket boundaries as well.
+     * The last bucket has no upper bound, it only shows in +Inf.
+     */
+    uint64_t cumulative = 0;
+    int bucket = 0;
+    for (uint64_t bound = 1; bound < i2cHistogramUpperBound(I2C_HISTOGRAM_BUCKETS - 2); bound <<= 1) {
+        while (bucket < I2C_HISTOGRAM_BUCKETS && i2cHistogramUpperBound(bucket) <= bound) {
+            cumulative += stats->histogram[bucket++];
+        }
+        fprintf(file, "cosybox_i2c_latency_seconds_bucket{device=\"%s\",le=\"%g\"} %" PRIu64 "\n",
+                device, bound / 1e6, cumulative);
+    }
+    fprintf(file, "cosybox_i2c_latency_seconds_bucket{device=\"%s\",le=\"+Inf\"} %" PRIu64 "\n",
+            device, stats->transactions);
+    fprintf(file, "cosybox_i2c_latency_seconds_sum{device=\"%s\"} %g\n", device, stats->totalUs / 1e6);
+    fprintf(file, "cosybox_i2c_latency_seconds_count{device=\"%s\"} %" PRIu64 "\n", device, stats->transactions);
+}
+
+/**
+ * Writes the statistics in the Prometheus text format. The file
+ * is replaced atomically, so a scraper never reads half of it.
+ *
+ * @param path target file (i. e. for the node exporter textfile collector)
+ * @return 0 on success, -1 on failure
+ */
+int writeI2CStatistics(const char *path) {
+    char temporary[512];
+    snprintf(temporary, sizeof(temporary), "%s.%d.tmp", path, (int) getpid());
+    FILE *file = fopen(temporary, "w");
+    if (file == NULL) {
+        return -1;
+    }
+
+    fprintf(file, "# HELP cosybox_i2c_transactions_total I2C transactions per device, register and direction.\n");
+    fprintf(file, "# TYPE cosybox_i2c_transactions_total counter\n");
+    fprintf(file, "# HELP cosybox_i2c_errors_total Failed I2C transactions per device and register.\n");
+    fprintf(file, "# TYPE cosybox_i2c_errors_total counter\n");
+    fprintf(file, "# HELP cosybox_i2c_bytes_total Transferred I2C data bytes per device.\n");
+    fprintf(file, "# TYPE cosybox_i2c_bytes_total counter\n");
+    fprintf(file, "# HELP cosybox_i2c_retries_total Retried I2C transactions per device.\n");
+    fprintf(file, "# TYPE cosybox_i2c_retries_total counter\n");
+    fprintf(file, "# HELP cosybox_i2c_breaker_trips_total Times the circuit breaker of a device opened.\n");
+    fprintf(file, "# TYPE cosybox_i2c_breaker_trips_total counter\n");
+    fprintf(file, "# HELP cosybox_i2c_breaker_rejected_total Transactions rejected by an open circuit breaker.\n");
+    fprintf(file, "# TYPE cosybox_i2c_breaker_rejected_total counter\n");
+    fprintf(file, "# HELP cosybox_i2c_breaker_open Whether the circuit breaker of a device is open.\n");
+    fprintf(file, "# TYPE cosybox_i2c_breaker_open gauge\n");
+    fprintf(file, "# HELP cosybox_i2c_latency_seconds Duration of I2C transactions per device.\n");
+    fprintf(file, "# TYPE cosybox_i2c_latency_seconds histogram\n");
+    const i2cDeviceStats *stats;
+    for (int i = 0; (stats = i2cDeviceStatistics(i)) != NULL; i++) {
+        writeDevice(file, stats);
+    }
+
+    if (fclose(file) != 0 || rename(temporary, path) < 0) {
+        unlink(temporary);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Resets all counters and histograms, known devices stay known.
+ */
+void resetI2CStatistics(void) {
+    pthread_mutex_lock(&deviceLock);
+    for (int i = 0; i < deviceCount; i++) {
+        size_t keep = offsetof(i2cDeviceStats, transactions);
+        memset((char *) &devices[i] + keep, 0, sizeof(i2cDeviceStats) - keep);
+    }
+    pthread_mutex_unlock(&deviceLock);
+}
+
+#ifndef SENSOR_NO_PYTHON
+/**
+ * Get the statistics of all known devices.
+ *
+ * @param self python instance the method is called on
+ * @param args passed arguments from calling python method
+ * @return dictionary of device address to a dictionary with the
+ *         counters, circuit breaker state, latency percentiles (us,
+ *         bucket bounds up to the exact max_us) and per register
+ *         tuples (reads, writes, errors)
+ */
+static PyObject *i2c_stats(PyObject *self, PyObject *args) {
+    PyObject *result = PyDict_New();
+    const i2cDeviceStats *stats;
+    if (result == NULL) {
+        return NULL;
+    }
+
+    for (int i = 0; (stats = i2cDeviceStatistics(i)) != NULL; i++) {
+        PyObject *registers = PyDict_New();
+        for (int reg = 0; registers != NULL && reg < I2C_REGISTERS; reg++) {
+            const i2cRegisterStats *registerStats = &stats->registers[reg];
+            if (registerStats->reads == 0 && registerStats->writes == 0) {
+                continue;
+            }
+            PyObject *key = reg == I2C_NO_REGISTER ? (Py_INCREF(Py_None), Py_None) : PyInt_FromLong(reg);
+            PyObject *value = Py_BuildValue("(III)", registerStats->reads, registerStats->writes,
+                                            registerStats->errors);
+            if (key == NULL || value == NULL || PyDict_SetItem(registers, key, value) < 0) {
+                Py_CLEAR(registers);
+            }
+            Py_XDECREF(key);
+            Py_XDECREF(value);
+        }
+
+        PyObject *device = registers == NULL ? NULL : Py_BuildValue(
+                "{s:K,s:K,s:K,s:K,s:K,s:K,s:i,s:K,s:K,s:K,s:K,s:N}",
+                "transactions", (unsigned PY_LONG_LONG) stats->transactions,
+                "errors", (unsigned PY_LONG_LONG) stats->errors,
+                "retries", (unsigned PY_LONG_LONG) stats->retries,
+                "trips", (unsigned PY_LONG_LONG) stats->trips,
+                "rejected", (unsigned PY_LONG_LONG) stats->rejected,
+                "breaker_open", stats->breaker != I2C_BREAKER_CLOSED,
+                "bytes", (unsigned PY_LONG_LONG) stats->bytes,
+                "time_us", (unsigned PY_LONG_LONG) stats->totalUs,
+                "p50_us", (unsigned PY_LONG_LONG) i2cLatencyPercentile(stats, 50),
+                "p99_us", (unsigned PY_LONG_LONG) i2cLatencyPercentile(stats, 99),
+                "max_us", (unsigned PY_LONG_LONG) __atomic_load_n(&stats->maxUs, __ATOMIC_RELAXED),
+                "registers", registers);
+        PyObject *key = stats->address >= 0 ? PyInt_FromLong(stats->address) : PyString_FromFormat("fd%d", stats->fd);
+        if (device == NULL || key == NULL || PyDict_SetItem(result, key, device) < 0) {
+            Py_XDECREF(device);
+            Py_XDECREF(key);
+            Py_DECREF(result);
+            return NULL;
+        }
+        Py_DECREF(device);
+        Py_DECREF(key);
+    }
+    return result;
+}
+
+/**
+ * Write the statistics in the Prometheus text format.
+ *
+ * @param self python instance the method is called on
+ * @param args target file
+ * @return 0 on success, -1 on failure
+ */
+static PyObject *dump_i2c_stats(PyObject *self, PyObject *args) {
+    const char *path;
+    if (!PyArg_ParseTuple(args, "s", &path)) {
+        return NULL;
+    }
+
+    return Py_BuildValue("i", writeI2CStatistics(path));
+}
+
+/**
+ * Reset all counters and histograms.
+ *
+ * @param self python instance the method is called on
+ * @param args passed arguments from calling python method
+ * @return None
+ */
+static PyObject *reset_i2c_stats(PyObject *self, PyObject *args) {
+    resetI2CStatistics();
+    Py_RETURN_NONE;
+}
+
+/**
+ * Change the retry budget and circuit breaker settings.
+ *
+ * @param self python instance the method is called on
+ * @param args retry budget (us), first backoff (us), failures
+ *             opening the breaker and probe interval (ms)
+ * @return None
+ */
+static PyObject *set_i2c_retry(PyObject *self, PyObject *args) {
+    i2cRetryPolicy policy;
+    if (!PyArg_ParseTuple(args, "IIII", &policy.budgetUs, &policy.backoffUs, &policy.threshold, &policy.probeMs)) {
+        return NULL;
+    }
+
+    i2cSetRetryPolicy(&policy);
+    Py_RETURN_NONE;
+}
+
+/**
+ * Start recording all I2C transactions to a trace file, before
+ * the sensors are read for the first time.
+ *
+ * @param self python instance the method is called on
+ * @param args trace file
+ * @return 0 on success, -1 on failure
+ */
+static PyObject *start_i2c_trace(PyObject *self, PyObject *args) {
+    const char *path;
+    if (!PyArg_ParseTuple(args, "s", &path)) {
+        return NULL;
+    }
+
+    return Py_BuildValue("i", i2cStartTrace(path));
+}
+
+/**
+ * Stop recording and close the trace file.
+ *
+ * @param self python instance the method is called on
+ * @param args passed arguments from calling python method
+ * @return number of recorded transactions, -1 on failure
+ */
+static PyObject *stop_i2c_trace(PyObject *self, PyObject *args) {
+    return Py_BuildValue("l", i2cStopTrace());
+}
+
+/**
+ * Send all I2C transactions of this process to the I2C broker
+ * instead of opening the bus, before the sensors are read for the
+ * first time.
+ *
+ * @param self python instance the method is called on
+ * @param args optional socket of the broker and priority class of
+ *             the transactions (BROKER_CONTROL, BROKER_REALTIME or
+ *             BROKER_BULK)
+ * @return 0 on success, -1 on failure
+ */
+static PyObject *use_i2c_broker(PyObject *self, PyObject *args) {
+    const char *path = BROKER_SOCKET;
+    int priority = BROKER_REALTIME;
+    if (!PyArg_ParseTuple(args, "|si", &path, &priority)) {
+        return NULL;
+    }
+
+    return Py_BuildValue("i", connectI2CBroker(path, priority));
+}
+
+/**
+ * Get the report of the I2C broker: queue wait per priority class
+ * and client and the bus utilization.
+ *
+ * @param self python instance the method is called on
+ * @param args passed arguments from calling python method
+ * @return report in the Prometheus text format, None if the
+ *         broker could not be reached
+ */
+static PyObject *i2c_broker_report(PyObject *self, PyObject *args) {
+    static char report[BROKER_REPORT_MAX];
+    long length;
+    Py_BEGIN_ALLOW_THREADS
+    length = readI2CBrokerReport(report, sizeof(report));
+    Py_END_ALLOW_THREADS
+    if (length < 0) {
+        Py_RETURN_NONE;
+    }
+    return PyString_FromStringAndSize(report, length);
+}
+
+/**
+ * Method definitions that are visible in Python afterwards
+ */
+static PyMethodDef i2cBus_methods[] = {
+        {"i2c_stats",         i2c_stats,         METH_VARARGS},
+        {"dump_i2c_stats",    dump_i2c_stats,    METH_VARARGS},
+        {"reset_i2c_stats",   reset_i2c_stats,   METH_VARARGS},
+        {"set_i2c_retry",     set_i2c_retry,     METH_VARARGS},
+        {"start_i2c_trace",   start_i2c_trace,   METH_VARARGS},
+        {"stop_i2c_trace",    stop_i2c_trace,    METH_VARARGS},
+        {"use_i2c_broker",    use_i2c_broker,    METH_VARARGS},
+        {"i2c_broker_report", i2c_broker_report, METH_VARARGS},
+        {NULL, NULL, 0, NULL} /* Sentinel */
+};
+
+/**
+ * Initializes the module and methods that can be called
+ * from python.
+ */
+void initi2cBus(void) {
+    PyImport_AddModule("i2cBus");
+    PyObject *module = Py_InitModule("i2cBus", i2cBus_methods);
+    if (module == NULL) {
+        return;
+    }
+    PyModule_AddIntConstant(module, "BROKER_CONTROL", BROKER_CONTROL);
+    PyModule_AddIntConstant(module, "BROKER_REALTIME", BROKER_REALTIME);
+    PyModule_AddIntConstant(module, "BROKER_BULK", BROKER_BULK);
+}
+#endif
@@ -0,0 +1,366 @@
+/**
+ * <Program>
+ * I2CBus.h
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ * Header file for the I2C access layer used by all drivers. It
+ * wraps the simplified routines of wiringPi, adds block reads
+ * and keeps statistics of every transaction: counters per device
+ * and register, errors and a latency histogram per device.
+ *
+ * The histogram is log-linear like an HDR histogram: values below
+ * 8us get one bucket each, above that every power of two is split
+ * into 8 buckets, so every bucket is at most 12.5% wide. Recording
+ * a transaction is a few relaxed atomic adds and two reads of the
+ * monotonic clock, negligible compared to ~100us per transfer at
+ * 100 kHz, so the statistics can stay enabled.
+ *
+ * The i2cTry* routines report failures explicitly instead of
+ * returning -1 as data. A failed transaction is retried until the
+ * retry budget is used up. After repeated failures the circuit
+ * breaker of the device opens and all transactions fail at once,
+ * only every probe interval a single transaction is let through
+ * to find out whether the device is back.
+ *
+ * All transactions go through a backend, by default the hardware.
+ * It can be replaced to record or replay a trace (see I2CTrace.h)
+ * without touching the drivers. The retries and circuit breakers
+ * take their time from a clock, by default the monotonic clock; a
+ * replay replaces it by the time of the recording, so it neither
+ * sleeps nor decides differently when it runs faster.
+ *
+ * <Sources>
+ * Accessed on 18.10.2026 - Linux kernel SMBus protocol summary:
+ *      https://www.kernel.org/doc/html/latest/i2c/smbus-protocol.html
+ * Accessed on 18.10.2026 - Prometheus text exposition format:
+ *      https://prometheus.io/docs/instrumenting/exposition_formats/
+ */
+
+#ifndef SRC_I2CBUS_H
+#define SRC_I2CBUS_H
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include "wiringPiI2C.h"
+
+/* Maximum length of a single block transfer (SMBus limit) */
+#define I2C_BLOCK_MAX 32
+
+/* --- Statistics --- */
+#define I2C_DEVICES_MAX        8
+#define I2C_FD_MAX             256
+#define I2C_NO_REGISTER        256  /* plain read/write without register */
+#define I2C_REGISTERS          257
+#define I2C_HISTOGRAM_SUB_BITS 3
+#define I2C_HISTOGRAM_SUB      (1 << I2C_HISTOGRAM_SUB_BITS)
+#define I2C_HISTOGRAM_BUCKETS  (22 * I2C_HISTOGRAM_SUB) /* exact below 15 * 2^20us (15.7s), the last one holds all above */
+
+/* --- Error handling --- */
+#define I2C_OK            0
+#define I2C_ERROR        -1  /* failed, retry budget used up */
+#define I2C_BREAKER_OPEN -2  /* not tried, the device failed too often */
+
+#define I2C_BREAKER_CLOSED    0
+#define I2C_BREAKER_TRIPPED   1
+#define I2C_BREAKER_HALF_OPEN 2
+
+#define I2C_RETRY_BUDGET_US   5000   /* time a transaction may be retried */
+#define I2C_RETRY_BACKOFF_US  250    /* first pause between tries, doubled every time */
+#define I2C_BREAKER_THRESHOLD 5      /* consecutive failures opening the breaker */
+#define I2C_BREAKER_PROBE_MS  10000  /* time until an open breaker lets a probe through */
+
+/* Used to configure retries and circuit breakers of all devices */
+typedef struct {
+    uint32_t budgetUs;
+    uint32_t backoffUs;
+    uint32_t threshold;
+    uint32_t probeMs;
+} i2cRetryPolicy;
+
+/*
+ * Used to route the transactions to the hardware or a replacement.
+ * All routines behave like their wiringPi counterparts, readBlock
+ * like i2cReadBlock.
+ */
+typedef struct {
+    int (*setup)(int devId);
+    int (*read)(int fd);
+    int (*readReg8)(int fd, int reg);
+    int (*readReg16)(int fd, int reg);
+    int (*write)(int fd, int data);
+    int (*writeReg8)(int fd, int reg, int data);
+    int (*writeReg16)(int fd, int reg, int data);
+    int (*readBlock)(int fd, int reg, uint8_t *buffer, int length);
+} i2cBackend;
+
+/* Used to replace the clock of the retries and circuit breakers */
+typedef struct {
+    /*
+     * Returns the time in us. With the fd of a device it is the time
+     * a transaction of the device starts now, with -1 the time after
+     * the last one.
+     */
+    uint64_t (*nowUs)(int fd);
+    /* Pauses before the next try */
+    void (*sleepUs)(uint32_t us);
+} i2cClock;
+
+/* Used to count the transactions of a single register */
+typedef struct {
+    uint32_t reads;
+    uint32_t writes;
+    uint32_t errors;
+} i2cRegisterStats;
+
+/* Used to hold the statistics of a single device */
+typedef struct {
+    int address;           /* I2C address, -1 if only the fd is known */
+    int fd;
+
+    /* Circuit breaker */
+    int breaker;
+    uint32_t consecutiveFailures;
+    uint64_t openedUs;
+
+    uint64_t transactions;
+    uint64_t errors;
+    uint64_t bytes;
+    uint64_t totalUs;
+    uint64_t maxUs;        /* longest transaction */
+    uint64_t retries;
+    uint64_t trips;
+    uint64_t rejected;
+    uint64_t histogram[I2C_HISTOGRAM_BUCKETS];
+    i2cRegisterStats registers[I2C_REGISTERS];
+} i2cDeviceStats;
+
+/* METHODS */
+
+/**
+ * Opens the I2C device like wiringPiI2CSetup and registers the
+ * address for the statistics.
+ *
+ * @param devId I2C address of the device
+ * @return file descriptor, -1 on failure
+ */
+int i2cSetup(const int devId);
+/**
+ * Reads a byte without register address (wiringPiI2CRead).
+ *
+ * @param fd file descriptor returned by i2cSetup
+ * @return read byte, -1 on failure
+ */
+int i2cRead(int fd);
+/**
+ * Reads an 8 bit register (wiringPiI2CReadReg8).
+ *
+ * @param fd file descriptor returned by i2cSetup
+ * @param reg register
+ * @return register value, -1 on failure
+ */
+int i2cReadReg8(int fd, int reg);
+/**
+ * Reads a 16 bit register, LSB first (wiringPiI2CReadReg16).
+ *
+ * @param fd file descriptor returned by i2cSetup
+ * @param reg register
+ * @return register value, -1 on failure
+ */
+int i2cReadReg16(int fd, int reg);
+/**
+ * Writes a byte without register address (wiringPiI2CWrite).
+ *
+ * @param fd file descriptor returned by i2cSetup
+ * @param data byte to write
+ * @return 0 on success, -1 on failure
+ */
+int i2cWrite(int fd, int data);
+/**
+ * Writes an 8 bit register (wiringPiI2CWriteReg8).
+ *
+ * @param fd file descriptor returned by i2cSetup
+ * @param reg register
+ * @param data value to write
+ * @return 0 on success, -1 on failure
+ */
+int i2cWriteReg8(int fd, int reg, int data);
+/**
+ * Writes a 16 bit register, LSB first (wiringPiI2CWriteReg16).
+ *
+ * @param fd file descriptor returned by i2cSetup
+ * @param reg register
+ * @param data value to write
+ * @return 0 on success, -1 on failure
+ */
+int i2cWriteReg16(int fd, int reg, int data);
+/**
+ * Reads consecutive registers starting at reg in a single
+ * combined transaction (write register, repeated start, read
+ * length bytes). The device has to auto-increment the register
+ * address, which all sensors of the box do.
+ *
+ * @param fd file descriptor returned by i2cSetup
+ * @param reg first register
+ * @param buffer receives the register values
+ * @param length number of registers, at most I2C_BLOCK_MAX
+ * @return number of bytes read, -1 on failure
+ */
+int i2cReadBlock(int fd, int reg, uint8_t *buffer, int length);
+/**
+ * Reads an 8 bit register with retries and circuit breaker.
+ *
+ * @param fd file descriptor returned by i2cSetup
+ * @param reg register
+ * @param value receives the register value
+ * @return I2C_OK, I2C_ERROR or I2C_BREAKER_OPEN
+ */
+int i2cTryReadReg8(int fd, int reg, uint8_t *value);
+/**
+ * Reads a 16 bit register (LSB first) with retries and circuit
+ * breaker.
+ *
+ * @param fd file descriptor returned by i2cSetup
+ * @param reg register
+ * @param value receives the register value
+ * @return I2C_OK, I2C_ERROR or I2C_BREAKER_OPEN
+ */
+int i2cTryReadReg16(int fd, int reg, uint16_t *value);
+/**
+ * Writes an 8 bit register with retries and circuit breaker.
+ *
+ * @param fd file descriptor returned by i2cSetup
+ * @param reg register
+ * @param data value to write
+ * @return I2C_OK, I2C_ERROR or I2C_BREAKER_OPEN
+ */
+int i2cTryWriteReg8(int fd, int reg, int data);
+/**
+ * Writes an 8 bit register once, guarded by the circuit breaker
+ * but without retries, for writes that must not be repeated (i. e.
+ * a command that would run twice). A failure counts towards
+ * opening the breaker like the ones of the other i2cTry* routines.
+ *
+ * @param fd file descriptor returned by i2cSetup
+ * @param reg register
+ * @param data value to write
+ * @return I2C_OK, I2C_ERROR or I2C_BREAKER_OPEN
+ */
+int i2cTryWriteReg8Once(int fd, int reg, int data);
+/**
+ * Writes a 16 bit register with retries and circuit breaker.
+ *
+ * @param fd file descriptor returned by i2cSetup
+ * @param reg register
+ * @param data value to write, sent LSB first
+ * @return I2C_OK, I2C_ERROR or I2C_BREAKER_OPEN
+ */
+int i2cTryWriteReg16(int fd, int reg, int data);
+/**
+ * Writes a byte without register address with retries and circuit
+ * breaker (i. e. to start a command that has no data).
+ *
+ * @param fd file descriptor returned by i2cSetup
+ * @param data byte to write
+ * @return I2C_OK, I2C_ERROR or I2C_BREAKER_OPEN
+ */
+int i2cTryWrite(int fd, int data);
+/**
+ * Reads a block of registers with retries and circuit breaker.
+ * Reading less than length bytes counts as failure.
+ *
+ * @param fd file descriptor returned by i2cSetup
+ * @param reg first register
+ * @param buffer receives the register values
+ * @param length number of registers, at most I2C_BLOCK_MAX
+ * @return I2C_OK, I2C_ERROR or I2C_BREAKER_OPEN
+ */
+int i2cTryReadBlock(int fd, int reg, uint8_t *buffer, int length);
+/**
+ * Replaces the retry and circuit breaker settings.
+ *
+ * @param policy new settings
+ */
+void i2cSetRetryPolicy(const i2cRetryPolicy *policy);
+/**
+ * Replaces the backend all transactions go through. Must not be
+ * called while transactions are running.
+ *
+ * @param replacement new backend, NULL for the hardware
+ * @return previous backend
+ */
+const i2cBackend *i2cSetBackend(const i2cBackend *replacement);
+/**
+ * Replaces the clock of the retries and circuit breakers. Must not
+ * be called while transactions are running.
+ *
+ * @param replacement new clock, NULL for the monotonic clock
+ * @return previous clock
+ */
+const i2cClock *i2cSetClock(const i2cClock *replacement);
+/**
+ * Closes the circuit breakers of all devices and forgets their
+ * failures, i. e. before a replay starts over.
+ */
+void i2cCloseBreakers(void);
+/**
+ * Returns the statistics of the n-th known device.
+ *
+ * @param index position of the device, starting at 0
+ * @return statistics or NULL if there are no more devices
+ */
+const i2cDeviceStats *i2cDeviceStatistics(int index);
+/**
+ * Maps a time to its histogram bucket. The first 8 buckets are 1us
+ * wide, after that every power of two is split into
+ * I2C_HISTOGRAM_SUB buckets. Used for the schedule histograms as
+ * well (see ScheduleStats.h).
+ *
+ * @param us time in microseconds
+ * @return bucket index
+ */
+int i2cHistogramBucket(uint64_t us);
+/**
+ * Returns the first time not included in a bucket anymore.
+ *
+ * @param bucket bucket index
+ * @return exclusive upper bound in microseconds
+ */
+uint64_t i2cHistogramUpperBound(int bucket);
+/**
+ * Estimates a percentile from a histogram with the buckets of
+ * i2cHistogramBucket.
+ *
+ * @param histogram I2C_HISTOGRAM_BUCKETS counts
+ * @param percentile value between 0 and 100
+ * @return upper bound of the bucket holding the percentile in us
+ */
+uint64_t i2cHistogramPercentile(const uint64_t *histogram, double percentile);
+/**
+ * Estimates a latency percentile of a device from its histogram.
+ *
+ * @param stats statistics of the device
+ * @param percentile value between 0 and 100
+ * @return upper bound of the bucket holding the percentile in us,
+ *         at most the longest transaction (maxUs)
+ */
+uint64_t i2cLatencyPercentile(const i2cDeviceStats *stats, double percentile);
+/**
+ * Writes the statistics in the Prometheus text format. The file
+ * is replaced atomically, so a scraper never reads half of it.
+ *
+ * @param path target file (i. e. for the node exporter textfile collector)
+ * @return 0 on success, -1 on failure
+ */
+int writeI2CStatistics(const char *path);
+/**
+ * Resets all counters and histograms, known devices stay known.
+ */
+void resetI2CStatistics(void);
+
+#endif //SRC_I2CBUS_H
@@ -0,0 +1,211 @@
+/**
+ * <Program>
+ * I2CReplay.c
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ *  Replays an I2C trace recorded on a box (i2cBus.start_i2c_trace)
+ * through the unmodified sensor loop and drivers, without hardware
+ * and without waiting for conversions. The trace has to be recorded
+ * while the sensor loop (cosybox.snapshot or sensorLoop.read_round)
+ * reads the sensors, from the first round on.
+ *  Every round is written as one line of raw fixed point values,
+ * so the output of two builds can be compared bit by bit. With -c
+ * the output is compared against a file written with -o before,
+ * any difference or divergence from the trace fails the run. The
+ * trace is replayed the given number of times to measure how fast
+ * the drivers and the compensation code are, a divergence in any
+ * of the runs fails it as well. Retries and circuit breakers run on
+ * the time of the recording (see I2CTrace.h), so every run replays
+ * the same calls and nothing waits.
+ *  Usage: i2creplay [-n repetitions] [-o output] [-c expected] trace
+ *
+ * <Sources>
+ * Accessed on 18.10.2026 - getopt(3):
+ *      https://man7.org/linux/man-pages/man3/getopt.3.html
+ */
+
+#define _GNU_SOURCE
+#include <getopt.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "I2CTrace.h"
+#include "SensorLoop.h"
+
+#define REPLAY_LINE_MAX 256
+
+/**
+ * Returns the current time of the monotonic clock in microseconds.
+ */
+static int64_t monotonicUs(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/**
+ * Formats the raw values and states of a round, everything the
+ * compensation code and the loop decided: the raw value of every
+ * channel, the status and error of the last result of the CCS811
+ * and the status of every sensor.
+ */
+static void formatRound(char *line, size_t size, long index, const sensorLoop *loop, const sensorRound *round) {
+    int length = snprintf(line, size, "%ld", index);
+    for (int i = 0; i < loop->channels && length < (int) size; i++) {
+        length += snprintf(line + length, size - length, ";%" PRId64, round->raw[i]);
+    }
+    if (length < (int) size) {
+        length += snprintf(line + length, size - length, ";%u;%u", loop->lastAir.status, loop->lastAir.errorId);
+    }
+    for (int i = 0; i < loop->sensors && length < (int) size; i++) {
+        length += snprintf(line + length, size - length, ";%d", round->status[i]);
+    }
+    if (length < (int) size) {
+        snprintf(line + length, size - length, "\n");
+    }
+}
+
+/**
+ * Replays the whole trace once.
+ *
+ * @param output receives the rounds, NULL to drop them
+ * @param expected rounds to compare against, NULL for no comparison
+ * @param mismatches incremented for every round that differs
+ * @return number of rounds, -1 if the loop could not be opened
+ */
+static long replayOnce(FILE *output, FILE *expected, long *mismatches) {
+    sensorLoop loop;
+    sensorRound round;
+    i2cReplayStats stats;
+    long rounds = 0;
+
+    i2cRewindReplay();
+    if (openSensorLoop(&loop) < 0) {
+        return -1;
+    }
+    loop.noWait = 1;
+
+    while (!i2cReplayFinished()) {
+        i2cReplayStatistics(&stats);
+        uint32_t before = stats.replayed;
+        if (runSensorRound(&loop, &round, LOOP_ROUND_TIMEOUT_MS) < 0) {
+            break;
+        }
+        i2cReplayStatistics(&stats);
+        if (stats.replayed == before) {
+            /* Nothing of the trace fits the calls of the loop anymore */
+            break;
+        }
+
+        if (output != NULL || expected != NULL) {
+            char line[REPLAY_LINE_MAX], wanted[REPLAY_LINE_MAX] = "";
+            formatRound(line, sizeof(line), rounds, &loop, &round);
+            if (output != NULL) {
+                fputs(line, output);
+            }
+            if (expected != NULL && (fgets(wanted, sizeof(wanted), expected) == NULL || strcmp(line, wanted) != 0)) {
+                if ((*mismatches)++ == 0) {
+                    fprintf(stderr, "round %ld differs\n  expected %s  replayed %s", rounds, wanted, line);
+                }
+            }
+        }
+        rounds++;
+    }
+    closeSensorLoop(&loop);
+    return rounds;
+}
+
+int main(int argc, char **argv) {
+    const char *outputPath = NULL, *expectedPath = NULL;
+    int repetitions = 1;
+    int option;
+
+    while ((option = getopt(argc, argv, "n:o:c:")) != -1) {
+        switch (option) {
+            case 'n':
+                repetitions = atoi(optarg);
+                break;
+            case 'o':
+                outputPath = optarg;
+                break;
+            case 'c':
+                expectedPath = optarg;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-n repetitions] [-o output] [-c expected] trace\n", argv[0]);
+                return 1;
+        }
+    }
+    if (optind != argc - 1 || repetitions < 1) {
+        fprintf(stderr, "usage: %s [-n repetitions] [-o output] [-c expected] trace\n", argv[0]);
+        return 1;
+    }
+
+    long records = i2cLoadReplay(argv[optind]);
+    if (records < 0) {
+        fprintf(stderr, "%s is not a valid trace\n", argv[optind]);
+        return 1;
+    }
+    FILE *output = outputPath != NULL ? fopen(outputPath, "w") : NULL;
+    FILE *expected = expectedPath != NULL ? fopen(expectedPath, "r") : NULL;
+    if ((outputPath != NULL && output == NULL) || (expectedPath != NULL && expected == NULL)) {
+        perror("fopen");
+        return 1;
+    }
+
+    /* The first run checks the output, the others only measure */
+    long mismatches = 0, rounds = 0;
+    uint64_t replayed = 0, divergences = 0;
+    i2cReplayStats stats;
+    char firstDivergence[sizeof(stats.firstDivergence)] = "";
+    int divergingRun = 0;
+    int64_t start = monotonicUs();
+    for (int i = 0; i < repetitions; i++) {
+        long result = replayOnce(i == 0 ? output : NULL, i == 0 ? expected : NULL, &mismatches);
+        if (result < 0) {
+            perror("sensor loop");
+            return 1;
+        }
+        rounds += result;
+        i2cReplayStatistics(&stats);
+        replayed += stats.replayed;
+        if (stats.divergences > 0 && divergences == 0) {
+            memcpy(firstDivergence, stats.firstDivergence, sizeof(firstDivergence));
+            divergingRun = i + 1;
+        }
+        divergences += stats.divergences;
+    }
+    double seconds = (monotonicUs() - start) / 1e6;
+
+    char rest[REPLAY_LINE_MAX];
+    if (expected != NULL && fgets(rest, sizeof(rest), expected) != NULL) {
+        fprintf(stderr, "expected output has more rounds than the replay\n");
+        mismatches++;
+    }
+    if (output != NULL) {
+        fclose(output);
+    }
+    if (expected != NULL) {
+        fclose(expected);
+    }
+
+    printf("replayed %" PRIu64 " of %ld transactions in %ld rounds (%d runs) in %.3f s\n",
+           replayed, records * repetitions, rounds, repetitions, seconds);
+    printf("%.0f transactions/s, %.0f rounds/s, %.0fx faster than recorded\n", replayed / seconds,
+           rounds / seconds, stats.recordedUs * repetitions / 1e6 / seconds);
+    if (divergences > 0) {
+        printf("%" PRIu64 " calls diverged from the trace, first in run %d: %s\n", divergences, divergingRun,
+               firstDivergence);
+    }
+    if (mismatches > 0) {
+        printf("%ld rounds differ from the expected output\n", mismatches);
+    }
+    i2cCloseReplay();
+    return divergences > 0 || mismatches > 0 || replayed < (uint64_t) records * repetitions;
+}
@@ -0,0 +1,626 @@
+/**
+ * <Program>
+ * I2CTrace.c
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ *  Recording and replaying of I2C traces. Both are backends of the
+ * I2C layer: the recorder wraps the backend that was active when
+ * it was started and writes every call to the trace file, the
+ * replay answers every call from a trace loaded into memory. The
+ * drivers do not notice either of them.
+ *  The replay brings its own clock for the retries and circuit
+ * breakers of the I2C layer: it stands at the end of the last
+ * transaction replayed, a pause moves it on without sleeping, and
+ * a device asking for the time to start a transaction gets the
+ * start of its next recorded one. So the replay decides when to
+ * retry, give up or let a probe through like the box did, however
+ * fast it runs.
+ *  Records are written through a large stdio buffer, so recording
+ * adds no system call to a transaction most of the time.
+ *
+ * <Sources>
+ * Accessed on 18.10.2026 - wiringPiI2C.c
+ *      https://github.com/WiringPi/WiringPi/blob/master/wiringPi/wiringPiI2C.c
+ */
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "I2CTrace.h"
+
+#define TRACE_BUFFER_SIZE (64 * 1024)
+/* Address of an fd that was not opened by i2cSetup, ignored by the replay */
+#define TRACE_NO_ADDRESS  0xFF
+
+static pthread_mutex_t traceLock = PTHREAD_MUTEX_INITIALIZER;
+
+/* --- Recording --- */
+static FILE *traceFile = NULL;
+static const i2cBackend *recorded = NULL;   /* backend wrapped by the recorder */
+static uint8_t traceAddress[I2C_FD_MAX];    /* address + 1 for every fd, 0 if unknown */
+static uint64_t lastStartUs;
+static long traceRecords;
+static int traceFailed;
+
+/* --- Replay --- */
+static i2cTraceRecord *replayRecords = NULL;
+static uint32_t *replayIndex[I2C_TRACE_ADDRESSES]; /* positions of the records of every address */
+static uint32_t replayLength[I2C_TRACE_ADDRESSES];
+static uint32_t replayCursor[I2C_TRACE_ADDRESSES];
+static uint8_t replayAddress[I2C_FD_MAX];          /* address + 1 for every fd, 0 if unknown */
+static i2cReplayStats replayStats;
+static const i2cBackend *replaced = NULL;          /* backend active before the replay */
+static const i2cClock *replacedClock = NULL;       /* clock active before the replay */
+static uint64_t replayNowUs;                       /* time of the recording the replay is at */
+
+/**
+ * Returns the current time of the monotonic clock in microseconds.
+ */
+static uint64_t monotonicUs(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static void putU32(uint8_t *buffer, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        buffer[i] = (uint8_t) (value >> (8 * i));
+    }
+}
+
+static uint32_t getU32(const uint8_t *buffer) {
+    return (uint32_t) buffer[0] | (uint32_t) buffer[1] << 8 | (uint32_t) buffer[2] << 16 |
+           (uint32_t) buffer[3] << 24;
+}
+
+/**
+ * Returns the address of a device while recording. Devices opened
+ * before the recording started are looked up in the statistics.
+ */
+static uint8_t addressOf(int fd) {
+    if (fd < 0 || fd >= I2C_FD_MAX) {
+        return TRACE_NO_ADDRESS;
+    }
+    if (traceAddress[fd] > 0) {
+        return (uint8_t) (traceAddress[fd] - 1);
+    }
+    const i2cDeviceStats *stats;
+    for (int i = 0; (stats = i2cDeviceStatistics(i)) != NULL; i++) {
+        if (stats->fd == fd && stats->address >= 0) {
+            traceAddress[fd] = (uint8_t) (stats->address + 1);
+            return (uint8_t) stats->address;
+        }
+    }
+    return TRACE_NO_ADDRESS;
+}
+
+/**
+ * Appends a transaction to the trace file.
+ *
+ * @param op I2C_TRACE_* operation
+ * @param fd file descriptor of the device
+ * @param reg register, 0 for operations without one
+ * @param length requested length of a block read, 0 otherwise
+ * @param data written data, 0 for reads
+ * @param result result of the transaction
+ * @param block read bytes of a block read, NULL otherwise
+ * @param start start time of the transaction in microseconds
+ */
+static void traceTransaction(int op, int fd, int reg, int length, int data, int result, const uint8_t *block,
+                             uint64_t start) {
+    uint8_t buffer[I2C_TRACE_RECORD_SIZE + I2C_BLOCK_MAX];
+    uint64_t end = monotonicUs();
+    size_t size = I2C_TRACE_RECORD_SIZE;
+
+    pthread_mutex_lock(&traceLock);
+    if (traceFile == NULL) {
+        pthread_mutex_unlock(&traceLock);
+        return;
+    }
+    buffer[0] = (uint8_t) op;
+    buffer[1] = op == I2C_TRACE_SETUP ? (uint8_t) fd : addressOf(fd);
+    buffer[2] = (uint8_t) reg;
+    buffer[3] = (uint8_t) length;
+    putU32(buffer + 4, (uint32_t) (lastStartUs == 0 ? 0 : start - lastStartUs));
+    putU32(buffer + 8, (uint32_t) (end - start));
+    putU32(buffer + 12, (uint32_t) data);
+    putU32(buffer + 16, (uint32_t) result);
+    if (block != NULL && result > 0) {
+        memcpy(buffer + size, block, (size_t) result);
+        size += (size_t) result;
+    }
+    lastStartUs = start;
+
+    if (fwrite(buffer, 1, size, traceFile) != size) {
+        traceFailed = 1;
+    }
+    traceRecords++;
+    pthread_mutex_unlock(&traceLock);
+}
+
+static int recordSetup(int devId) {
+    uint64_t start = monotonicUs();
+    int fd = recorded->setup(devId);
+    if (fd >= 0 && fd < I2C_FD_MAX) {
+        traceAddress[fd] = (uint8_t) (devId + 1);
+    }
+    /* Setups are recorded by address, not by fd */
+    traceTransaction(I2C_TRACE_SETUP, devId, 0, 0, 0, fd, NULL, start);
+    return fd;
+}
+
+static int recordRead(int fd) {
+    uint64_t start = monotonicUs();
+    int result = recorded->read(fd);
+    traceTransaction(I2C_TRACE_READ, fd, 0, 0, 0, result, NULL, start);
+    return result;
+}
+
+static int recordReadReg8(int fd, int reg) {
+    uint64_t start = monotonicUs();
+    int result = recorded->readReg8(fd, reg);
+    traceTransaction(I2C_TRACE_READ8, fd, reg, 0, 0, result, NULL, start);
+    return result;
+}
+
+static int recordReadReg16(int fd, int reg) {
+    uint64_t start = monotonicUs();
+    int result = recorded->readReg16(fd, reg);
+    traceTransaction(I2C_TRACE_READ16, fd, reg, 0, 0, result, NULL, start);
+    return result;
+}
+
+static int recordWrite(int fd, int data) {
+    uint64_t start = monotonicUs();
+    int result = recorded->write(fd, data);
+    traceTransaction(I2C_TRACE_WRITE, fd, 0, 0, data, result, NULL, start);
+    return result;
+}
+
+static int recordWriteReg8(int fd, int reg, int data) {
+    uint64_t start = monotonicUs();
+    int result = recorded->writeReg8(fd, reg, data);
+    traceTransaction(I2C_TRACE_WRITE8, fd, reg, 0, data, result, NULL, start);
+    return result;
+}
+
+static int recordWriteReg16(int fd, int reg, int data) {
+    uint64_t start = monotonicUs();
+    int result = recorded->writeReg16(fd, reg, data);
+    traceTransaction(I2C_TRACE_WRITE16, fd, reg, 0, data, result, NULL, start);
+    return result;
+}
+
+static int recordReadBlock(int fd, int reg, uint8_t *buffer, int length) {
+    uint64_t start = monotonicUs();
+    int result = recorded->readBlock(fd, reg, buffer, length);
+    traceTransaction(I2C_TRACE_BLOCK, fd, reg, length, 0, result, buffer, start);
+    return result;
+}
+
+static const i2cBackend recorder = {
+        recordSetup, recordRead, recordReadReg8, recordReadReg16,
+        recordWrite, recordWriteReg8, recordWriteReg16, recordReadBlock
+};
+
+/**
+ * Starts recording all transactions to a file. The recorder wraps
+ * the current backend, so it should be started before the sensors
+ * are set up to have the setup in the trace as well.
+ *
+ * @param path trace file, replaced if it exists
+ * @return 0 on success, -1 on failure (i. e. already recording)
+ */
+int i2cStartTrace(const char *path) {
+    uint8_t header[I2C_TRACE_HEADER_SIZE] = {0};
+    struct timespec now;
+
+    if (traceFile != NULL) {
+        return -1;
+    }
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        return -1;
+    }
+    setvbuf(file, NULL, _IOFBF, TRACE_BUFFER_SIZE);
+
+    clock_gettime(CLOCK_REALTIME, &now);
+    uint64_t startUs = (uint64_t) now.tv_sec * 1000000 + (uint64_t) now.tv_nsec / 1000;
+    memcpy(header, I2C_TRACE_MAGIC, 4);
+    header[4] = I2C_TRACE_VERSION;
+    putU32(header + 8, (uint32_t) startUs);
+    putU32(header + 12, (uint32_t) (startUs >> 32));
+    if (fwrite(header, 1, sizeof(header), file) != sizeof(header)) {
+        fclose(file);
+        return -1;
+    }
+
+    pthread_mutex_lock(&traceLock);
+    memset(traceAddress, 0, sizeof(traceAddress));
+    lastStartUs = 0;
+    traceRecords = 0;
+    traceFailed = 0;
+    traceFile = file;
+    pthread_mutex_unlock(&traceLock);
+    recorded = i2cSetBackend(&recorder);
+    return 0;
+}
+
+/**
+ * Stops recording and closes the trace file.
+ *
+ * @return number of recorded transactions, -1 if writing failed
+ */
+long i2cStopTrace(void) {
+    if (traceFile == NULL) {
+        return -1;
+    }
+    i2cSetBackend(recorded);
+
+    pthread_mutex_lock(&traceLock);
+    FILE *file = traceFile;
+    traceFile = NULL;
+    long records = traceRecords;
+    int failed = traceFailed;
+    pthread_mutex_unlock(&traceLock);
+
+    if (fclose(file) != 0 || failed) {
+        return -1;
+    }
+    return records;
+}
+
+/**
+ * Returns the next recorded transaction of a device if it matches
+ * the call, otherwise the divergence is counted.
+ *
+ * @return matching record, NULL if the call diverged from the trace
+ */
+static const i2cTraceRecord *replayNext(int fd, int op, int reg, int data, int length) {
+    const i2cTraceRecord *record = NULL;
+    int address = fd >= 0 && fd < I2C_FD_MAX ? replayAddress[fd] - 1 : -1;
+
+    pthread_mutex_lock(&traceLock);
+    if (address >= 0 && replayCursor[address] < replayLength[address]) {
+        record = &replayRecords[replayIndex[address][replayCursor[address]]];
+    }
+    if (record != NULL && record->op == op && record->reg == (uint8_t) reg && record->data == data &&
+        record->length == length) {
+        replayCursor[address]++;
+        replayStats.replayed++;
+        if (replayNowUs < record->startUs + record->durationUs) {
+            replayNowUs = record->startUs + record->durationUs;
+        }
+    } else {
+        if (replayStats.divergences++ == 0 && record != NULL) {
+            snprintf(replayStats.firstDivergence, sizeof(replayStats.firstDivergence),
+                     "address %d: called op %d reg 0x%02x data %d, trace has op %d reg 0x%02x data %d",
+                     address, op, reg & 0xFF, data, record->op, record->reg, record->data);
+        } else if (replayStats.divergences == 1) {
+            snprintf(replayStats.firstDivergence, sizeof(replayStats.firstDivergence),
+                     "address %d: called op %d reg 0x%02x data %d, trace has no more transactions",
+                     address, op, reg & 0xFF, data);
+        }
+        record = NULL;
+    }
+    pthread_mutex_unlock(&traceLock);
+    return record;
+}
+
+/**
+ * Opens a device of the trace. If the device was opened before the
+ * recording started, the trace has no setup and it just succeeds.
+ * The fd refers to /dev/null, so the drivers can close it as usual.
+ */
+static int replaySetup(int devId) {
+    if (devId < 0 || devId >= I2C_TRACE_ADDRESSES) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&traceLock);
+    int result = -1;
+    if (replayCursor[devId] < replayLength[devId]) {
+        const i2cTraceRecord *record = &replayRecords[replayIndex[devId][replayCursor[devId]]];
+        result = 0;
+        if (record->op == I2C_TRACE_SETUP) {
+            result = record->result;
+            replayCursor[devId]++;
+            replayStats.replayed++;
+        }
+    }
+    pthread_mutex_unlock(&traceLock);
+    if (result < 0) {
+        return -1;
+    }
+
+    int fd = open("/dev/null", O_RDWR | O_CLOEXEC);
+    if (fd >= I2C_FD_MAX) {
+        close(fd);
+        return -1;
+    }
+    if (fd >= 0) {
+        replayAddress[fd] = (uint8_t) (devId + 1);
+    }
+    return fd;
+}
+
+static int replayRead(int fd) {
+    const i2cTraceRecord *record = replayNext(fd, I2C_TRACE_READ, 0, 0, 0);
+    return record != NULL ? record->result : -1;
+}
+
+static int replayReadReg8(int fd, int reg) {
+    const i2cTraceRecord *record = replayNext(fd, I2C_TRACE_READ8, reg, 0, 0);
+    return record != NULL ? record->result : -1;
+}
+
+static int replayReadReg16(int fd, int reg) {
+    const i2cTraceRecord *record = replayNext(fd, I2C_TRACE_READ16, reg, 0, 0);
+    return record != NULL ? record->result : -1;
+}
+
+static int replayWrite(int fd, int data) {
+    const i2cTraceRecord *record = replayNext(fd, I2C_TRACE_WRITE, 0, data, 0);
+    return record != NULL ? record->result : -1;
+}
+
+static int replayWriteReg8(int fd, int reg, int data) {
+    const i2cTraceRecord *record = replayNext(fd, I2C_TRACE_WRITE8, reg, data, 0);
+    return record != NULL ? record->result : -1;
+}
+
+static int replayWriteReg16(int fd, int reg, int data) {
+    const i2cTraceRecord *record = replayNext(fd, I2C_TRACE_WRITE16, reg, data, 0);
+    return record != NULL ? record->result : -1;
+}
+
+static int replayReadBlock(int fd, int reg, uint8_t *buffer, int length) {
+    const i2cTraceRecord *record = replayNext(fd, I2C_TRACE_BLOCK, reg, 0, length);
+    if (record == NULL) {
+        return -1;
+    }
+    if (record->result > 0) {
+        memcpy(buffer, record->block, (size_t) record->result);
+    }
+    return record->result;
+}
+
+static const i2cBackend replay = {
+        replaySetup, replayRead, replayReadReg8, replayReadReg16,
+        replayWrite, replayWriteReg8, replayWriteReg16, replayReadBlock
+};
+
+/**
+ * Returns the time of the recording. A transaction of a device
+ * starts when its next recorded one started, if that is later.
+ */
+static uint64_t replayClockUs(int fd) {
+    int address = fd >= 0 && fd < I2C_FD_MAX ? replayAddress[fd] - 1 : -1;
+    pthread_mutex_lock(&traceLock);
+    uint64_t now = replayNowUs;
+    if (address >= 0 && replayCursor[address] < replayLength[address]) {
+        const i2cTraceRecord *next = &replayRecords[replayIndex[address][replayCursor[address]]];
+        if (now < next->startUs) {
+            now = next->startUs;
+        }
+    }
+    pthread_mutex_unlock(&traceLock);
+    return now;
+}
+
+/**
+ * Moves the time of the recording on instead of sleeping.
+ */
+static void replaySleepUs(uint32_t us) {
+    pthread_mutex_lock(&traceLock);
+    replayNowUs += us;
+    pthread_mutex_unlock(&traceLock);
+}
+
+static const i2cClock replayClock = {replayClockUs, replaySleepUs};
+
+/**
+ * Reads a whole file into memory.
+ *
+ * @return contents to be freed by the caller, NULL on failure
+ */
+static uint8_t *readFile(const char *path, size_t *size) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return NULL;
+    }
+    size_t capacity = TRACE_BUFFER_SIZE, used = 0;
+    uint8_t *data = malloc(capacity);
+    while (data != NULL) {
+        used += fread(data + used, 1, capacity - used, file);
+        if (used < capacity) {
+            break;
+        }
+        uint8_t *larger = realloc(data, capacity * 2);
+        if (larger == NULL) {
+            free(data);
+        }
+        data = larger;
+        capacity *= 2;
+    }
+    if (data != NULL && ferror(file)) {
+        free(data);
+        data = NULL;
+    }
+    fclose(file);
+    *size = used;
+    return data;
+}
+
+/**
+ * Parses a trace, every record is checked against the end of the
+ * file and the limits of its fields.
+ *
+ * @return number of records, -1 if the trace is invalid
+ */
+static long parseTrace(const uint8_t *data, size_t size, i2cTraceRecord *records) {
+    if (size < I2C_TRACE_HEADER_SIZE || memcmp(data, I2C_TRACE_MAGIC, 4) != 0 || data[4] != I2C_TRACE_VERSION) {
+        return -1;
+    }
+
+    long count = 0;
+    size_t position = I2C_TRACE_HEADER_SIZE;
+    while (position < size) {
+        const uint8_t *in = data + position;
+        if (size - position < I2C_TRACE_RECORD_SIZE || in[0] > I2C_TRACE_BLOCK || in[3] > I2C_BLOCK_MAX) {
+            return -1;
+        }
+        int32_t result = (int32_t) getU32(in + 16);
+        size_t bytes = in[0] == I2C_TRACE_BLOCK && result > 0 ? (size_t) result : 0;
+        if (bytes > in[3] || size - position - I2C_TRACE_RECORD_SIZE < bytes) {
+            return -1;
+        }
+
+        if (records != NULL) {
+            i2cTraceRecord *record = &records[count];
+            record->op = in[0];
+            record->address = in[1];
+            record->reg = in[2];
+            record->length = in[3];
+            record->deltaUs = getU32(in + 4);
+            record->durationUs = getU32(in + 8);
+            record->data = (int32_t) getU32(in + 12);
+            record->result = result;
+            memcpy(record->block, in + I2C_TRACE_RECORD_SIZE, bytes);
+        }
+        position += I2C_TRACE_RECORD_SIZE + bytes;
+        count++;
+    }
+    return count;
+}
+
+/**
+ * Loads a trace and replaces the hardware and the clock of the
+ * retries and circuit breakers by it.
+ *
+ * @param path trace file
+ * @return number of transactions, -1 if the file is not a valid trace
+ */
+long i2cLoadReplay(const char *path) {
+    size_t size;
+    uint8_t *data = readFile(path, &size);
+    if (data == NULL) {
+        return -1;
+    }
+    long count = parseTrace(data, size, NULL);
+    i2cTraceRecord *records = count > 0 ? malloc(sizeof(i2cTraceRecord) * (size_t) count) : NULL;
+    if (records == NULL) {
+        free(data);
+        return -1;
+    }
+    parseTrace(data, size, records);
+    free(data);
+
+    i2cCloseReplay();
+    memset(&replayStats, 0, sizeof(replayStats));
+    for (long i = 0; i < count; i++) {
+        if (records[i].address < I2C_TRACE_ADDRESSES) {
+            replayLength[records[i].address]++;
+        }
+        replayStats.recordedUs += records[i].deltaUs;
+        records[i].startUs = replayStats.recordedUs;
+    }
+    replayStats.recordedUs += records[count - 1].durationUs;
+    for (int address = 0; address < I2C_TRACE_ADDRESSES; address++) {
+        if (replayLength[address] == 0) {
+            continue;
+        }
+        replayIndex[address] = malloc(sizeof(uint32_t) * replayLength[address]);
+        if (replayIndex[address] == NULL) {
+            free(records);
+            i2cCloseReplay();
+            return -1;
+        }
+        replayLength[address] = 0;
+    }
+    for (long i = 0; i < count; i++) {
+        uint8_t address = records[i].address;
+        if (address < I2C_TRACE_ADDRESSES) {
+            replayIndex[address][replayLength[address]++] = (uint32_t) i;
+            replayStats.records++;
+        }
+    }
+
+    replayRecords = records;
+    replayNowUs = 0;
+    replaced = i2cSetBackend(&replay);
+    replacedClock = i2cSetClock(&replayClock);
+    i2cCloseBreakers();
+    return replayStats.records;
+}
+
+/**
+ * Starts the replay from the beginning of the trace again, at the
+ * time the recording started and with closed circuit breakers.
+ */
+void i2cRewindReplay(void) {
+    pthread_mutex_lock(&traceLock);
+    memset(replayCursor, 0, sizeof(replayCursor));
+    replayNowUs = 0;
+    replayStats.replayed = 0;
+    replayStats.divergences = 0;
+    replayStats.firstDivergence[0] = '\0';
+    pthread_mutex_unlock(&traceLock);
+    i2cCloseBreakers();
+}
+
+/**
+ * Checks whether all transactions of the trace were replayed.
+ *
+ * @return 1 if the trace is used up, 0 otherwise
+ */
+int i2cReplayFinished(void) {
+    int finished = 1;
+    pthread_mutex_lock(&traceLock);
+    for (int address = 0; address < I2C_TRACE_ADDRESSES; address++) {
+        if (replayCursor[address] < replayLength[address]) {
+            finished = 0;
+        }
+    }
+    pthread_mutex_unlock(&traceLock);
+    return finished;
+}
+
+/**
+ * Returns the progress of the replay.
+ *
+ * @param stats receives the progress
+ */
+void i2cReplayStatistics(i2cReplayStats *stats) {
+    pthread_mutex_lock(&traceLock);
+    *stats = replayStats;
+    pthread_mutex_unlock(&traceLock);
+}
+
+/**
+ * Ends the replay, the transactions go to the hardware again.
+ */
+void i2cCloseReplay(void) {
+    if (replayRecords != NULL) {
+        i2cSetBackend(replaced);
+        i2cSetClock(replacedClock);
+        free(replayRecords);
+        replayRecords = NULL;
+    }
+    for (int address = 0; address < I2C_TRACE_ADDRESSES; address++) {
+        free(replayIndex[address]);
+        replayIndex[address] = NULL;
+        replayLength[address] = 0;
+        replayCursor[address] = 0;
+    }
+    memset(replayAddress, 0, sizeof(replayAddress));
+}
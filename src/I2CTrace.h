@@ -0,0 +1,141 @@
+/**
+ * <Program>
+ * I2CTrace.h
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ * Header file for recording and replaying I2C traces. While a
+ * trace is recorded every transaction of the I2C layer is written
+ * to a binary file with its arguments, result and timing. A
+ * replay feeds such a file back to the unmodified drivers without
+ * any hardware, so a field problem (i. e. a strange humidity
+ * spike) can be reproduced from the raw register values, and the
+ * compensation code can be checked bit by bit against a known
+ * output.
+ *
+ * A trace file starts with a header
+ *
+ *      char[4]  magic "I2CT"
+ *      u8       version (1)
+ *      u8[3]    reserved
+ *      u64      start of the recording, us since epoch
+ *
+ * followed by one record per transaction, all values little endian:
+ *
+ *      u8       operation (I2C_TRACE_*)
+ *      u8       I2C address
+ *      u8       register (0 for operations without one)
+ *      u8       requested length of a block read, 0 otherwise
+ *      u32      us since the start of the previous record
+ *      u32      duration in us
+ *      i32      written data, 0 for reads
+ *      i32      result, for block reads the number of bytes read
+ *      u8[]     the bytes of a block read
+ *
+ * The replay answers the calls of every device with its recorded
+ * transactions in order. A call that does not match the next
+ * recorded transaction of the device (other operation, register
+ * or written data) fails and is counted as divergence. Retries and
+ * circuit breakers run on the time of the recording meanwhile (see
+ * i2cSetClock), the replay never sleeps.
+ */
+
+#ifndef SRC_I2CTRACE_H
+#define SRC_I2CTRACE_H
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include "I2CBus.h"
+
+#define I2C_TRACE_MAGIC       "I2CT"
+#define I2C_TRACE_VERSION     1
+#define I2C_TRACE_HEADER_SIZE 16
+#define I2C_TRACE_RECORD_SIZE 20
+#define I2C_TRACE_ADDRESSES   128
+
+/* --- Operations --- */
+#define I2C_TRACE_SETUP   0
+#define I2C_TRACE_READ    1
+#define I2C_TRACE_READ8   2
+#define I2C_TRACE_READ16  3
+#define I2C_TRACE_WRITE   4
+#define I2C_TRACE_WRITE8  5
+#define I2C_TRACE_WRITE16 6
+#define I2C_TRACE_BLOCK   7
+
+/* Used to hold a single transaction of a trace */
+typedef struct {
+    uint8_t op;
+    uint8_t address;
+    uint8_t reg;
+    uint8_t length;
+    uint32_t deltaUs;
+    uint32_t durationUs;
+    int32_t data;
+    int32_t result;
+    uint8_t block[I2C_BLOCK_MAX];
+    uint64_t startUs;      /* since the start of the recording, set by the replay */
+} i2cTraceRecord;
+
+/* Used to report the progress of a replay */
+typedef struct {
+    uint32_t records;      /* transactions in the trace */
+    uint32_t replayed;     /* transactions answered since the last rewind */
+    uint32_t divergences;  /* calls not matching the trace */
+    uint64_t recordedUs;   /* duration of the recording */
+    char firstDivergence[128];
+} i2cReplayStats;
+
+/* METHODS */
+
+/**
+ * Starts recording all transactions to a file. The recorder wraps
+ * the current backend, so it should be started before the sensors
+ * are set up to have the setup in the trace as well.
+ *
+ * @param path trace file, replaced if it exists
+ * @return 0 on success, -1 on failure (i. e. already recording)
+ */
+int i2cStartTrace(const char *path);
+/**
+ * Stops recording and closes the trace file.
+ *
+ * @return number of recorded transactions, -1 if writing failed
+ */
+long i2cStopTrace(void);
+/**
+ * Loads a trace and replaces the hardware and the clock of the
+ * retries and circuit breakers by it.
+ *
+ * @param path trace file
+ * @return number of transactions, -1 if the file is not a valid trace
+ */
+long i2cLoadReplay(const char *path);
+/**
+ * Starts the replay from the beginning of the trace again, at the
+ * time the recording started and with closed circuit breakers.
+ */
+void i2cRewindReplay(void);
+/**
+ * Checks whether all transactions of the trace were replayed.
+ *
+ * @return 1 if the trace is used up, 0 otherwise
+ */
+int i2cReplayFinished(void);
+/**
+ * Returns the progress of the replay.
+ *
+ * @param stats receives the progress
+ */
+void i2cReplayStatistics(i2cReplayStats *stats);
+/**
+ * Ends the replay, the transactions go to the hardware again.
+ */
+void i2cCloseReplay(void);
+
+#endif //SRC_I2CTRACE_H
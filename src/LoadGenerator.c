@@ -0,0 +1,329 @@
+/**
+ * <Program>
+ * LoadGenerator.c
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ *  Simulates a cluster of boxes sending their samples to the
+ * collector, to find out how many boxes one collector can take.
+ * Every simulated box sends frames with synthetic samples at the
+ * given rate, over UDP (batched with sendmmsg) or over one TCP
+ * connection per box. TCP connections block when the collector
+ * applies backpressure, so the reported rate is what the
+ * collector really took.
+ *  Usage: loadgen [-t] [-b boxes] [-s samples per frame]
+ *                 [-r frames per second and box, 0 = unlimited]
+ *                 [-d seconds] [-j threads] [-i first box ID]
+ *                 [host] [port]
+ *
+ * <Sources>
+ * Accessed on 18.10.2026 - sendmmsg(2):
+ *      https://man7.org/linux/man-pages/man2/sendmmsg.2.html
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include "Collector.h"
+
+#define LOADGEN_THREADS_MAX 64
+#define LOADGEN_SEND_BATCH  64
+
+/* Used to configure the simulated cluster */
+typedef struct {
+    struct sockaddr_in address;
+    int tcp;
+    int boxes;
+    int samples;
+    int rate;
+    int seconds;
+    int threads;
+    uint32_t firstBox;
+} loadConfig;
+
+/* Used to hold the simulated boxes of one thread */
+typedef struct {
+    const loadConfig *config;
+    pthread_t thread;
+    int firstBox;        /* position of the first box of the thread */
+    int boxCount;
+    int *sockets;        /* one per box for TCP, one for all for UDP */
+    int64_t *lastTime;   /* time of the last sample of every box */
+    uint32_t *sequence;  /* number of samples sent by every box */
+    uint64_t frames;
+    uint64_t bytes;
+    uint64_t errors;
+} loadThread;
+
+/**
+ * Returns the current time of the given clock in microseconds.
+ */
+static int64_t clockUs(clockid_t clock) {
+    struct timespec now;
+    clock_gettime(clock, &now);
+    return (int64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/**
+ * Fills a frame of a box with synthetic samples. The values drift
+ * slowly like in a real room, times are strictly increasing.
+ *
+ * @return length of the frame
+ */
+static long buildFrame(loadThread *thread, int box, uint8_t *buffer, size_t capacity) {
+    frameSample samples[FRAME_SAMPLES_MAX];
+    int64_t time = clockUs(CLOCK_REALTIME);
+    if (time <= thread->lastTime[box]) {
+        time = thread->lastTime[box] + 1;
+    }
+
+    for (int i = 0; i < thread->config->samples; i++) {
+        uint32_t n = thread->sequence[box]++;
+        frameSample *sample = &samples[i];
+        memset(sample, 0, sizeof(frameSample));
+        sample->time = time + i;
+        sample->temperature = 2100 + (int32_t) (n % 300);
+        sample->pressure = 25600 * (1000 + n % 20);
+        sample->humidity = 1024 * (40 + n % 10);
+        sample->uv = (uint16_t) (n % 800);
+        sample->ir = (uint16_t) (250 + n % 50);
+        sample->vis = (uint16_t) (260 + n % 40);
+        sample->eCO2 = (uint16_t) (400 + n % 600);
+        sample->TVOC = (uint16_t) (n % 100);
+    }
+    thread->lastTime[box] = time + thread->config->samples - 1;
+    return encodeFrame(buffer, capacity, thread->config->firstBox + (uint32_t) (thread->firstBox + box), samples,
+                       (size_t) thread->config->samples);
+}
+
+/**
+ * Sends one frame of every box of the thread over UDP.
+ */
+static void sendDatagrams(loadThread *thread, uint8_t (*frames)[FRAME_BYTES_MAX]) {
+    struct mmsghdr messages[LOADGEN_SEND_BATCH];
+    struct iovec vectors[LOADGEN_SEND_BATCH];
+
+    for (int first = 0; first < thread->boxCount; first += LOADGEN_SEND_BATCH) {
+        int count = thread->boxCount - first < LOADGEN_SEND_BATCH ? thread->boxCount - first : LOADGEN_SEND_BATCH;
+        memset(messages, 0, sizeof(messages));
+        for (int i = 0; i < count; i++) {
+            vectors[i].iov_base = frames[i];
+            vectors[i].iov_len = (size_t) buildFrame(thread, first + i, frames[i], FRAME_BYTES_MAX);
+            messages[i].msg_hdr.msg_iov = &vectors[i];
+            messages[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        int sent = 0;
+        while (sent < count) {
+            int result = sendmmsg(thread->sockets[0], messages + sent, (unsigned int) (count - sent), 0);
+            if (result < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                thread->errors += (uint64_t) (count - sent);
+                break;
+            }
+            for (int i = sent; i < sent + result; i++) {
+                thread->bytes += messages[i].msg_len;
+            }
+            thread->frames += (uint64_t) result;
+            sent += result;
+        }
+    }
+}
+
+/**
+ * Sends one frame of every box of the thread over its connection,
+ * preceded by the length.
+ */
+static void sendStreams(loadThread *thread, uint8_t *buffer) {
+    for (int box = 0; box < thread->boxCount; box++) {
+        uint32_t length = (uint32_t) buildFrame(thread, box, buffer + 4, FRAME_BYTES_MAX - 4);
+        memcpy(buffer, &length, sizeof(length));
+
+        size_t sent = 0;
+        while (sent < length + 4) {
+            ssize_t result = send(thread->sockets[box], buffer + sent, length + 4 - sent, MSG_NOSIGNAL);
+            if (result < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                thread->errors++;
+                break;
+            }
+            sent += (size_t) result;
+        }
+        if (sent == length + 4) {
+            thread->frames++;
+            thread->bytes += sent;
+        }
+    }
+}
+
+/**
+ * Thread simulating a part of the boxes. Every period all boxes
+ * send one frame, then the thread sleeps until the next period.
+ */
+static void *runThread(void *argument) {
+    loadThread *thread = argument;
+    const loadConfig *config = thread->config;
+    uint8_t (*frames)[FRAME_BYTES_MAX] = malloc(sizeof(*frames) * LOADGEN_SEND_BATCH);
+    if (frames == NULL) {
+        return NULL;
+    }
+
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    int64_t end = clockUs(CLOCK_MONOTONIC) + (int64_t) config->seconds * 1000000;
+    long periodNs = config->rate > 0 ? 1000000000L / config->rate : 0;
+
+    while (clockUs(CLOCK_MONOTONIC) < end) {
+        if (config->tcp) {
+            sendStreams(thread, frames[0]);
+        } else {
+            sendDatagrams(thread, frames);
+        }
+
+        if (periodNs > 0) {
+            next.tv_nsec += periodNs;
+            while (next.tv_nsec >= 1000000000L) {
+                next.tv_nsec -= 1000000000L;
+                next.tv_sec++;
+            }
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+        }
+    }
+    free(frames);
+    return NULL;
+}
+
+/**
+ * Opens the sockets of a thread: one UDP socket for all boxes or
+ * one TCP connection per box.
+ *
+ * @return 0 on success, -1 on failure
+ */
+static int openSockets(loadThread *thread) {
+    const loadConfig *config = thread->config;
+    int count = config->tcp ? thread->boxCount : 1;
+    for (int i = 0; i < count; i++) {
+        int fd = socket(AF_INET, config->tcp ? SOCK_STREAM : SOCK_DGRAM, 0);
+        if (fd < 0 || connect(fd, (const struct sockaddr *) &config->address, sizeof(config->address)) < 0) {
+            if (fd >= 0) {
+                close(fd);
+            }
+            return -1;
+        }
+        thread->sockets[i] = fd;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    loadConfig config = {.tcp = 0, .boxes = 100, .samples = 10, .rate = 1, .seconds = 10, .threads = 1,
+                         .firstBox = 1};
+    const char *host = "127.0.0.1";
+    int port = COLLECTOR_PORT;
+    int option;
+
+    while ((option = getopt(argc, argv, "tb:s:r:d:j:i:")) != -1) {
+        switch (option) {
+            case 't':
+                config.tcp = 1;
+                break;
+            case 'b':
+                config.boxes = atoi(optarg);
+                break;
+            case 's':
+                config.samples = atoi(optarg);
+                break;
+            case 'r':
+                config.rate = atoi(optarg);
+                break;
+            case 'd':
+                config.seconds = atoi(optarg);
+                break;
+            case 'j':
+                config.threads = atoi(optarg);
+                break;
+            case 'i':
+                config.firstBox = (uint32_t) strtoul(optarg, NULL, 0);
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-t] [-b boxes] [-s samples] [-r rate] [-d seconds] [-j threads]"
+                                " [-i first box] [host] [port]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (optind < argc) {
+        host = argv[optind++];
+    }
+    if (optind < argc) {
+        port = atoi(argv[optind]);
+    }
+    if (config.boxes < 1 || config.samples < 1 || config.samples > FRAME_SAMPLES_MAX || config.rate < 0 ||
+        config.threads < 1 || config.threads > LOADGEN_THREADS_MAX || config.threads > config.boxes) {
+        fprintf(stderr, "invalid arguments\n");
+        return 1;
+    }
+
+    config.address.sin_family = AF_INET;
+    config.address.sin_port = htons((uint16_t) port);
+    if (inet_pton(AF_INET, host, &config.address.sin_addr) != 1) {
+        fprintf(stderr, "invalid address %s\n", host);
+        return 1;
+    }
+
+    static loadThread threads[LOADGEN_THREADS_MAX];
+    for (int i = 0; i < config.threads; i++) {
+        loadThread *thread = &threads[i];
+        thread->config = &config;
+        thread->firstBox = config.boxes * i / config.threads;
+        thread->boxCount = config.boxes * (i + 1) / config.threads - thread->firstBox;
+        thread->sockets = calloc((size_t) thread->boxCount, sizeof(int));
+        thread->lastTime = calloc((size_t) thread->boxCount, sizeof(int64_t));
+        thread->sequence = calloc((size_t) thread->boxCount, sizeof(uint32_t));
+        if (thread->sockets == NULL || thread->lastTime == NULL || thread->sequence == NULL ||
+            openSockets(thread) < 0) {
+            perror("connect");
+            return 1;
+        }
+    }
+
+    printf("simulating %i boxes over %s, %i samples per frame, %i frames/s per box for %i s\n",
+           config.boxes, config.tcp ? "TCP" : "UDP", config.samples, config.rate, config.seconds);
+    fflush(stdout);
+    int64_t start = clockUs(CLOCK_MONOTONIC);
+    for (int i = 0; i < config.threads; i++) {
+        pthread_create(&threads[i].thread, NULL, runThread, &threads[i]);
+    }
+
+    uint64_t frames = 0, bytes = 0, errors = 0;
+    for (int i = 0; i < config.threads; i++) {
+        pthread_join(threads[i].thread, NULL);
+        frames += threads[i].frames;
+        bytes += threads[i].bytes;
+        errors += threads[i].errors;
+        for (int j = 0; j < (config.tcp ? threads[i].boxCount : 1); j++) {
+            close(threads[i].sockets[j]);
+        }
+    }
+    double seconds = (clockUs(CLOCK_MONOTONIC) - start) / 1e6;
+
+    printf("sent %" PRIu64 " frames (%.0f frames/s, %.0f samples/s, %.2f MB/s), %" PRIu64 " errors\n",
+           frames, frames / seconds, frames * config.samples / seconds, bytes / seconds / 1e6, errors);
+    return 0;
+}
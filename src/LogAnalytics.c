@@ -0,0 +1,1243 @@
+/**
+ * <Program>
+ * LogAnalytics.c
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ *  Offline analysis of sensor logs on a work-stealing thread pool.
+ * The inputs are mapped into memory, split into chunks while they
+ * are analyzed and the workers steal chunks from each other. Every
+ * worker keeps the hourly statistics and pair sums of each chunk and
+ * its own histograms. Once all workers are done the chunks are
+ * merged in the order of the inputs, so the result does not depend
+ * on which worker analyzed which chunk.
+ *  Numbers are parsed by hand, only numbers with an exponent or
+ * too many digits go through strtod.
+ *  Usage: loganalytics [-j threads] [-c chunk KiB] [-b bins]
+ *                      [-o directory] input...
+ *
+ * <Sources>
+ * Accessed on 18.10.2026 - Scheduling Multithreaded Computations by Work Stealing (Blumofe, Leiserson):
+ *      http://supertech.csail.mit.edu/papers/steal.pdf
+ * Accessed on 18.10.2026 - Algorithms for computing the sample variance (Chan, Golub, LeVeque):
+ *      http://i.stanford.edu/pub/cstr/reports/cs/tr/79/773/CS-TR-79-773.pdf
+ * Accessed on 18.10.2026 - Algorithms for calculating variance, covariance:
+ *      https://en.wikipedia.org/wiki/Algorithms_for_calculating_variance
+ */
+
+#define _GNU_SOURCE
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <math.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "LogAnalytics.h"
+#include "SensorLog.h"
+
+#define COUNT(counter, value) __atomic_fetch_add(&(counter), (value), __ATOMIC_RELAXED)
+#define LOAD(counter) __atomic_load_n(&(counter), __ATOMIC_ACQUIRE)
+
+#define NO_HOUR INT64_MIN
+
+static const double powersOfTen[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+                                     1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18};
+
+/**
+ * Returns the current time of the monotonic clock in seconds.
+ */
+static double monotonicSeconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/**
+ * Removes blanks, quotes and the literal "\t" the first scripts
+ * wrote behind every value from both ends of a field.
+ */
+static void trimField(const char **begin, const char **end) {
+    const char *b = *begin, *e = *end;
+    while (b < e && (*b == ' ' || *b == '\t' || *b == '"')) {
+        b++;
+    }
+    for (;;) {
+        if (e > b && (e[-1] == ' ' || e[-1] == '\t' || e[-1] == '\r' || e[-1] == '"')) {
+            e--;
+        } else if (e - b >= 2 && e[-2] == '\\' && e[-1] == 't') {
+            e -= 2;
+        } else {
+            break;
+        }
+    }
+    *begin = b;
+    *end = e;
+}
+
+/**
+ * Parses a field holding a decimal number.
+ *
+ * @return the number, NaN if the field is empty or not a number
+ */
+static double parseValue(const char *begin, const char *end) {
+    trimField(&begin, &end);
+    const char *p = begin;
+    int negative = 0;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
+    }
+    uint64_t mantissa = 0;
+    int digits = 0, decimals = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        mantissa = mantissa * 10 + (uint64_t) (*p++ - '0');
+        digits++;
+    }
+    if (p < end && *p == '.') {
+        p++;
+        while (p < end && *p >= '0' && *p <= '9') {
+            mantissa = mantissa * 10 + (uint64_t) (*p++ - '0');
+            digits++;
+            decimals++;
+        }
+    }
+    if (digits == 0) {
+        return NAN;
+    }
+    if (p == end && digits <= 18) {
+        double value = (double) mantissa / powersOfTen[decimals];
+        return negative ? -value : value;
+    }
+
+    /* Exponent or too many digits for the mantissa */
+    char copy[64];
+    if (end - begin >= (long) sizeof(copy)) {
+        return NAN;
+    }
+    memcpy(copy, begin, (size_t) (end - begin));
+    copy[end - begin] = '\0';
+    char *parsed;
+    double value = strtod(copy, &parsed);
+    return *parsed == '\0' ? value : NAN;
+}
+
+/**
+ * Returns midnight (UTC) of the first date dd.mm.yyyy or dd-mm-yyyy
+ * in the file name of a path, 0 if there is none.
+ */
+static int64_t dateFromName(const char *path) {
+    const char *name = strrchr(path, '/');
+    name = name == NULL ? path : name + 1;
+    for (const char *p = name; *p != '\0'; p++) {
+        int day, month, year, length = 0;
+        if (sscanf(p, "%2d%*[.-]%2d%*[.-]%4d%n", &day, &month, &year, &length) == 3 && length == 10 &&
+            day >= 1 && day <= 31 && month >= 1 && month <= 12 && year >= 1970) {
+            struct tm date = {0};
+            date.tm_mday = day;
+            date.tm_mon = month - 1;
+            date.tm_year = year - 1900;
+            return (int64_t) timegm(&date);
+        }
+    }
+    return 0;
+}
+
+/**
+ * Returns the channel of a column name, adding it if it is new.
+ */
+static int channelFor(logAnalytics *analytics, const char *begin, const char *end) {
+    size_t length = (size_t) (end - begin);
+    if (length == 0 || length >= ANALYTICS_NAME_MAX ||
+        (length == 6 && strncmp(begin, "Status", 6) == 0) ||
+        (length > 6 && strncmp(begin, "Column", 6) == 0)) {
+        return ANALYTICS_NO_CHANNEL;
+    }
+    for (int c = 0; c < analytics->channels; c++) {
+        if (strlen(analytics->channelName[c]) == length && strncmp(analytics->channelName[c], begin, length) == 0) {
+            return c;
+        }
+    }
+    if (analytics->channels == ANALYTICS_CHANNELS_MAX) {
+        fprintf(stderr, "too many channels, %.*s is ignored\n", (int) length, begin);
+        return ANALYTICS_NO_CHANNEL;
+    }
+    memcpy(analytics->channelName[analytics->channels], begin, length);
+    analytics->channelName[analytics->channels][length] = '\0';
+    return analytics->channels++;
+}
+
+/**
+ * Finds the header of an input and maps its columns to channels.
+ *
+ * @return 0 on success, -1 if there is no header with a Time column
+ */
+static int readHeader(logAnalytics *analytics, analyticsInput *input) {
+    const char *data = input->data, *end = data + input->length;
+    const char *header = NULL, *headerEnd = NULL;
+    const char *line = data;
+    if (input->length >= 3 && memcmp(data, "\xEF\xBB\xBF", 3) == 0) {
+        line += 3;  /* byte order mark of files saved by Excel */
+    }
+    while (line < end) {
+        const char *lineEnd = memchr(line, '\n', (size_t) (end - line));
+        if (lineEnd == NULL) {
+            lineEnd = end;
+        }
+        const char *fieldEnd = memchr(line, ';', (size_t) (lineEnd - line));
+        if (!isnan(parseValue(line, fieldEnd == NULL ? lineEnd : fieldEnd))) {
+            break;
+        }
+        if (lineEnd > line) {
+            header = line;
+            headerEnd = lineEnd;
+        }
+        line = lineEnd + 1;
+    }
+    if (header == NULL) {
+        return -1;
+    }
+    input->dataStart = line < end ? (size_t) (line - data) : input->length;
+
+    input->columns = 0;
+    input->timeColumn = -1;
+    const char *field = header;
+    while (field <= headerEnd && input->columns < ANALYTICS_COLUMNS_MAX) {
+        const char *fieldEnd = memchr(field, ';', (size_t) (headerEnd - field));
+        if (fieldEnd == NULL) {
+            fieldEnd = headerEnd;
+        }
+        const char *name = field, *nameEnd = fieldEnd;
+        trimField(&name, &nameEnd);
+        if (nameEnd - name == 4 && strncmp(name, "Time", 4) == 0) {
+            input->timeColumn = input->columns;
+            input->channel[input->columns] = ANALYTICS_NO_CHANNEL;
+        } else {
+            input->channel[input->columns] = channelFor(analytics, name, nameEnd);
+        }
+        input->columns++;
+        field = fieldEnd + 1;
+    }
+    return input->timeColumn < 0 ? -1 : 0;
+}
+
+/**
+ * Maps a file and adds it as an input.
+ *
+ * @param length bytes to analyze, 0 for the whole file
+ * @return 1 if the file was added, 0 if it holds no rows, -1 on failure
+ */
+static int addFile(logAnalytics *analytics, const char *path, size_t length) {
+    if (analytics->inputCount == analytics->inputCapacity) {
+        uint32_t capacity = analytics->inputCapacity == 0 ? 64 : analytics->inputCapacity * 2;
+        analyticsInput *inputs = realloc(analytics->inputs, capacity * sizeof(analyticsInput));
+        if (inputs == NULL) {
+            return -1;
+        }
+        analytics->inputs = inputs;
+        analytics->inputCapacity = capacity;
+    }
+
+    int fd = open(path, O_RDONLY);
+    struct stat status;
+    if (fd < 0 || fstat(fd, &status) < 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    if (length == 0 || length > (size_t) status.st_size) {
+        length = (size_t) status.st_size;
+    }
+    if (length == 0) {
+        close(fd);
+        return 0;
+    }
+    void *data = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return -1;
+    }
+    madvise(data, length, MADV_WILLNEED);
+
+    analyticsInput *input = &analytics->inputs[analytics->inputCount];
+    memset(input, 0, sizeof(*input));
+    snprintf(input->path, sizeof(input->path), "%s", path);
+    input->data = data;
+    input->length = length;
+    input->timeBase = dateFromName(path);
+    if (readHeader(analytics, input) < 0) {
+        fprintf(stderr, "%s has no header with a Time column, skipped\n", path);
+        munmap(data, length);
+        return 0;
+    }
+    analytics->inputCount++;
+    return 1;
+}
+
+/**
+ * Adds the segments of a sensor log that were not dropped.
+ *
+ * @return number of segments added, -1 if the catalog could not be read
+ */
+static long addLog(logAnalytics *analytics, const char *name) {
+    catalogEntry *catalog;
+    long entries = readSensorLogCatalog(name, &catalog);
+    if (entries < 0) {
+        return -1;
+    }
+    long added = 0;
+    for (long i = 0; i < entries; i++) {
+        if (catalog[i].indexEntries == 0) {
+            continue;
+        }
+        char path[LOG_NAME_MAX + 16];
+        snprintf(path, sizeof(path), "%s.%06" PRIu32 ".csv", name, catalog[i].segment);
+        int result = addFile(analytics, path, (size_t) catalog[i].length);
+        if (result < 0) {
+            fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        } else {
+            added += result;
+        }
+    }
+    free(catalog);
+    return added;
+}
+
+/**
+ * Tells whether a file name ends with the suffix.
+ */
+static int endsWith(const char *name, const char *suffix) {
+    size_t length = strlen(name), suffixLength = strlen(suffix);
+    return length >= suffixLength && strcmp(name + length - suffixLength, suffix) == 0;
+}
+
+/**
+ * Tells whether a file name is a segment of a log (name.000001.csv).
+ */
+static int isSegment(const char *name) {
+    size_t length = strlen(name);
+    if (length < 12 || !endsWith(name, ".csv") || name[length - 11] != '.') {
+        return 0;
+    }
+    for (size_t i = length - 10; i < length - 4; i++) {
+        if (name[i] < '0' || name[i] > '9') {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * Adds the logs and CSV files of a directory.
+ */
+static long addDirectory(logAnalytics *analytics, const char *path) {
+    DIR *directory = opendir(path);
+    if (directory == NULL) {
+        return -1;
+    }
+    long added = 0;
+    struct dirent *entry;
+    while ((entry = readdir(directory)) != NULL) {
+        char child[LOG_NAME_MAX + 16];
+        long result = 0;
+        if (endsWith(entry->d_name, ".cat")) {
+            snprintf(child, sizeof(child), "%s/%.*s", path, (int) strlen(entry->d_name) - 4, entry->d_name);
+            result = addLog(analytics, child);
+        } else if (endsWith(entry->d_name, ".csv") && !isSegment(entry->d_name) &&
+                   strncmp(entry->d_name, "analytics_", 10) != 0) {
+            snprintf(child, sizeof(child), "%s/%s", path, entry->d_name);
+            result = addFile(analytics, child, 0);
+        } else {
+            continue;
+        }
+        if (result < 0) {
+            fprintf(stderr, "%s: %s\n", child, strerror(errno));
+        } else {
+            added += result;
+        }
+    }
+    closedir(directory);
+    return added;
+}
+
+/**
+ * Adds the chunk sums of a pair to its statistics.
+ */
+static void mergePair(pairStats *into, const pairStats *from) {
+    if (from->count == 0) {
+        return;
+    }
+    if (into->count == 0) {
+        *into = *from;
+        return;
+    }
+    double count = (double) (into->count + from->count);
+    double weight = (double) into->count * from->count / count;
+    double deltaX = from->meanX - into->meanX;
+    double deltaY = from->meanY - into->meanY;
+    into->meanX += deltaX * from->count / count;
+    into->meanY += deltaY * from->count / count;
+    into->m2X += from->m2X + deltaX * deltaX * weight;
+    into->m2Y += from->m2Y + deltaY * deltaY * weight;
+    into->coMoment += from->coMoment + deltaX * deltaY * weight;
+    into->count += from->count;
+}
+
+/**
+ * Merges the statistics of a channel.
+ */
+static void mergeChannel(channelStats *into, const channelStats *from) {
+    if (from->count == 0) {
+        return;
+    }
+    if (into->count == 0) {
+        *into = *from;
+        return;
+    }
+    double count = (double) (into->count + from->count);
+    double delta = from->mean - into->mean;
+    into->mean += delta * from->count / count;
+    into->m2 += from->m2 + delta * delta * (double) into->count * from->count / count;
+    into->count += from->count;
+    if (from->min < into->min) {
+        into->min = from->min;
+    }
+    if (from->max > into->max) {
+        into->max = from->max;
+    }
+}
+
+/**
+ * Returns the index of the pair of two channels, first < second.
+ */
+static int pairIndex(int first, int second) {
+    return first * ANALYTICS_CHANNELS_MAX - first * (first + 1) / 2 + second - first - 1;
+}
+
+/**
+ * Makes room for one more element in an array of results.
+ *
+ * @return 0 on success, -1 if the array could not grow
+ */
+static int growResults(void **array, size_t *capacity, size_t count, size_t size) {
+    if (count < *capacity) {
+        return 0;
+    }
+    size_t grown = *capacity == 0 ? 256 : *capacity * 2;
+    void *larger = realloc(*array, grown * size);
+    if (larger == NULL) {
+        return -1;
+    }
+    *array = larger;
+    *capacity = grown;
+    return 0;
+}
+
+/**
+ * Keeps the pair sums of a piece as its statistics, to be merged in
+ * the order of the pieces.
+ */
+static void flushPairSums(analyticsWorker *worker, const analyticsTask *task) {
+    pairSums *sums = &worker->sums;
+    int channels = worker->analytics->channels;
+    for (int x = 0; x < channels; x++) {
+        for (int y = x + 1; y < channels; y++) {
+            int p = pairIndex(x, y);
+            if (sums->count[p] == 0) {
+                continue;
+            }
+            double n = (double) sums->count[p];
+            pairStats chunk = {
+                    sums->count[p],
+                    sums->shift[x] + sums->sumX[p] / n,
+                    sums->shift[y] + sums->sumY[p] / n,
+                    sums->sumXX[p] - sums->sumX[p] * sums->sumX[p] / n,
+                    sums->sumYY[p] - sums->sumY[p] * sums->sumY[p] / n,
+                    sums->sumXY[p] - sums->sumX[p] * sums->sumY[p] / n
+            };
+            if (growResults((void **) &worker->pairs, &worker->pairCapacity, worker->pairCount,
+                            sizeof(pairResult)) < 0) {
+                worker->failed = 1;
+                continue;
+            }
+            pairResult *result = &worker->pairs[worker->pairCount++];
+            result->pair = p;
+            result->input = task->input;
+            result->begin = task->begin;
+            result->stats = chunk;
+        }
+    }
+    memset(sums, 0, sizeof(*sums));
+}
+
+/**
+ * Keeps the hours of a piece, to be merged in the order of the
+ * pieces, and empties the table for the next piece.
+ */
+static void flushHours(analyticsWorker *worker, const analyticsTask *task) {
+    for (size_t i = 0; i < worker->hourCapacity && worker->hourCount > 0; i++) {
+        hourStats *hour = &worker->hours[i];
+        if (hour->hour == NO_HOUR) {
+            continue;
+        }
+        if (growResults((void **) &worker->pieceHours, &worker->pieceHourCapacity, worker->pieceHourCount,
+                        sizeof(hourStats)) < 0) {
+            worker->failed = 1;
+        } else {
+            hour->input = task->input;
+            hour->begin = task->begin;
+            worker->pieceHours[worker->pieceHourCount++] = *hour;
+        }
+        hour->hour = NO_HOUR;
+        worker->hourCount--;
+    }
+    worker->lastHour = NULL;
+}
+
+/**
+ * Returns the statistics of an hour, adding it if it is new.
+ */
+static hourStats *hourFor(analyticsWorker *worker, int64_t hour) {
+    if (worker->lastHour != NULL && worker->lastHour->hour == hour) {
+        return worker->lastHour;
+    }
+    if ((worker->hourCount + 1) * 10 > worker->hourCapacity * 7) {
+        size_t capacity = worker->hourCapacity == 0 ? 256 : worker->hourCapacity * 2;
+        hourStats *hours = malloc(capacity * sizeof(hourStats));
+        if (hours == NULL) {
+            return NULL;
+        }
+        for (size_t i = 0; i < capacity; i++) {
+            hours[i].hour = NO_HOUR;
+        }
+        for (size_t i = 0; i < worker->hourCapacity; i++) {
+            if (worker->hours[i].hour != NO_HOUR) {
+                size_t slot = (uint64_t) worker->hours[i].hour * 0x9E3779B97F4A7C15u >> 40 & (capacity - 1);
+                while (hours[slot].hour != NO_HOUR) {
+                    slot = (slot + 1) & (capacity - 1);
+                }
+                hours[slot] = worker->hours[i];
+            }
+        }
+        free(worker->hours);
+        worker->hours = hours;
+        worker->hourCapacity = capacity;
+    }
+
+    size_t slot = (uint64_t) hour * 0x9E3779B97F4A7C15u >> 40 & (worker->hourCapacity - 1);
+    while (worker->hours[slot].hour != hour) {
+        if (worker->hours[slot].hour == NO_HOUR) {
+            memset(&worker->hours[slot], 0, sizeof(hourStats));
+            worker->hours[slot].hour = hour;
+            worker->hourCount++;
+            break;
+        }
+        slot = (slot + 1) & (worker->hourCapacity - 1);
+    }
+    worker->lastHour = &worker->hours[slot];
+    return worker->lastHour;
+}
+
+/**
+ * Adds the values of a row to the hourly statistics and the pair
+ * sums.
+ */
+static void analyzeRow(analyticsWorker *worker, int64_t time, const int *present, int count, const double *values) {
+    hourStats *hour = hourFor(worker, time >= 0 ? time / 3600 : (time - 3599) / 3600);
+    if (hour == NULL) {
+        return;
+    }
+    for (int i = 0; i < count; i++) {
+        int c = present[i];
+        double value = values[c];
+        channelStats *stats = &hour->channel[c];
+        stats->count++;
+        double delta = value - stats->mean;
+        stats->mean += delta / (double) stats->count;
+        stats->m2 += delta * (value - stats->mean);
+        if (stats->count == 1 || value < stats->min) {
+            stats->min = value;
+        }
+        if (stats->count == 1 || value > stats->max) {
+            stats->max = value;
+        }
+    }
+
+    pairSums *sums = &worker->sums;
+    double shifted[ANALYTICS_CHANNELS_MAX];
+    for (int i = 0; i < count; i++) {
+        int c = present[i];
+        if (!sums->shifted[c]) {
+            sums->shift[c] = values[c];
+            sums->shifted[c] = 1;
+        }
+        shifted[c] = values[c] - sums->shift[c];
+    }
+    for (int i = 0; i < count; i++) {
+        int x = present[i];
+        double valueX = shifted[x];
+        for (int j = i + 1; j < count; j++) {
+            int y = present[j];
+            int p = x < y ? pairIndex(x, y) : pairIndex(y, x);
+            double a = x < y ? valueX : shifted[y];
+            double b = x < y ? shifted[y] : valueX;
+            sums->count[p]++;
+            sums->sumX[p] += a;
+            sums->sumY[p] += b;
+            sums->sumXX[p] += a * a;
+            sums->sumYY[p] += b * b;
+            sums->sumXY[p] += a * b;
+        }
+    }
+}
+
+/**
+ * Adds the values of a row to the histograms.
+ */
+static void countRow(analyticsWorker *worker, const int *present, int count, const double *values) {
+    const logAnalytics *analytics = worker->analytics;
+    for (int i = 0; i < count; i++) {
+        int c = present[i];
+        const channelStats *total = &analytics->total[c];
+        int bin = 0;
+        if (total->max > total->min) {
+            bin = (int) ((values[c] - total->min) / (total->max - total->min) * analytics->bins);
+            if (bin >= analytics->bins) {
+                bin = analytics->bins - 1;
+            }
+        }
+        worker->histogram[c * analytics->bins + bin]++;
+    }
+}
+
+/**
+ * Analyzes the rows starting within a piece of an input.
+ */
+static void analyzeTask(analyticsWorker *worker, const analyticsTask *task) {
+    const analyticsInput *input = &worker->analytics->inputs[task->input];
+    const char *data = input->data, *end = data + input->length;
+    const char *line = data + task->begin;
+    const char *stop = data + task->end;
+
+    /* The row the piece starts in belongs to the piece before */
+    if (task->begin > input->dataStart && line[-1] != '\n') {
+        line = memchr(line, '\n', (size_t) (end - line));
+        line = line == NULL ? end : line + 1;
+    }
+
+    const char *first = line;
+    while (line < stop) {
+        const char *lineEnd = memchr(line, '\n', (size_t) (end - line));
+        if (lineEnd == NULL) {
+            lineEnd = end;
+        }
+        double values[ANALYTICS_CHANNELS_MAX];
+        int present[ANALYTICS_CHANNELS_MAX];
+        int count = 0;
+        double time = NAN;
+        const char *field = line;
+        for (int column = 0; column < input->columns && field <= lineEnd; column++) {
+            const char *fieldEnd = memchr(field, ';', (size_t) (lineEnd - field));
+            if (fieldEnd == NULL) {
+                fieldEnd = lineEnd;
+            }
+            int channel = input->channel[column];
+            if (column == input->timeColumn) {
+                time = parseValue(field, fieldEnd);
+            } else if (channel != ANALYTICS_NO_CHANNEL) {
+                double value = parseValue(field, fieldEnd);
+                if (!isnan(value)) {
+                    values[channel] = value;
+                    present[count++] = channel;
+                }
+            }
+            field = fieldEnd + 1;
+        }
+
+        if (lineEnd > line && *line != '\0') {
+            if (isnan(time)) {
+                worker->invalidRows++;
+            } else {
+                worker->rows++;
+                if (worker->analytics->pass == 1) {
+                    int64_t seconds = (int64_t) time;
+                    if (seconds < ANALYTICS_RELATIVE_TIME) {
+                        seconds += input->timeBase;
+                    }
+                    analyzeRow(worker, seconds, present, count, values);
+                } else {
+                    countRow(worker, present, count, values);
+                }
+            }
+        }
+        line = lineEnd + 1;
+    }
+    worker->bytes += (uint64_t) (line > first ? line - first : 0);
+    if (worker->analytics->pass == 1) {
+        flushHours(worker, task);
+        flushPairSums(worker, task);
+    }
+    worker->chunks++;
+}
+
+/**
+ * Pushes a task to the bottom of the deque of a worker.
+ *
+ * @return 0 on success, -1 if the deque could not grow
+ */
+static int pushTask(analyticsWorker *worker, const analyticsTask *task) {
+    pthread_mutex_lock(&worker->lock);
+    if (worker->bottom - worker->top == worker->capacity) {
+        size_t capacity = worker->capacity == 0 ? ANALYTICS_DEQUE : worker->capacity * 2;
+        analyticsTask *tasks = malloc(capacity * sizeof(analyticsTask));
+        if (tasks == NULL) {
+            pthread_mutex_unlock(&worker->lock);
+            return -1;
+        }
+        for (size_t i = worker->top; i < worker->bottom; i++) {
+            tasks[i % capacity] = worker->tasks[i % worker->capacity];
+        }
+        free(worker->tasks);
+        worker->tasks = tasks;
+        worker->capacity = capacity;
+    }
+    worker->tasks[worker->bottom % worker->capacity] = *task;
+    worker->bottom++;
+    pthread_mutex_unlock(&worker->lock);
+    return 0;
+}
+
+/**
+ * Takes a task from the bottom of the own deque (the one pushed
+ * last) or from the top of another one (the one pushed first).
+ *
+ * @return 1 if a task was taken, 0 if the deque is empty
+ */
+static int takeTask(analyticsWorker *worker, int own, analyticsTask *task) {
+    int taken = 0;
+    pthread_mutex_lock(&worker->lock);
+    if (worker->bottom > worker->top) {
+        if (own) {
+            worker->bottom--;
+            *task = worker->tasks[worker->bottom % worker->capacity];
+        } else {
+            *task = worker->tasks[worker->top % worker->capacity];
+            worker->top++;
+        }
+        taken = 1;
+    }
+    pthread_mutex_unlock(&worker->lock);
+    return taken;
+}
+
+/**
+ * Steals a task from a random other worker.
+ *
+ * @return 1 if a task was stolen, 0 if all deques are empty
+ */
+static int stealTask(analyticsWorker *worker, analyticsTask *task) {
+    logAnalytics *analytics = worker->analytics;
+    uint32_t x = worker->random;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    worker->random = x;
+    for (int i = 0; i < analytics->threads; i++) {
+        analyticsWorker *victim = &analytics->worker[(x + (uint32_t) i) % (uint32_t) analytics->threads];
+        if (victim != worker && takeTask(victim, 0, task)) {
+            worker->steals++;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Worker thread, runs tasks until all tasks of the pass are done.
+ */
+static void *runWorker(void *argument) {
+    analyticsWorker *worker = argument;
+    logAnalytics *analytics = worker->analytics;
+    for (;;) {
+        analyticsTask task;
+        if (!takeTask(worker, 1, &task) && !stealTask(worker, &task)) {
+            if (LOAD(analytics->pending) == 0) {
+                break;
+            }
+            sched_yield();
+            continue;
+        }
+
+        /* Split off the second half until the rest fits into a chunk */
+        while (task.end - task.begin > analytics->chunkSize) {
+            size_t middle = task.begin + (task.end - task.begin) / 2;
+            analyticsTask second = {task.input, middle, task.end};
+            COUNT(analytics->pending, 1);
+            if (pushTask(worker, &second) < 0) {
+                __atomic_fetch_sub(&analytics->pending, 1, __ATOMIC_RELAXED);
+                break;
+            }
+            task.end = middle;
+        }
+        analyzeTask(worker, &task);
+        __atomic_fetch_sub(&analytics->pending, 1, __ATOMIC_RELEASE);
+    }
+    return NULL;
+}
+
+/**
+ * Runs a pass over all inputs, one task per input to start with.
+ *
+ * @return 0 on success, -1 on failure
+ */
+static int runPass(logAnalytics *analytics, int pass) {
+    analytics->pass = pass;
+    analytics->pending = 0;
+    for (uint32_t i = 0; i < analytics->inputCount; i++) {
+        const analyticsInput *input = &analytics->inputs[i];
+        if (input->dataStart >= input->length) {
+            continue;
+        }
+        analyticsTask task = {i, input->dataStart, input->length};
+        if (pushTask(&analytics->worker[i % analytics->threads], &task) < 0) {
+            return -1;
+        }
+        analytics->pending++;
+    }
+
+    /* If not all workers start, the others steal their tasks */
+    double start = monotonicSeconds();
+    int started = 0;
+    while (started < analytics->threads &&
+           pthread_create(&analytics->worker[started].thread, NULL, runWorker, &analytics->worker[started]) == 0) {
+        started++;
+    }
+    for (int i = 0; i < started; i++) {
+        pthread_join(analytics->worker[i].thread, NULL);
+    }
+    analytics->seconds[pass - 1] = monotonicSeconds() - start;
+    return started > 0 ? 0 : -1;
+}
+
+/**
+ * Compares the order of two pieces.
+ */
+static int comparePieces(uint32_t firstInput, size_t firstBegin, uint32_t secondInput, size_t secondBegin) {
+    if (firstInput != secondInput) {
+        return firstInput < secondInput ? -1 : 1;
+    }
+    return firstBegin < secondBegin ? -1 : firstBegin > secondBegin;
+}
+
+/**
+ * Compares two hours by time, then by the order of their pieces.
+ */
+static int compareHours(const void *a, const void *b) {
+    const hourStats *first = a, *second = b;
+    if (first->hour != second->hour) {
+        return first->hour < second->hour ? -1 : 1;
+    }
+    return comparePieces(first->input, first->begin, second->input, second->begin);
+}
+
+/**
+ * Compares two pair results by pair, then by the order of their
+ * pieces.
+ */
+static int comparePairs(const void *a, const void *b) {
+    const pairResult *first = a, *second = b;
+    if (first->pair != second->pair) {
+        return first->pair < second->pair ? -1 : 1;
+    }
+    return comparePieces(first->input, first->begin, second->input, second->begin);
+}
+
+/**
+ * Merges the hours of all pieces into a sorted array, in the order
+ * of the pieces.
+ *
+ * @return 0 on success, -1 if the memory could not be allocated
+ */
+static int mergeHours(logAnalytics *analytics) {
+    size_t capacity = 0;
+    for (int w = 0; w < analytics->threads; w++) {
+        capacity += analytics->worker[w].pieceHourCount;
+    }
+    analytics->hours = malloc((capacity == 0 ? 1 : capacity) * sizeof(hourStats));
+    if (analytics->hours == NULL) {
+        return -1;
+    }
+    size_t count = 0;
+    for (int w = 0; w < analytics->threads; w++) {
+        const analyticsWorker *worker = &analytics->worker[w];
+        memcpy(analytics->hours + count, worker->pieceHours, worker->pieceHourCount * sizeof(hourStats));
+        count += worker->pieceHourCount;
+    }
+    qsort(analytics->hours, count, sizeof(hourStats), compareHours);
+
+    /* Hours seen by several pieces */
+    size_t merged = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (merged > 0 && analytics->hours[merged - 1].hour == analytics->hours[i].hour) {
+            for (int c = 0; c < analytics->channels; c++) {
+                mergeChannel(&analytics->hours[merged - 1].channel[c], &analytics->hours[i].channel[c]);
+            }
+        } else {
+            analytics->hours[merged++] = analytics->hours[i];
+        }
+    }
+    analytics->hourCount = merged;
+
+    for (size_t i = 0; i < merged; i++) {
+        for (int c = 0; c < analytics->channels; c++) {
+            mergeChannel(&analytics->total[c], &analytics->hours[i].channel[c]);
+        }
+    }
+    return 0;
+}
+
+/**
+ * Merges the pairs of all pieces, in the order of the pieces.
+ *
+ * @return 0 on success, -1 if the memory could not be allocated
+ */
+static int mergePairs(logAnalytics *analytics) {
+    size_t count = 0;
+    for (int w = 0; w < analytics->threads; w++) {
+        count += analytics->worker[w].pairCount;
+    }
+    pairResult *pairs = malloc((count == 0 ? 1 : count) * sizeof(pairResult));
+    if (pairs == NULL) {
+        return -1;
+    }
+    count = 0;
+    for (int w = 0; w < analytics->threads; w++) {
+        const analyticsWorker *worker = &analytics->worker[w];
+        memcpy(pairs + count, worker->pairs, worker->pairCount * sizeof(pairResult));
+        count += worker->pairCount;
+    }
+    qsort(pairs, count, sizeof(pairResult), comparePairs);
+    for (size_t i = 0; i < count; i++) {
+        mergePair(&analytics->pairs[pairs[i].pair], &pairs[i].stats);
+    }
+    free(pairs);
+    return 0;
+}
+
+/**
+ * Initializes an analysis without inputs.
+ *
+ * @param analytics analysis to initialize
+ * @param threads number of worker threads, 1 to ANALYTICS_THREADS_MAX
+ * @param chunkSize size of the pieces inputs are split into
+ * @param bins histogram bins per channel, 1 to ANALYTICS_BINS_MAX
+ * @return 0 on success, -1 if the arguments are invalid
+ */
+int openLogAnalytics(logAnalytics *analytics, int threads, size_t chunkSize, int bins) {
+    memset(analytics, 0, sizeof(*analytics));
+    if (threads < 1 || threads > ANALYTICS_THREADS_MAX || chunkSize == 0 || bins < 1 || bins > ANALYTICS_BINS_MAX) {
+        return -1;
+    }
+    analytics->threads = threads;
+    analytics->chunkSize = chunkSize;
+    analytics->bins = bins;
+    for (int w = 0; w < threads; w++) {
+        analyticsWorker *worker = &analytics->worker[w];
+        worker->analytics = analytics;
+        worker->id = w;
+        worker->random = 2463534242u + (uint32_t) w * 2654435761u;
+        pthread_mutex_init(&worker->lock, NULL);
+    }
+    return 0;
+}
+
+/**
+ * Adds an input: a CSV file, a segmented sensor log (the path
+ * prefix without ".cat") or a directory, whose CSV files and logs
+ * are added except the segments of the logs and earlier results.
+ *
+ * @param analytics opened analysis
+ * @param path path of the input
+ * @return number of files added, -1 if the path could not be read
+ */
+long addAnalyticsInput(logAnalytics *analytics, const char *path) {
+    struct stat status;
+    char catalog[LOG_NAME_MAX + 16];
+    snprintf(catalog, sizeof(catalog), "%s.cat", path);
+    if (stat(path, &status) == 0 && S_ISDIR(status.st_mode)) {
+        return addDirectory(analytics, path);
+    }
+    if (stat(catalog, &status) == 0) {
+        return addLog(analytics, path);
+    }
+    return addFile(analytics, path, 0);
+}
+
+/**
+ * Analyzes all inputs and merges the results of the workers.
+ *
+ * @param analytics opened analysis with inputs
+ * @return 0 on success, -1 if the workers could not be started or
+ *         the memory could not be allocated
+ */
+int runLogAnalytics(logAnalytics *analytics) {
+    if (runPass(analytics, 1) < 0) {
+        return -1;
+    }
+    for (int w = 0; w < analytics->threads; w++) {
+        if (analytics->worker[w].failed) {
+            return -1;
+        }
+    }
+    if (mergeHours(analytics) < 0 || mergePairs(analytics) < 0) {
+        return -1;
+    }
+    for (int w = 0; w < analytics->threads; w++) {
+        analyticsWorker *worker = &analytics->worker[w];
+        analytics->rows += worker->rows;
+        analytics->invalidRows += worker->invalidRows;
+        analytics->bytes += worker->bytes;
+        worker->rows = 0;
+        worker->invalidRows = 0;
+        worker->bytes = 0;
+    }
+
+    size_t bins = (size_t) analytics->channels * analytics->bins;
+    analytics->histogram = calloc(bins == 0 ? 1 : bins, sizeof(uint64_t));
+    if (analytics->histogram == NULL) {
+        return -1;
+    }
+    for (int w = 0; w < analytics->threads; w++) {
+        analytics->worker[w].histogram = calloc(bins == 0 ? 1 : bins, sizeof(uint64_t));
+        if (analytics->worker[w].histogram == NULL) {
+            return -1;
+        }
+    }
+    if (runPass(analytics, 2) < 0) {
+        return -1;
+    }
+    for (int w = 0; w < analytics->threads; w++) {
+        for (size_t b = 0; b < bins; b++) {
+            analytics->histogram[b] += analytics->worker[w].histogram[b];
+        }
+    }
+    return 0;
+}
+
+/**
+ * Writes the statistics of a channel as the rest of a row.
+ */
+static void writeStats(FILE *file, const channelStats *stats) {
+    double deviation = stats->count > 1 ? sqrt(stats->m2 / (double) (stats->count - 1)) : 0;
+    fprintf(file, "%" PRIu64 ";%.6g;%.6g;%.6g;%.6g\n", stats->count, stats->min, stats->max, stats->mean, deviation);
+}
+
+/**
+ * Opens a result table and writes its header, if there is one.
+ */
+static FILE *openTable(const char *directory, const char *name, const char *header) {
+    char path[LOG_NAME_MAX + 32];
+    snprintf(path, sizeof(path), "%s/analytics_%s.csv", directory, name);
+    FILE *file = fopen(path, "w");
+    if (file != NULL && header != NULL) {
+        fprintf(file, "%s\n", header);
+    }
+    return file;
+}
+
+/**
+ * Writes the result tables into a directory.
+ *
+ * @param analytics analysis that was run
+ * @param directory existing directory
+ * @return 0 on success, -1 if a table could not be written
+ */
+int writeAnalyticsTables(const logAnalytics *analytics, const char *directory) {
+    int result = 0;
+    char time[32];
+
+    FILE *hourly = openTable(directory, "hourly", "Time;Channel;Count;Min;Max;Mean;Deviation");
+    FILE *daily = openTable(directory, "daily", "Time;Channel;Count;Min;Max;Mean;Deviation");
+    if (hourly != NULL && daily != NULL) {
+        channelStats day[ANALYTICS_CHANNELS_MAX];
+        for (size_t i = 0; i < analytics->hourCount; i++) {
+            const hourStats *hour = &analytics->hours[i];
+            time_t start = (time_t) (hour->hour * 3600);
+            strftime(time, sizeof(time), "%Y-%m-%d %H:00", gmtime(&start));
+            if (i == 0 || hour->hour / 24 != analytics->hours[i - 1].hour / 24) {
+                memset(day, 0, sizeof(day));
+            }
+            for (int c = 0; c < analytics->channels; c++) {
+                if (hour->channel[c].count > 0) {
+                    fprintf(hourly, "%s;%s;", time, analytics->channelName[c]);
+                    writeStats(hourly, &hour->channel[c]);
+                }
+                mergeChannel(&day[c], &hour->channel[c]);
+            }
+            if (i + 1 == analytics->hourCount || analytics->hours[i + 1].hour / 24 != hour->hour / 24) {
+                strftime(time, sizeof(time), "%Y-%m-%d", gmtime(&start));
+                for (int c = 0; c < analytics->channels; c++) {
+                    if (day[c].count > 0) {
+                        fprintf(daily, "%s;%s;", time, analytics->channelName[c]);
+                        writeStats(daily, &day[c]);
+                    }
+                }
+            }
+        }
+    }
+    if (hourly == NULL || fclose(hourly) != 0) {
+        result = -1;
+    }
+    if (daily == NULL || fclose(daily) != 0) {
+        result = -1;
+    }
+
+    /* Correlation matrix, empty where two channels never were in the same row */
+    FILE *correlation = openTable(directory, "correlation", NULL);
+    if (correlation != NULL) {
+        fputs("Channel", correlation);
+        for (int c = 0; c < analytics->channels; c++) {
+            fprintf(correlation, ";%s", analytics->channelName[c]);
+        }
+        fputc('\n', correlation);
+        for (int x = 0; x < analytics->channels; x++) {
+            fputs(analytics->channelName[x], correlation);
+            for (int y = 0; y < analytics->channels; y++) {
+                if (x == y) {
+                    fputs(";1", correlation);
+                    continue;
+                }
+                const pairStats *pair = &analytics->pairs[x < y ? pairIndex(x, y) : pairIndex(y, x)];
+                if (pair->count > 1 && pair->m2X > 0 && pair->m2Y > 0) {
+                    fprintf(correlation, ";%.4f", pair->coMoment / sqrt(pair->m2X * pair->m2Y));
+                } else {
+                    fputc(';', correlation);
+                }
+            }
+            fputc('\n', correlation);
+        }
+    }
+    if (correlation == NULL || fclose(correlation) != 0) {
+        result = -1;
+    }
+
+    FILE *histogram = openTable(directory, "histogram", "Channel;From;To;Count");
+    if (histogram != NULL) {
+        for (int c = 0; c < analytics->channels; c++) {
+            const channelStats *total = &analytics->total[c];
+            double width = (total->max - total->min) / analytics->bins;
+            for (int b = 0; b < analytics->bins; b++) {
+                fprintf(histogram, "%s;%.6g;%.6g;%" PRIu64 "\n", analytics->channelName[c],
+                        total->min + b * width, total->min + (b + 1) * width,
+                        analytics->histogram[c * analytics->bins + b]);
+            }
+        }
+    }
+    if (histogram == NULL || fclose(histogram) != 0) {
+        result = -1;
+    }
+    return result;
+}
+
+/**
+ * Unmaps the inputs and frees the results.
+ *
+ * @param analytics opened analysis
+ */
+void closeLogAnalytics(logAnalytics *analytics) {
+    for (uint32_t i = 0; i < analytics->inputCount; i++) {
+        munmap((void *) analytics->inputs[i].data, analytics->inputs[i].length);
+    }
+    free(analytics->inputs);
+    for (int w = 0; w < analytics->threads; w++) {
+        analyticsWorker *worker = &analytics->worker[w];
+        free(worker->tasks);
+        free(worker->hours);
+        free(worker->pieceHours);
+        free(worker->pairs);
+        free(worker->histogram);
+        pthread_mutex_destroy(&worker->lock);
+    }
+    free(analytics->hours);
+    free(analytics->histogram);
+    memset(analytics, 0, sizeof(*analytics));
+}
+
+int main(int argc, char **argv) {
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = processors < 1 ? 1 : processors > ANALYTICS_THREADS_MAX ? ANALYTICS_THREADS_MAX : (int) processors;
+    size_t chunkSize = ANALYTICS_CHUNK;
+    int bins = ANALYTICS_BINS;
+    const char *directory = ".";
+    int option;
+
+    while ((option = getopt(argc, argv, "j:c:b:o:")) != -1) {
+        switch (option) {
+            case 'j':
+                threads = atoi(optarg);
+                break;
+            case 'c':
+                chunkSize = (size_t) atol(optarg) * 1024;
+                break;
+            case 'b':
+                bins = atoi(optarg);
+                break;
+            case 'o':
+                directory = optarg;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-j threads] [-c chunk KiB] [-b bins] [-o directory] input...\n", argv[0]);
+                return 1;
+        }
+    }
+    if (optind == argc) {
+        fprintf(stderr, "usage: %s [-j threads] [-c chunk KiB] [-b bins] [-o directory] input...\n", argv[0]);
+        return 1;
+    }
+
+    static logAnalytics analytics;
+    if (openLogAnalytics(&analytics, threads, chunkSize, bins) < 0) {
+        fprintf(stderr, "invalid number of threads, chunk size or number of bins\n");
+        return 1;
+    }
+    for (int i = optind; i < argc; i++) {
+        if (addAnalyticsInput(&analytics, argv[i]) < 0) {
+            fprintf(stderr, "%s: %s\n", argv[i], strerror(errno));
+        }
+    }
+
+    if (runLogAnalytics(&analytics) < 0) {
+        perror("analytics");
+        closeLogAnalytics(&analytics);
+        return 1;
+    }
+    mkdir(directory, 0755);
+    int result = writeAnalyticsTables(&analytics, directory);
+    if (result < 0) {
+        perror(directory);
+    }
+
+    uint64_t chunks = 0, steals = 0;
+    for (int w = 0; w < analytics.threads; w++) {
+        chunks += analytics.worker[w].chunks;
+        steals += analytics.worker[w].steals;
+    }
+    printf("%" PRIu32 " files, %i channels, %" PRIu64 " rows (%" PRIu64 " without time), %zu hours\n",
+           analytics.inputCount, analytics.channels, analytics.rows, analytics.invalidRows, analytics.hourCount);
+    printf("%.1f MiB, statistics in %.3f s (%.1f MiB/s), histograms in %.3f s, %i threads, %" PRIu64
+           " chunks, %" PRIu64 " stolen\n", analytics.bytes / 1048576.0, analytics.seconds[0],
+           analytics.bytes / 1048576.0 / analytics.seconds[0], analytics.seconds[1], analytics.threads, chunks, steals);
+    closeLogAnalytics(&analytics);
+    return result < 0 ? 1 : 0;
+}
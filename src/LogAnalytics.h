@@ -0,0 +1,254 @@
+/**
+ * <Program>
+ * LogAnalytics.h
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ * Header file for the offline analysis of sensor logs. The inputs
+ * are CSV files as written by the Python scripts (e.g.
+ * airout_09.02.2018.csv) and segmented sensor logs as written by
+ * the collector (see SensorLog.h), or directories holding them.
+ * The result is a set of small CSV tables:
+ *
+ *      analytics_hourly.csv       count, min, max, mean and standard
+ *                                 deviation of every channel per hour
+ *      analytics_daily.csv        the same per day (UTC)
+ *      analytics_correlation.csv  Pearson correlation of every pair
+ *                                 of channels found in the same rows
+ *      analytics_histogram.csv    histogram of every channel between
+ *                                 its minimum and maximum
+ *
+ * Every input is mapped into memory and analyzed as one task. A
+ * task longer than the chunk size is split in half: the second
+ * half is pushed to the deque of the worker and the first half
+ * analyzed, until the rest fits into a chunk. A worker takes
+ * tasks from the bottom of its own deque and, when it is empty,
+ * steals from the top of the deque of another worker, i. e. the
+ * largest pieces, so all workers stay busy without a central
+ * queue. A row belongs to the chunk its first byte is in.
+ *
+ * Every worker keeps the statistics of each piece it analyzed, they
+ * are merged when all tasks are done. Mean and variance are merged
+ * with the pairwise formulas of Chan et al. Floating point addition
+ * is not associative, so the pieces are merged in the order of the
+ * inputs and their offsets, not in the order the workers happened
+ * to take them: the pieces only depend on the chunk size, so the
+ * result is the same for any number of workers. Another chunk size
+ * may change the last digits. The histograms need the range of
+ * every channel and are filled by a second pass over the mapped
+ * inputs.
+ *
+ * The columns of an input are taken from its header, the last line
+ * before the first line starting with a number, so the "Column1;"
+ * line Excel puts above the header is skipped. Every input needs
+ * a Time column in seconds since epoch. The first scripts wrote
+ * the seconds since midnight instead; times below
+ * ANALYTICS_RELATIVE_TIME are taken as such and the date is taken
+ * from the file name (dd.mm.yyyy).
+ */
+
+#ifndef SRC_LOGANALYTICS_H
+#define SRC_LOGANALYTICS_H
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdlib.h>
+
+#define ANALYTICS_CHANNELS_MAX  16
+#define ANALYTICS_PAIRS         (ANALYTICS_CHANNELS_MAX * (ANALYTICS_CHANNELS_MAX - 1) / 2)
+#define ANALYTICS_COLUMNS_MAX   32
+#define ANALYTICS_NAME_MAX      32
+#define ANALYTICS_THREADS_MAX   64
+#define ANALYTICS_CHUNK         (1024 * 1024)  /* default size of the pieces tasks are split into */
+#define ANALYTICS_BINS          32
+#define ANALYTICS_BINS_MAX      1024
+#define ANALYTICS_DEQUE         64             /* initial capacity of a deque */
+#define ANALYTICS_RELATIVE_TIME 100000000      /* smaller times are seconds since midnight */
+#define ANALYTICS_NO_CHANNEL    -1
+
+/* Used to hold the statistics of a channel */
+typedef struct {
+    uint64_t count;
+    double min;
+    double max;
+    double mean;
+    double m2;              /* sum of the squared differences from the mean */
+} channelStats;
+
+/* Used to hold the statistics of a pair of channels */
+typedef struct {
+    uint64_t count;
+    double meanX;
+    double meanY;
+    double m2X;
+    double m2Y;
+    double coMoment;        /* sum of the products of the differences from the means */
+} pairStats;
+
+/* Used to hold the statistics of all channels within an hour */
+typedef struct {
+    int64_t hour;           /* hours since epoch, INT64_MIN if the slot is empty */
+    uint32_t input;         /* input and offset of the piece the statistics are from */
+    size_t begin;
+    channelStats channel[ANALYTICS_CHANNELS_MAX];
+} hourStats;
+
+/* Used to hold the statistics of a pair within a piece until the pieces are merged in order */
+typedef struct {
+    int pair;
+    uint32_t input;         /* input and offset of the piece, the order of the merge */
+    size_t begin;
+    pairStats stats;
+} pairResult;
+
+/*
+ * Used to sum up the pairs within a chunk. The values are shifted
+ * by the first value of the channel in the chunk, so the sums of
+ * squares do not lose the variance to cancellation.
+ */
+typedef struct {
+    double shift[ANALYTICS_CHANNELS_MAX];
+    uint8_t shifted[ANALYTICS_CHANNELS_MAX];
+    uint64_t count[ANALYTICS_PAIRS];
+    double sumX[ANALYTICS_PAIRS];
+    double sumY[ANALYTICS_PAIRS];
+    double sumXX[ANALYTICS_PAIRS];
+    double sumYY[ANALYTICS_PAIRS];
+    double sumXY[ANALYTICS_PAIRS];
+} pairSums;
+
+/* Used to hold a mapped input file */
+typedef struct {
+    char path[512];
+    const char *data;
+    size_t length;          /* bytes of rows, a segment may be longer on disk */
+    size_t dataStart;       /* offset of the first row after the header */
+    int columns;
+    int channel[ANALYTICS_COLUMNS_MAX]; /* channel of a column, ANALYTICS_NO_CHANNEL if none */
+    int timeColumn;
+    int64_t timeBase;       /* added to relative times, midnight of the date in the file name */
+} analyticsInput;
+
+/* A piece of an input to analyze */
+typedef struct {
+    uint32_t input;
+    size_t begin;
+    size_t end;
+} analyticsTask;
+
+struct logAnalytics;
+
+/* Used to hold a worker thread, its deque and its statistics */
+typedef struct {
+    struct logAnalytics *analytics;
+    int id;
+    pthread_t thread;
+    uint32_t random;
+
+    pthread_mutex_t lock;   /* protects the deque */
+    analyticsTask *tasks;
+    size_t capacity;
+    size_t top;             /* thieves take from here */
+    size_t bottom;          /* the owner pushes and pops here */
+
+    hourStats *hours;       /* open addressing by hour, the hours of the current piece */
+    size_t hourCapacity;
+    size_t hourCount;
+    hourStats *lastHour;
+    hourStats *pieceHours;  /* hours of the pieces done */
+    size_t pieceHourCount;
+    size_t pieceHourCapacity;
+    pairResult *pairs;      /* pairs of the pieces done */
+    size_t pairCount;
+    size_t pairCapacity;
+    int failed;             /* results of a piece were lost, no memory */
+    pairSums sums;
+    uint64_t *histogram;    /* channels * bins */
+
+    uint64_t rows;
+    uint64_t invalidRows;   /* rows without a time */
+    uint64_t bytes;
+    uint64_t chunks;
+    uint64_t steals;
+} analyticsWorker;
+
+/* Used to hold an analysis */
+typedef struct logAnalytics {
+    int threads;
+    size_t chunkSize;
+    int bins;
+
+    analyticsInput *inputs;
+    uint32_t inputCount;
+    uint32_t inputCapacity;
+
+    int channels;
+    char channelName[ANALYTICS_CHANNELS_MAX][ANALYTICS_NAME_MAX];
+
+    int pass;               /* 1 for the statistics, 2 for the histograms */
+    uint64_t pending;       /* tasks not finished yet */
+    analyticsWorker worker[ANALYTICS_THREADS_MAX];
+
+    /* Merged results */
+    hourStats *hours;       /* sorted by hour */
+    size_t hourCount;
+    channelStats total[ANALYTICS_CHANNELS_MAX];
+    pairStats pairs[ANALYTICS_PAIRS];
+    uint64_t *histogram;
+    uint64_t rows;
+    uint64_t invalidRows;
+    uint64_t bytes;
+    double seconds[2];      /* duration of the passes */
+} logAnalytics;
+
+/* METHODS */
+
+/**
+ * Initializes an analysis without inputs.
+ *
+ * @param analytics analysis to initialize
+ * @param threads number of worker threads, 1 to ANALYTICS_THREADS_MAX
+ * @param chunkSize size of the pieces inputs are split into
+ * @param bins histogram bins per channel, 1 to ANALYTICS_BINS_MAX
+ * @return 0 on success, -1 if the arguments are invalid
+ */
+int openLogAnalytics(logAnalytics *analytics, int threads, size_t chunkSize, int bins);
+/**
+ * Adds an input: a CSV file, a segmented sensor log (the path
+ * prefix without ".cat") or a directory, whose CSV files and logs
+ * are added except the segments of the logs and earlier results.
+ *
+ * @param analytics opened analysis
+ * @param path path of the input
+ * @return number of files added, -1 if the path could not be read
+ */
+long addAnalyticsInput(logAnalytics *analytics, const char *path);
+/**
+ * Analyzes all inputs and merges the results of the workers.
+ *
+ * @param analytics opened analysis with inputs
+ * @return 0 on success, -1 if the workers could not be started or
+ *         the memory could not be allocated
+ */
+int runLogAnalytics(logAnalytics *analytics);
+/**
+ * Writes the result tables into a directory.
+ *
+ * @param analytics analysis that was run
+ * @param directory existing directory
+ * @return 0 on success, -1 if a table could not be written
+ */
+int writeAnalyticsTables(const logAnalytics *analytics, const char *directory);
+/**
+ * Unmaps the inputs and frees the results.
+ *
+ * @param analytics opened analysis
+ */
+void closeLogAnalytics(logAnalytics *analytics);
+
+#endif //SRC_LOGANALYTICS_H
@@ -0,0 +1,321 @@
+/**
+ * <Program>
+ * OutlierFilter.c
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ *  Hampel identifier over a rolling window kept in an indexable
+ * skip list. Every link of the list knows how many values it skips,
+ * so the value at a position of the sorted window is found in
+ * O(log w) like a value itself. Node 0 is the head, node 1 the tail
+ * with an infinite value, the others hold the values of the window
+ * and are reused, nothing is allocated per value.
+ *  The MAD is the median of the distances to the median. Left of
+ * the median the distances grow from right to left, right of it
+ * from left to right, so both sides are sorted sequences and their
+ * k-th smallest element is found by a binary search over how many
+ * of them come from the left side.
+ *
+ * <Sources>
+ * Accessed on 18.10.2026 - Efficient Running Median using an Indexable Skiplist (R. Hettinger):
+ *      https://code.activestate.com/recipes/576930/
+ * Accessed on 18.10.2026 - Hampel filter (Pearson et al., Generalized Hampel Filters):
+ *      https://asp-eurasipjournals.springeropen.com/articles/10.1186/s13634-016-0383-6
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "OutlierFilter.h"
+
+#define HEAD 0
+#define TAIL 1
+
+/**
+ * Number of levels of a new node, every level half as likely as
+ * the one below (xorshift32).
+ */
+static uint8_t randomLevels(outlierFilter *filter) {
+    uint32_t x = filter->random;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    filter->random = x;
+    return (uint8_t) (__builtin_ctz(x | 1u << (OUTLIER_LEVELS - 1)) + 1);
+}
+
+/**
+ * Inserts a value into the skip list, after all equal values.
+ */
+static void insertValue(outlierFilter *filter, double value) {
+    outlierNode *nodes = filter->nodes;
+    uint16_t chain[OUTLIER_LEVELS];
+    uint16_t steps[OUTLIER_LEVELS];
+    uint16_t node = HEAD;
+    for (int level = OUTLIER_LEVELS - 1; level >= 0; level--) {
+        steps[level] = 0;
+        while (nodes[nodes[node].next[level]].value <= value) {
+            steps[level] += nodes[node].width[level];
+            node = nodes[node].next[level];
+        }
+        chain[level] = node;
+    }
+
+    uint16_t inserted = filter->freeNodes;
+    outlierNode *new = &nodes[inserted];
+    filter->freeNodes = new->next[0];
+    new->value = value;
+    new->levels = randomLevels(filter);
+
+    uint16_t skipped = 0;
+    for (int level = 0; level < new->levels; level++) {
+        outlierNode *previous = &nodes[chain[level]];
+        new->next[level] = previous->next[level];
+        previous->next[level] = inserted;
+        new->width[level] = (uint16_t) (previous->width[level] - skipped);
+        previous->width[level] = (uint16_t) (skipped + 1);
+        skipped += steps[level];
+    }
+    for (int level = new->levels; level < OUTLIER_LEVELS; level++) {
+        nodes[chain[level]].width[level]++;
+    }
+}
+
+/**
+ * Removes the first node holding the value from the skip list.
+ */
+static void removeValue(outlierFilter *filter, double value) {
+    outlierNode *nodes = filter->nodes;
+    uint16_t chain[OUTLIER_LEVELS];
+    uint16_t node = HEAD;
+    for (int level = OUTLIER_LEVELS - 1; level >= 0; level--) {
+        while (nodes[nodes[node].next[level]].value < value) {
+            node = nodes[node].next[level];
+        }
+        chain[level] = node;
+    }
+
+    uint16_t removed = nodes[chain[0]].next[0];
+    for (int level = 0; level < nodes[removed].levels; level++) {
+        outlierNode *previous = &nodes[chain[level]];
+        previous->width[level] = (uint16_t) (previous->width[level] + nodes[removed].width[level] - 1);
+        previous->next[level] = nodes[removed].next[level];
+    }
+    for (int level = nodes[removed].levels; level < OUTLIER_LEVELS; level++) {
+        nodes[chain[level]].width[level]--;
+    }
+    nodes[removed].next[0] = filter->freeNodes;
+    filter->freeNodes = removed;
+}
+
+/**
+ * Returns the value at a position of the sorted window.
+ */
+static double valueAt(const outlierFilter *filter, int position) {
+    const outlierNode *nodes = filter->nodes;
+    uint16_t node = HEAD;
+    int remaining = position + 1;
+    for (int level = OUTLIER_LEVELS - 1; level >= 0; level--) {
+        while (nodes[node].width[level] <= remaining) {
+            remaining -= nodes[node].width[level];
+            node = nodes[node].next[level];
+        }
+    }
+    return nodes[node].value;
+}
+
+/**
+ * Distance of the i-th value left of the split from the median,
+ * growing with i.
+ */
+static double leftDistance(const outlierFilter *filter, int split, double median, int i) {
+    return median - valueAt(filter, split - 1 - i);
+}
+
+/**
+ * Distance of the i-th value right of the split from the median,
+ * growing with i.
+ */
+static double rightDistance(const outlierFilter *filter, int split, double median, int i) {
+    return valueAt(filter, split + i) - median;
+}
+
+/**
+ * Returns the k-th smallest distance from the median (k from 0).
+ */
+static double distanceAt(const outlierFilter *filter, int split, double median, int k) {
+    int left = split;
+    int right = filter->count - split;
+    /* Smallest number of left distances among the k + 1 smallest */
+    int low = k + 1 - right > 0 ? k + 1 - right : 0;
+    int high = k + 1 < left ? k + 1 : left;
+    while (low < high) {
+        int i = (low + high) / 2;
+        int j = k + 1 - i;
+        if (rightDistance(filter, split, median, j - 1) > leftDistance(filter, split, median, i)) {
+            low = i + 1;
+        } else {
+            high = i;
+        }
+    }
+    int j = k + 1 - low;
+    double distance = -INFINITY;
+    if (low > 0) {
+        distance = leftDistance(filter, split, median, low - 1);
+    }
+    if (j > 0 && rightDistance(filter, split, median, j - 1) > distance) {
+        distance = rightDistance(filter, split, median, j - 1);
+    }
+    return distance;
+}
+
+/**
+ * Allocates the window of a filter.
+ *
+ * @param filter filter to initialize
+ * @param window number of values the median is taken of, at least
+ *        3 and at most OUTLIER_WINDOW_MAX
+ * @param threshold scales from the median a value has to be to be
+ *        an outlier, 3 is the usual choice
+ * @param minScale smallest scale, i. e. the resolution of the channel
+ * @return 0 on success, -1 if the window is invalid or the memory
+ *         could not be allocated
+ */
+int openOutlierFilter(outlierFilter *filter, int window, double threshold, double minScale) {
+    memset(filter, 0, sizeof(*filter));
+    if (window < 3 || window > OUTLIER_WINDOW_MAX) {
+        return -1;
+    }
+    filter->window = window;
+    filter->threshold = threshold;
+    filter->minScale = minScale;
+    filter->random = 2463534242u;
+    filter->history = malloc((size_t) window * sizeof(double));
+    filter->nodes = malloc((size_t) (window + 2) * sizeof(outlierNode));
+    if (filter->history == NULL || filter->nodes == NULL) {
+        closeOutlierFilter(filter);
+        return -1;
+    }
+    resetOutlierFilter(filter);
+    return 0;
+}
+
+/**
+ * Tests a value against the window and adds it to the window.
+ * Values are only tested once the window is half full.
+ *
+ * @param filter opened filter
+ * @param value value to test
+ * @param median receives the median of the window before the value
+ *        was added, the value itself while the window is too short
+ * @return 1 if the value is an outlier, 0 otherwise
+ */
+int filterOutlier(outlierFilter *filter, double value, double *median) {
+    struct timespec start;
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    int outlier = 0;
+    *median = value;
+    if (isnan(value)) {
+        return 0;
+    }
+    if (filter->count > filter->window / 2) {
+        double center = rollingMedian(filter);
+        double scale = OUTLIER_MAD_SCALE * rollingMAD(filter);
+        if (scale < filter->minScale) {
+            scale = filter->minScale;
+        }
+        outlier = fabs(value - center) > filter->threshold * scale;
+        *median = center;
+    }
+
+    if (filter->count == filter->window) {
+        removeValue(filter, filter->history[filter->oldest]);
+        filter->history[filter->oldest] = value;
+        filter->oldest = (filter->oldest + 1) % filter->window;
+    } else {
+        filter->history[(filter->oldest + filter->count) % filter->window] = value;
+        filter->count++;
+    }
+    insertValue(filter, value);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    uint64_t ns = (uint64_t) ((end.tv_sec - start.tv_sec) * 1000000000L + end.tv_nsec - start.tv_nsec);
+    filter->samples++;
+    filter->outliers += outlier;
+    filter->totalNs += ns;
+    if (ns > filter->maxNs) {
+        filter->maxNs = ns;
+    }
+    return outlier;
+}
+
+/**
+ * Returns the median of the window.
+ *
+ * @param filter opened filter with at least one value
+ * @return median
+ */
+double rollingMedian(const outlierFilter *filter) {
+    int middle = filter->count / 2;
+    if (filter->count % 2 == 1) {
+        return valueAt(filter, middle);
+    }
+    return (valueAt(filter, middle - 1) + valueAt(filter, middle)) / 2;
+}
+
+/**
+ * Returns the median absolute deviation of the window.
+ *
+ * @param filter opened filter with at least one value
+ * @return median absolute deviation from the median
+ */
+double rollingMAD(const outlierFilter *filter) {
+    double median = rollingMedian(filter);
+    int middle = filter->count / 2;
+    if (filter->count % 2 == 1) {
+        return distanceAt(filter, middle, median, middle);
+    }
+    return (distanceAt(filter, middle, median, middle - 1) + distanceAt(filter, middle, median, middle)) / 2;
+}
+
+/**
+ * Empties the window, the settings and statistics are kept.
+ *
+ * @param filter opened filter
+ */
+void resetOutlierFilter(outlierFilter *filter) {
+    outlierNode *nodes = filter->nodes;
+    filter->count = 0;
+    filter->oldest = 0;
+    for (int level = 0; level < OUTLIER_LEVELS; level++) {
+        nodes[HEAD].next[level] = TAIL;
+        nodes[HEAD].width[level] = 1;
+    }
+    nodes[HEAD].levels = OUTLIER_LEVELS;
+    nodes[TAIL].value = INFINITY;
+    nodes[TAIL].levels = 0;
+    for (int i = 2; i < filter->window + 2; i++) {
+        nodes[i].next[0] = (uint16_t) (i + 1);
+    }
+    filter->freeNodes = 2;
+}
+
+/**
+ * Frees the window of a filter.
+ *
+ * @param filter opened filter
+ */
+void closeOutlierFilter(outlierFilter *filter) {
+    free(filter->history);
+    free(filter->nodes);
+    filter->history = NULL;
+    filter->nodes = NULL;
+}
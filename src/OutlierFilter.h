@@ -0,0 +1,120 @@
+/**
+ * <Program>
+ * OutlierFilter.h
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ * Header file for the outlier filter of a single channel, a
+ * Hampel identifier over a rolling window: a value is an outlier
+ * if it is further from the median of the window than threshold
+ * times the scale, the median absolute deviation (MAD) times
+ * OUTLIER_MAD_SCALE, but at least minScale (the resolution of the
+ * channel, so a constant signal does not make every change an
+ * outlier).
+ *
+ * The window holds the values before the one that is tested, so
+ * the filter does not delay the samples. Every value enters the
+ * window, outlier or not, so a real step of the signal is accepted
+ * once it fills half of the window.
+ *
+ * The window is kept sorted in an indexable skip list: a value is
+ * added and the oldest one removed in O(log w), the median is found
+ * in O(log w) and the MAD in O(log^2 w). All memory is allocated
+ * when the filter is opened.
+ */
+
+#ifndef SRC_OUTLIERFILTER_H
+#define SRC_OUTLIERFILTER_H
+
+#include <inttypes.h>
+
+#define OUTLIER_WINDOW_MAX 255
+#define OUTLIER_LEVELS     9       /* levels of the skip list, log2(OUTLIER_WINDOW_MAX + 1) + 1 */
+#define OUTLIER_MAD_SCALE  1.4826  /* MAD to standard deviation of a normal distribution */
+
+/* Used to hold a value of the skip list */
+typedef struct {
+    double value;
+    uint16_t next[OUTLIER_LEVELS];   /* node index */
+    uint16_t width[OUTLIER_LEVELS];  /* values skipped by next */
+    uint8_t levels;
+} outlierNode;
+
+/* Used to hold the filter of a single channel */
+typedef struct {
+    int window;
+    double threshold;
+    double minScale;
+
+    int count;              /* values in the window */
+    int oldest;             /* position of the oldest value in history */
+    double *history;        /* values of the window in the order they came in */
+    outlierNode *nodes;     /* head, tail and one node per value of the window */
+    uint16_t freeNodes;     /* first unused node, linked through next[0] */
+    uint32_t random;
+
+    uint64_t samples;
+    uint64_t outliers;
+    uint64_t totalNs;       /* time spent filtering */
+    uint64_t maxNs;
+} outlierFilter;
+
+/* METHODS */
+
+/**
+ * Allocates the window of a filter.
+ *
+ * @param filter filter to initialize
+ * @param window number of values the median is taken of, at least
+ *        3 and at most OUTLIER_WINDOW_MAX
+ * @param threshold scales from the median a value has to be to be
+ *        an outlier, 3 is the usual choice
+ * @param minScale smallest scale, i. e. the resolution of the channel
+ * @return 0 on success, -1 if the window is invalid or the memory
+ *         could not be allocated
+ */
+int openOutlierFilter(outlierFilter *filter, int window, double threshold, double minScale);
+/**
+ * Tests a value against the window and adds it to the window.
+ * Values are only tested once the window is half full.
+ *
+ * @param filter opened filter
+ * @param value value to test
+ * @param median receives the median of the window before the value
+ *        was added, the value itself while the window is too short
+ * @return 1 if the value is an outlier, 0 otherwise
+ */
+int filterOutlier(outlierFilter *filter, double value, double *median);
+/**
+ * Returns the median of the window.
+ *
+ * @param filter opened filter with at least one value
+ * @return median
+ */
+double rollingMedian(const outlierFilter *filter);
+/**
+ * Returns the median absolute deviation of the window.
+ *
+ * @param filter opened filter with at least one value
+ * @return median absolute deviation from the median
+ */
+double rollingMAD(const outlierFilter *filter);
+/**
+ * Empties the window, the settings and statistics are kept.
+ *
+ * @param filter opened filter
+ */
+void resetOutlierFilter(outlierFilter *filter);
+/**
+ * Frees the window of a filter.
+ *
+ * @param filter opened filter
+ */
+void closeOutlierFilter(outlierFilter *filter);
+
+#endif //SRC_OUTLIERFILTER_H
@@ -0,0 +1,732 @@
+/**
+ * <Program>
+ * Retention.c
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ *  Tiered retention of the sensor logs. Raw rows that left their
+ * window are aggregated per minute, minutes that left theirs per
+ * hour, and the compacted segments are dropped afterwards. The
+ * background thread runs with the idle scheduling class for both
+ * CPU and I/O, so a pass never delays the sampling loop or the
+ * writes of the logs.
+ *  A pass only looks at the leading segments of a tier that lie
+ * completely before the window; the segment a writer appends to
+ * is always the last one in the catalog and never touched. The
+ * bucket still continuing in the first segment that is kept is
+ * left for a later pass.
+ *  Additionally this class holds the methods to communicate
+ * with Python software using the CPython library.
+ *
+ * <Sources>
+ * Accessed on 18.10.2026 - sched(7), SCHED_IDLE:
+ *      https://man7.org/linux/man-pages/man7/sched.7.html
+ * Accessed on 18.10.2026 - ioprio_set(2):
+ *      https://man7.org/linux/man-pages/man2/ioprio_set.2.html
+ * Accesses on 11.01.2018 - Extending Python with C
+ *      https://docs.python.org/2/extending/extending.html
+ */
+
+#ifdef SENSOR_NO_PYTHON
+#define _GNU_SOURCE
+#else
+#include <Python.h>
+#endif
+#include <errno.h>
+#include <poll.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include "Retention.h"
+
+/* Not exported by the C library (see ioprio_set(2)) */
+#define IOPRIO_WHO_PROCESS 1
+#define IOPRIO_CLASS_IDLE  3
+#define IOPRIO_CLASS_SHIFT 13
+
+/* Length of a bucket of the aggregate tiers in s */
+static const int bucketLength[RETENTION_TIERS] = {0, 60, 3600};
+static const char *tierSuffix[RETENTION_TIERS] = {"", ".1m", ".1h"};
+
+/* Used to aggregate the rows of one tier into buckets of the next */
+typedef struct {
+    int columns;
+    int aggregated;       /* the rows are aggregates themselves */
+    int bucket;
+    int64_t from;         /* first bucket not written yet */
+    int64_t current;      /* bucket in progress, INT64_MIN if none */
+    double sum[RETENTION_COLUMNS_MAX];
+    double weight[RETENTION_COLUMNS_MAX];
+    double min[RETENTION_COLUMNS_MAX];
+    double max[RETENTION_COLUMNS_MAX];
+    uint64_t samples;
+    sensorLog *target;
+    retentionStats *stats;
+    int failed;
+} bucketState;
+
+/* Used to pass the rows of one tier on while reading a retained range */
+typedef struct {
+    retainedRowCallback callback;
+    void *context;
+    int bucket;
+    int stopped;
+} tierReader;
+
+/**
+ * Returns the current time of the monotonic clock in microseconds.
+ */
+static int64_t monotonicUs(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/**
+ * Builds the path prefix of a tier.
+ */
+static void tierName(char *name, const char *log, int tier) {
+    snprintf(name, LOG_NAME_MAX, "%s%s", log, tierSuffix[tier]);
+}
+
+/**
+ * Returns the start of the bucket a time falls into.
+ */
+static int64_t bucketStart(int64_t time, int bucket) {
+    int64_t start = time / bucket * bucket;
+    return start > time ? start - bucket : start;
+}
+
+/**
+ * Returns the time of the last row of a log.
+ *
+ * @return 0 on success, -1 if the log has no rows
+ */
+static int lastLogTime(const char *name, int64_t *time) {
+    catalogEntry *catalog;
+    long entries = readSensorLogCatalog(name, &catalog);
+    int result = -1;
+    for (long i = entries - 1; i >= 0; i--) {
+        if (catalog[i].indexEntries > 0) {
+            *time = catalog[i].lastTime;
+            result = 0;
+            break;
+        }
+    }
+    if (entries >= 0) {
+        free(catalog);
+    }
+    return result;
+}
+
+/**
+ * Writes the bucket in progress as one row of the next tier.
+ */
+static void writeBucket(bucketState *state) {
+    char row[LOG_ROW_MAX];
+    size_t length = 0;
+    for (int i = 0; i < state->columns && length < sizeof(row); i++) {
+        if (state->weight[i] > 0) {
+            length += snprintf(row + length, sizeof(row) - length, "%.8g;%.8g;%.8g;",
+                               state->sum[i] / state->weight[i], state->min[i], state->max[i]);
+        } else {
+            length += snprintf(row + length, sizeof(row) - length, ";;;");
+        }
+    }
+    if (length < sizeof(row)) {
+        snprintf(row + length, sizeof(row) - length, "%" PRIu64, state->samples);
+    }
+    if (appendSensorLog(state->target, state->current, row) < 0) {
+        state->failed = 1;
+        return;
+    }
+    state->stats->rowsWritten++;
+}
+
+/**
+ * Adds a row of the source tier to its bucket. Raw rows hold one
+ * value per column, aggregate rows mean, minimum and maximum and
+ * the number of samples, which weighs the mean. Empty or invalid
+ * values are left out.
+ */
+static int aggregateRow(const char *row, size_t length, int64_t time, void *context) {
+    bucketState *state = context;
+    int64_t bucket = bucketStart(time, state->bucket);
+    if (bucket < state->from) {
+        return 0;
+    }
+    if (bucket != state->current) {
+        if (state->current != INT64_MIN) {
+            writeBucket(state);
+        }
+        state->current = bucket;
+        state->samples = 0;
+        for (int i = 0; i < state->columns; i++) {
+            state->sum[i] = 0;
+            state->weight[i] = 0;
+        }
+    }
+    state->stats->rowsRead++;
+
+    char line[LOG_ROW_MAX + 32];
+    if (length >= sizeof(line)) {
+        return 0;
+    }
+    memcpy(line, row, length);
+    line[length] = '\0';
+
+    /* Split into fields, the time is the last one */
+    char *fields[RETENTION_COLUMNS_MAX * 3 + 2];
+    int count = 0;
+    for (char *field = line, *end; count < (int) (sizeof(fields) / sizeof(fields[0])); field = end + 1) {
+        fields[count++] = field;
+        if ((end = strchr(field, ';')) == NULL) {
+            break;
+        }
+        *end = '\0';
+    }
+
+    int wanted = state->aggregated ? state->columns * 3 + 2 : state->columns + 1;
+    if (count != wanted) {
+        return 0;
+    }
+    double weight = 1;
+    if (state->aggregated) {
+        weight = strtod(fields[state->columns * 3], NULL);
+        if (weight <= 0) {
+            return 0;
+        }
+    }
+    state->samples += (uint64_t) weight;
+
+    for (int i = 0; i < state->columns; i++) {
+        const char *text = fields[state->aggregated ? i * 3 : i];
+        char *end;
+        double value = strtod(text, &end);
+        if (end == text) {
+            continue;
+        }
+        double low = value, high = value;
+        if (state->aggregated) {
+            low = strtod(fields[i * 3 + 1], NULL);
+            high = strtod(fields[i * 3 + 2], NULL);
+        }
+        if (state->weight[i] == 0 || low < state->min[i]) {
+            state->min[i] = low;
+        }
+        if (state->weight[i] == 0 || high > state->max[i]) {
+            state->max[i] = high;
+        }
+        state->sum[i] += value * weight;
+        state->weight[i] += weight;
+    }
+    return state->failed;
+}
+
+/**
+ * Compacts the leading segments of a tier that lie before its
+ * window: they are aggregated into the next tier, if there is
+ * one, and dropped.
+ *
+ * @return number of dropped segments, -1 on failure
+ */
+static int compactTier(retentionLog *retention, int tier, int64_t now) {
+    const int64_t windows[RETENTION_TIERS] = {
+            retention->policy.rawWindow, retention->policy.minuteWindow, retention->policy.hourWindow
+    };
+    if (windows[tier] <= 0) {
+        return 0;
+    }
+
+    char name[LOG_NAME_MAX];
+    catalogEntry *catalog;
+    tierName(name, retention->name, tier);
+    long entries = readSensorLogCatalog(name, &catalog);
+    if (entries < 0) {
+        return errno == ENOENT ? 0 : -1;
+    }
+
+    /* Leading segments ending before the window, never the last one */
+    int64_t cutoff = now - windows[tier];
+    int64_t next = INT64_MAX;
+    long eligible = 0;
+    for (long i = 0; i < entries; i++) {
+        if (catalog[i].indexEntries == 0) {
+            continue;
+        }
+        if (i == entries - 1 || catalog[i].lastTime >= cutoff) {
+            next = catalog[i].firstTime;
+            break;
+        }
+        eligible = i + 1;
+    }
+    if (eligible == 0) {
+        free(catalog);
+        return 0;
+    }
+
+    int64_t limit = INT64_MAX;
+    if (tier + 1 < RETENTION_TIERS) {
+        int bucket = bucketLength[tier + 1];
+        sensorLog *target = &retention->aggregates[tier];
+
+        /* Buckets continuing behind the dropped segments are left for later */
+        limit = bucketStart(next < cutoff ? next : cutoff, bucket);
+        bucketState state;
+        memset(&state, 0, sizeof(state));
+        state.columns = retention->columns;
+        state.aggregated = tier != RETENTION_RAW;
+        state.bucket = bucket;
+        state.from = target->lastTime == INT64_MIN ? INT64_MIN : bucketStart(target->lastTime, bucket) + bucket;
+        state.current = INT64_MIN;
+        state.target = target;
+        state.stats = &retention->stats;
+
+        if (state.from < limit &&
+            readSensorLog(name, state.from, limit - 1, aggregateRow, &state) < 0) {
+            state.failed = 1;
+        }
+        if (!state.failed && state.current != INT64_MIN) {
+            writeBucket(&state);
+        }
+        /* The aggregates have to be on disk before their rows are gone */
+        if (state.failed || syncSensorLog(target) < 0) {
+            free(catalog);
+            return -1;
+        }
+    }
+
+    int dropped = 0;
+    for (long i = 0; i < eligible; i++) {
+        if (catalog[i].indexEntries == 0 || catalog[i].lastTime >= limit) {
+            continue;
+        }
+        if (dropSensorLogSegment(name, (uint32_t) i, &retention->stats.bytesFreed) < 0) {
+            free(catalog);
+            return -1;
+        }
+        dropped++;
+    }
+    retention->stats.segmentsDeleted += dropped;
+    free(catalog);
+    return dropped;
+}
+
+/**
+ * Fills in the default policy: raw rows for a week, minutes for
+ * three months, hours forever and a pass every hour.
+ *
+ * @param policy policy to initialize
+ */
+void defaultRetentionPolicy(retentionPolicy *policy) {
+    policy->rawWindow = RETENTION_RAW_WINDOW;
+    policy->minuteWindow = RETENTION_MINUTE_WINDOW;
+    policy->hourWindow = RETENTION_HOUR_WINDOW;
+    policy->interval = RETENTION_INTERVAL;
+}
+
+/**
+ * Opens the aggregate logs of a log for appending. Their header
+ * has a mean, minimum and maximum column for every raw column.
+ *
+ * @param retention retention to initialize
+ * @param name path prefix of the raw log
+ * @param header CSV header of the raw rows, without the time column
+ * @param policy windows of the tiers, NULL for the defaults
+ * @return 0 on success, -1 on failure (errno is set)
+ */
+int openRetention(retentionLog *retention, const char *name, const char *header, const retentionPolicy *policy) {
+    char aggregateHeader[LOG_HEADER_MAX];
+    char columns[LOG_HEADER_MAX];
+    char tier[LOG_NAME_MAX];
+    size_t length = 0;
+
+    if (strlen(name) + 4 >= LOG_NAME_MAX || strlen(header) >= LOG_HEADER_MAX) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    memset(retention, 0, sizeof(retentionLog));
+    strcpy(retention->name, name);
+    retention->stopFd = -1;
+    if (policy != NULL) {
+        retention->policy = *policy;
+    } else {
+        defaultRetentionPolicy(&retention->policy);
+    }
+
+    strcpy(columns, header);
+    char *column = strtok(columns, ";");
+    while (column != NULL && length < sizeof(aggregateHeader)) {
+        if (retention->columns == RETENTION_COLUMNS_MAX) {
+            errno = EINVAL;
+            return -1;
+        }
+        length += snprintf(aggregateHeader + length, sizeof(aggregateHeader) - length, "%s_mean;%s_min;%s_max;",
+                           column, column, column);
+        retention->columns++;
+        column = strtok(NULL, ";");
+    }
+    if (length >= sizeof(aggregateHeader) - 8) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    strcpy(aggregateHeader + length, "Samples");
+
+    for (int i = 0; i < RETENTION_TIERS - 1; i++) {
+        tierName(tier, name, i + 1);
+        if (openSensorLog(&retention->aggregates[i], tier, aggregateHeader, NULL) < 0) {
+            int error = errno;
+            for (int j = 0; j < i; j++) {
+                closeSensorLog(&retention->aggregates[j]);
+            }
+            errno = error;
+            return -1;
+        }
+    }
+    pthread_mutex_init(&retention->lock, NULL);
+    return 0;
+}
+
+/**
+ * Runs one compaction pass over all tiers, from the raw rows to
+ * the hours, so a pass can move rows all the way down.
+ *
+ * @param retention opened retention
+ * @param now current time (seconds since epoch)
+ * @return number of deleted segments, -1 on failure
+ */
+int compactRetention(retentionLog *retention, int64_t now) {
+    int deleted = 0;
+    pthread_mutex_lock(&retention->lock);
+    int64_t start = monotonicUs();
+    for (int tier = 0; tier < RETENTION_TIERS; tier++) {
+        int dropped = compactTier(retention, tier, now);
+        if (dropped < 0) {
+            retention->stats.failures++;
+            deleted = -1;
+            break;
+        }
+        deleted += dropped;
+    }
+    retention->stats.passes++;
+    retention->stats.lastPassUs = monotonicUs() - start;
+    pthread_mutex_unlock(&retention->lock);
+    return deleted;
+}
+
+/**
+ * Runs a pass every interval until the stop event is signalled.
+ */
+static void *retainLog(void *argument) {
+    retentionLog *retention = argument;
+
+    /* Only run when nothing else wants the CPU or the disk */
+    struct sched_param param = {0};
+    pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+    syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, (int) syscall(SYS_gettid), IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT);
+
+    int64_t interval = retention->policy.interval > 0 ? retention->policy.interval : RETENTION_INTERVAL;
+    int timeoutMs = interval > INT32_MAX / 1000 ? INT32_MAX : (int) (interval * 1000);
+    struct pollfd stop = {retention->stopFd, POLLIN, 0};
+    for (;;) {
+        compactRetention(retention, (int64_t) time(NULL));
+        int ready;
+        while ((ready = poll(&stop, 1, timeoutMs)) < 0 && errno == EINTR);
+        if (ready != 0) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Starts a thread with idle CPU and I/O priority running a pass
+ * every policy.interval seconds, the first one right away.
+ *
+ * @param retention opened retention
+ * @return 0 on success, -1 on failure
+ */
+int startRetention(retentionLog *retention) {
+    retention->stopFd = eventfd(0, EFD_CLOEXEC);
+    if (retention->stopFd < 0) {
+        return -1;
+    }
+    if (pthread_create(&retention->thread, NULL, retainLog, retention) != 0) {
+        close(retention->stopFd);
+        retention->stopFd = -1;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Stops the thread, a running pass is finished first, and closes
+ * the aggregate logs.
+ *
+ * @param retention opened retention
+ * @return 0 on success, -1 if the last aggregates could not be written
+ */
+int closeRetention(retentionLog *retention) {
+    int result = 0;
+    if (retention->stopFd >= 0) {
+        uint64_t signal = 1;
+        if (write(retention->stopFd, &signal, sizeof(signal)) == sizeof(signal)) {
+            pthread_join(retention->thread, NULL);
+        }
+        close(retention->stopFd);
+        retention->stopFd = -1;
+    }
+    for (int i = 0; i < RETENTION_TIERS - 1; i++) {
+        if (closeSensorLog(&retention->aggregates[i]) < 0) {
+            result = -1;
+        }
+    }
+    pthread_mutex_destroy(&retention->lock);
+    return result;
+}
+
+/**
+ * Passes a row of a tier on together with the bucket length.
+ */
+static int forwardRow(const char *row, size_t length, int64_t time, void *context) {
+    tierReader *reader = context;
+    reader->stopped = reader->callback(row, length, time, reader->bucket, reader->context) != 0;
+    return reader->stopped;
+}
+
+/**
+ * Reads all rows with start <= time <= end from the finest tier
+ * that still holds them. A tier covers everything up to the end of
+ * its last bucket, the finer tiers are only read behind that.
+ *
+ * @param name path prefix of the raw log
+ * @param start first timestamp of the range
+ * @param end last timestamp of the range
+ * @param callback called for every row
+ * @param context passed to the callback
+ * @return number of rows passed to the callback, -1 on failure
+ */
+long readRetainedLog(const char *name, int64_t start, int64_t end, retainedRowCallback callback, void *context) {
+    char tier[LOG_NAME_MAX];
+    tierReader reader = {callback, context, 0, 0};
+    int64_t covered = INT64_MIN;
+    long rows = 0;
+
+    for (int i = RETENTION_TIERS - 1; i >= 0 && !reader.stopped; i--) {
+        tierName(tier, name, i);
+        int64_t from = start > covered ? start : covered;
+        if (from <= end) {
+            reader.bucket = bucketLength[i];
+            long read = readSensorLog(tier, from, end, forwardRow, &reader);
+            if (read < 0 && errno != ENOENT) {
+                return -1;
+            }
+            rows += read > 0 ? read : 0;
+        }
+
+        int64_t last;
+        if (i > RETENTION_RAW && lastLogTime(tier, &last) == 0 && last + bucketLength[i] > covered) {
+            covered = last + bucketLength[i];
+        }
+    }
+    return rows;
+}
+
+/* Left out when linked into a program without Python */
+#ifndef SENSOR_NO_PYTHON
+
+#define RETENTION_HANDLES_MAX 8
+
+/* Retentions started from Python, the handle is the position in this table */
+static retentionLog retentions[RETENTION_HANDLES_MAX];
+static int retentionUsed[RETENTION_HANDLES_MAX];
+
+/**
+ * Start the tiered retention of a log in the background. The
+ * windows are given in seconds, a window of 0 keeps a tier forever.
+ *
+ * @param self python instance the method is called on
+ * @param args log name, CSV header without the time column and
+ *             optional raw, minute and hour window and the interval
+ *             between two passes
+ * @return handle of the retention, -1 on failure
+ */
+static PyObject *start_retention(PyObject *self, PyObject *args) {
+    const char *name, *header;
+    retentionPolicy policy;
+    PY_LONG_LONG raw = RETENTION_RAW_WINDOW, minutes = RETENTION_MINUTE_WINDOW, hours = RETENTION_HOUR_WINDOW;
+    PY_LONG_LONG interval = RETENTION_INTERVAL;
+    if (!PyArg_ParseTuple(args, "ss|LLLL", &name, &header, &raw, &minutes, &hours, &interval)) {
+        return NULL;
+    }
+    policy.rawWindow = raw;
+    policy.minuteWindow = minutes;
+    policy.hourWindow = hours;
+    policy.interval = interval;
+
+    for (int handle = 0; handle < RETENTION_HANDLES_MAX; handle++) {
+        if (!retentionUsed[handle]) {
+            if (openRetention(&retentions[handle], name, header, &policy) < 0) {
+                printf("retention of %s could not be opened!\n", name);
+                return Py_BuildValue("i", -1);
+            }
+            if (startRetention(&retentions[handle]) < 0) {
+                printf("retention of %s could not be started!\n", name);
+                closeRetention(&retentions[handle]);
+                return Py_BuildValue("i", -1);
+            }
+            retentionUsed[handle] = 1;
+            return Py_BuildValue("i", handle);
+        }
+    }
+    return Py_BuildValue("i", -1);
+}
+
+/**
+ * Run a compaction pass right away, besides the background thread.
+ *
+ * @param self python instance the method is called on
+ * @param args handle of the retention
+ * @return number of deleted segments, -1 on failure
+ */
+static PyObject *compact_log(PyObject *self, PyObject *args) {
+    int handle, result;
+    if (!PyArg_ParseTuple(args, "i", &handle)) {
+        return NULL;
+    }
+    if (handle < 0 || handle >= RETENTION_HANDLES_MAX || !retentionUsed[handle]) {
+        return Py_BuildValue("i", -1);
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    result = compactRetention(&retentions[handle], (int64_t) time(NULL));
+    Py_END_ALLOW_THREADS
+    return Py_BuildValue("i", result);
+}
+
+/**
+ * Stop the retention of a log, a running pass is finished first.
+ *
+ * @param self python instance the method is called on
+ * @param args handle of the retention
+ * @return 0 on success, -1 on failure
+ */
+static PyObject *stop_retention(PyObject *self, PyObject *args) {
+    int handle, result;
+    if (!PyArg_ParseTuple(args, "i", &handle)) {
+        return NULL;
+    }
+    if (handle < 0 || handle >= RETENTION_HANDLES_MAX || !retentionUsed[handle]) {
+        return Py_BuildValue("i", -1);
+    }
+
+    retentionUsed[handle] = 0;
+    Py_BEGIN_ALLOW_THREADS
+    result = closeRetention(&retentions[handle]);
+    Py_END_ALLOW_THREADS
+    return Py_BuildValue("i", result);
+}
+
+/**
+ * Get the statistics of the compaction of a log.
+ *
+ * @param self python instance the method is called on
+ * @param args handle of the retention
+ * @return dictionary with the counters and the duration of the last pass
+ */
+static PyObject *retention_stats(PyObject *self, PyObject *args) {
+    int handle;
+    if (!PyArg_ParseTuple(args, "i", &handle)) {
+        return NULL;
+    }
+    if (handle < 0 || handle >= RETENTION_HANDLES_MAX || !retentionUsed[handle]) {
+        Py_RETURN_NONE;
+    }
+
+    retentionLog *retention = &retentions[handle];
+    pthread_mutex_lock(&retention->lock);
+    retentionStats stats = retention->stats;
+    pthread_mutex_unlock(&retention->lock);
+    return Py_BuildValue("{s:K,s:K,s:K,s:K,s:K,s:K,s:d}",
+                         "passes", (unsigned PY_LONG_LONG) stats.passes,
+                         "rows_read", (unsigned PY_LONG_LONG) stats.rowsRead,
+                         "rows_written", (unsigned PY_LONG_LONG) stats.rowsWritten,
+                         "segments_deleted", (unsigned PY_LONG_LONG) stats.segmentsDeleted,
+                         "bytes_freed", (unsigned PY_LONG_LONG) stats.bytesFreed,
+                         "failures", (unsigned PY_LONG_LONG) stats.failures,
+                         "last_pass_ms", stats.lastPassUs / 1000.0);
+}
+
+/**
+ * Collects the rows of a retained range into a python list.
+ */
+static int collectRetainedRow(const char *row, size_t length, int64_t time, int bucket, void *context) {
+    PyObject *entry = Py_BuildValue("(Lis#)", (PY_LONG_LONG) time, bucket, row, (Py_ssize_t) length);
+    if (entry == NULL) {
+        return -1;
+    }
+    int result = PyList_Append((PyObject *) context, entry);
+    Py_DECREF(entry);
+    return result;
+}
+
+/**
+ * Read all rows of a log between two timestamps (inclusive), from
+ * the finest tier still holding them.
+ *
+ * @param self python instance the method is called on
+ * @param args log name, start and end time
+ * @return list of (time, bucket length in s or 0 for raw rows, CSV row) tuples
+ */
+static PyObject *read_retained(PyObject *self, PyObject *args) {
+    const char *name;
+    PY_LONG_LONG start, end;
+    if (!PyArg_ParseTuple(args, "sLL", &name, &start, &end)) {
+        return NULL;
+    }
+
+    PyObject *rows = PyList_New(0);
+    if (rows == NULL) {
+        return NULL;
+    }
+    if (readRetainedLog(name, start, end, collectRetainedRow, rows) < 0 || PyErr_Occurred()) {
+        Py_DECREF(rows);
+        if (!PyErr_Occurred()) {
+            PyErr_SetFromErrno(PyExc_IOError);
+        }
+        return NULL;
+    }
+    return rows;
+}
+
+/**
+ * Method definitions that are visible in Python afterwards
+ */
+static PyMethodDef retention_methods[] = {
+        {"start_retention", start_retention, METH_VARARGS},
+        {"compact_log",     compact_log,     METH_VARARGS},
+        {"stop_retention",  stop_retention,  METH_VARARGS},
+        {"retention_stats", retention_stats, METH_VARARGS},
+        {"read_retained",   read_retained,   METH_VARARGS},
+        {NULL, NULL, 0, NULL} /* Sentinel */
+};
+
+/**
+ * Initializes the module and methods that can be called
+ * from python.
+ */
+void initretention(void) {
+    PyImport_AddModule("retention");
+    Py_InitModule("retention", retention_methods);
+}
+
+#endif
@@ -0,0 +1,155 @@
+/**
+ * <Program>
+ * Retention.h
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ * Header file for the tiered retention of sensor logs. A log keeps
+ * its raw rows for a recent window, 1-minute aggregates for a
+ * medium window and hourly aggregates beyond that, so a box runs
+ * for years within a fixed storage budget.
+ *
+ * The aggregates are sensor logs of their own next to the raw log,
+ * for a log called "envout":
+ *      envout.*        raw rows
+ *      envout.1m.*     mean, minimum and maximum of every column per minute
+ *      envout.1h.*     the same per hour, built from the minutes
+ *
+ * A compaction pass aggregates the whole segments of a tier that
+ * left its window into the next tier, writes the aggregates to
+ * disk and only then deletes the segments: they are marked in the
+ * catalog and their files are removed. A bucket is only written
+ * once all of its rows are in deleted segments, the last bucket
+ * of the next tier tells where to continue, so a pass interrupted
+ * at any point neither loses nor duplicates a bucket.
+ *
+ * Aggregate rows look like this, one triple per raw column:
+ *      Temperature_mean;Temperature_min;Temperature_max;...;Samples;Time
+ *
+ * Only whole segments are deleted, so every tier takes up to one
+ * segment more than its window.
+ */
+
+#ifndef SRC_RETENTION_H
+#define SRC_RETENTION_H
+
+#include <inttypes.h>
+#include <pthread.h>
+#include "SensorLog.h"
+
+/* --- Tiers --- */
+#define RETENTION_RAW     0
+#define RETENTION_MINUTES 1
+#define RETENTION_HOURS   2
+#define RETENTION_TIERS   3
+
+#define RETENTION_COLUMNS_MAX 8   /* aggregate rows have to fit into LOG_ROW_MAX */
+
+/* --- Default policy (s) --- */
+#define RETENTION_RAW_WINDOW    (7 * 24 * 3600)   /* raw rows for a week */
+#define RETENTION_MINUTE_WINDOW (90 * 24 * 3600)  /* minutes for three months */
+#define RETENTION_HOUR_WINDOW   0                 /* hours forever */
+#define RETENTION_INTERVAL      3600              /* one pass per hour */
+
+/* Used to configure how long every tier is kept, in seconds */
+typedef struct {
+    int64_t rawWindow;
+    int64_t minuteWindow;
+    int64_t hourWindow;   /* 0 keeps the hours forever */
+    int64_t interval;     /* time between two passes of the background thread */
+} retentionPolicy;
+
+/* Used to hold the statistics of the compaction */
+typedef struct {
+    uint64_t passes;
+    uint64_t rowsRead;
+    uint64_t rowsWritten;
+    uint64_t segmentsDeleted;
+    uint64_t bytesFreed;
+    uint64_t failures;
+    int64_t lastPassUs;   /* duration of the last pass */
+} retentionStats;
+
+/* Used to hold a log under retention */
+typedef struct {
+    char name[LOG_NAME_MAX];
+    int columns;             /* columns of a raw row without the time */
+    retentionPolicy policy;
+    sensorLog aggregates[RETENTION_TIERS - 1]; /* minutes and hours, the raw log is written by its owner */
+    retentionStats stats;
+    pthread_mutex_t lock;    /* held during a pass */
+
+    pthread_t thread;
+    int stopFd;              /* eventfd waking the thread to stop, -1 if not started */
+} retentionLog;
+
+/**
+ * Called for every row of a retained range. bucket is 0 for raw
+ * rows and the length of the bucket in seconds for aggregates.
+ * Returning a value other than 0 stops the read.
+ */
+typedef int (*retainedRowCallback)(const char *row, size_t length, int64_t time, int bucket, void *context);
+
+/* METHODS */
+
+/**
+ * Fills in the default policy: raw rows for a week, minutes for
+ * three months, hours forever and a pass every hour.
+ *
+ * @param policy policy to initialize
+ */
+void defaultRetentionPolicy(retentionPolicy *policy);
+/**
+ * Opens the aggregate logs of a log for appending.
+ *
+ * @param retention retention to initialize
+ * @param name path prefix of the raw log
+ * @param header CSV header of the raw rows, without the time column
+ * @param policy windows of the tiers, NULL for the defaults
+ * @return 0 on success, -1 on failure (errno is set)
+ */
+int openRetention(retentionLog *retention, const char *name, const char *header, const retentionPolicy *policy);
+/**
+ * Runs one compaction pass over all tiers.
+ *
+ * @param retention opened retention
+ * @param now current time (seconds since epoch)
+ * @return number of deleted segments, -1 on failure
+ */
+int compactRetention(retentionLog *retention, int64_t now);
+/**
+ * Starts a thread with idle CPU and I/O priority running a pass
+ * every policy.interval seconds.
+ *
+ * @param retention opened retention
+ * @return 0 on success, -1 on failure
+ */
+int startRetention(retentionLog *retention);
+/**
+ * Stops the thread, a running pass is finished first, and closes
+ * the aggregate logs.
+ *
+ * @param retention opened retention
+ * @return 0 on success, -1 if the last aggregates could not be written
+ */
+int closeRetention(retentionLog *retention);
+/**
+ * Reads all rows with start <= time <= end from the finest tier
+ * that still holds them: hours where only hours are left, then
+ * minutes, then raw rows.
+ *
+ * @param name path prefix of the raw log
+ * @param start first timestamp of the range
+ * @param end last timestamp of the range
+ * @param callback called for every row
+ * @param context passed to the callback
+ * @return number of rows passed to the callback, -1 on failure
+ */
+long readRetainedLog(const char *name, int64_t start, int64_t end, retainedRowCallback callback, void *context);
+
+#endif //SRC_RETENTION_H
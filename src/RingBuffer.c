@@ -0,0 +1,119 @@
+/**
+ * <Program>
+ * RingBuffer.c
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ *  Ring buffer of fixed size records with one writer and lock free
+ * readers. The writer copies a record into its slot and publishes
+ * it by incrementing the head. A reader copies the records it
+ * wants and then checks the head again: every record the writer
+ * may have started to overwrite meanwhile is dropped and counted
+ * as lost, like a seqlock with the head as sequence.
+ *
+ * <Sources>
+ * Accessed on 18.10.2026 - GCC built-in functions for memory model aware atomic operations:
+ *      https://gcc.gnu.org/onlinedocs/gcc/_005f_005fatomic-Builtins.html
+ */
+
+#include <string.h>
+#include "RingBuffer.h"
+
+/**
+ * Allocates the records of a ring buffer.
+ *
+ * @param ring ring buffer to initialize
+ * @param recordSize size of a record
+ * @param capacity number of records, rounded up to a power of two
+ * @return 0 on success, -1 if the memory could not be allocated
+ */
+int openRing(ringBuffer *ring, size_t recordSize, size_t capacity) {
+    memset(ring, 0, sizeof(*ring));
+    ring->capacity = 1;
+    while (ring->capacity < capacity) {
+        ring->capacity <<= 1;
+    }
+    ring->recordSize = recordSize;
+    ring->records = calloc((size_t) ring->capacity, recordSize);
+    return ring->records != NULL ? 0 : -1;
+}
+
+/**
+ * Appends a record, overwriting the oldest one if the buffer is
+ * full. Must only be called by one thread.
+ *
+ * @param ring opened ring buffer
+ * @param record record to append
+ */
+void pushRing(ringBuffer *ring, const void *record) {
+    uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+    uint8_t *slot = ring->records + (head & (ring->capacity - 1)) * ring->recordSize;
+    /* The previous head has to be visible before the oldest record changes */
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(slot, record, ring->recordSize);
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Copies the records after the cursor and moves the cursor behind
+ * them. A cursor of 0 starts at the oldest record still kept.
+ *
+ * @param ring opened ring buffer
+ * @param cursor position of the reader
+ * @param records receives the records
+ * @param max maximum number of records to copy
+ * @param lost receives the number of records overwritten before they were read
+ * @return number of copied records
+ */
+size_t readRing(const ringBuffer *ring, uint64_t *cursor, void *records, size_t max, uint64_t *lost) {
+    uint8_t *out = records;
+    uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    uint64_t oldest = head > ring->capacity ? head - ring->capacity : 0;
+    uint64_t first = *cursor > oldest ? *cursor : oldest;
+    *lost = first - (*cursor < first ? *cursor : first);
+
+    size_t count = 0;
+    for (uint64_t i = first; i < head && count < max; i++, count++) {
+        memcpy(out + count * ring->recordSize, ring->records + (i & (ring->capacity - 1)) * ring->recordSize,
+               ring->recordSize);
+    }
+
+    /* The writer may be overwriting the record capacity before the head, drop it and everything older */
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    uint64_t now = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+    uint64_t valid = now >= ring->capacity ? now - ring->capacity + 1 : 0;
+    size_t skipped = 0;
+    if (valid > first) {
+        skipped = (size_t) (valid - first < count ? valid - first : count);
+        memmove(out, out + skipped * ring->recordSize, (count - skipped) * ring->recordSize);
+        *lost += skipped;
+    }
+    *cursor = first + count;
+    return count - skipped;
+}
+
+/**
+ * Returns the number of records written so far, a cursor for
+ * reading only records written from now on.
+ *
+ * @param ring opened ring buffer
+ * @return records written so far
+ */
+uint64_t ringHead(const ringBuffer *ring) {
+    return __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * Frees the records of a ring buffer.
+ *
+ * @param ring opened ring buffer
+ */
+void closeRing(ringBuffer *ring) {
+    free(ring->records);
+    ring->records = NULL;
+}
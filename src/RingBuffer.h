@@ -0,0 +1,84 @@
+/**
+ * <Program>
+ * RingBuffer.h
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ * Header file for a ring buffer of fixed size records, used to
+ * keep the samples of high rate streams. One thread writes, any
+ * number of readers read without a lock and without slowing the
+ * writer down: the writer always overwrites the oldest record,
+ * a reader that falls behind loses the overwritten records and is
+ * told how many.
+ *
+ * Every reader keeps a cursor, the number of records written
+ * before the next record it wants. A record is only returned if
+ * it was not overwritten while it was copied.
+ */
+
+#ifndef SRC_RINGBUFFER_H
+#define SRC_RINGBUFFER_H
+
+#include <inttypes.h>
+#include <stdlib.h>
+
+/* Used to hold a ring buffer */
+typedef struct {
+    uint8_t *records;
+    size_t recordSize;
+    uint64_t capacity;   /* power of two */
+    uint64_t head;       /* records written so far, updated atomically */
+} ringBuffer;
+
+/* METHODS */
+
+/**
+ * Allocates the records of a ring buffer.
+ *
+ * @param ring ring buffer to initialize
+ * @param recordSize size of a record
+ * @param capacity number of records, rounded up to a power of two
+ * @return 0 on success, -1 if the memory could not be allocated
+ */
+int openRing(ringBuffer *ring, size_t recordSize, size_t capacity);
+/**
+ * Appends a record, overwriting the oldest one if the buffer is
+ * full. Must only be called by one thread.
+ *
+ * @param ring opened ring buffer
+ * @param record record to append
+ */
+void pushRing(ringBuffer *ring, const void *record);
+/**
+ * Copies the records after the cursor and moves the cursor behind
+ * them. A cursor of 0 starts at the oldest record still kept.
+ *
+ * @param ring opened ring buffer
+ * @param cursor position of the reader
+ * @param records receives the records
+ * @param max maximum number of records to copy
+ * @param lost receives the number of records overwritten before they were read
+ * @return number of copied records
+ */
+size_t readRing(const ringBuffer *ring, uint64_t *cursor, void *records, size_t max, uint64_t *lost);
+/**
+ * Returns the number of records written so far, a cursor for
+ * reading only records written from now on.
+ *
+ * @param ring opened ring buffer
+ * @return records written so far
+ */
+uint64_t ringHead(const ringBuffer *ring);
+/**
+ * Frees the records of a ring buffer.
+ *
+ * @param ring opened ring buffer
+ */
+void closeRing(ringBuffer *ring);
+
+#endif //SRC_RINGBUFFER_H
@@ -13,7 +13,8 @@
  * to interact with the SI1145 Sensor developed by Silicon
  * Labs. The breakout sensor from Adafruit was used. It is
  * capable of reading the ultraviolet, infrared and visible
- * light.
+ * light. Instead of reading blindly on a timer the INT pin
+ * can be used to read every sample as soon as it is ready.
  *  Additionally this class holds the methods to communicate
  * with Python software using the CPython library.
  *
@@ -26,34 +27,86 @@
  *      https://github.com/adafruit/Adafruit_SI1145_Library
  */
 
+#ifndef SENSOR_NO_PYTHON
 #include <Python.h>
+#endif
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <time.h>
 #include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/gpio.h>
 #include "SI1145_LightSensor.h"
 
 /**
  * It is recommended to reset the command register to 0x00
  * before writing to it and check if the response register
- * changed accordingly (see p. 22).
+ * changed accordingly (see p. 22). Gives up after
+ * SI1145_COMMAND_TRIES tries instead of waiting forever for a
+ * sensor that does not answer.
+ *  The command register is written without retries: a write that
+ * failed may still have reached the sensor, writing the command
+ * again would run it twice. A failed write starts the next try
+ * with the NOP instead. The writes still go through the circuit
+ * breaker, so a dead sensor opens it and is not written to while
+ * it is open.
  *
  * @param sensor sensor ID
  * @param data data that will be written to the command register
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
  */
-void writeToCommand(int sensor, int data) {
-    int response = 0x00;
-    while (response == 0x00) {
-        wiringPiI2CWriteReg8(sensor, SI1145_REG_COMMAND, 0x00);
-        response = wiringPiI2CReadReg8(sensor, SI1145_REG_RESPONSE);
+int writeToCommand(int sensor, int data) {
+    uint8_t response;
+    int status;
+    for (int tries = 0; tries < SI1145_COMMAND_TRIES; tries++) {
+        if ((status = i2cTryWriteReg8Once(sensor, SI1145_REG_COMMAND, 0x00)) == I2C_BREAKER_OPEN) {
+            return status;
+        } else if (status != I2C_OK) {
+            continue;
+        }
+        if ((status = i2cTryReadReg8(sensor, SI1145_REG_RESPONSE, &response)) != I2C_OK) {
+            return status;
+        }
         if (response == 0x00) {
-            wiringPiI2CWriteReg8(sensor, SI1145_REG_COMMAND, data);
+            if ((status = i2cTryWriteReg8Once(sensor, SI1145_REG_COMMAND, data)) == I2C_BREAKER_OPEN) {
+                return status;
+            } else if (status != I2C_OK) {
+                continue;
+            }
             usleep(25);
-            response = wiringPiI2CReadReg8(sensor, SI1145_REG_RESPONSE);
-        } else {
-            response = 0x00;
+            if ((status = i2cTryReadReg8(sensor, SI1145_REG_RESPONSE, &response)) != I2C_OK) {
+                return status;
+            }
+            if (response != 0x00) {
+                return I2C_OK;
+            }
+        }
+    }
+    return I2C_ERROR;
+}
+
+/**
+ * Writes a list of register values, stops at the first failure.
+ *
+ * @param sensor sensor ID
+ * @param values pairs of register and value
+ * @param count number of pairs
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+static int writeRegisters(int sensor, const uint8_t values[][2], int count) {
+    for (int i = 0; i < count; i++) {
+        int status = i2cTryWriteReg8(sensor, values[i][0], values[i][1]);
+        if (status != I2C_OK) {
+            return status;
         }
     }
+    return I2C_OK;
 }
 
 /**
+ * First half of a reset, see resetSensor.
  * The sensor needs to be reset before any values can be written
  * or read from the I2C connection. The I2C-Broadcast-Reset is
  * sent to all necessary registers. See page 17 of the SI1145
@@ -61,22 +114,49 @@ void writeToCommand(int sensor, int data) {
  * 31.
  *
  * @param sensor sensor ID
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int startReset(int sensor) {
+    static const uint8_t reset[][2] = {
+            {SI1145_REG_INTCFG,    0x00},
+            {SI1145_REG_IRQEN,     0x00},
+            {SI1145_REG_IRQMODE1,  0x00},
+            {SI1145_REG_IRQMODE2,  0x00},
+            {SI1145_REG_MEASRATE0, 0x00},
+            {SI1145_REG_MEASRATE1, 0x00},
+            /* Set every status to 1 (p. 39) */
+            {SI1145_REG_IRQSTAT,   0xFF},
+            {SI1145_REG_COMMAND,   SI1145_RESET}
+    };
+    return writeRegisters(sensor, reset, sizeof(reset) / sizeof(reset[0]));
+}
+
+/**
+ * Second half of a reset, after the sensor had SI1145_RESET_US to
+ * restart: write 0x17 to HW_KEY for proper operation (p. 34).
+ *
+ * @param sensor sensor ID
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
  */
-void resetSensor(int sensor) {
-    wiringPiI2CWriteReg8(sensor, SI1145_REG_INTCFG, 0x00);
-    wiringPiI2CWriteReg8(sensor, SI1145_REG_IRQEN, 0x00);
-    wiringPiI2CWriteReg8(sensor, SI1145_REG_IRQMODE1, 0x00);
-    wiringPiI2CWriteReg8(sensor, SI1145_REG_IRQMODE2, 0x00);
-    wiringPiI2CWriteReg8(sensor, SI1145_REG_MEASRATE0, 0x00);
-    wiringPiI2CWriteReg8(sensor, SI1145_REG_MEASRATE1, 0x00);
-    /* Set every status to 1 (p. 39) */
-    wiringPiI2CWriteReg8(sensor, SI1145_REG_IRQSTAT, 0xFF);
+int unlockSensor(int sensor) {
+    return i2cTryWriteReg8(sensor, SI1145_REG_HWKEY, 0x17);
+}
 
-    wiringPiI2CWriteReg8(sensor, SI1145_REG_COMMAND, SI1145_RESET);
-    usleep(10); /* wait 10ms to let sensor reset */
-    /* Write 0x17 for proper operation (p. 34) */
-    wiringPiI2CWriteReg8(sensor, SI1145_REG_HWKEY, 0x17);
-    usleep(10);
+/**
+ * Resets the sensor and waits until it is usable again. The sensor
+ * loop runs both halves itself, so it can do something else while
+ * the sensor restarts.
+ *
+ * @param sensor sensor ID
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int resetSensor(int sensor) {
+    int status = startReset(sensor);
+    if (status != I2C_OK) {
+        return status;
+    }
+    usleep(SI1145_RESET_US);
+    return unlockSensor(sensor);
 }
 
 /**
@@ -84,36 +164,110 @@ void resetSensor(int sensor) {
  * to default values (see p. 16).
  *
  * @param sensor sensor ID
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
  */
-void calibrateUV(int sensor){
-    wiringPiI2CWriteReg8(sensor, SI1145_REG_UCOEFF0, SI1145_DEF_UCOEFF0);
-    wiringPiI2CWriteReg8(sensor, SI1145_REG_UCOEFF1, SI1145_DEF_UCOEFF1);
-    wiringPiI2CWriteReg8(sensor, SI1145_REG_UCOEFF2, SI1145_DEF_UCOEFF2);
-    wiringPiI2CWriteReg8(sensor, SI1145_REG_UCOEFF3, SI1145_DEF_UCOEFF3);
+int calibrateUV(int sensor){
+    static const uint8_t coefficients[][2] = {
+            {SI1145_REG_UCOEFF0, SI1145_DEF_UCOEFF0},
+            {SI1145_REG_UCOEFF1, SI1145_DEF_UCOEFF1},
+            {SI1145_REG_UCOEFF2, SI1145_DEF_UCOEFF2},
+            {SI1145_REG_UCOEFF3, SI1145_DEF_UCOEFF3}
+    };
+    return writeRegisters(sensor, coefficients, sizeof(coefficients) / sizeof(coefficients[0]));
 }
 
 /**
  * Set the EN_UV, EN_ALS_IR and EN_ALS_VIS bits in CHLIST
  * (see p. 47) to enable UV (ultraviolet), IR (infrared)
- * and VIS (visible light).
+ * and VIS (visible light), enable the interrupt and set the
+ * measurement rate.
  *
  * @param sensor sensor ID
+ * @param measRate MEASRATE0 value, 0 for forced measurements only
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
  */
-void enableMeas(int sensor) {
-    wiringPiI2CWriteReg8(sensor, SI1145_REG_PARAMWR, SI1145_PARAM_CHLIST_ENUV |
-                                                     SI1145_PARAM_CHLIST_ENALSIR |
-                                                     SI1145_PARAM_CHLIST_ENALSVIS);
-    writeToCommand(sensor, SI1145_PARAM_CHLIST | SI1145_PARAM_SET);
-
-    /* Enable interrupt Pin whenever measurements are ready */
-    wiringPiI2CWriteReg8(sensor, SI1145_REG_INTCFG, SI1145_REG_INTCFG_INTOE);
-    wiringPiI2CWriteReg8(sensor, SI1145_REG_IRQEN, SI1145_REG_IRQEN_ALSEVERYSAMPLE);
+static int configureMeas(int sensor, int measRate) {
+    const uint8_t interrupt[][2] = {
+            /* Enable interrupt Pin whenever measurements are ready */
+            {SI1145_REG_INTCFG,    SI1145_REG_INTCFG_INTOE},
+            {SI1145_REG_IRQEN,     SI1145_REG_IRQEN_ALSEVERYSAMPLE},
+            /* measurement rate for auto */
+            {SI1145_REG_MEASRATE0, (uint8_t) measRate}
+    };
+    int status;
+    if ((status = i2cTryWriteReg8(sensor, SI1145_REG_PARAMWR, SI1145_PARAM_CHLIST_ENUV |
+                                                              SI1145_PARAM_CHLIST_ENALSIR |
+                                                              SI1145_PARAM_CHLIST_ENALSVIS)) != I2C_OK ||
+        (status = writeToCommand(sensor, SI1145_PARAM_CHLIST | SI1145_PARAM_SET)) != I2C_OK) {
+        return status;
+    }
+    return writeRegisters(sensor, interrupt, sizeof(interrupt) / sizeof(interrupt[0]));
+}
 
-    /* measurement rate for auto */
-    wiringPiI2CWriteReg8(sensor, SI1145_REG_MEASRATE0, 0xFF); // 255 * 31.25uS = 8ms
+/**
+ * Enables UV, IR and VIS and lets the sensor measure on its
+ * own every 8ms (auto run, see p. 21).
+ *
+ * @param sensor sensor ID
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int enableMeas(int sensor) {
+    int status = configureMeas(sensor, 0xFF); // 255 * 31.25uS = 8ms
+    if (status != I2C_OK) {
+        return status;
+    }
 
     /* auto run */
-    writeToCommand(sensor, SI1145_PSALS_AUTO);
+    return writeToCommand(sensor, SI1145_PSALS_AUTO);
+}
+
+/**
+ * Enables UV, IR and VIS without auto run, a measurement only
+ * happens after startForcedMeas (forced mode, see p. 21).
+ *
+ * @param sensor sensor ID
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int enableForcedMeas(int sensor) {
+    return configureMeas(sensor, 0x00);
+}
+
+/**
+ * Enables IR and VIS only and lets the sensor measure them on its
+ * own every measRate * 31.25us (ALS auto run, see p. 21), for
+ * streams faster than the 8ms of enableMeas. UV is left out, every
+ * enabled channel lengthens a measurement.
+ *
+ * @param sensor sensor ID
+ * @param measRate MEASRATE1:MEASRATE0, 32 = 1ms
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int enableStreamMeas(int sensor, int measRate) {
+    const uint8_t interrupt[][2] = {
+            {SI1145_REG_INTCFG,    SI1145_REG_INTCFG_INTOE},
+            {SI1145_REG_IRQEN,     SI1145_REG_IRQEN_ALSEVERYSAMPLE},
+            {SI1145_REG_MEASRATE0, (uint8_t) measRate},
+            {SI1145_REG_MEASRATE1, (uint8_t) (measRate >> 8)}
+    };
+    int status;
+    if ((status = i2cTryWriteReg8(sensor, SI1145_REG_PARAMWR, SI1145_PARAM_CHLIST_ENALSIR |
+                                                              SI1145_PARAM_CHLIST_ENALSVIS)) != I2C_OK ||
+        (status = writeToCommand(sensor, SI1145_PARAM_CHLIST | SI1145_PARAM_SET)) != I2C_OK ||
+        (status = writeRegisters(sensor, interrupt, sizeof(interrupt) / sizeof(interrupt[0]))) != I2C_OK) {
+        return status;
+    }
+    return writeToCommand(sensor, SI1145_ALS_AUTO);
+}
+
+/**
+ * Stops the auto run, the sensor only measures when forced again
+ * (see p. 22).
+ *
+ * @param sensor sensor ID
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int pauseMeas(int sensor) {
+    return writeToCommand(sensor, SI1145_PSALS_PAUSE);
 }
 
 /**
@@ -122,12 +276,65 @@ void enableMeas(int sensor) {
  * reading and enables measurments.
  *
  * @param sensor sensor ID
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
  */
-void initSensor(int sensor) {
+int initSensor(int sensor) {
+    int status;
     /* Reset device before any register is accessed */
-    resetSensor(sensor);
-    calibrateUV(sensor);
-    enableMeas(sensor);
+    if ((status = resetSensor(sensor)) != I2C_OK ||
+        (status = calibrateUV(sensor)) != I2C_OK) {
+        return status;
+    }
+    return enableMeas(sensor);
+}
+
+/**
+ * Initialize the sensor like initSensor, but for forced
+ * measurements instead of auto run.
+ *
+ * @param sensor sensor ID
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int initForcedSensor(int sensor) {
+    int status;
+    if ((status = resetSensor(sensor)) != I2C_OK ||
+        (status = calibrateUV(sensor)) != I2C_OK) {
+        return status;
+    }
+    return enableForcedMeas(sensor);
+}
+
+/**
+ * Starts a single ALS measurement of all enabled channels. The
+ * interrupt status is cleared first, so isSampleReady reports
+ * the end of this measurement. It takes about SI1145_FORCE_WAIT_US.
+ *
+ * @param sensor sensor ID
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int startForcedMeas(int sensor) {
+    int status = i2cTryWriteReg8(sensor, SI1145_REG_IRQSTAT, SI1145_REG_IRQSTAT_ALS);
+    if (status != I2C_OK) {
+        return status;
+    }
+    return writeToCommand(sensor, SI1145_ALS_FORCE);
+}
+
+/**
+ * Checks the ALS bit of IRQSTAT, it is set as soon as a
+ * measurement finished (see p. 39).
+ *
+ * @param sensor sensor ID
+ * @param ready set to 1 if a new sample can be read
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int isSampleReady(int sensor, int *ready) {
+    uint8_t status;
+    int result = i2cTryReadReg8(sensor, SI1145_REG_IRQSTAT, &status);
+    if (result == I2C_OK) {
+        *ready = (status & SI1145_REG_IRQSTAT_ALS) != 0;
+    }
+    return result;
 }
 
 /**
@@ -135,33 +342,298 @@ void initSensor(int sensor) {
  * needs to be divided by 100 to represented the real UV index.
  *
  * @param sensor sensor ID
- * @return UV index * 100
+ * @param uv UV index * 100
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
  */
-uint16_t getUV(int sensor) {
-    uint16_t uv = (uint16_t) wiringPiI2CReadReg16(sensor, UVDATA);
-    return uv;
+int getUV(int sensor, uint16_t *uv) {
+    return i2cTryReadReg16(sensor, UVDATA, uv);
 }
 
 /**
  * Reads the VIS value out of the register 0x26 (see p. 29f).
  *
  * @param sensor sensor ID
- * @return visible light value
+ * @param vis visible light value
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
  */
-uint16_t getVIS(int sensor) {
-    uint16_t vis = (uint16_t) wiringPiI2CReadReg16(sensor, VISDATA);
-    return vis;
+int getVIS(int sensor, uint16_t *vis) {
+    return i2cTryReadReg16(sensor, VISDATA, vis);
 }
 
 /**
  * Reads the IR value out of the register 0x24 (see p. 30).
  *
  * @param sensor sensor ID
- * @return infrared light value
+ * @param ir infrared light value
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int getIR(int sensor, uint16_t *ir) {
+    return i2cTryReadReg16(sensor, IRDATA, ir);
+}
+
+/**
+ * Reads VIS, IR, the three proximity values and UV with one
+ * burst read of the registers 0x22 to 0x2D (see p. 29f). All
+ * values belong to the same measurement cycle.
+ *
+ * @param sensor sensor ID
+ * @param data read values
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int readLightSample(int sensor, lightData *data) {
+    uint8_t block[LIGHTDATA_LENGTH];
+    int status = i2cTryReadBlock(sensor, LIGHTDATA, block, LIGHTDATA_LENGTH);
+    if (status != I2C_OK) {
+        return status;
+    }
+    decodeLightSample(block, data);
+    return I2C_OK;
+}
+
+/**
+ * Reads VIS and IR with one burst read of the registers 0x22 to
+ * 0x25, the other values of data are left alone.
+ *
+ * @param sensor sensor ID
+ * @param data read values
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int readVisIrSample(int sensor, lightData *data) {
+    uint8_t block[VISIRDATA_LENGTH];
+    int status = i2cTryReadBlock(sensor, VISDATA, block, VISIRDATA_LENGTH);
+    if (status != I2C_OK) {
+        return status;
+    }
+    data->vis = (uint16_t) (block[0] | block[1] << 8);
+    data->ir = (uint16_t) (block[2] | block[3] << 8);
+    return I2C_OK;
+}
+
+/**
+ * Decodes a burst read of LIGHTDATA_LENGTH bytes from LIGHTDATA,
+ * every value is stored LSB first.
+ *
+ * @param block registers 0x22 to 0x2D
+ * @param data decoded values
+ */
+void decodeLightSample(const uint8_t *block, lightData *data) {
+    data->vis = (uint16_t) (block[VISDATA - LIGHTDATA] | block[VISDATA - LIGHTDATA + 1] << 8);
+    data->ir = (uint16_t) (block[IRDATA - LIGHTDATA] | block[IRDATA - LIGHTDATA + 1] << 8);
+    data->ps1 = (uint16_t) (block[PS1DATA - LIGHTDATA] | block[PS1DATA - LIGHTDATA + 1] << 8);
+    data->ps2 = (uint16_t) (block[PS2DATA - LIGHTDATA] | block[PS2DATA - LIGHTDATA + 1] << 8);
+    data->ps3 = (uint16_t) (block[PS3DATA - LIGHTDATA] | block[PS3DATA - LIGHTDATA + 1] << 8);
+    data->uv = (uint16_t) (block[UVDATA - LIGHTDATA] | block[UVDATA - LIGHTDATA + 1] << 8);
+}
+
+/**
+ * Reads all queued line events, the fd is non-blocking.
+ *
+ * @param event GPIO event source
+ * @return number of events read, -1 on failure
+ */
+static int consumeGpioEvent(sampleEvent *event) {
+    struct gpioevent_data data;
+    int count = 0;
+    while (read(event->fd, &data, sizeof(data)) == sizeof(data)) {
+        count++;
+    }
+    return (errno == EAGAIN || count > 0) ? count : -1;
+}
+
+/**
+ * Drains everything written to the fd, the fd is non-blocking.
+ *
+ * @param event fd event source
+ * @return 1 if something was read, 0 if not, -1 on failure
+ */
+static int consumeFdEvent(sampleEvent *event) {
+    char data[64];
+    int count = 0;
+    ssize_t received;
+    while ((received = read(event->fd, data, sizeof(data))) > 0) {
+        count = 1;
+    }
+    return (received == 0 || errno == EAGAIN) ? count : -1;
+}
+
+/**
+ * Releases the line event fd.
+ *
+ * @param event GPIO event source
+ */
+static void closeGpioEvent(sampleEvent *event) {
+    close(event->fd);
+    event->fd = -1;
+}
+
+/**
+ * The fd belongs to the caller, just forget it.
+ *
+ * @param event fd event source
+ */
+static void closeFdEvent(sampleEvent *event) {
+    event->fd = -1;
+}
+
+/**
+ * Requests falling edge events for the GPIO line the INT pin is
+ * connected to. INT is active low and held until IRQSTAT is
+ * cleared (see p. 39).
+ *
+ * @param event event source to initialize
+ * @param chip path of the gpiochip device (i. e. /dev/gpiochip0)
+ * @param line offset of the line on the chip
+ * @return 0 on success, -1 on failure
+ */
+int openGpioEvent(sampleEvent *event, const char *chip, int line) {
+    struct gpioevent_request request;
+    int chipFd = open(chip, O_RDONLY);
+    if (chipFd < 0) {
+        return -1;
+    }
+
+    memset(&request, 0, sizeof(request));
+    request.lineoffset = (uint32_t) line;
+    request.handleflags = GPIOHANDLE_REQUEST_INPUT;
+    request.eventflags = GPIOEVENT_REQUEST_FALLING_EDGE;
+    strncpy(request.consumer_label, SI1145_GPIO_LABEL, sizeof(request.consumer_label) - 1);
+
+    int result = ioctl(chipFd, GPIO_GET_LINEEVENT_IOCTL, &request);
+    close(chipFd);
+    if (result < 0) {
+        return -1;
+    }
+
+    fcntl(request.fd, F_SETFL, fcntl(request.fd, F_GETFL) | O_NONBLOCK);
+    event->fd = request.fd;
+    event->consume = consumeGpioEvent;
+    event->close = closeGpioEvent;
+    return 0;
+}
+
+/**
+ * Uses any readable fd as event source, every write to it counts
+ * as a finished measurement. The fd is not closed by the source.
+ *
+ * @param event event source to initialize
+ * @param fd eventfd or read end of a pipe
+ * @return 0 on success, -1 on failure
+ */
+int openFdEvent(sampleEvent *event, int fd) {
+    int flags = fcntl(fd, F_GETFL);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+        return -1;
+    }
+    event->fd = fd;
+    event->consume = consumeFdEvent;
+    event->close = closeFdEvent;
+    return 0;
+}
+
+/**
+ * Waits until the sensor signals a finished ALS measurement,
+ * reads UV, IR and VIS and clears the interrupt. The bus is not
+ * touched while waiting.
+ *
+ * @param sensor sensor ID
+ * @param event event source
+ * @param timeoutMs maximum time to wait, -1 waits forever
+ * @param data read values
+ * @return 1 if a sample was read, 0 on timeout, -1 on failure
+ */
+int waitForSample(int sensor, sampleEvent *event, int timeoutMs, lightData *data) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    int64_t deadline = (int64_t) now.tv_sec * 1000 + now.tv_nsec / 1000000 + timeoutMs;
+
+    for (;;) {
+        struct pollfd descriptor = {event->fd, POLLIN | POLLPRI, 0};
+        int wait = timeoutMs;
+        if (timeoutMs >= 0) {
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            wait = (int) (deadline - ((int64_t) now.tv_sec * 1000 + now.tv_nsec / 1000000));
+            if (wait < 0) {
+                wait = 0;
+            }
+        }
+
+        int ready = poll(&descriptor, 1, wait);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        if (ready == 0) {
+            /* An edge may have been missed while INT was held, clear to re-arm it */
+            return i2cTryWriteReg8(sensor, SI1145_REG_IRQSTAT, SI1145_REG_IRQSTAT_ALS) == I2C_OK ? 0 : -1;
+        }
+        if ((descriptor.revents & (POLLHUP | POLLERR | POLLNVAL)) && !(descriptor.revents & POLLIN)) {
+            /* The writing end of the event source is gone */
+            return -1;
+        }
+        if (event->consume(event) < 0) {
+            return -1;
+        }
+
+        /* Ignore events that were not caused by a finished ALS measurement */
+        uint8_t status;
+        if (i2cTryReadReg8(sensor, SI1145_REG_IRQSTAT, &status) != I2C_OK) {
+            return -1;
+        }
+        if (status & SI1145_REG_IRQSTAT_ALS) {
+            int result = readLightSample(sensor, data);
+            /* Writing 1 clears the status bit and releases INT (p. 39) */
+            if (i2cTryWriteReg8(sensor, SI1145_REG_IRQSTAT, SI1145_REG_IRQSTAT_ALS) != I2C_OK) {
+                return -1;
+            }
+            return result != I2C_OK ? -1 : 1;
+        }
+    }
+}
+
+#ifndef SENSOR_NO_PYTHON
+/* Sensor kept initialized between calls and event source of the interrupt driven read path */
+static int lightSensor = -1;
+static sampleEvent event = {-1, NULL, NULL};
+
+/**
+ * Setup the sensor once and keep it running in auto mode, so
+ * later calls just read the latest sample. The first call waits
+ * until the first measurement (8ms) is done.
+ *
+ * @return sensor ID, -1 if the sensor was not found or did not respond
+ */
+static int setupLightSensor(void) {
+    if (lightSensor < 0) {
+        int sensor = i2cSetup(SI1145_ADDRESS);
+        if (sensor < 0) {
+            printf("sensor not found!\n");
+            return -1;
+        }
+        if (initSensor(sensor) != I2C_OK) {
+            printf("sensor not responding!\n");
+            close(sensor);
+            return -1;
+        }
+        usleep(10000);
+        lightSensor = sensor;
+    }
+    return lightSensor;
+}
+
+/**
+ * Forgets the sensor after a failed read, so the next call sets it
+ * up again (i. e. after it lost power). While the circuit breaker
+ * is open the sensor is kept, the breaker decides when to try again.
+ *
+ * @param status result of the failed read
  */
-uint16_t getIR(int sensor) {
-    uint16_t ir = (uint16_t) wiringPiI2CReadReg16(sensor, IRDATA);
-    return ir;
+static void dropLightSensor(int status) {
+    if (status == I2C_ERROR && lightSensor >= 0 && event.fd < 0) {
+        close(lightSensor);
+        lightSensor = -1;
+    }
 }
 
 /**
@@ -169,19 +641,18 @@ uint16_t getIR(int sensor) {
  *
  * @param self python instance the method is called on
  * @param args passed arguments from calling python method
- * @return UV index
+ * @return UV index or None on failure
  */
 static PyObject *get_UV(PyObject *self, PyObject *args) {
-    int32_t sensor;
-    sensor = wiringPiI2CSetup(ADDRESS);
-    if (sensor < 0) {
-        printf("sensor not found!\n");
-        return NULL;
+    lightData data;
+    int status;
+    if (setupLightSensor() < 0) {
+        Py_RETURN_NONE;
+    }
+    if ((status = getUV(lightSensor, &data.uv)) != I2C_OK) {
+        dropLightSensor(status);
+        Py_RETURN_NONE;
     }
-
-    initSensor(sensor);
-    measData data;
-    data.uv = getUV(sensor);
 
     return Py_BuildValue("f", data.uv / 100.0);
 }
@@ -191,19 +662,18 @@ static PyObject *get_UV(PyObject *self, PyObject *args) {
  *
  * @param self python instance the method is called on
  * @param args passed arguments from calling python method
- * @return infrared light value
+ * @return infrared light value or None on failure
  */
 static PyObject *get_IR(PyObject *self, PyObject *args) {
-    int32_t sensor;
-    sensor = wiringPiI2CSetup(ADDRESS);
-    if (sensor < 0) {
-        printf("sensor not found!\n");
-        return NULL;
+    lightData data;
+    int status;
+    if (setupLightSensor() < 0) {
+        Py_RETURN_NONE;
+    }
+    if ((status = getIR(lightSensor, &data.ir)) != I2C_OK) {
+        dropLightSensor(status);
+        Py_RETURN_NONE;
     }
-
-    initSensor(sensor);
-    measData data;
-    data.ir = getIR(sensor);
 
     return Py_BuildValue("i", data.ir);
 }
@@ -213,21 +683,134 @@ static PyObject *get_IR(PyObject *self, PyObject *args) {
  *
  * @param self python instance the method is called on
  * @param args passed arguments from calling python method
- * @return visible light value
+ * @return visible light value or None on failure
  */
 static PyObject *get_VIS(PyObject *self, PyObject *args) {
-    int32_t sensor;
-    sensor = wiringPiI2CSetup(ADDRESS);
-    if (sensor < 0) {
-        printf("sensor not found!\n");
+    lightData data;
+    int status;
+    if (setupLightSensor() < 0) {
+        Py_RETURN_NONE;
+    }
+    if ((status = getVIS(lightSensor, &data.vis)) != I2C_OK) {
+        dropLightSensor(status);
+        Py_RETURN_NONE;
+    }
+
+    return Py_BuildValue("i", data.vis);
+}
+
+/**
+ * Setup the sensor for the interrupt driven read path and switch
+ * to the given event source. A still pending interrupt is cleared
+ * so the next sample produces a new edge.
+ *
+ * @param source initialized event source
+ * @return 0 on success, -1 on failure
+ */
+static int startListening(sampleEvent *source) {
+    if (setupLightSensor() < 0) {
+        source->close(source);
+        return -1;
+    }
+    if (event.fd >= 0) {
+        event.close(&event);
+    }
+    event = *source;
+    return i2cTryWriteReg8(lightSensor, SI1145_REG_IRQSTAT, SI1145_REG_IRQSTAT_ALS) == I2C_OK ? 0 : -1;
+}
+
+/**
+ * Read UV index, IR, VIS and the proximity values of the same
+ * measurement cycle with a single bus transaction.
+ *
+ * @param self python instance the method is called on
+ * @param args passed arguments from calling python method
+ * @return tuple (uv, ir, vis, ps1, ps2, ps3) or None on failure
+ */
+static PyObject *get_light(PyObject *self, PyObject *args) {
+    lightData data;
+    int status;
+    if (setupLightSensor() < 0) {
+        Py_RETURN_NONE;
+    }
+    if ((status = readLightSample(lightSensor, &data)) != I2C_OK) {
+        dropLightSensor(status);
+        Py_RETURN_NONE;
+    }
+
+    return Py_BuildValue("(fiiiii)", data.uv / 100.0, data.ir, data.vis, data.ps1, data.ps2, data.ps3);
+}
+
+/**
+ * Listen on the GPIO line connected to the INT pin of the sensor.
+ *
+ * @param self python instance the method is called on
+ * @param args line offset and optional gpiochip path
+ * @return 0 on success, -1 on failure
+ */
+static PyObject *listen_interrupt(PyObject *self, PyObject *args) {
+    int line;
+    const char *chip = SI1145_GPIO_CHIP;
+    sampleEvent source;
+    if (!PyArg_ParseTuple(args, "i|s", &line, &chip)) {
         return NULL;
     }
 
-    initSensor(sensor);
-    measData data;
-    data.vis = getVIS(sensor);
+    if (openGpioEvent(&source, chip, line) < 0) {
+        printf("gpio line %i could not be requested!\n", line);
+        return Py_BuildValue("i", -1);
+    }
+    return Py_BuildValue("i", startListening(&source));
+}
 
-    return Py_BuildValue("i", data.vis);
+/**
+ * Listen on an arbitrary fd (eventfd or pipe) instead of the
+ * GPIO line, i. e. to drive the read path in tests.
+ *
+ * @param self python instance the method is called on
+ * @param args readable fd
+ * @return 0 on success, -1 on failure
+ */
+static PyObject *listen_fd(PyObject *self, PyObject *args) {
+    int fd;
+    sampleEvent source;
+    if (!PyArg_ParseTuple(args, "i", &fd)) {
+        return NULL;
+    }
+
+    if (openFdEvent(&source, fd) < 0) {
+        return Py_BuildValue("i", -1);
+    }
+    return Py_BuildValue("i", startListening(&source));
+}
+
+/**
+ * Wait for the next sample signaled by the event source and
+ * return it like get_light.
+ *
+ * @param self python instance the method is called on
+ * @param args optional timeout in ms (default: wait forever)
+ * @return tuple (uv, ir, vis, ps1, ps2, ps3) or None on timeout or failure
+ */
+static PyObject *wait_light(PyObject *self, PyObject *args) {
+    int timeoutMs = -1;
+    if (!PyArg_ParseTuple(args, "|i", &timeoutMs)) {
+        return NULL;
+    }
+    if (event.fd < 0) {
+        Py_RETURN_NONE;
+    }
+
+    lightData data;
+    int result;
+    Py_BEGIN_ALLOW_THREADS
+    result = waitForSample(lightSensor, &event, timeoutMs, &data);
+    Py_END_ALLOW_THREADS
+    if (result <= 0) {
+        Py_RETURN_NONE;
+    }
+
+    return Py_BuildValue("(fiiiii)", data.uv / 100.0, data.ir, data.vis, data.ps1, data.ps2, data.ps3);
 }
 
 /**
@@ -237,6 +820,10 @@ static PyMethodDef lightSensor_methods[] = {
         {"get_UV", get_UV, METH_VARARGS},
         {"get_IR", get_IR, METH_VARARGS},
         {"get_VIS", get_VIS, METH_VARARGS},
+        {"get_light", get_light, METH_VARARGS},
+        {"listen_interrupt", listen_interrupt, METH_VARARGS},
+        {"listen_fd", listen_fd, METH_VARARGS},
+        {"wait_light", wait_light, METH_VARARGS},
         {NULL, NULL, 0, NULL} /* Sentinel */
 };
 
@@ -248,7 +835,10 @@ void initlightSensor(void) {
     PyImport_AddModule("lightSensor");
     Py_InitModule("lightSensor", lightSensor_methods);
 }
+#endif
 
+/* Left out when the driver is linked into another module (i. e. sensorLoop) */
+#ifndef SENSOR_NO_MAIN
 int main(int argc, char **argv) {
     /* Initialize the Python interpreter. */
     Py_Initialize();
@@ -256,18 +846,21 @@ int main(int argc, char **argv) {
     initlightSensor();
 
 /*
-    int sensor = wiringPiI2CSetup(ADDRESS);
+    int sensor = i2cSetup(SI1145_ADDRESS);
     if (sensor < 0) {
         printf("sensor not found!\n");
         return 1;
     }
 
-    initSensor(sensor);
+    if (initSensor(sensor) != I2C_OK) {
+        printf("sensor not responding!\n");
+        return 1;
+    }
 
-    measData data;
-    data.uv = getUV(sensor);
-    data.ir = getIR(sensor);
-    data.vis = getVIS(sensor);
+    lightData data;
+    getUV(sensor, &data.uv);
+    getIR(sensor, &data.ir);
+    getVIS(sensor, &data.vis);
 
     printf("UV: %.2f\n"
            "IR: %i\n"
@@ -275,3 +868,4 @@ int main(int argc, char **argv) {
 */
 
 }
+#endif
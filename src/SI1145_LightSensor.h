@@ -12,7 +12,8 @@
  * Header file for the SI1145 Sensor from Silicon Labs. Defines
  * all addresses that are necessarry to read out ultraviolet,
  * infrared and visible light and introduces a structure,
- * which holds the readable sensor data values.
+ * which holds the readable sensor data values. Also defines
+ * the event source used to wait for the INT pin.
  *
  * <Sources>
  * Accessed on 11.01.2018 - SI1145 Datasheet:
@@ -26,14 +27,17 @@
 
 #include <inttypes.h>
 #include <stdlib.h>
-#include "wiringPiI2C.h"
+#include "I2CBus.h"
 
 /* I2C ADDRESS */
-#define ADDRESS       0x60
+#define SI1145_ADDRESS 0x60
 
 /* COMMANDS */
 #define SI1145_PARAM_SET   0xA0
 #define SI1145_RESET       0x01
+#define SI1145_ALS_FORCE   0x06
+#define SI1145_PSALS_PAUSE 0x0B
+#define SI1145_ALS_AUTO    0x0E
 #define SI1145_PSALS_AUTO  0x0F
 
 /* PARAMETERS */
@@ -63,6 +67,14 @@
 #define SI1145_REG_COMMAND  0x18
 #define SI1145_REG_RESPONSE 0x20
 #define SI1145_REG_IRQSTAT  0x21
+#define SI1145_REG_IRQSTAT_ALS 0x01
+
+/* Tries to get a response to a command before giving up */
+#define SI1145_COMMAND_TRIES 10
+/* Time a forced measurement of UV, IR and VIS takes */
+#define SI1145_FORCE_WAIT_US 5000
+/* Time the sensor needs after a reset before it takes the hardware key */
+#define SI1145_RESET_US 10000
 
 /* DEFAULT VALUES */
 #define SI1145_DEF_UCOEFF0 0x7B
@@ -74,11 +86,198 @@
 #define UVDATA  0x2C
 #define VISDATA 0x22
 #define IRDATA  0x24
+#define PS1DATA 0x26
+#define PS2DATA 0x28
+#define PS3DATA 0x2A
+
+/* VIS, IR, PS1, PS2, PS3 and UV (AUX) are stored from 0x22 to 0x2D */
+#define LIGHTDATA        VISDATA
+#define LIGHTDATA_LENGTH 12
+/* VIS and IR only, 0x22 to 0x25 */
+#define VISIRDATA_LENGTH 4
 
 typedef struct {
     uint16_t uv;
     uint16_t ir;
     uint16_t vis;
-} measData;
+    uint16_t ps1;
+    uint16_t ps2;
+    uint16_t ps3;
+} lightData;
+
+/* --- Interrupt --- */
+#define SI1145_GPIO_CHIP  "/dev/gpiochip0"
+#define SI1145_GPIO_LABEL "si1145-int"
+
+/*
+ * Used as source of the "sample ready" events. The fd becomes
+ * readable whenever the INT pin signals a finished measurement,
+ * consume clears the pending event(s). Besides the GPIO line
+ * any fd can be used (i. e. an eventfd or pipe in tests).
+ */
+typedef struct sampleEvent {
+    int fd;
+    int (*consume)(struct sampleEvent *event);
+    void (*close)(struct sampleEvent *event);
+} sampleEvent;
+
+/* METHODS */
+
+/**
+ * Initialize the sensor to work properly. In this case it
+ * resets the device to default values, calibrates the UV
+ * reading and enables measurments in auto run.
+ *
+ * @param sensor sensor ID
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int initSensor(int sensor);
+/**
+ * First half of a reset: clears the interrupt and measurement
+ * settings and sends the reset command. The sensor has to be left
+ * alone for SI1145_RESET_US before unlockSensor is called.
+ *
+ * @param sensor sensor ID
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int startReset(int sensor);
+/**
+ * Second half of a reset: writes the hardware key, without it
+ * the sensor does not operate properly.
+ *
+ * @param sensor sensor ID
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int unlockSensor(int sensor);
+/**
+ * To enable UV reading, it is necessary to configure UCOEF
+ * to default values.
+ *
+ * @param sensor sensor ID
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int calibrateUV(int sensor);
+/**
+ * Enables UV, IR and VIS without auto run, a measurement only
+ * happens after startForcedMeas (forced mode).
+ *
+ * @param sensor sensor ID
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int enableForcedMeas(int sensor);
+/**
+ * Resets the sensor and waits until it is usable again. The sensor
+ * loop runs both halves itself, so it can do something else while
+ * the sensor restarts.
+ *
+ * @param sensor sensor ID
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int resetSensor(int sensor);
+/**
+ * Enables IR and VIS only and lets the sensor measure them on its
+ * own every measRate * 31.25us (ALS auto run, see p. 21), for
+ * streams faster than the 8ms of enableMeas. UV is left out, every
+ * enabled channel lengthens a measurement.
+ *
+ * @param sensor sensor ID
+ * @param measRate MEASRATE1:MEASRATE0, 32 = 1ms
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int enableStreamMeas(int sensor, int measRate);
+/**
+ * Stops the auto run, the sensor only measures when forced again
+ * (see p. 22).
+ *
+ * @param sensor sensor ID
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int pauseMeas(int sensor);
+/**
+ * Initialize the sensor like initSensor, but for forced
+ * measurements instead of auto run.
+ *
+ * @param sensor sensor ID
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int initForcedSensor(int sensor);
+/**
+ * Starts a single ALS measurement of all enabled channels. The
+ * interrupt status is cleared first, so isSampleReady reports
+ * the end of this measurement. It takes about SI1145_FORCE_WAIT_US.
+ *
+ * @param sensor sensor ID
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int startForcedMeas(int sensor);
+/**
+ * Checks the ALS bit of IRQSTAT, it is set as soon as a
+ * measurement finished (see p. 39).
+ *
+ * @param sensor sensor ID
+ * @param ready set to 1 if a new sample can be read
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int isSampleReady(int sensor, int *ready);
+
+/**
+ * Reads VIS, IR, the three proximity values and UV with one
+ * burst read of the registers 0x22 to 0x2D (see p. 29f). All
+ * values belong to the same measurement cycle.
+ *
+ * @param sensor sensor ID
+ * @param data read values
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int readLightSample(int sensor, lightData *data);
+/**
+ * Reads VIS and IR with one burst read of the registers 0x22 to
+ * 0x25, the other values of data are left alone.
+ *
+ * @param sensor sensor ID
+ * @param data read values
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int readVisIrSample(int sensor, lightData *data);
+/**
+ * Decodes a burst read of LIGHTDATA_LENGTH bytes from LIGHTDATA,
+ * every value is stored LSB first.
+ *
+ * @param block registers 0x22 to 0x2D
+ * @param data decoded values
+ */
+void decodeLightSample(const uint8_t *block, lightData *data);
+/**
+ * Requests falling edge events for the GPIO line the INT pin is
+ * connected to. INT is active low and held until IRQSTAT is
+ * cleared (see p. 39).
+ *
+ * @param event event source to initialize
+ * @param chip path of the gpiochip device (i. e. /dev/gpiochip0)
+ * @param line offset of the line on the chip
+ * @return 0 on success, -1 on failure
+ */
+int openGpioEvent(sampleEvent *event, const char *chip, int line);
+/**
+ * Uses any readable fd as event source, every write to it counts
+ * as a finished measurement. The fd is not closed by the source.
+ *
+ * @param event event source to initialize
+ * @param fd eventfd or read end of a pipe
+ * @return 0 on success, -1 on failure
+ */
+int openFdEvent(sampleEvent *event, int fd);
+/**
+ * Waits until the sensor signals a finished ALS measurement,
+ * reads the whole light sample and clears the interrupt. The bus is not
+ * touched while waiting.
+ *
+ * @param sensor sensor ID
+ * @param event event source
+ * @param timeoutMs maximum time to wait, -1 waits forever
+ * @param data read values
+ * @return 1 if a sample was read, 0 on timeout, -1 on failure
+ */
+int waitForSample(int sensor, sampleEvent *event, int timeoutMs, lightData *data);
 
 #endif //SRC_SI1145_LIGHTSENSOR_H
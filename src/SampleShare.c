@@ -0,0 +1,445 @@
+/**
+ * <Program>
+ * SampleShare.c
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ *  Shares the latest sample of every channel through a POSIX shared
+ * memory object protected by a seqlock. The writer is the process
+ * running the sensor loop, readers only map the object.
+ *  An object left by an older version or of another size is
+ * removed and created again, readers that still map the old one
+ * see its last sample until they attach again.
+ *  Additionally this class holds the reader for Python and, unless
+ * SENSOR_NO_MAIN is defined, a small program printing the current
+ * sample.
+ *
+ * <Sources>
+ * Accessed on 18.10.2026 - shm_overview(7):
+ *      https://man7.org/linux/man-pages/man7/shm_overview.7.html
+ * Accessed on 18.10.2026 - Hans-J. Boehm, Can Seqlocks Get Along With Programming Language Memory Models?:
+ *      https://www.hpl.hp.com/techreports/2012/HPL-2012-68.pdf
+ * Accesses on 11.01.2018 - Extending Python with C
+ *      https://docs.python.org/2/extending/extending.html
+ */
+
+#ifndef SENSOR_NO_PYTHON
+#include <Python.h>
+#endif
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "SampleShare.h"
+
+/**
+ * Maps a shared memory object of the size of a segment.
+ *
+ * @param fd opened object
+ * @param writable 1 to map it for writing
+ * @return mapping or NULL on failure
+ */
+static sharedSegment *mapSegment(int fd, int writable) {
+    void *address = mmap(NULL, sizeof(sharedSegment), writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                         MAP_SHARED, fd, 0);
+    return address != MAP_FAILED ? address : NULL;
+}
+
+/**
+ * Checks whether a mapped object is a segment of this version.
+ */
+static int validSegment(const sharedSegment *segment) {
+    return __atomic_load_n(&segment->magic, __ATOMIC_ACQUIRE) == SHARE_MAGIC &&
+           segment->version == SHARE_VERSION && segment->size == sizeof(sharedSegment);
+}
+
+/**
+ * Checks whether a name or unit of a layout ends within its array.
+ */
+static int terminated(const char *label) {
+    return memchr(label, '\0', SHARE_LABEL_MAX) != NULL;
+}
+
+/**
+ * Checks whether a layout read from a segment can be used to
+ * interpret its sample.
+ */
+static int validLayout(const sharedLayout *layout) {
+    if (layout->sensors < 0 || layout->sensors > SHARE_SENSORS_MAX || layout->channels < 0 ||
+        layout->channels > SHARE_CHANNELS_MAX) {
+        return 0;
+    }
+    for (int i = 0; i < layout->sensors; i++) {
+        const sharedSensor *sensor = &layout->sensor[i];
+        if (!terminated(sensor->name) || !terminated(sensor->field)) {
+            return 0;
+        }
+    }
+    for (int i = 0; i < layout->channels; i++) {
+        const sharedChannel *channel = &layout->channel[i];
+        if (channel->sensor < 0 || channel->sensor >= layout->sensors || !terminated(channel->name) ||
+            !terminated(channel->unit)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * Creates or takes over the shared memory object. An existing
+ * object is kept, so readers that mapped it keep working when the
+ * writer is restarted. If it was written with another layout, its
+ * sample is cleared.
+ *
+ * @param share share to initialize
+ * @param name name of the object, i. e. SHARE_NAME
+ * @param layout layout of the samples that will be published
+ * @return 0 on success, -1 on failure (errno is set)
+ */
+int openSampleShare(sampleShare *share, const char *name, const sharedLayout *layout) {
+    share->fd = shm_open(name, O_RDWR | O_CREAT, 0644);
+    if (share->fd < 0) {
+        return -1;
+    }
+
+    struct stat status;
+    if (fstat(share->fd, &status) < 0) {
+        close(share->fd);
+        return -1;
+    }
+    if (status.st_size != 0 && status.st_size != (off_t) sizeof(sharedSegment)) {
+        /* Left by another version, readers keep their mapping of the old one */
+        close(share->fd);
+        shm_unlink(name);
+        share->fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+        if (share->fd < 0) {
+            return -1;
+        }
+    }
+    if (ftruncate(share->fd, sizeof(sharedSegment)) < 0) {
+        close(share->fd);
+        return -1;
+    }
+    share->segment = mapSegment(share->fd, 1);
+    if (share->segment == NULL) {
+        close(share->fd);
+        return -1;
+    }
+
+    sharedSegment *segment = share->segment;
+    if (!validSegment(segment)) {
+        memset(segment, 0, sizeof(*segment));
+        segment->version = SHARE_VERSION;
+        segment->size = sizeof(sharedSegment);
+        segment->layout = *layout;
+    }
+    /*
+     * A writer that died while writing left the sequence odd and the
+     * sample half written, a writer with other drivers left values
+     * that do not fit the layout. The sample is cleared like a new
+     * segment before the sequence is made even, so readers see no
+     * channel as read until the next sample instead of the torn or
+     * misplaced one.
+     */
+    uint32_t sequence = __atomic_load_n(&segment->sequence, __ATOMIC_RELAXED);
+    if ((sequence & 1) || memcmp(&segment->layout, layout, sizeof(*layout)) != 0) {
+        if (!(sequence & 1)) {
+            __atomic_store_n(&segment->sequence, ++sequence, __ATOMIC_RELAXED);
+            __atomic_thread_fence(__ATOMIC_RELEASE);
+        }
+        segment->layout = *layout;
+        memset(&segment->sample, 0, sizeof(segment->sample));
+        segment->publishes++;
+        __atomic_store_n(&segment->sequence, sequence + 1, __ATOMIC_RELEASE);
+    }
+    segment->writerPid = (int32_t) getpid();
+    __atomic_store_n(&segment->magic, SHARE_MAGIC, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/**
+ * Publishes a sample. Must only be called by one thread.
+ *
+ * @param share opened share
+ * @param sample values to publish
+ */
+void publishSample(sampleShare *share, const sharedSample *sample) {
+    sharedSegment *segment = share->segment;
+    uint32_t sequence = __atomic_load_n(&segment->sequence, __ATOMIC_RELAXED);
+    __atomic_store_n(&segment->sequence, sequence + 1, __ATOMIC_RELAXED);
+    /* The odd sequence has to be visible before the sample changes */
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(&segment->sample, sample, sizeof(*sample));
+    segment->publishes++;
+    __atomic_store_n(&segment->sequence, sequence + 2, __ATOMIC_RELEASE);
+}
+
+/**
+ * Unmaps the shared memory object. It is not removed, readers see
+ * the last sample and its time.
+ *
+ * @param share opened share
+ */
+void closeSampleShare(sampleShare *share) {
+    munmap(share->segment, sizeof(sharedSegment));
+    close(share->fd);
+    share->segment = NULL;
+    share->fd = -1;
+}
+
+/**
+ * Maps the shared memory object read only.
+ *
+ * @param reader reader to initialize
+ * @param name name of the object, i. e. SHARE_NAME
+ * @return 0 on success, -1 if there is no valid object (errno is set)
+ */
+int attachSampleShare(sampleReader *reader, const char *name) {
+    reader->segment = NULL;
+    reader->fd = shm_open(name, O_RDONLY, 0);
+    if (reader->fd < 0) {
+        return -1;
+    }
+
+    struct stat status;
+    if (fstat(reader->fd, &status) < 0) {
+        close(reader->fd);
+        return -1;
+    }
+    const sharedSegment *segment = NULL;
+    if (status.st_size == (off_t) sizeof(sharedSegment)) {
+        segment = mapSegment(reader->fd, 0);
+    }
+    if (segment == NULL || !validSegment(segment)) {
+        if (segment != NULL) {
+            munmap((void *) segment, sizeof(sharedSegment));
+        }
+        close(reader->fd);
+        errno = EPROTO;
+        return -1;
+    }
+    reader->segment = segment;
+    return 0;
+}
+
+/**
+ * Copies the latest sample with its layout.
+ *
+ * @param reader attached reader
+ * @param layout receives the layout of the sample
+ * @param sample receives the values
+ * @param publishes receives the number of samples published so
+ *        far, it changes whenever there is a new sample, may be NULL
+ * @return 0 on success, -1 if nothing was published yet, the
+ *         writer did not finish a sample within SHARE_RETRIES reads
+ *         or the layout is not valid
+ */
+int readSampleShare(const sampleReader *reader, sharedLayout *layout, sharedSample *sample, uint64_t *publishes) {
+    const sharedSegment *segment = reader->segment;
+    for (int attempt = 0; attempt < SHARE_RETRIES; attempt++) {
+        uint32_t before = __atomic_load_n(&segment->sequence, __ATOMIC_ACQUIRE);
+        if (before & 1) {
+            /* The writer is in the middle of a sample, let it finish if it shares the CPU */
+            sched_yield();
+            continue;
+        }
+        memcpy(layout, &segment->layout, sizeof(*layout));
+        memcpy(sample, &segment->sample, sizeof(*sample));
+        uint64_t count = segment->publishes;
+        /* The copy has to be complete before the sequence is checked again */
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&segment->sequence, __ATOMIC_RELAXED) == before) {
+            if (publishes != NULL) {
+                *publishes = count;
+            }
+            return count > 0 && validLayout(layout) ? 0 : -1;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Unmaps the shared memory object.
+ *
+ * @param reader attached reader
+ */
+void detachSampleShare(sampleReader *reader) {
+    if (reader->segment != NULL) {
+        munmap((void *) reader->segment, sizeof(sharedSegment));
+        close(reader->fd);
+        reader->segment = NULL;
+        reader->fd = -1;
+    }
+}
+
+/* Left out when linked into a program without Python */
+#ifndef SENSOR_NO_PYTHON
+
+/* Reader kept attached between calls and the name of its object */
+static sampleReader reader = {-1, NULL};
+static char readerName[256];
+
+/**
+ * Returns the value if the sensor was ever read, None otherwise.
+ */
+static PyObject *valueOrNone(PyObject *value, int valid) {
+    if (!valid) {
+        Py_DECREF(value);
+        Py_INCREF(Py_None);
+        value = Py_None;
+    }
+    return value;
+}
+
+/**
+ * Adds a value to the dict and drops the reference to it.
+ *
+ * @return 0 on success, -1 on failure
+ */
+static int setField(PyObject *dict, const char *key, PyObject *value) {
+    int result = value != NULL ? PyDict_SetItemString(dict, key, value) : -1;
+    Py_XDECREF(value);
+    return result;
+}
+
+/**
+ * Get the latest values published by the process running the
+ * sensors, without touching the bus.
+ *
+ * @param self python instance the method is called on
+ * @param args optional name of the shared memory object
+ * @return dict with the fields of cosybox.snapshot_result, laid
+ *         out after the drivers of the writer, the number of
+ *         samples published so far and the PID of the writer, None
+ *         if nothing was published yet
+ */
+static PyObject *read_shared(PyObject *self, PyObject *args) {
+    const char *name = SHARE_NAME;
+    if (!PyArg_ParseTuple(args, "|s", &name)) {
+        return NULL;
+    }
+    if (reader.segment != NULL && strcmp(name, readerName) != 0) {
+        detachSampleShare(&reader);
+    }
+    if (reader.segment == NULL) {
+        if (strlen(name) >= sizeof(readerName)) {
+            PyErr_SetString(PyExc_ValueError, "name too long");
+            return NULL;
+        }
+        if (attachSampleShare(&reader, name) < 0) {
+            Py_RETURN_NONE;
+        }
+        snprintf(readerName, sizeof(readerName), "%s", name);
+    }
+
+    sharedLayout layout;
+    sharedSample sample;
+    uint64_t publishes;
+    if (readSampleShare(&reader, &layout, &sample, &publishes) < 0) {
+        Py_RETURN_NONE;
+    }
+    PyObject *result = Py_BuildValue("{s:d,s:d,s:K,s:i}",
+                                     "time", sample.roundTime / 1e6,
+                                     "duration_ms", sample.durationUs / 1000.0,
+                                     "publishes", (unsigned PY_LONG_LONG) publishes,
+                                     "writer_pid", (int) reader.segment->writerPid);
+    if (result == NULL) {
+        return NULL;
+    }
+    for (int i = 0; i < layout.channels; i++) {
+        const sharedChannel *channel = &layout.channel[i];
+        int read = sample.sampleTime[channel->sensor] != 0 && (sample.valid >> i) & 1;
+        PyObject *value = channel->integer ? PyInt_FromLong((long) sample.value[i])
+                                           : PyFloat_FromDouble(sample.value[i]);
+        if (setField(result, channel->name, valueOrNone(value, read)) < 0) {
+            Py_DECREF(result);
+            return NULL;
+        }
+    }
+    for (int i = 0; i < layout.sensors; i++) {
+        char key[SHARE_LABEL_MAX + 8];
+        snprintf(key, sizeof(key), "%s_status", layout.sensor[i].field);
+        if (setField(result, key, PyInt_FromLong(sample.status[i])) < 0) {
+            Py_DECREF(result);
+            return NULL;
+        }
+        snprintf(key, sizeof(key), "%s_time", layout.sensor[i].field);
+        if (setField(result, key, valueOrNone(PyFloat_FromDouble(sample.sampleTime[i] / 1e6),
+                                              sample.sampleTime[i] != 0)) < 0) {
+            Py_DECREF(result);
+            return NULL;
+        }
+    }
+    return result;
+}
+
+/**
+ * Method definitions that are visible in Python afterwards
+ */
+static PyMethodDef sampleshare_methods[] = {
+        {"read_shared", read_shared, METH_VARARGS},
+        {NULL, NULL, 0, NULL} /* Sentinel */
+};
+
+/**
+ * Initializes the module and methods that can be called
+ * from python.
+ */
+void initsampleshare(void) {
+    PyImport_AddModule("sampleshare");
+    Py_InitModule("sampleshare", sampleshare_methods);
+}
+
+#endif
+
+#ifndef SENSOR_NO_MAIN
+int main(int argc, char **argv) {
+    const char *name = argc > 1 ? argv[1] : SHARE_NAME;
+    sampleReader shared;
+    if (attachSampleShare(&shared, name) < 0) {
+        printf("%s could not be attached: %s\n", name, strerror(errno));
+        return 1;
+    }
+
+    sharedLayout layout;
+    sharedSample sample;
+    uint64_t publishes;
+    if (readSampleShare(&shared, &layout, &sample, &publishes) < 0) {
+        printf("nothing published in %s yet\n", name);
+        detachSampleShare(&shared);
+        return 1;
+    }
+    printf("Round %.3f (%.1f ms), %llu published by %d\n", sample.roundTime / 1e6, sample.durationUs / 1000.0,
+           (unsigned long long) publishes, (int) shared.segment->writerPid);
+    for (int i = 0; i < layout.sensors; i++) {
+        printf("%s status %d at %.3f:", layout.sensor[i].name, sample.status[i], sample.sampleTime[i] / 1e6);
+        for (int j = 0, first = 1; j < layout.channels; j++) {
+            const sharedChannel *channel = &layout.channel[j];
+            if (channel->sensor != i) {
+                continue;
+            }
+            printf("%s %s ", first ? "" : ",", channel->name);
+            if (!((sample.valid >> j) & 1)) {
+                printf("-");
+            } else if (channel->integer) {
+                printf("%.0f %s", sample.value[j], channel->unit);
+            } else {
+                printf("%.2f %s", sample.value[j], channel->unit);
+            }
+            first = 0;
+        }
+        printf("\n");
+    }
+    detachSampleShare(&shared);
+    return 0;
+}
+#endif
@@ -0,0 +1,163 @@
+/**
+ * <Program>
+ * SampleShare.h
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ * Header file for sharing the latest sample of every channel with
+ * other processes. The process that owns the sensors publishes
+ * every round into a POSIX shared memory object, any number of
+ * readers (a dashboard, a debugging shell, ...) map it read only
+ * and get the current values without touching the bus.
+ *
+ * The sample is protected by a seqlock: the writer makes the
+ * sequence odd, changes the sample and makes it even again. A
+ * reader copies the sample and retries if the sequence was odd or
+ * changed meanwhile, so neither side ever waits for the other.
+ *
+ * The segment describes its values: the writer lays them out after
+ * its drivers, with the name of every sensor and the name, unit and
+ * sensor of every channel, and a reader takes the layout with every
+ * sample. Values of a sensor are the last ones it read with the time
+ * they were read, the status tells whether the last round
+ * succeeded. A channel the sensor did not measure in its last
+ * successful read (i. e. with the settings of then) has no value.
+ * The values are in the unit of their channel.
+ *
+ * This header and SampleShare.c are all a reader needs, they do
+ * not depend on the drivers.
+ */
+
+#ifndef SRC_SAMPLESHARE_H
+#define SRC_SAMPLESHARE_H
+
+#include <inttypes.h>
+
+#define SHARE_NAME         "/cosybox"  /* name of the shared memory object */
+#define SHARE_MAGIC        0x43534231  /* "CSB1" */
+#define SHARE_VERSION      2
+#define SHARE_SENSORS_MAX  8
+#define SHARE_CHANNELS_MAX 16
+#define SHARE_LABEL_MAX    24          /* bytes of a name or unit with its terminating 0 */
+#define SHARE_RETRIES      1000        /* reads before a reader gives up on a writer that died while writing */
+
+/* Used to describe a sensor */
+typedef struct {
+    char name[SHARE_LABEL_MAX];   /* i. e. BME280 */
+    char field[SHARE_LABEL_MAX];  /* prefix of its status and time, i. e. env for env_status */
+} sharedSensor;
+
+/* Used to describe a channel */
+typedef struct {
+    char name[SHARE_LABEL_MAX];
+    char unit[SHARE_LABEL_MAX];
+    int32_t sensor;       /* index of the sensor that reads it */
+    int32_t integer;      /* 1 if the value is a count */
+} sharedChannel;
+
+/* Used to describe the values of a sample, in the order of the sensor loop */
+typedef struct {
+    int32_t sensors;
+    int32_t channels;
+    sharedSensor sensor[SHARE_SENSORS_MAX];
+    sharedChannel channel[SHARE_CHANNELS_MAX];
+} sharedLayout;
+
+/* Used to hold the latest values of all channels */
+typedef struct {
+    int64_t roundTime;    /* start of the last round, us since epoch */
+    int64_t durationUs;   /* duration of the last round */
+
+    double value[SHARE_CHANNELS_MAX];       /* in the unit of the channel */
+    uint32_t valid;                         /* bit (1 << channel) of every value there is */
+    int32_t status[SHARE_SENSORS_MAX];      /* I2C_OK or the error of the last round */
+    int64_t sampleTime[SHARE_SENSORS_MAX];  /* us since epoch the values were read, 0 if never */
+} sharedSample;
+
+/* Used to lay out the shared memory object */
+typedef struct {
+    uint32_t magic;       /* written last, once the segment is initialized */
+    uint32_t version;
+    uint32_t size;        /* sizeof(sharedSegment) */
+    int32_t writerPid;
+    uint32_t sequence;    /* odd while the sample is changed */
+    uint32_t reserved;
+    uint64_t publishes;
+    sharedLayout layout;  /* changed with the sequence odd, like the sample */
+    sharedSample sample;
+} sharedSegment;
+
+/* Used to hold the writing side */
+typedef struct {
+    int fd;
+    sharedSegment *segment;
+} sampleShare;
+
+/* Used to hold a reader */
+typedef struct {
+    int fd;
+    const sharedSegment *segment;
+} sampleReader;
+
+/* METHODS */
+
+/**
+ * Creates or takes over the shared memory object. An existing
+ * object is kept, so readers that mapped it keep working when the
+ * writer is restarted. If it was written with another layout, its
+ * sample is cleared.
+ *
+ * @param share share to initialize
+ * @param name name of the object, i. e. SHARE_NAME
+ * @param layout layout of the samples that will be published
+ * @return 0 on success, -1 on failure (errno is set)
+ */
+int openSampleShare(sampleShare *share, const char *name, const sharedLayout *layout);
+/**
+ * Publishes a sample. Must only be called by one thread.
+ *
+ * @param share opened share
+ * @param sample values to publish
+ */
+void publishSample(sampleShare *share, const sharedSample *sample);
+/**
+ * Unmaps the shared memory object. It is not removed, readers see
+ * the last sample and its time.
+ *
+ * @param share opened share
+ */
+void closeSampleShare(sampleShare *share);
+/**
+ * Maps the shared memory object read only.
+ *
+ * @param reader reader to initialize
+ * @param name name of the object, i. e. SHARE_NAME
+ * @return 0 on success, -1 if there is no valid object (errno is set)
+ */
+int attachSampleShare(sampleReader *reader, const char *name);
+/**
+ * Copies the latest sample with its layout.
+ *
+ * @param reader attached reader
+ * @param layout receives the layout of the sample
+ * @param sample receives the values
+ * @param publishes receives the number of samples published so
+ *        far, it changes whenever there is a new sample, may be NULL
+ * @return 0 on success, -1 if nothing was published yet, the
+ *         writer did not finish a sample within SHARE_RETRIES reads
+ *         or the layout is not valid
+ */
+int readSampleShare(const sampleReader *reader, sharedLayout *layout, sharedSample *sample, uint64_t *publishes);
+/**
+ * Unmaps the shared memory object.
+ *
+ * @param reader attached reader
+ */
+void detachSampleShare(sampleReader *reader);
+
+#endif //SRC_SAMPLESHARE_H
@@ -0,0 +1,289 @@
+/**
+ * <Program>
+ * ScheduleStats.c
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ *  Statistics of how well a sampling loop keeps its schedule:
+ * lateness and period jitter histograms, cumulative drift and
+ * overruns per channel. The histograms are bucketed by the functions
+ * of the I2C latency histograms, so percentiles of both can be
+ * compared.
+ *
+ * <Sources>
+ * Accessed on 18.10.2026 - Prometheus text exposition format:
+ *      https://prometheus.io/docs/instrumenting/exposition_formats/
+ * Accessed on 18.10.2026 - clock_nanosleep(2):
+ *      https://man7.org/linux/man-pages/man2/clock_nanosleep.2.html
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "ScheduleStats.h"
+
+/**
+ * Initializes the statistics without channels.
+ *
+ * @param stats statistics to initialize
+ */
+void openScheduleStats(scheduleStats *stats) {
+    memset(stats, 0, sizeof(*stats));
+}
+
+/**
+ * Adds a channel.
+ *
+ * @param stats opened statistics
+ * @param name name of the channel, must stay valid
+ * @return index of the channel, -1 if there are too many
+ */
+int addScheduleChannel(scheduleStats *stats, const char *name) {
+    if (stats->channels >= SCHEDULE_CHANNELS_MAX) {
+        return -1;
+    }
+    scheduleChannel *channel = &stats->channel[stats->channels];
+    memset(channel, 0, sizeof(*channel));
+    channel->name = name;
+    return stats->channels++;
+}
+
+/**
+ * Records a run of a channel.
+ *
+ * @param stats opened statistics
+ * @param channel index of the channel
+ * @param intendedUs time the run was due
+ * @param actualUs time the run started
+ * @param periodUs intended period, the next run is due periodUs
+ *        after this one
+ * @param durationUs duration of the run
+ */
+void recordScheduledRun(scheduleStats *stats, int channel, int64_t intendedUs, int64_t actualUs,
+                        int64_t periodUs, int64_t durationUs) {
+    if (channel < 0 || channel >= stats->channels) {
+        return;
+    }
+    scheduleChannel *c = &stats->channel[channel];
+    int64_t late = actualUs - intendedUs;
+    int64_t sinceUs = periodUs * (int64_t) (c->skipped + 1);
+    c->idealUs = c->idealUs == 0 ? intendedUs : c->idealUs + sinceUs;
+    c->driftUs = actualUs - c->idealUs;
+    c->runs++;
+    if (late < 0) {
+        c->early++;
+        late = 0;
+    }
+    c->lateUs += (uint64_t) late;
+    if (late > c->maxLateUs) {
+        c->maxLateUs = late;
+    }
+    c->lateHistogram[i2cHistogramBucket((uint64_t) late)]++;
+
+    if (c->lastActualUs != 0) {
+        int64_t jitter = actualUs - c->lastActualUs - sinceUs;
+        if (jitter < 0) {
+            jitter = -jitter;
+        }
+        c->periods++;
+        c->jitterUs += (uint64_t) jitter;
+        if (jitter > c->maxJitterUs) {
+            c->maxJitterUs = jitter;
+        }
+        c->jitterHistogram[i2cHistogramBucket((uint64_t) jitter)]++;
+    }
+    if (actualUs + durationUs > intendedUs + periodUs) {
+        c->overruns++;
+    }
+    c->lastActualUs = actualUs;
+    c->skipped = 0;
+}
+
+/**
+ * Records periods a loop skipped because it was too late for them.
+ *
+ * @param stats opened statistics
+ * @param channel index of the channel
+ * @param periods number of skipped periods
+ */
+void recordMissedPeriods(scheduleStats *stats, int channel, uint64_t periods) {
+    if (channel >= 0 && channel < stats->channels) {
+        stats->channel[channel].missed += periods;
+        stats->channel[channel].skipped += periods;
+    }
+}
+
+/**
+ * Starts a new schedule, i. e. after the period was changed: the
+ * next run is taken as the start of the ideal schedule and not
+ * compared with the last one. The counters and histograms stay.
+ *
+ * @param stats opened statistics
+ */
+void restartSchedule(scheduleStats *stats) {
+    for (int i = 0; i < stats->channels; i++) {
+        stats->channel[i].lastActualUs = 0;
+        stats->channel[i].idealUs = 0;
+        stats->channel[i].skipped = 0;
+    }
+}
+
+/**
+ * Estimates a percentile from a lateness or jitter histogram.
+ *
+ * @param histogram histogram of a channel
+ * @param maxUs exact maximum recorded in the histogram
+ * @param percentile value between 0 and 100
+ * @return upper bound of the bucket holding the percentile in us, at
+ *         most maxUs, so it never shows above the maximum
+ */
+uint64_t schedulePercentile(const uint64_t *histogram, int64_t maxUs, double percentile) {
+    uint64_t bound = i2cHistogramPercentile(histogram, percentile);
+    uint64_t max = maxUs > 0 ? (uint64_t) maxUs : 0;
+    return bound < max ? bound : max;
+}
+
+/**
+ * Writes a histogram with the powers of two as bucket bounds,
+ * which are exact bucket boundaries as well.
+ */
+static void writeHistogram(FILE *file, const char *metric, const char *channel, const uint64_t *histogram,
+                           uint64_t count, uint64_t sumUs) {
+    uint64_t cumulative = 0;
+    int bucket = 0;
+    /* The last bucket has no upper bound, it only shows in +Inf */
+    for (uint64_t bound = 1; bound < i2cHistogramUpperBound(SCHEDULE_HISTOGRAM_BUCKETS - 2); bound <<= 1) {
+        while (bucket < SCHEDULE_HISTOGRAM_BUCKETS && i2cHistogramUpperBound(bucket) <= bound) {
+            cumulative += histogram[bucket++];
+        }
+        fprintf(file, "%s_bucket{channel=\"%s\",le=\"%g\"} %" PRIu64 "\n", metric, channel, bound / 1e6, cumulative);
+    }
+    fprintf(file, "%s_bucket{channel=\"%s\",le=\"+Inf\"} %" PRIu64 "\n", metric, channel, count);
+    fprintf(file, "%s_sum{channel=\"%s\"} %g\n", metric, channel, sumUs / 1e6);
+    fprintf(file, "%s_count{channel=\"%s\"} %" PRIu64 "\n", metric, channel, count);
+}
+
+/**
+ * Writes the statistics in the Prometheus text format. The file
+ * is replaced atomically, so a scraper never reads half of it.
+ *
+ * @param stats opened statistics
+ * @param path target file
+ * @return 0 on success, -1 on failure
+ */
+int writeScheduleStatistics(const scheduleStats *stats, const char *path) {
+    char temporary[512];
+    snprintf(temporary, sizeof(temporary), "%s.%d.tmp", path, (int) getpid());
+    FILE *file = fopen(temporary, "w");
+    if (file == NULL) {
+        return -1;
+    }
+
+    fprintf(file, "# HELP cosybox_schedule_runs_total Scheduled runs per channel.\n");
+    fprintf(file, "# TYPE cosybox_schedule_runs_total counter\n");
+    fprintf(file, "# HELP cosybox_schedule_early_total Runs started before they were due.\n");
+    fprintf(file, "# TYPE cosybox_schedule_early_total counter\n");
+    fprintf(file, "# HELP cosybox_schedule_overruns_total Runs that ended after the next run was due.\n");
+    fprintf(file, "# TYPE cosybox_schedule_overruns_total counter\n");
+    fprintf(file, "# HELP cosybox_schedule_missed_total Periods skipped to catch up.\n");
+    fprintf(file, "# TYPE cosybox_schedule_missed_total counter\n");
+    fprintf(file, "# HELP cosybox_schedule_drift_seconds Start of the last run after the ideal schedule.\n");
+    fprintf(file, "# TYPE cosybox_schedule_drift_seconds gauge\n");
+    fprintf(file, "# HELP cosybox_schedule_lateness_seconds Start of a run after it was due.\n");
+    fprintf(file, "# TYPE cosybox_schedule_lateness_seconds histogram\n");
+    fprintf(file, "# HELP cosybox_schedule_jitter_seconds Difference of the period from the intended one.\n");
+    fprintf(file, "# TYPE cosybox_schedule_jitter_seconds histogram\n");
+    for (int i = 0; i < stats->channels; i++) {
+        const scheduleChannel *c = &stats->channel[i];
+        fprintf(file, "cosybox_schedule_runs_total{channel=\"%s\"} %" PRIu64 "\n", c->name, c->runs);
+        fprintf(file, "cosybox_schedule_early_total{channel=\"%s\"} %" PRIu64 "\n", c->name, c->early);
+        fprintf(file, "cosybox_schedule_overruns_total{channel=\"%s\"} %" PRIu64 "\n", c->name, c->overruns);
+        fprintf(file, "cosybox_schedule_missed_total{channel=\"%s\"} %" PRIu64 "\n", c->name, c->missed);
+        fprintf(file, "cosybox_schedule_drift_seconds{channel=\"%s\"} %g\n", c->name, c->driftUs / 1e6);
+        writeHistogram(file, "cosybox_schedule_lateness_seconds", c->name, c->lateHistogram, c->runs, c->lateUs);
+        writeHistogram(file, "cosybox_schedule_jitter_seconds", c->name, c->jitterHistogram, c->periods,
+                       c->jitterUs);
+    }
+
+    if (fclose(file) != 0 || rename(temporary, path) < 0) {
+        unlink(temporary);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Writes one line per channel that ran with its runs, lateness,
+ * jitter, drift and overruns.
+ *
+ * @param stats opened statistics
+ * @param file target, i. e. stderr
+ */
+void printScheduleSummary(const scheduleStats *stats, FILE *file) {
+    for (int i = 0; i < stats->channels; i++) {
+        const scheduleChannel *c = &stats->channel[i];
+        if (c->runs == 0) {
+            continue;
+        }
+        fprintf(file, "%s: %" PRIu64 " runs, late p50 %" PRIu64 "us p99 %" PRIu64 "us max %" PRId64 "us, "
+                      "jitter p50 %" PRIu64 "us p99 %" PRIu64 "us max %" PRId64 "us, drift %.3fs, "
+                      "%" PRIu64 " early, %" PRIu64 " overruns, %" PRIu64 " missed\n",
+                c->name, c->runs, schedulePercentile(c->lateHistogram, c->maxLateUs, 50),
+                schedulePercentile(c->lateHistogram, c->maxLateUs, 99), c->maxLateUs,
+                schedulePercentile(c->jitterHistogram, c->maxJitterUs, 50),
+                schedulePercentile(c->jitterHistogram, c->maxJitterUs, 99), c->maxJitterUs, c->driftUs / 1e6, c->early, c->overruns, c->missed);
+    }
+}
+
+/**
+ * Resets all counters and histograms, the channels stay.
+ *
+ * @param stats opened statistics
+ */
+void resetScheduleStats(scheduleStats *stats) {
+    for (int i = 0; i < stats->channels; i++) {
+        const char *name = stats->channel[i].name;
+        memset(&stats->channel[i], 0, sizeof(scheduleChannel));
+        stats->channel[i].name = name;
+    }
+}
+
+/**
+ * Returns the time of the monotonic clock the schedules are kept on.
+ *
+ * @return time in us
+ */
+int64_t scheduleClockUs(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/**
+ * Sleeps until an absolute time of the clock the schedules are kept
+ * on. A signal interrupting the sleep is passed to interrupted, a
+ * return other than 0 ends the sleep early, so a signal stopping
+ * the loop is handled at once and not after the next due time.
+ *
+ * @param us time to wake up, see scheduleClockUs
+ * @param interrupted called after every signal, NULL to sleep on
+ * @param context passed to interrupted
+ * @return 0 when the time was reached, otherwise the return of
+ *         interrupted
+ */
+int sleepUntilScheduled(int64_t us, int (*interrupted)(void *context), void *context) {
+    struct timespec until = {(time_t) (us / 1000000), (long) (us % 1000000) * 1000};
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL) == EINTR) {
+        int result = interrupted != NULL ? interrupted(context) : 0;
+        if (result != 0) {
+            return result;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,179 @@
+/**
+ * <Program>
+ * ScheduleStats.h
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ * Header file for the statistics of how well a sampling loop keeps
+ * its schedule. For every run of a channel (a sensor, its values
+ * share its schedule) the loop records when the run was due and
+ * when it really started:
+ *
+ *      lateness  actual - intended start of the run
+ *      jitter    |actual period - intended period|, the period
+ *                being the time since the last run
+ *      drift     start of the last run after the ideal schedule,
+ *                the first run plus the intended periods. A loop
+ *                that schedules every run from the start of the
+ *                last one carries the lateness over and drifts,
+ *                one sleeping until absolute times does not.
+ *      overrun   the run ended after the next one was due
+ *      missed    whole periods a loop skipped to catch up
+ *
+ * Runs started before they were due (because they were gathered
+ * with an earlier run) are counted as early, their lateness counts
+ * as 0 in the histogram.
+ *
+ * The times are of the monotonic clock (see scheduleClockUs): the
+ * wall clock of a box without RTC is stepped by NTP after the boot,
+ * a step forward would show as missed periods and drift, one back
+ * would stall the loop for its size. The wall clock only stamps the
+ * samples.
+ *
+ * Lateness and jitter go into log-linear histograms with the
+ * buckets of the I2C latency histograms (see I2CBus.h). The
+ * statistics are written in the Prometheus text format or as a
+ * summary for the end of a run. They are not synchronized, the
+ * loop owning them has to serialize the calls.
+ */
+
+#ifndef SRC_SCHEDULESTATS_H
+#define SRC_SCHEDULESTATS_H
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "I2CBus.h"
+
+#define SCHEDULE_CHANNELS_MAX       8
+#define SCHEDULE_HISTOGRAM_BUCKETS  I2C_HISTOGRAM_BUCKETS /* filled with i2cHistogramBucket */
+
+/* Used to hold the statistics of a single channel */
+typedef struct {
+    const char *name;
+    uint64_t runs;
+    uint64_t early;         /* runs started before they were due */
+    uint64_t overruns;      /* runs that ended after the next run was due */
+    uint64_t missed;        /* periods skipped to catch up */
+    int64_t lastActualUs;   /* start of the last run, 0 before the first one */
+    int64_t idealUs;        /* start of the last run on the ideal schedule, 0 before the first one */
+    uint64_t skipped;       /* periods missed since the last run */
+    int64_t driftUs;        /* start of the last run - idealUs */
+    uint64_t lateUs;        /* sum of the lateness of the runs that were late */
+    int64_t maxLateUs;
+    uint64_t periods;       /* runs after a previous one, i. e. jitter samples */
+    uint64_t jitterUs;
+    int64_t maxJitterUs;
+    uint64_t lateHistogram[SCHEDULE_HISTOGRAM_BUCKETS];
+    uint64_t jitterHistogram[SCHEDULE_HISTOGRAM_BUCKETS];
+} scheduleChannel;
+
+/* Used to hold the statistics of all channels of a loop */
+typedef struct {
+    int channels;
+    scheduleChannel channel[SCHEDULE_CHANNELS_MAX];
+} scheduleStats;
+
+/* METHODS */
+
+/**
+ * Initializes the statistics without channels.
+ *
+ * @param stats statistics to initialize
+ */
+void openScheduleStats(scheduleStats *stats);
+/**
+ * Adds a channel.
+ *
+ * @param stats opened statistics
+ * @param name name of the channel, must stay valid
+ * @return index of the channel, -1 if there are too many
+ */
+int addScheduleChannel(scheduleStats *stats, const char *name);
+/**
+ * Records a run of a channel.
+ *
+ * @param stats opened statistics
+ * @param channel index of the channel
+ * @param intendedUs time the run was due
+ * @param actualUs time the run started
+ * @param periodUs intended period, the next run is due periodUs
+ *        after this one
+ * @param durationUs duration of the run
+ */
+void recordScheduledRun(scheduleStats *stats, int channel, int64_t intendedUs, int64_t actualUs,
+                        int64_t periodUs, int64_t durationUs);
+/**
+ * Records periods a loop skipped because it was too late for them.
+ *
+ * @param stats opened statistics
+ * @param channel index of the channel
+ * @param periods number of skipped periods
+ */
+void recordMissedPeriods(scheduleStats *stats, int channel, uint64_t periods);
+/**
+ * Starts a new schedule, i. e. after the period was changed: the
+ * next run is taken as the start of the ideal schedule and not
+ * compared with the last one. The counters and histograms stay.
+ *
+ * @param stats opened statistics
+ */
+void restartSchedule(scheduleStats *stats);
+/**
+ * Estimates a percentile from a lateness or jitter histogram.
+ *
+ * @param histogram histogram of a channel
+ * @param maxUs exact maximum recorded in the histogram
+ * @param percentile value between 0 and 100
+ * @return upper bound of the bucket holding the percentile in us, at
+ *         most maxUs, so it never shows above the maximum
+ */
+uint64_t schedulePercentile(const uint64_t *histogram, int64_t maxUs, double percentile);
+/**
+ * Writes the statistics in the Prometheus text format. The file
+ * is replaced atomically, so a scraper never reads half of it.
+ *
+ * @param stats opened statistics
+ * @param path target file
+ * @return 0 on success, -1 on failure
+ */
+int writeScheduleStatistics(const scheduleStats *stats, const char *path);
+/**
+ * Writes one line per channel that ran with its runs, lateness,
+ * jitter, drift and overruns.
+ *
+ * @param stats opened statistics
+ * @param file target, i. e. stderr
+ */
+void printScheduleSummary(const scheduleStats *stats, FILE *file);
+/**
+ * Resets all counters and histograms, the channels stay.
+ *
+ * @param stats opened statistics
+ */
+void resetScheduleStats(scheduleStats *stats);
+/**
+ * Returns the time of the monotonic clock the schedules are kept on.
+ *
+ * @return time in us
+ */
+int64_t scheduleClockUs(void);
+/**
+ * Sleeps until an absolute time of the clock the schedules are kept
+ * on. A signal interrupting the sleep is passed to interrupted, a
+ * return other than 0 ends the sleep early, so a signal stopping
+ * the loop is handled at once and not after the next due time.
+ *
+ * @param us time to wake up, see scheduleClockUs
+ * @param interrupted called after every signal, NULL to sleep on
+ * @param context passed to interrupted
+ * @return 0 when the time was reached, otherwise the return of
+ *         interrupted
+ */
+int sleepUntilScheduled(int64_t us, int (*interrupted)(void *context), void *context);
+
+#endif //SRC_SCHEDULESTATS_H
@@ -0,0 +1,215 @@
+/**
+ * <Program>
+ * SensorDriver.c
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ *  Engine running the table driven sensor drivers in the states of
+ * the sensor loop: the init and trigger sequences are interpreted
+ * step by step, a wait ends the steps of a call and the loop arms
+ * the timer of the task with it. A result is read with the plan of
+ * the round in burst reads and decoded by the driver, then the
+ * engine converts every channel of the plan to its unit.
+ *  All register accesses go through the i2cTry* routines, so the
+ * retries and the circuit breaker apply to every driver alike.
+ *
+ * <Sources>
+ * Accessed on 18.10.2026 - Linux kernel SMBus protocol summary:
+ *      https://www.kernel.org/doc/html/latest/i2c/smbus-protocol.html
+ */
+
+#include "SensorDriver.h"
+
+/**
+ * Runs the steps of a sequence from *step on, up to the next wait
+ * or the end of the sequence.
+ *
+ * @return 1 at the end, 0 at a wait (waitUs is set, *step is the
+ *         step after it), I2C_* codes on failure
+ */
+static int runSteps(sensorTask *task, const driverStep *steps, int *step, uint32_t *waitUs) {
+    *waitUs = 0;
+    while (steps != NULL && steps[*step].op != DRIVER_END) {
+        const driverStep *current = &steps[(*step)++];
+        uint8_t value;
+        int status;
+        switch (current->op) {
+            case DRIVER_WRITE:
+                status = i2cTryWriteReg8(task->fd, current->reg, current->value);
+                break;
+            case DRIVER_EXPECT:
+                status = i2cTryReadReg8(task->fd, current->reg, &value);
+                if (status == I2C_OK && (value & current->mask) != current->value) {
+                    status = I2C_ERROR;
+                }
+                break;
+            case DRIVER_WAIT:
+                *waitUs = current->us;
+                return 0;
+            case DRIVER_RUN:
+                status = current->run(task->fd);
+                break;
+            case DRIVER_CALL:
+                status = current->call(task, waitUs);
+                if (status == I2C_OK && *waitUs > 0) {
+                    return 0;
+                }
+                break;
+            default:
+                status = I2C_ERROR;
+        }
+        if (status != I2C_OK) {
+            return status;
+        }
+    }
+    return 1;
+}
+
+/**
+ * Converts the channels a plan yields with the current settings and
+ * marks them as read.
+ *
+ * @return 1, the result is complete
+ */
+static int convertChannels(sensorTask *task, int index) {
+    const sensorDriver *driver = task->driver;
+    sensorRound *round = task->loop->round;
+    unsigned int channels = driver->plan[index].channels;
+    if (driver->yields != NULL) {
+        channels &= driver->yields(task, index);
+    }
+    for (int i = 0; i < driver->channels; i++) {
+        int channel = task->firstChannel + i;
+        if (channels & (1u << i)) {
+            round->value[channel] = driverValue(&driver->channel[i], round->raw[channel]);
+            round->valid |= 1u << channel;
+        }
+    }
+    return 1;
+}
+
+/**
+ * Runs the next steps of the init sequence of a sensor, up to the
+ * next wait.
+ *
+ * @param task task of the sensor, step is the next step to run
+ * @param waitUs set to the time until the next step
+ * @return 1 if the sequence is finished, 0 if it has to be called
+ *         again after waitUs, I2C_* codes on failure
+ */
+int driverSetup(sensorTask *task, uint32_t *waitUs) {
+    return runSteps(task, task->driver->init, &task->step, waitUs);
+}
+
+/**
+ * Runs the trigger sequence of a sensor.
+ *
+ * @param task task of a set up sensor
+ * @param waitUs set to the time until the result is due
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int driverTrigger(sensorTask *task, uint32_t *waitUs) {
+    int step = 0;
+    int result = runSteps(task, task->driver->trigger, &step, waitUs);
+    return result < 0 ? result : I2C_OK;
+}
+
+/**
+ * Reads the result of a sensor with the plan of this round, if it
+ * is ready, decodes it and converts the values of its channels.
+ *
+ * @param task task of a converting sensor
+ * @param waitUs set to the time until the result is checked again
+ * @return 1 if the result was read, 0 if it has to be called again
+ *         after waitUs, I2C_* codes on failure
+ */
+int driverCollect(sensorTask *task, uint32_t *waitUs) {
+    const sensorDriver *driver = task->driver;
+    int index = driver->selectPlan != NULL ? driver->selectPlan(task) : 0;
+    const driverPlan *plan = &driver->plan[index];
+    int status;
+
+    if (plan->statusReg != DRIVER_NO_STATUS) {
+        uint8_t value;
+        if ((status = i2cTryReadReg8(task->fd, plan->statusReg, &value)) != I2C_OK) {
+            return status;
+        }
+        if (value & plan->errorMask) {
+            return I2C_ERROR;
+        }
+        if ((value & plan->readyMask) != plan->readyValue) {
+            int result = 0;
+            *waitUs = 0;
+            if (driver->pending != NULL && (result = driver->pending(task, index, waitUs)) != 0) {
+                return result < 0 ? result : convertChannels(task, index);
+            }
+            if (*waitUs == 0) {
+                *waitUs = plan->pollUs;
+            }
+            return 0;
+        }
+    }
+
+    uint8_t raw[DRIVER_RAW_MAX];
+    int length = 0;
+    for (int i = 0; i < plan->bursts; i++) {
+        const driverBurst *burst = &plan->burst[i];
+        if ((status = i2cTryReadBlock(task->fd, burst->reg, raw + length, burst->length)) != I2C_OK) {
+            return status;
+        }
+        length += burst->length;
+    }
+    if ((status = driver->decode(task, index, raw)) != I2C_OK) {
+        return status;
+    }
+    return convertChannels(task, index);
+}
+
+/**
+ * Keeps the decoded raw value of a channel in the round in
+ * progress, to be converted after decode.
+ *
+ * @param task task of the sensor
+ * @param channel index of the channel in the driver
+ * @param raw raw value, the value is raw / divisor of the channel
+ */
+void driverKeepRaw(sensorTask *task, int channel, int64_t raw) {
+    task->loop->round->raw[task->firstChannel + channel] = raw;
+}
+
+/**
+ * Converts the raw value of a channel to its unit.
+ *
+ * @param channel channel of a driver
+ * @param raw raw value as kept by driverKeepRaw
+ * @return value in the unit of the channel
+ */
+double driverValue(const driverChannel *channel, int64_t raw) {
+    return raw / channel->divisor;
+}
+
+/**
+ * Finds a channel of the box by its number, the channels of
+ * boxDrivers are numbered in their order.
+ *
+ * @param channel number of the channel
+ * @param sensor set to the LOOP_* index of its sensor, may be NULL
+ * @return the channel, NULL if there is no such channel
+ */
+const driverChannel *boxChannel(int channel, int *sensor) {
+    for (int i = 0; i < boxSensors && channel >= 0; i++) {
+        if (channel < boxDrivers[i]->channels) {
+            if (sensor != NULL) {
+                *sensor = i;
+            }
+            return &boxDrivers[i]->channel[channel];
+        }
+        channel -= boxDrivers[i]->channels;
+    }
+    return NULL;
+}
@@ -0,0 +1,203 @@
+/**
+ * <Program>
+ * SensorDriver.h
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ * Header file for the table driven sensor drivers. A driver is a
+ * descriptor the sensor loop runs, no code of its own is needed
+ * besides hooks for what a table can not describe:
+ *
+ *      init      sequence of steps run once after the device was
+ *                opened: register writes and checks, waits (the
+ *                loop uses the bus for the other sensors meanwhile),
+ *                driver routines and hooks
+ *      trigger   sequence of steps starting a conversion, a wait as
+ *                its last step is the time until the result is due
+ *      plan      how a result is read: a status register polled
+ *                until the result is ready, then burst reads into a
+ *                raw buffer. A driver may have several plans, i. e.
+ *                per measurement mode, a hook selects one per round
+ *      decode    turns the raw buffer into the raw values of the
+ *                channels, kept in the round with driverKeepRaw
+ *      channels  name, unit and scale of every value, with the
+ *                hints for the adaptive sampling and outlier filter
+ *
+ * The engine runs any descriptor through the sensor loop, so a new
+ * sensor gets the overlapping conversions, circuit breaker and
+ * retries of I2CBus.h, the schedule statistics, the adaptive
+ * sampling, the outlier filter and the exports of the rounds by the
+ * sensorLoop module, the snapshot of the cosybox module (a field per
+ * channel, the status and time fields named after field) and the
+ * shared sample (see SampleShare.h), all laid out after the
+ * descriptors, by adding its descriptor to boxDrivers in
+ * BoxSensors.c. A LOOP_* index in SensorLoop.h is only needed for
+ * code that refers to the sensor itself, i. e. its settings. Not
+ * covered: a stream sampling a sensor faster than the rounds has a
+ * descriptor of its own (see SensorStream.h).
+ *
+ * Channels are numbered through all drivers in the order of
+ * boxDrivers. The engine converts the values of every channel a
+ * plan yields to its unit after decode, see sensorRound.value. A
+ * hook may narrow them to the channels the settings of the sensor
+ * measure, the others are not marked as read.
+ */
+
+#ifndef SRC_SENSORDRIVER_H
+#define SRC_SENSORDRIVER_H
+
+#include "SensorLoop.h"
+
+/* --- Operations of a step --- */
+#define DRIVER_END    0  /* end of the sequence */
+#define DRIVER_WRITE  1  /* writes value to reg */
+#define DRIVER_EXPECT 2  /* reads reg, fails unless (reg & mask) == value */
+#define DRIVER_WAIT   3  /* the next step is run us later */
+#define DRIVER_RUN    4  /* runs a driver routine on the device */
+#define DRIVER_CALL   5  /* runs a hook with access to the task and loop */
+
+#define DRIVER_PLANS_MAX    2
+#define DRIVER_BURSTS_MAX   2
+#define DRIVER_CHANNELS_MAX 8
+#define DRIVER_RAW_MAX      32   /* bytes of all bursts of a plan */
+#define DRIVER_NO_STATUS    -1   /* the result of a plan is always ready */
+
+/* Used to describe a step of an init or trigger sequence */
+typedef struct {
+    uint8_t op;
+    uint8_t reg;
+    uint8_t value;
+    uint8_t mask;
+    uint32_t us;                                        /* DRIVER_WAIT */
+    int (*run)(int fd);                                 /* DRIVER_RUN */
+    /*
+     * DRIVER_CALL: returns I2C_OK or an I2C_* code on failure and
+     * may set waitUs to wait before the next step
+     */
+    int (*call)(sensorTask *task, uint32_t *waitUs);
+} driverStep;
+
+/* Used to describe a burst read */
+typedef struct {
+    uint8_t reg;
+    uint8_t length;
+} driverBurst;
+
+/* Used to describe how a result is read */
+typedef struct {
+    int statusReg;          /* DRIVER_NO_STATUS if the result is always ready */
+    uint8_t readyMask;      /* ready if (status & readyMask) == readyValue */
+    uint8_t readyValue;
+    uint8_t errorMask;      /* the read failed if one of the bits is set */
+    uint32_t pollUs;        /* re-check of a result that is not ready */
+    int bursts;
+    driverBurst burst[DRIVER_BURSTS_MAX]; /* read one after the other into the raw buffer */
+    unsigned int channels;  /* bit (1 << channel of the driver) of every channel the plan yields */
+} driverPlan;
+
+/* Used to describe a value of a sensor */
+typedef struct {
+    const char *name;
+    const char *unit;
+    const char *description; /* doc of the value in the exports */
+    uint8_t integer;        /* 1 if the value is a count, exported as an integer */
+    double divisor;         /* value in unit = raw value / divisor */
+    double rate;            /* change per second counting as active (see AdaptiveSampler.h) */
+    double deviation;       /* standard deviation counting as active */
+    double resolution;      /* smallest scale of the outlier filter (see OutlierFilter.h) */
+} driverChannel;
+
+/* Used to describe a sensor */
+typedef struct sensorDriver {
+    const char *name;
+    const char *field;      /* prefix of the fields of the sensor in the exports, i. e. env for env_status */
+    int address;
+    uint32_t startupUs;     /* about the time to the first sample, the slowest sensors are set up first */
+    const driverStep *init;
+    const driverStep *trigger;
+    int plans;
+    driverPlan plan[DRIVER_PLANS_MAX];
+    /* Returns the plan of this round, NULL to always use plan 0 */
+    int (*selectPlan)(const sensorTask *task);
+    /*
+     * Called if the result is not ready yet, NULL to poll again.
+     * Returns 1 if it set the result itself (i. e. one that is
+     * still current), 0 to poll again after waitUs or the plan's
+     * pollUs if it is left at 0, I2C_* codes on failure.
+     */
+    int (*pending)(sensorTask *task, int plan, uint32_t *waitUs);
+    /* Decodes the raw buffer into the raw values of the channels, returns I2C_OK or an I2C_* code */
+    int (*decode)(sensorTask *task, int plan, const uint8_t *raw);
+    /* Returns the channels of the plan measured with the current settings, NULL for all of them */
+    unsigned int (*yields)(const sensorTask *task, int plan);
+    int channels;
+    driverChannel channel[DRIVER_CHANNELS_MAX];
+} sensorDriver;
+
+/* Drivers of the box in the order of the LOOP_* indices, see BoxSensors.c */
+extern const sensorDriver *const boxDrivers[];
+extern const int boxSensors; /* number of boxDrivers */
+
+/* METHODS */
+
+/**
+ * Runs the next steps of the init sequence of a sensor, up to the
+ * next wait.
+ *
+ * @param task task of the sensor, step is the next step to run
+ * @param waitUs set to the time until the next step
+ * @return 1 if the sequence is finished, 0 if it has to be called
+ *         again after waitUs, I2C_* codes on failure
+ */
+int driverSetup(sensorTask *task, uint32_t *waitUs);
+/**
+ * Runs the trigger sequence of a sensor.
+ *
+ * @param task task of a set up sensor
+ * @param waitUs set to the time until the result is due
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN on failure
+ */
+int driverTrigger(sensorTask *task, uint32_t *waitUs);
+/**
+ * Reads the result of a sensor with the plan of this round, if it
+ * is ready, decodes it and converts the values of its channels.
+ *
+ * @param task task of a converting sensor
+ * @param waitUs set to the time until the result is checked again
+ * @return 1 if the result was read, 0 if it has to be called again
+ *         after waitUs, I2C_* codes on failure
+ */
+int driverCollect(sensorTask *task, uint32_t *waitUs);
+/**
+ * Keeps the decoded raw value of a channel in the round in
+ * progress, to be converted after decode.
+ *
+ * @param task task of the sensor
+ * @param channel index of the channel in the driver
+ * @param raw raw value, the value is raw / divisor of the channel
+ */
+void driverKeepRaw(sensorTask *task, int channel, int64_t raw);
+/**
+ * Converts the raw value of a channel to its unit.
+ *
+ * @param channel channel of a driver
+ * @param raw raw value as kept by driverKeepRaw
+ * @return value in the unit of the channel
+ */
+double driverValue(const driverChannel *channel, int64_t raw);
+/**
+ * Finds a channel of the box by its number, the channels of
+ * boxDrivers are numbered in their order.
+ *
+ * @param channel number of the channel
+ * @param sensor set to the LOOP_* index of its sensor, may be NULL
+ * @return the channel, NULL if there is no such channel
+ */
+const driverChannel *boxChannel(int channel, int *sensor);
+
+#endif //SRC_SENSORDRIVER_H
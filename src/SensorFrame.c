@@ -0,0 +1,361 @@
+/**
+ * <Program>
+ * SensorFrame.c
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ *  Encoding and decoding of the frames boxes send their samples
+ * to the collector in. Frames come from the network, so the
+ * decoder checks every single read against the end of the frame
+ * and every value against the range of its channel before it is
+ * used, no input can make it read out of bounds or overflow.
+ *  The CRC32C uses the CRC instruction of SSE 4.2 or ARMv8 if the
+ * compiler targets it, otherwise a slice-by-8 table. Both take 8
+ * bytes at a time as little endian words, which are put together
+ * byte by byte so the CRC is the same on big endian CPUs.
+ *
+ * <Sources>
+ * Accessed on 18.10.2026 - Protocol Buffers encoding (varint, zigzag):
+ *      https://protobuf.dev/programming-guides/encoding/
+ * Accessed on 18.10.2026 - RFC 3720, appendix B.4 (CRC32C):
+ *      https://www.rfc-editor.org/rfc/rfc3720#appendix-B.4
+ */
+
+#include "SensorFrame.h"
+
+#if defined(__SSE4_2__)
+#include <nmmintrin.h>
+#elif defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+/* Longest varint of a 64 bit value */
+#define VARINT_MAX 10
+
+#define CRC32C_POLYNOMIAL 0x82F63B78 /* reversed */
+
+/* Lower and upper bound of every channel, in the order they are encoded */
+static const int64_t channelMin[FRAME_CHANNELS] = {INT32_MIN, 0, 0, 0, 0, 0, 0, 0};
+static const int64_t channelMax[FRAME_CHANNELS] = {
+        INT32_MAX, UINT32_MAX, UINT32_MAX, UINT16_MAX, UINT16_MAX, UINT16_MAX, UINT16_MAX, UINT16_MAX
+};
+
+/**
+ * Reads a 32 bit little endian value. Compiles to a single load on
+ * little endian CPUs.
+ */
+static inline uint32_t loadLittle32(const uint8_t *bytes) {
+    return (uint32_t) bytes[0] | (uint32_t) bytes[1] << 8 | (uint32_t) bytes[2] << 16 | (uint32_t) bytes[3] << 24;
+}
+
+#if !defined(__SSE4_2__) && !defined(__ARM_FEATURE_CRC32)
+static uint32_t crcTable[8][256];
+
+/**
+ * Fills the slice-by-8 tables once when the program is loaded.
+ */
+__attribute__((constructor)) static void initCrcTable(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (CRC32C_POLYNOMIAL & (0 - (crc & 1)));
+        }
+        crcTable[0][i] = crc;
+    }
+    for (uint32_t i = 0; i < 256; i++) {
+        for (int slice = 1; slice < 8; slice++) {
+            crcTable[slice][i] = (crcTable[slice - 1][i] >> 8) ^ crcTable[0][crcTable[slice - 1][i] & 0xFF];
+        }
+    }
+}
+#endif
+
+/**
+ * Calculates the CRC32C (Castagnoli) of the data, with the CRC
+ * instruction if the CPU has one.
+ *
+ * @param crc CRC of the preceding data, 0 at the start
+ * @param data data to add
+ * @param length number of bytes
+ * @return updated CRC
+ */
+uint32_t crc32c(uint32_t crc, const void *data, size_t length) {
+    const uint8_t *bytes = data;
+    crc = ~crc;
+
+#if defined(__SSE4_2__) || defined(__ARM_FEATURE_CRC32)
+    for (; length >= 8; length -= 8, bytes += 8) {
+        uint64_t word = loadLittle32(bytes) | (uint64_t) loadLittle32(bytes + 4) << 32;
+#if defined(__SSE4_2__)
+        crc = (uint32_t) _mm_crc32_u64(crc, word);
+#else
+        crc = __crc32cd(crc, word);
+#endif
+    }
+    for (; length > 0; length--, bytes++) {
+#if defined(__SSE4_2__)
+        crc = _mm_crc32_u8(crc, *bytes);
+#else
+        crc = __crc32cb(crc, *bytes);
+#endif
+    }
+#else
+    for (; length >= 8; length -= 8, bytes += 8) {
+        uint32_t low = loadLittle32(bytes) ^ crc;
+        uint32_t high = loadLittle32(bytes + 4);
+        crc = crcTable[7][low & 0xFF] ^ crcTable[6][(low >> 8) & 0xFF] ^
+              crcTable[5][(low >> 16) & 0xFF] ^ crcTable[4][low >> 24] ^
+              crcTable[3][high & 0xFF] ^ crcTable[2][(high >> 8) & 0xFF] ^
+              crcTable[1][(high >> 16) & 0xFF] ^ crcTable[0][high >> 24];
+    }
+    for (; length > 0; length--, bytes++) {
+        crc = (crc >> 8) ^ crcTable[0][(crc ^ *bytes) & 0xFF];
+    }
+#endif
+    return ~crc;
+}
+
+/**
+ * Writes an unsigned varint, 7 bits per byte starting with the
+ * lowest, the highest bit is set in all bytes but the last.
+ *
+ * @return 0 on success, -1 if the buffer is too small
+ */
+static int writeUvarint(uint8_t **position, const uint8_t *end, uint64_t value) {
+    uint8_t *out = *position;
+    do {
+        if (out == end) {
+            return -1;
+        }
+        uint8_t byte = (uint8_t) (value & 0x7F);
+        value >>= 7;
+        *out++ = (uint8_t) (value != 0 ? byte | 0x80 : byte);
+    } while (value != 0);
+    *position = out;
+    return 0;
+}
+
+/**
+ * Reads an unsigned varint. Varints running past the end, longer
+ * than 64 bits or with needless zero bytes at the end are invalid.
+ *
+ * @return 0 on success, -1 if the varint is invalid
+ */
+static int readUvarint(const uint8_t **position, const uint8_t *end, uint64_t *value) {
+    const uint8_t *in = *position;
+    uint64_t result = 0;
+    for (int shift = 0; shift < VARINT_MAX * 7; shift += 7) {
+        if (in == end) {
+            return -1;
+        }
+        uint8_t byte = *in++;
+        if (shift == 63 && byte > 1) {
+            return -1;
+        }
+        result |= (uint64_t) (byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            if (byte == 0 && shift > 0) {
+                return -1;
+            }
+            *value = result;
+            *position = in;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Maps signed to unsigned values so small differences in both
+ * directions get small varints (0, -1, 1, -2, ... -> 0, 1, 2, 3, ...).
+ */
+static uint64_t zigzag(int64_t value) {
+    return ((uint64_t) value << 1) ^ (uint64_t) (value >> 63);
+}
+
+static int64_t unzigzag(uint64_t value) {
+    return (int64_t) (value >> 1) ^ -(int64_t) (value & 1);
+}
+
+/**
+ * Copies the channels of a sample in the order they are encoded.
+ */
+static void channelsOf(const frameSample *sample, int64_t channels[FRAME_CHANNELS]) {
+    channels[0] = sample->temperature;
+    channels[1] = sample->pressure;
+    channels[2] = sample->humidity;
+    channels[3] = sample->uv;
+    channels[4] = sample->ir;
+    channels[5] = sample->vis;
+    channels[6] = sample->eCO2;
+    channels[7] = sample->TVOC;
+}
+
+/**
+ * Writes a frame with the given samples. The times of the samples
+ * have to be non-decreasing.
+ *
+ * @param buffer receives the frame
+ * @param capacity size of the buffer, FRAME_BYTES_MAX always fits
+ * @param boxId ID of the sending box
+ * @param samples samples to send
+ * @param count number of samples, 1 to FRAME_SAMPLES_MAX
+ * @return length of the frame, -1 if the samples can not be encoded
+ */
+long encodeFrame(uint8_t *buffer, size_t capacity, uint32_t boxId, const frameSample *samples, size_t count) {
+    if (count == 0 || count > FRAME_SAMPLES_MAX || capacity < FRAME_BYTES_MIN || samples[0].time < 0) {
+        return -1;
+    }
+    uint8_t *out = buffer;
+    const uint8_t *end = buffer + capacity - sizeof(uint32_t);
+
+    *out++ = FRAME_MAGIC;
+    *out++ = FRAME_VERSION;
+    int64_t time = samples[0].time;
+    if (writeUvarint(&out, end, boxId) < 0 || writeUvarint(&out, end, count) < 0 ||
+        writeUvarint(&out, end, (uint64_t) time) < 0) {
+        return -1;
+    }
+
+    int64_t previous[FRAME_CHANNELS] = {0};
+    for (size_t i = 0; i < count; i++) {
+        int64_t channels[FRAME_CHANNELS];
+        if (samples[i].time < time || writeUvarint(&out, end, (uint64_t) (samples[i].time - time)) < 0 ||
+            out == end) {
+            return -1;
+        }
+        time = samples[i].time;
+        *out++ = samples[i].status;
+
+        channelsOf(&samples[i], channels);
+        for (int channel = 0; channel < FRAME_CHANNELS; channel++) {
+            if (writeUvarint(&out, end, zigzag(channels[channel] - previous[channel])) < 0) {
+                return -1;
+            }
+            previous[channel] = channels[channel];
+        }
+    }
+
+    uint32_t crc = crc32c(0, buffer, (size_t) (out - buffer));
+    for (int i = 0; i < 4; i++) {
+        *out++ = (uint8_t) (crc >> (8 * i));
+    }
+    return (long) (out - buffer);
+}
+
+/**
+ * Reads magic, version, box ID and sample count.
+ *
+ * @return 0 on success, -1 if the header is invalid
+ */
+static int readHeader(const uint8_t **position, const uint8_t *end, frameHeader *header) {
+    uint64_t boxId, count;
+    const uint8_t *in = *position;
+    if (end - in < 2 || in[0] != FRAME_MAGIC || in[1] != FRAME_VERSION) {
+        return -1;
+    }
+    header->version = in[1];
+    in += 2;
+    if (readUvarint(&in, end, &boxId) < 0 || boxId > UINT32_MAX ||
+        readUvarint(&in, end, &count) < 0 || count == 0 || count > FRAME_SAMPLES_MAX) {
+        return -1;
+    }
+    header->boxId = (uint32_t) boxId;
+    header->count = (uint16_t) count;
+    *position = in;
+    return 0;
+}
+
+/**
+ * Checks a received frame and decodes its samples. Any frame
+ * that is not exactly what encodeFrame writes is rejected: a
+ * wrong magic, version or CRC, varints that are too long or run
+ * past the end, values out of range of their channel, decreasing
+ * times or bytes left over.
+ *
+ * @param data received frame
+ * @param length length of the frame
+ * @param header receives the header
+ * @param samples receives the samples, FRAME_SAMPLES_MAX entries
+ * @return number of samples, -1 if the frame is invalid
+ */
+long decodeFrame(const uint8_t *data, size_t length, frameHeader *header, frameSample *samples) {
+    if (length < FRAME_BYTES_MIN || length > FRAME_BYTES_MAX) {
+        return -1;
+    }
+    const uint8_t *end = data + length - sizeof(uint32_t);
+    uint32_t crc = loadLittle32(end);
+    if (crc32c(0, data, length - sizeof(uint32_t)) != crc) {
+        return -1;
+    }
+
+    const uint8_t *in = data;
+    uint64_t baseTime;
+    if (readHeader(&in, end, header) < 0 || readUvarint(&in, end, &baseTime) < 0 || baseTime > INT64_MAX) {
+        return -1;
+    }
+    header->baseTime = (int64_t) baseTime;
+
+    int64_t time = header->baseTime;
+    int64_t channels[FRAME_CHANNELS] = {0};
+    for (int i = 0; i < header->count; i++) {
+        uint64_t delta;
+        /* The base time is the time of the first sample, its difference is always 0 */
+        if (readUvarint(&in, end, &delta) < 0 || delta > INT64_MAX || (i == 0 && delta != 0) ||
+            __builtin_add_overflow(time, (int64_t) delta, &time) || in == end) {
+            return -1;
+        }
+        frameSample *sample = &samples[i];
+        sample->time = time;
+        sample->status = *in++;
+
+        for (int channel = 0; channel < FRAME_CHANNELS; channel++) {
+            /* Channels are kept in range, so the sum of two of them can not overflow */
+            if (readUvarint(&in, end, &delta) < 0) {
+                return -1;
+            }
+            int64_t change = unzigzag(delta);
+            if (change < channelMin[channel] - channelMax[channel] || change > channelMax[channel] - channelMin[channel]) {
+                return -1;
+            }
+            channels[channel] += change;
+            if (channels[channel] < channelMin[channel] || channels[channel] > channelMax[channel]) {
+                return -1;
+            }
+        }
+        sample->temperature = (int32_t) channels[0];
+        sample->pressure = (uint32_t) channels[1];
+        sample->humidity = (uint32_t) channels[2];
+        sample->uv = (uint16_t) channels[3];
+        sample->ir = (uint16_t) channels[4];
+        sample->vis = (uint16_t) channels[5];
+        sample->eCO2 = (uint16_t) channels[6];
+        sample->TVOC = (uint16_t) channels[7];
+    }
+
+    return in == end ? header->count : -1;
+}
+
+/**
+ * Reads the box ID of a frame without checking the rest, used to
+ * pick the worker before the frame is decoded.
+ *
+ * @param data received frame
+ * @param length length of the frame
+ * @param boxId receives the box ID
+ * @return 0 on success, -1 if the frame has no valid header
+ */
+int peekFrameBox(const uint8_t *data, size_t length, uint32_t *boxId) {
+    frameHeader header;
+    const uint8_t *in = data;
+    if (length < FRAME_BYTES_MIN || readHeader(&in, data + length, &header) < 0) {
+        return -1;
+    }
+    *boxId = header.boxId;
+    return 0;
+}
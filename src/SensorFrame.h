@@ -0,0 +1,135 @@
+/**
+ * <Program>
+ * SensorFrame.h
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ * Header file for the frames boxes send their samples to the
+ * collector in. Over UDP every datagram is one frame, over TCP
+ * every frame is preceded by its length as 32 bit little endian
+ * value.
+ *
+ * Since the uplinks of the boxes are slow, samples are delta
+ * encoded: the time and every channel are stored as difference to
+ * the previous sample, zigzag and varint encoded, so slowly
+ * changing values take a single byte. A frame looks like this:
+ *
+ *      u8       magic (0xCB)
+ *      u8       version of the format and channel set (2)
+ *      uvarint  box ID
+ *      uvarint  number of samples
+ *      uvarint  base time (us since epoch), the time of the first
+ *               sample
+ *      samples  uvarint time since the previous sample (0 for the
+ *               first), u8 status and one zigzag
+ *               varint per channel holding the difference to the
+ *               previous sample (the first to 0)
+ *      u32      CRC32C of everything before, little endian
+ *
+ * Version 1 was the fixed size layout of the first collector, it
+ * is not accepted any more.
+ *
+ * <Sources>
+ * Accessed on 18.10.2026 - Protocol Buffers encoding (varint, zigzag):
+ *      https://protobuf.dev/programming-guides/encoding/
+ * Accessed on 18.10.2026 - RFC 3720, appendix B.4 (CRC32C):
+ *      https://www.rfc-editor.org/rfc/rfc3720#appendix-B.4
+ */
+
+#ifndef SRC_SENSORFRAME_H
+#define SRC_SENSORFRAME_H
+
+#include <inttypes.h>
+#include <stdlib.h>
+
+#define FRAME_MAGIC       0xCB
+#define FRAME_VERSION     2
+#define FRAME_CHANNELS    8
+#define FRAME_SAMPLES_MAX 256
+/* Worst case: 2 byte header, 3 varints, 256 samples of 41 bytes and the CRC */
+#define FRAME_BYTES_MAX   16384
+/* Smallest possible frame: header, three one byte varints and the CRC */
+#define FRAME_BYTES_MIN   9
+
+/* Status bits of a sample, set if the sensor failed in that round */
+#define FRAME_ENV_FAILED   0x01
+#define FRAME_LIGHT_FAILED 0x02
+#define FRAME_AIR_FAILED   0x04
+
+/* Used to hold the header of a decoded frame */
+typedef struct {
+    uint8_t version;
+    uint32_t boxId;
+    uint16_t count;
+    int64_t baseTime;    /* us since epoch */
+} frameHeader;
+
+/* Used to hold all channels of one round */
+typedef struct {
+    int64_t time;        /* us since epoch */
+    int32_t temperature; /* C * 100 */
+    uint32_t pressure;   /* Pa in Q24.8 */
+    uint32_t humidity;   /* %RH in Q22.10 */
+    uint16_t uv;         /* UV index * 100 */
+    uint16_t ir;
+    uint16_t vis;
+    uint16_t eCO2;
+    uint16_t TVOC;
+    uint8_t status;
+} frameSample;
+
+/* METHODS */
+
+/**
+ * Writes a frame with the given samples. The times of the samples
+ * have to be non-decreasing.
+ *
+ * @param buffer receives the frame
+ * @param capacity size of the buffer, FRAME_BYTES_MAX always fits
+ * @param boxId ID of the sending box
+ * @param samples samples to send
+ * @param count number of samples, 1 to FRAME_SAMPLES_MAX
+ * @return length of the frame, -1 if the samples can not be encoded
+ */
+long encodeFrame(uint8_t *buffer, size_t capacity, uint32_t boxId, const frameSample *samples, size_t count);
+/**
+ * Checks a received frame and decodes its samples. Any frame
+ * that is not exactly what encodeFrame writes is rejected: a
+ * wrong magic, version or CRC, varints that are too long or run
+ * past the end, values out of range of their channel, decreasing
+ * times or bytes left over.
+ *
+ * @param data received frame
+ * @param length length of the frame
+ * @param header receives the header
+ * @param samples receives the samples, FRAME_SAMPLES_MAX entries
+ * @return number of samples, -1 if the frame is invalid
+ */
+long decodeFrame(const uint8_t *data, size_t length, frameHeader *header, frameSample *samples);
+/**
+ * Reads the box ID of a frame without checking the rest, used to
+ * pick the worker before the frame is decoded.
+ *
+ * @param data received frame
+ * @param length length of the frame
+ * @param boxId receives the box ID
+ * @return 0 on success, -1 if the frame has no valid header
+ */
+int peekFrameBox(const uint8_t *data, size_t length, uint32_t *boxId);
+/**
+ * Calculates the CRC32C (Castagnoli) of the data, with the CRC
+ * instruction if the CPU has one.
+ *
+ * @param crc CRC of the preceding data, 0 at the start
+ * @param data data to add
+ * @param length number of bytes
+ * @return updated CRC
+ */
+uint32_t crc32c(uint32_t crc, const void *data, size_t length);
+
+#endif //SRC_SENSORFRAME_H
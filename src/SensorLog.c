@@ -0,0 +1,1000 @@
+/**
+ * <Program>
+ * SensorLog.c
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ *  This is the storage class used by the COSY-Lab-IoT-Box to
+ * persist sensor rows. Rows are appended to numbered segment
+ * files. For every 4 KiB block of a segment the time of the
+ * first row starting in that block is written to a sidecar
+ * index file and each segment is listed in a catalog with its
+ * time range. A range read binary searches the catalog and the
+ * index and then reads just the blocks covering the range using
+ * pread, instead of scanning the CSV from the beginning.
+ *  Additionally this class holds the methods to communicate
+ * with Python software using the CPython library.
+ *
+ * <Sources>
+ * Accesses on 11.01.2018 - Extending Python with C
+ *      https://docs.python.org/2/extending/extending.html
+ */
+
+#ifdef SENSOR_NO_PYTHON
+/* Python.h defines it otherwise, needed for fallocate and O_DIRECT */
+#define _GNU_SOURCE
+#else
+#include <Python.h>
+#endif
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "SensorLog.h"
+
+#define LOG_HANDLES_MAX 8
+
+/**
+ * Returns the current time of the monotonic clock in milliseconds.
+ */
+static int64_t monotonicMs(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t) now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+/**
+ * Writes the whole buffer at the given offset, pwrite may write
+ * less than requested. Every call is counted in the statistics.
+ *
+ * @param log opened log
+ * @param fd file descriptor
+ * @param buffer data to write
+ * @param length number of bytes
+ * @param offset file offset
+ * @return 0 on success, -1 on failure
+ */
+static int writeFully(sensorLog *log, int fd, const void *buffer, size_t length, uint64_t offset) {
+    const char *data = buffer;
+    while (length > 0) {
+        ssize_t written = pwrite(fd, data, length, (off_t) offset);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        log->stats.writeCalls++;
+        log->stats.writtenBytes += written;
+        data += written;
+        length -= written;
+        offset += written;
+    }
+    return 0;
+}
+
+/**
+ * Builds the path of a file belonging to the log. Segment and
+ * index files carry the segment number, the catalog does not
+ * (segment 0).
+ *
+ * @param path buffer of at least LOG_NAME_MAX + 16 bytes
+ * @param name path prefix of the log
+ * @param segment segment number, 0 for the catalog
+ * @param suffix file suffix
+ */
+static void logPath(char *path, const char *name, uint32_t segment, const char *suffix) {
+    if (segment == 0) {
+        snprintf(path, LOG_NAME_MAX + 16, "%s.%s", name, suffix);
+    } else {
+        snprintf(path, LOG_NAME_MAX + 16, "%s.%06" PRIu32 ".%s", name, segment, suffix);
+    }
+}
+
+/**
+ * Writes the catalog entry of the current segment in place.
+ *
+ * @param log opened log
+ * @return 0 on success, -1 on failure
+ */
+static int updateCatalog(sensorLog *log) {
+    uint64_t offset = (uint64_t) (log->catalogEntries - 1) * sizeof(catalogEntry);
+    return writeFully(log, log->catalogFd, &log->current, sizeof(catalogEntry), offset);
+}
+
+/**
+ * Cuts the zero padding of the last write off the segment, so the
+ * file ends with the data like any CSV file. Cutting also frees the
+ * blocks preallocated behind it, they are reserved again.
+ *
+ * @param log opened log
+ * @param end bytes of data in the segment
+ * @return 0 on success, -1 on failure
+ */
+static int trimPadding(sensorLog *log, uint64_t end) {
+    if (ftruncate(log->segmentFd, (off_t) end) < 0) {
+        return -1;
+    }
+    if (end < log->config.segmentSize &&
+        fallocate(log->segmentFd, FALLOC_FL_KEEP_SIZE, (off_t) end, (off_t) (log->config.segmentSize - end)) < 0) {
+        log->stats.preallocFailures++;
+    }
+    return 0;
+}
+
+/**
+ * Writes the buffered data as whole aligned blocks, the unused
+ * end of the last block is zero padded and cut off again right
+ * after the write. The partly filled last block stays in the
+ * buffer and is written again by the next flush, that rewrite is
+ * what shows up as write amplification. Afterwards the pending
+ * index entries and the catalog are written, so readers never see
+ * an offset that is not on disk.
+ *
+ * @param log opened log
+ * @return 0 on success, -1 on failure
+ */
+static int flushBuffer(sensorLog *log) {
+    size_t aligned = (log->bufferUsed + LOG_ALIGN - 1) / LOG_ALIGN * LOG_ALIGN;
+    size_t complete = log->bufferUsed / LOG_ALIGN * LOG_ALIGN;
+
+    if (aligned > 0) {
+        memset(log->buffer + log->bufferUsed, 0, aligned - log->bufferUsed);
+        if (writeFully(log, log->segmentFd, log->buffer, aligned, log->bufferOffset) < 0 ||
+            (aligned > log->bufferUsed && trimPadding(log, log->bufferOffset + log->bufferUsed) < 0)) {
+            return -1;
+        }
+        memmove(log->buffer, log->buffer + complete, log->bufferUsed - complete);
+        log->bufferUsed -= complete;
+        log->bufferOffset += complete;
+    }
+
+    if (log->indexPending > 0) {
+        uint64_t offset = (uint64_t) (log->current.indexEntries - log->indexPending) * sizeof(indexEntry);
+        if (writeFully(log, log->indexFd, log->index, log->indexPending * sizeof(indexEntry), offset) < 0) {
+            return -1;
+        }
+        log->indexPending = 0;
+    }
+
+    log->stats.flushes++;
+    log->lastFlush = monotonicMs();
+    return updateCatalog(log);
+}
+
+/**
+ * Copies data into the chunk buffer, every time the buffer is
+ * full it is written out.
+ *
+ * @param log opened log
+ * @param data bytes to append
+ * @param length number of bytes
+ * @return 0 on success, -1 on failure
+ */
+static int bufferData(sensorLog *log, const char *data, size_t length) {
+    while (length > 0) {
+        size_t space = log->config.chunkSize - log->bufferUsed;
+        size_t part = length < space ? length : space;
+        memcpy(log->buffer + log->bufferUsed, data, part);
+        log->bufferUsed += part;
+        data += part;
+        length -= part;
+        if (log->bufferUsed == log->config.chunkSize && flushBuffer(log) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Creates the next segment and its index, preallocates both,
+ * buffers the header line and registers the segment in the
+ * catalog.
+ *
+ * @param log opened log
+ * @param segment number of the new segment
+ * @return 0 on success, -1 on failure
+ */
+static int startSegment(sensorLog *log, uint32_t segment) {
+    char path[LOG_NAME_MAX + 16];
+    char header[LOG_HEADER_MAX + 8];
+    int length = snprintf(header, sizeof(header), "%s;Time\n", log->header);
+    int flags = O_WRONLY | O_CREAT | O_TRUNC;
+
+    logPath(path, log->name, segment, "csv");
+    log->segmentFd = open(path, flags | (log->config.directIO ? O_DIRECT : 0), 0644);
+    if (log->segmentFd < 0 && log->config.directIO && errno == EINVAL) {
+        /* The file system does not support O_DIRECT (i. e. tmpfs) */
+        log->config.directIO = 0;
+        log->segmentFd = open(path, flags, 0644);
+    }
+    logPath(path, log->name, segment, "idx");
+    log->indexFd = open(path, flags, 0644);
+    if (log->segmentFd < 0 || log->indexFd < 0) {
+        return -1;
+    }
+
+    /*
+     * Reserve the whole segment up front so it ends up in as few
+     * extents as possible. The file size is kept, only the blocks
+     * are allocated. Failing is not an error, the writes still work.
+     */
+    if (fallocate(log->segmentFd, FALLOC_FL_KEEP_SIZE, 0, (off_t) log->config.segmentSize) < 0 ||
+        fallocate(log->indexFd, FALLOC_FL_KEEP_SIZE, 0,
+                  (off_t) (log->config.segmentSize / LOG_INDEX_BLOCK + 1) * sizeof(indexEntry)) < 0) {
+        log->stats.preallocFailures++;
+    }
+
+    memset(&log->current, 0, sizeof(catalogEntry));
+    log->current.segment = segment;
+    log->bufferUsed = 0;
+    log->bufferOffset = 0;
+    log->indexPending = 0;
+    if (bufferData(log, header, (size_t) length) < 0) {
+        return -1;
+    }
+    log->current.length = (uint64_t) length;
+    /* The first row always gets an index entry */
+    log->nextIndexOffset = (uint64_t) length;
+
+    log->stats.segments++;
+    log->catalogEntries++;
+    return flushBuffer(log);
+}
+
+/**
+ * Writes out everything buffered for the current segment, cuts
+ * off the preallocated and padded space behind the last row and
+ * closes the segment and index file.
+ *
+ * @param log opened log
+ * @return 0 on success, -1 on failure
+ */
+static int finishSegment(sensorLog *log) {
+    int result = 0;
+    if (log->segmentFd >= 0) {
+        if (flushBuffer(log) < 0 || ftruncate(log->segmentFd, (off_t) log->current.length) < 0 ||
+            fdatasync(log->segmentFd) < 0) {
+            result = -1;
+        }
+        close(log->segmentFd);
+        log->segmentFd = -1;
+    }
+    if (log->indexFd >= 0) {
+        if (ftruncate(log->indexFd, (off_t) log->current.indexEntries * sizeof(indexEntry)) < 0) {
+            result = -1;
+        }
+        close(log->indexFd);
+        log->indexFd = -1;
+    }
+    return result;
+}
+
+/**
+ * Cuts the zero padding off the end of a segment left behind by a
+ * writer that crashed between a write and the trim following it.
+ * The padding is shorter than a block.
+ *
+ * @param name path prefix of the log files
+ * @param segment number of the segment
+ */
+static void trimCrashedSegment(const char *name, uint32_t segment) {
+    char path[LOG_NAME_MAX + 16];
+    char tail[LOG_ALIGN];
+    struct stat info;
+
+    logPath(path, name, segment, "csv");
+    int fd = open(path, O_RDWR);
+    if (fd < 0) {
+        return;
+    }
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        off_t start = info.st_size > LOG_ALIGN ? info.st_size - LOG_ALIGN : 0;
+        ssize_t received = pread(fd, tail, (size_t) (info.st_size - start), start);
+        ssize_t end = received;
+        while (end > 0 && tail[end - 1] == '\0') {
+            end--;
+        }
+        if (received > 0 && end < received) {
+            ftruncate(fd, start + end);
+        }
+    }
+    close(fd);
+}
+
+/**
+ * Fills in the default configuration: 4 MiB segments, 64 KiB
+ * chunks, a flush at least every five minutes and buffered I/O.
+ *
+ * @param config configuration to initialize
+ */
+void defaultLogConfig(logConfig *config) {
+    config->segmentSize = LOG_SEGMENT_SIZE;
+    config->chunkSize = LOG_CHUNK_SIZE;
+    config->flushInterval = LOG_FLUSH_INTERVAL;
+    config->directIO = 0;
+}
+
+/**
+ * Opens the log with the given name for appending. Every call
+ * starts a fresh segment, older segments stay untouched and
+ * readable. The header is written as the first line of every
+ * segment, followed by ";Time".
+ *
+ * @param log log to initialize
+ * @param name path prefix of the log files
+ * @param header CSV header of the rows, without the time column
+ * @param config writer configuration, NULL for the defaults
+ * @return 0 on success, -1 on failure (errno is set)
+ */
+int openSensorLog(sensorLog *log, const char *name, const char *header, const logConfig *config) {
+    char path[LOG_NAME_MAX + 16];
+    struct stat info;
+    catalogEntry last;
+    uint32_t segment = 1;
+
+    if (strlen(name) >= LOG_NAME_MAX || strlen(header) >= LOG_HEADER_MAX) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    memset(log, 0, sizeof(sensorLog));
+    strcpy(log->name, name);
+    strcpy(log->header, header);
+    log->catalogFd = -1;
+    log->segmentFd = -1;
+    log->indexFd = -1;
+    log->lastTime = INT64_MIN;
+
+    /* Chunks are whole blocks between 4 KiB and the erase block size */
+    if (config != NULL) {
+        log->config = *config;
+    } else {
+        defaultLogConfig(&log->config);
+    }
+    log->config.chunkSize = (log->config.chunkSize + LOG_ALIGN - 1) / LOG_ALIGN * LOG_ALIGN;
+    if (log->config.chunkSize < LOG_ALIGN) {
+        log->config.chunkSize = LOG_ALIGN;
+    } else if (log->config.chunkSize > LOG_CHUNK_MAX) {
+        log->config.chunkSize = LOG_CHUNK_MAX;
+    }
+    if (log->config.segmentSize < log->config.chunkSize) {
+        log->config.segmentSize = log->config.chunkSize;
+    }
+
+    log->indexCapacity = log->config.chunkSize / LOG_INDEX_BLOCK + 2;
+    log->index = malloc(log->indexCapacity * sizeof(indexEntry));
+    if (log->index == NULL || posix_memalign((void **) &log->buffer, LOG_ALIGN, log->config.chunkSize) != 0) {
+        log->buffer = NULL;
+        closeSensorLog(log);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    logPath(path, name, 0, "cat");
+    log->catalogFd = open(path, O_RDWR | O_CREAT, 0644);
+    if (log->catalogFd < 0 || fstat(log->catalogFd, &info) < 0) {
+        closeSensorLog(log);
+        return -1;
+    }
+
+    /* Continue numbering and time ordering after the last segment */
+    log->catalogEntries = (uint32_t) (info.st_size / sizeof(catalogEntry));
+    if (log->catalogEntries > 0) {
+        uint64_t offset = (uint64_t) (log->catalogEntries - 1) * sizeof(catalogEntry);
+        if (pread(log->catalogFd, &last, sizeof(catalogEntry), (off_t) offset) != sizeof(catalogEntry)) {
+            closeSensorLog(log);
+            return -1;
+        }
+        segment = last.segment + 1;
+        if (last.indexEntries > 0) {
+            log->lastTime = last.lastTime;
+        }
+        trimCrashedSegment(name, last.segment);
+    }
+
+    if (startSegment(log, segment) < 0) {
+        closeSensorLog(log);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Appends a row to the log. The time is written as the last
+ * column. Times have to be non-decreasing, otherwise the sparse
+ * index could not be searched: a time before the last one (the
+ * clock was set back, i. e. by NTP after a boot without RTC) is
+ * clamped to the last one, so the row is kept and counted in
+ * clampedRows. The row is only buffered, it reaches the disk when
+ * a chunk is full or the flush interval has passed.
+ *
+ * @param log opened log
+ * @param time timestamp of the row (seconds since epoch)
+ * @param row CSV row without the time column and newline
+ * @return 0 on success, 1 if the time was clamped, -1 on failure
+ *         (errno is set)
+ */
+int appendSensorLog(sensorLog *log, int64_t time, const char *row) {
+    char line[LOG_ROW_MAX + 32];
+    int clamped = time < log->lastTime;
+    if (clamped) {
+        time = log->lastTime;
+    }
+    int length = snprintf(line, sizeof(line), "%s;%" PRId64 "\n", row, time);
+
+    if (length < 0 || length >= (int) sizeof(line)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    /* Roll over, a segment always holds at least one row */
+    if (log->current.indexEntries > 0 && log->current.length + length > log->config.segmentSize) {
+        if (finishSegment(log) < 0 || startSegment(log, log->current.segment + 1) < 0) {
+            return -1;
+        }
+    }
+
+    if (bufferData(log, line, (size_t) length) < 0) {
+        return -1;
+    }
+
+    /* First row starting in a new block gets an index entry */
+    if (log->current.length >= log->nextIndexOffset) {
+        indexEntry entry = {time, log->current.length};
+        log->index[log->indexPending++] = entry;
+        if (log->current.indexEntries == 0) {
+            log->current.firstTime = time;
+        }
+        log->current.indexEntries++;
+        log->nextIndexOffset = (log->current.length / LOG_INDEX_BLOCK + 1) * LOG_INDEX_BLOCK;
+    }
+
+    log->current.length += length;
+    log->current.lastTime = time;
+    log->lastTime = time;
+    log->stats.payloadBytes += length;
+    log->stats.clampedRows += clamped;
+
+    if ((log->indexPending == log->indexCapacity ||
+         monotonicMs() - log->lastFlush >= log->config.flushInterval) && flushBuffer(log) < 0) {
+        return -1;
+    }
+    return clamped;
+}
+
+/**
+ * Writes all buffered rows to disk.
+ *
+ * @param log opened log
+ * @return 0 on success, -1 on failure
+ */
+int flushSensorLog(sensorLog *log) {
+    if (log->bufferUsed == 0 && log->indexPending == 0) {
+        return 0;
+    }
+    return flushBuffer(log);
+}
+
+/**
+ * Writes all buffered rows and makes them durable, including the
+ * index and the catalog.
+ *
+ * @param log opened log
+ * @return 0 on success, -1 on failure
+ */
+int syncSensorLog(sensorLog *log) {
+    if (flushBuffer(log) < 0 || fdatasync(log->segmentFd) < 0 || fdatasync(log->indexFd) < 0 ||
+        fdatasync(log->catalogFd) < 0) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Flushes and closes all files of the log.
+ *
+ * @param log opened log
+ * @return 0 on success, -1 if the last rows could not be written
+ */
+int closeSensorLog(sensorLog *log) {
+    int result = finishSegment(log);
+    if (log->catalogFd >= 0) {
+        close(log->catalogFd);
+        log->catalogFd = -1;
+    }
+    free(log->buffer);
+    free(log->index);
+    log->buffer = NULL;
+    log->index = NULL;
+    return result;
+}
+
+/**
+ * Maps a whole file read-only.
+ *
+ * @param path file to map
+ * @param length mapped length, only this many bytes are used
+ * @return mapped memory or NULL on failure
+ */
+static void *mapFile(const char *path, size_t length) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    void *data = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    return data == MAP_FAILED ? NULL : data;
+}
+
+/**
+ * Reads the rows of one segment inside the range. The index is
+ * searched for the last block starting before the range and the
+ * first block starting after it, only the bytes in between are
+ * read.
+ *
+ * @param name path prefix of the log files
+ * @param segment catalog entry of the segment
+ * @param start first timestamp of the range
+ * @param end last timestamp of the range
+ * @param callback called for every matching row
+ * @param context passed to the callback
+ * @param rows incremented for every matching row
+ * @return 1 if the callback stopped the read, 0 if not, -1 on failure
+ */
+static int readSegment(const char *name, const catalogEntry *segment, int64_t start, int64_t end,
+                       logRowCallback callback, void *context, long *rows) {
+    char path[LOG_NAME_MAX + 16];
+    char buffer[LOG_READ_CHUNK];
+    size_t indexLength = segment->indexEntries * sizeof(indexEntry);
+    uint32_t low = 0, high = segment->indexEntries;
+    uint64_t begin, stop;
+    int result = 0;
+
+    logPath(path, name, segment->segment, "idx");
+    indexEntry *index = mapFile(path, indexLength);
+    if (index == NULL) {
+        /* Dropped after the catalog was read */
+        return errno == ENOENT ? 0 : -1;
+    }
+
+    /* Rows in front of the last block starting before the range are all too early */
+    while (low < high) {
+        uint32_t middle = low + (high - low) / 2;
+        if (index[middle].time < start) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    begin = index[low > 0 ? low - 1 : 0].offset;
+
+    /* Rows from the first block starting after the range on are all too late */
+    high = segment->indexEntries;
+    while (low < high) {
+        uint32_t middle = low + (high - low) / 2;
+        if (index[middle].time <= end) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    stop = low < segment->indexEntries ? index[low].offset : segment->length;
+    munmap(index, indexLength);
+
+    logPath(path, name, segment->segment, "csv");
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return errno == ENOENT ? 0 : -1;
+    }
+
+    size_t filled = 0;
+    while (begin < stop && result == 0) {
+        size_t wanted = sizeof(buffer) - filled;
+        if (wanted > stop - begin) {
+            wanted = (size_t) (stop - begin);
+        }
+        ssize_t received = pread(fd, buffer + filled, wanted, (off_t) begin);
+        if (received <= 0) {
+            result = -1;
+            break;
+        }
+        begin += received;
+        filled += received;
+
+        /* Hand out complete lines, keep the remainder for the next chunk */
+        char *line = buffer;
+        char *newline;
+        while ((newline = memchr(line, '\n', filled - (line - buffer))) != NULL) {
+            char *column = newline;
+            while (column > line && *column != ';') {
+                column--;
+            }
+            int64_t time = strtoll(column + 1, NULL, 10);
+            if (time > end) {
+                result = 1;
+                break;
+            }
+            if (time >= start) {
+                (*rows)++;
+                if (callback(line, (size_t) (newline - line), time, context) != 0) {
+                    result = 1;
+                    break;
+                }
+            }
+            line = newline + 1;
+        }
+        filled -= line - buffer;
+        memmove(buffer, line, filled);
+        if (filled == sizeof(buffer)) {
+            /* No newline in a whole chunk, the segment is broken */
+            errno = EIO;
+            result = -1;
+        }
+    }
+
+    close(fd);
+    return result;
+}
+
+/**
+ * Reads all rows with start <= time <= end. The catalog is used
+ * to find the segments overlapping the range and the sparse index
+ * of each segment to find the first and last block to read, so
+ * only those blocks are touched.
+ *
+ * @param name path prefix of the log files
+ * @param start first timestamp of the range
+ * @param end last timestamp of the range
+ * @param callback called for every matching row
+ * @param context passed to the callback
+ * @return number of rows passed to the callback, -1 on failure
+ */
+long readSensorLog(const char *name, int64_t start, int64_t end, logRowCallback callback, void *context) {
+    char path[LOG_NAME_MAX + 16];
+    struct stat info;
+    long rows = 0;
+
+    logPath(path, name, 0, "cat");
+    if (stat(path, &info) < 0) {
+        return -1;
+    }
+    uint32_t entries = (uint32_t) (info.st_size / sizeof(catalogEntry));
+    if (entries == 0 || start > end) {
+        return 0;
+    }
+    catalogEntry *catalog = mapFile(path, entries * sizeof(catalogEntry));
+    if (catalog == NULL) {
+        return -1;
+    }
+
+    /*
+     * Find the first segment ending inside or after the range. Empty
+     * segments (dropped, crashed or just started) hold no times, the
+     * next segment with rows decides for them: if it ends before the
+     * range they are skipped with it, if there is none they are left
+     * to the scan below.
+     */
+    uint32_t low = 0, high = entries;
+    while (low < high) {
+        uint32_t middle = low + (high - low) / 2;
+        uint32_t next = middle;
+        while (next < high && catalog[next].indexEntries == 0) {
+            next++;
+        }
+        if (next < high && catalog[next].lastTime < start) {
+            low = next + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    for (uint32_t i = low; i < entries; i++) {
+        if (catalog[i].indexEntries == 0 || catalog[i].lastTime < start) {
+            continue;
+        }
+        if (catalog[i].firstTime > end) {
+            break;
+        }
+        int result = readSegment(name, &catalog[i], start, end, callback, context, &rows);
+        if (result != 0) {
+            if (result < 0) {
+                rows = -1;
+            }
+            break;
+        }
+    }
+
+    munmap(catalog, entries * sizeof(catalogEntry));
+    return rows;
+}
+
+/**
+ * Reads a copy of the catalog.
+ *
+ * @param name path prefix of the log files
+ * @param catalog receives the entries, to be freed by the caller
+ * @return number of entries, -1 on failure
+ */
+long readSensorLogCatalog(const char *name, catalogEntry **catalog) {
+    char path[LOG_NAME_MAX + 16];
+    struct stat info;
+
+    logPath(path, name, 0, "cat");
+    int fd = open(path, O_RDONLY);
+    if (fd < 0 || fstat(fd, &info) < 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    size_t entries = (size_t) info.st_size / sizeof(catalogEntry);
+    *catalog = malloc(entries * sizeof(catalogEntry) + 1);
+    ssize_t received = *catalog != NULL ? pread(fd, *catalog, entries * sizeof(catalogEntry), 0) : -1;
+    close(fd);
+    if (received != (ssize_t) (entries * sizeof(catalogEntry))) {
+        free(*catalog);
+        *catalog = NULL;
+        return -1;
+    }
+    return (long) entries;
+}
+
+/**
+ * Drops a segment: it is marked in the catalog, the mark is made
+ * durable and the segment and its index are removed. A crash in
+ * between leaves files nobody reads.
+ *
+ * @param name path prefix of the log files
+ * @param position position of the segment in the catalog
+ * @param freed incremented by the size of the removed files
+ * @return 0 on success, -1 on failure
+ */
+int dropSensorLogSegment(const char *name, uint32_t position, uint64_t *freed) {
+    char path[LOG_NAME_MAX + 16];
+    catalogEntry entry;
+    struct stat info;
+
+    logPath(path, name, 0, "cat");
+    int fd = open(path, O_RDWR);
+    if (fd < 0) {
+        return -1;
+    }
+    /* Only the index entries are written, a writer may update the rest of its own entry */
+    off_t offset = (off_t) position * sizeof(catalogEntry);
+    uint32_t dropped = 0;
+    if (pread(fd, &entry, sizeof(entry), offset) != sizeof(entry) ||
+        pwrite(fd, &dropped, sizeof(dropped), offset + offsetof(catalogEntry, indexEntries)) != sizeof(dropped) ||
+        fdatasync(fd) < 0) {
+        close(fd);
+        return -1;
+    }
+    close(fd);
+
+    logPath(path, name, entry.segment, "csv");
+    if (stat(path, &info) == 0) {
+        *freed += (uint64_t) info.st_blocks * 512;
+    }
+    unlink(path);
+    logPath(path, name, entry.segment, "idx");
+    if (stat(path, &info) == 0) {
+        *freed += (uint64_t) info.st_blocks * 512;
+    }
+    unlink(path);
+    return 0;
+}
+
+/* Left out when the log is linked into a program without Python (i. e. the collector) */
+#ifndef SENSOR_NO_PYTHON
+
+/* Logs opened from Python, the handle is the position in this table */
+static sensorLog logs[LOG_HANDLES_MAX];
+static int logUsed[LOG_HANDLES_MAX];
+
+/**
+ * Open a log for appending. Optionally the chunk size in bytes,
+ * the flush interval in seconds and O_DIRECT (1) can be given.
+ *
+ * @param self python instance the method is called on
+ * @param args log name, CSV header without the time column and
+ *             optional chunk size, flush interval and O_DIRECT
+ * @return handle used for appending, -1 on failure
+ */
+static PyObject *open_log(PyObject *self, PyObject *args) {
+    const char *name, *header;
+    logConfig config;
+    int chunkSize = -1, flushInterval = -1, directIO = 0;
+    if (!PyArg_ParseTuple(args, "ss|iii", &name, &header, &chunkSize, &flushInterval, &directIO)) {
+        return NULL;
+    }
+
+    defaultLogConfig(&config);
+    if (chunkSize > 0) {
+        config.chunkSize = (size_t) chunkSize;
+    }
+    if (flushInterval >= 0) {
+        config.flushInterval = (int64_t) flushInterval * 1000;
+    }
+    config.directIO = directIO;
+
+    for (int handle = 0; handle < LOG_HANDLES_MAX; handle++) {
+        if (!logUsed[handle]) {
+            if (openSensorLog(&logs[handle], name, header, &config) < 0) {
+                printf("log %s could not be opened!\n", name);
+                return Py_BuildValue("i", -1);
+            }
+            logUsed[handle] = 1;
+            return Py_BuildValue("i", handle);
+        }
+    }
+    return Py_BuildValue("i", -1);
+}
+
+/**
+ * Append a row to an opened log. Without a time the current
+ * time is used.
+ *
+ * @param self python instance the method is called on
+ * @param args handle, CSV row and optional time
+ * @return 0 on success, 1 if the time was before the last one and
+ *         the row got the last one, -1 on failure
+ */
+static PyObject *append_log(PyObject *self, PyObject *args) {
+    int handle;
+    const char *row;
+    PY_LONG_LONG timestamp = -1;
+    if (!PyArg_ParseTuple(args, "is|L", &handle, &row, &timestamp)) {
+        return NULL;
+    }
+    if (handle < 0 || handle >= LOG_HANDLES_MAX || !logUsed[handle]) {
+        return Py_BuildValue("i", -1);
+    }
+    if (timestamp < 0) {
+        timestamp = (PY_LONG_LONG) time(NULL);
+    }
+
+    return Py_BuildValue("i", appendSensorLog(&logs[handle], timestamp, row));
+}
+
+/**
+ * Write all buffered rows of an opened log to disk.
+ *
+ * @param self python instance the method is called on
+ * @param args handle of the log
+ * @return 0 on success, -1 on failure
+ */
+static PyObject *flush_log(PyObject *self, PyObject *args) {
+    int handle;
+    if (!PyArg_ParseTuple(args, "i", &handle)) {
+        return NULL;
+    }
+    if (handle < 0 || handle >= LOG_HANDLES_MAX || !logUsed[handle]) {
+        return Py_BuildValue("i", -1);
+    }
+
+    return Py_BuildValue("i", flushSensorLog(&logs[handle]));
+}
+
+/**
+ * Close an opened log, buffered rows are written first.
+ *
+ * @param self python instance the method is called on
+ * @param args handle of the log
+ * @return 0 on success, -1 on failure
+ */
+static PyObject *close_log(PyObject *self, PyObject *args) {
+    int handle;
+    if (!PyArg_ParseTuple(args, "i", &handle)) {
+        return NULL;
+    }
+    if (handle < 0 || handle >= LOG_HANDLES_MAX || !logUsed[handle]) {
+        return Py_BuildValue("i", -1);
+    }
+
+    logUsed[handle] = 0;
+    return Py_BuildValue("i", closeSensorLog(&logs[handle]));
+}
+
+/**
+ * Get the write statistics of an opened log.
+ *
+ * @param self python instance the method is called on
+ * @param args handle of the log
+ * @return dictionary with the byte counters and the write amplification
+ */
+static PyObject *log_stats(PyObject *self, PyObject *args) {
+    int handle;
+    if (!PyArg_ParseTuple(args, "i", &handle)) {
+        return NULL;
+    }
+    if (handle < 0 || handle >= LOG_HANDLES_MAX || !logUsed[handle]) {
+        Py_RETURN_NONE;
+    }
+
+    logStats *stats = &logs[handle].stats;
+    double amplification = stats->payloadBytes > 0 ? (double) stats->writtenBytes / stats->payloadBytes : 0.0;
+    return Py_BuildValue("{s:K,s:K,s:K,s:K,s:I,s:I,s:K,s:i,s:d}",
+                         "payload_bytes", (unsigned PY_LONG_LONG) stats->payloadBytes,
+                         "written_bytes", (unsigned PY_LONG_LONG) stats->writtenBytes,
+                         "write_calls", (unsigned PY_LONG_LONG) stats->writeCalls,
+                         "flushes", (unsigned PY_LONG_LONG) stats->flushes,
+                         "segments", stats->segments,
+                         "prealloc_failures", stats->preallocFailures,
+                         "clamped_rows", (unsigned PY_LONG_LONG) stats->clampedRows,
+                         "direct_io", logs[handle].config.directIO,
+                         "write_amplification", amplification);
+}
+
+/**
+ * Collects the rows of a range read into a python list.
+ */
+static int collectRow(const char *row, size_t length, int64_t time, void *context) {
+    PyObject *line = PyString_FromStringAndSize(row, (Py_ssize_t) length);
+    if (line == NULL) {
+        return -1;
+    }
+    int result = PyList_Append((PyObject *) context, line);
+    Py_DECREF(line);
+    return result;
+}
+
+/**
+ * Read all rows of a log between two timestamps (inclusive).
+ *
+ * @param self python instance the method is called on
+ * @param args log name, start and end time
+ * @return list of CSV rows including the time column
+ */
+static PyObject *read_log(PyObject *self, PyObject *args) {
+    const char *name;
+    PY_LONG_LONG start, end;
+    if (!PyArg_ParseTuple(args, "sLL", &name, &start, &end)) {
+        return NULL;
+    }
+
+    PyObject *rows = PyList_New(0);
+    if (rows == NULL) {
+        return NULL;
+    }
+    if (readSensorLog(name, start, end, collectRow, rows) < 0 || PyErr_Occurred()) {
+        Py_DECREF(rows);
+        if (!PyErr_Occurred()) {
+            PyErr_SetFromErrno(PyExc_IOError);
+        }
+        return NULL;
+    }
+    return rows;
+}
+
+/**
+ * Method definitions that are visible in Python afterwards
+ */
+static PyMethodDef sensorLog_methods[] = {
+        {"open_log",   open_log,   METH_VARARGS},
+        {"append_log", append_log, METH_VARARGS},
+        {"flush_log",  flush_log,  METH_VARARGS},
+        {"close_log",  close_log,  METH_VARARGS},
+        {"log_stats",  log_stats,  METH_VARARGS},
+        {"read_log",   read_log,   METH_VARARGS},
+        {NULL, NULL, 0, NULL} /* Sentinel */
+};
+
+/**
+ * Initializes the module and methods that can be called
+ * from python.
+ */
+void initsensorLog(void) {
+    PyImport_AddModule("sensorLog");
+    Py_InitModule("sensorLog", sensorLog_methods);
+}
+
+#endif
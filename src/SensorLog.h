@@ -0,0 +1,224 @@
+/**
+ * <Program>
+ * SensorLog.h
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ * Header file for the segmented sensor log. A log is made of
+ * numbered CSV segment files, each carrying a sparse index of
+ * timestamps to file offsets in a sidecar file, and a catalog
+ * listing all segments with their first and last timestamp.
+ * Together they allow a time range to be read without scanning
+ * the log from the start.
+ *
+ * Since the boxes write to SD cards, rows are collected in a
+ * buffer of whole 4 KiB blocks (up to the erase block size) and
+ * written when the buffer is full or the flush interval passed.
+ * Segments are preallocated with fallocate and can optionally be
+ * written with O_DIRECT. The zero padding of the last block of a
+ * write is cut off right after it, so a segment always ends with
+ * its data and can be read by any program, not only through the
+ * catalog. The last segment of a writer that crashed in between
+ * is trimmed when the log is opened again.
+ *
+ * Old segments can be dropped (see Retention.h): they are marked in
+ * the catalog by setting their index entries to 0, which readers
+ * skip like an empty segment, and their files are removed.
+ *
+ * On disk a log called "envout" looks like this:
+ *      envout.cat          catalog, one catalogEntry per segment
+ *      envout.000001.csv   segment data (header line + rows)
+ *      envout.000001.idx   sparse index, one indexEntry per block
+ */
+
+#ifndef SRC_SENSORLOG_H
+#define SRC_SENSORLOG_H
+
+#include <inttypes.h>
+#include <stdlib.h>
+
+/* --- Layout --- */
+#define LOG_NAME_MAX        256
+#define LOG_HEADER_MAX      256
+#define LOG_ROW_MAX         512
+#define LOG_INDEX_BLOCK     4096              /* one index entry per 4 KiB of segment data */
+#define LOG_SEGMENT_SIZE    (4 * 1024 * 1024) /* roll over to a new segment at 4 MiB */
+#define LOG_READ_CHUNK      (64 * 1024)
+
+/* --- Writer --- */
+#define LOG_ALIGN           4096              /* writes are whole blocks of this size */
+#define LOG_CHUNK_SIZE      (64 * 1024)       /* default size of the write buffer */
+#define LOG_CHUNK_MAX       (4 * 1024 * 1024) /* typical SD card erase block */
+#define LOG_FLUSH_INTERVAL  (5 * 60 * 1000)   /* flush at least every 5 minutes (ms) */
+
+/* One entry of the sparse index, time of the first row starting in a block */
+typedef struct {
+    int64_t time;
+    uint64_t offset;
+} indexEntry;
+
+/* One entry of the catalog, describing a single segment */
+typedef struct {
+    uint32_t segment;
+    uint32_t indexEntries;
+    int64_t firstTime;
+    int64_t lastTime;
+    uint64_t length;
+} catalogEntry;
+
+/* Used to configure how a log is written */
+typedef struct {
+    uint64_t segmentSize;  /* bytes per segment, preallocated on creation */
+    size_t chunkSize;      /* bytes buffered before writing, multiple of LOG_ALIGN */
+    int64_t flushInterval; /* ms after which buffered rows are written anyway */
+    int directIO;          /* open segments with O_DIRECT */
+} logConfig;
+
+/*
+ * Used to hold the write statistics. The write amplification is
+ * writtenBytes / payloadBytes, it includes the rewrites of partly
+ * filled blocks as well as the index and catalog updates.
+ */
+typedef struct {
+    uint64_t payloadBytes;
+    uint64_t writtenBytes;
+    uint64_t writeCalls;
+    uint64_t flushes;
+    uint32_t segments;
+    uint32_t preallocFailures;
+    uint64_t clampedRows;  /* rows stamped with the last time, their own was earlier */
+} logStats;
+
+/* Used to hold an opened log that can be appended to */
+typedef struct {
+    char name[LOG_NAME_MAX];
+    char header[LOG_HEADER_MAX];
+    logConfig config;
+    logStats stats;
+    int catalogFd;
+    int segmentFd;
+    int indexFd;
+    uint32_t catalogEntries;
+    catalogEntry current;
+    int64_t lastTime;
+    uint64_t nextIndexOffset;
+
+    /* Write buffer, starts at bufferOffset of the current segment */
+    char *buffer;
+    size_t bufferUsed;
+    uint64_t bufferOffset;
+    int64_t lastFlush;
+
+    /* Index entries not written yet */
+    indexEntry *index;
+    size_t indexPending;
+    size_t indexCapacity;
+} sensorLog;
+
+/**
+ * Called for every row inside the requested time range. The row
+ * is passed without the trailing newline. Returning a value other
+ * than 0 stops the read.
+ */
+typedef int (*logRowCallback)(const char *row, size_t length, int64_t time, void *context);
+
+/* METHODS */
+
+/**
+ * Fills in the default configuration: 4 MiB segments, 64 KiB
+ * chunks, a flush at least every five minutes and buffered I/O.
+ *
+ * @param config configuration to initialize
+ */
+void defaultLogConfig(logConfig *config);
+/**
+ * Opens the log with the given name for appending. Every call
+ * starts a fresh segment, older segments stay untouched and
+ * readable. The header is written as the first line of every
+ * segment, followed by ";Time".
+ *
+ * @param log log to initialize
+ * @param name path prefix of the log files
+ * @param header CSV header of the rows, without the time column
+ * @param config writer configuration, NULL for the defaults
+ * @return 0 on success, -1 on failure (errno is set)
+ */
+int openSensorLog(sensorLog *log, const char *name, const char *header, const logConfig *config);
+/**
+ * Appends a row to the log. The time is written as the last
+ * column. Times have to be non-decreasing, otherwise the sparse
+ * index could not be searched: a time before the last one (the
+ * clock was set back, i. e. by NTP after a boot without RTC) is
+ * clamped to the last one, so the row is kept and counted in
+ * clampedRows. The row is only buffered, it reaches the disk when
+ * a chunk is full or the flush interval has passed.
+ *
+ * @param log opened log
+ * @param time timestamp of the row (seconds since epoch)
+ * @param row CSV row without the time column and newline
+ * @return 0 on success, 1 if the time was clamped, -1 on failure
+ *         (errno is set)
+ */
+int appendSensorLog(sensorLog *log, int64_t time, const char *row);
+/**
+ * Writes all buffered rows to disk.
+ *
+ * @param log opened log
+ * @return 0 on success, -1 on failure
+ */
+int flushSensorLog(sensorLog *log);
+/**
+ * Writes all buffered rows and makes them durable, including the
+ * index and the catalog.
+ *
+ * @param log opened log
+ * @return 0 on success, -1 on failure
+ */
+int syncSensorLog(sensorLog *log);
+/**
+ * Flushes and closes all files of the log.
+ *
+ * @param log opened log
+ * @return 0 on success, -1 if the last rows could not be written
+ */
+int closeSensorLog(sensorLog *log);
+/**
+ * Reads all rows with start <= time <= end. The catalog is used
+ * to find the segments overlapping the range and the sparse index
+ * of each segment to find the first and last block to read, so
+ * only those blocks are touched.
+ *
+ * @param name path prefix of the log files
+ * @param start first timestamp of the range
+ * @param end last timestamp of the range
+ * @param callback called for every matching row
+ * @param context passed to the callback
+ * @return number of rows passed to the callback, -1 on failure
+ */
+long readSensorLog(const char *name, int64_t start, int64_t end, logRowCallback callback, void *context);
+/**
+ * Reads a copy of the catalog.
+ *
+ * @param name path prefix of the log files
+ * @param catalog receives the entries, to be freed by the caller
+ * @return number of entries, -1 on failure
+ */
+long readSensorLogCatalog(const char *name, catalogEntry **catalog);
+/**
+ * Drops a segment: it is marked in the catalog, the mark is made
+ * durable and the segment and its index are removed. The segment
+ * must not be the one a writer appends to.
+ *
+ * @param name path prefix of the log files
+ * @param position position of the segment in the catalog
+ * @param freed incremented by the size of the removed files
+ * @return 0 on success, -1 on failure
+ */
+int dropSensorLogSegment(const char *name, uint32_t position, uint64_t *freed);
+
+#endif //SRC_SENSORLOG_H
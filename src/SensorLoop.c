@@ -0,0 +1,562 @@
+/**
+ * <Program>
+ * SensorLoop.c
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ *  Event loop reading all sensors of boxDrivers (the BME280, SI1145
+ * and CCS811) in one round with overlapping conversion times. Each sensor has a state
+ * machine and a timerfd, epoll wakes the loop whenever one of the
+ * conversions is due, so no time is spent sleeping for a single
+ * sensor while the others could be read.
+ *  What a sensor does in every state is taken from its driver
+ * descriptor (see SensorDriver.h and BoxSensors.c), the drivers are
+ * linked in with SENSOR_NO_MAIN defined. The Python module
+ * sensorLoop exposes a single round with every channel of the
+ * drivers, it is left out with SENSOR_NO_PYTHON defined (i. e. for
+ * i2creplay).
+ *
+ * <Sources>
+ * Accessed on 18.10.2026 - epoll(7) and timerfd_create(2):
+ *      https://man7.org/linux/man-pages/man7/epoll.7.html
+ *      https://man7.org/linux/man-pages/man2/timerfd_create.2.html
+ * Accesses on 11.01.2018 - Extending Python with C
+ *      https://docs.python.org/2/extending/extending.html
+ */
+
+#ifndef SENSOR_NO_PYTHON
+#include <Python.h>
+#endif
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include "SensorDriver.h"
+
+/**
+ * Returns the current time of the given clock in microseconds.
+ */
+static int64_t clockUs(clockid_t clock) {
+    struct timespec now;
+    clock_gettime(clock, &now);
+    return (int64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/**
+ * Arms the timer of a task to expire once after waitUs. A zero
+ * value would disarm the timer, so it expires after 1ns instead,
+ * just like every timer of a loop that does not wait.
+ *
+ * @return 0 on success, -1 on failure
+ */
+static int armTask(sensorTask *task, uint32_t waitUs) {
+    struct itimerspec timer;
+    memset(&timer, 0, sizeof(timer));
+    timer.it_value.tv_sec = waitUs / 1000000;
+    timer.it_value.tv_nsec = (long) (waitUs % 1000000) * 1000;
+    if (waitUs == 0 || task->loop->noWait) {
+        timer.it_value.tv_sec = 0;
+        timer.it_value.tv_nsec = 1;
+    }
+    return timerfd_settime(task->timerFd, 0, &timer, NULL);
+}
+
+/**
+ * Disarms the timer of a task and drops a pending expiration.
+ */
+static void disarmTask(sensorTask *task) {
+    struct itimerspec timer;
+    uint64_t expirations;
+    memset(&timer, 0, sizeof(timer));
+    timerfd_settime(task->timerFd, 0, &timer, NULL);
+    while (read(task->timerFd, &expirations, sizeof(expirations)) > 0);
+}
+
+/**
+ * Marks a task as failed. If the sensor did not respond, it is
+ * closed and set up again in the next round. While the circuit
+ * breaker is open the fd is kept, the breaker decides when the
+ * sensor is tried again.
+ */
+static void failTask(sensorTask *task, int status) {
+    task->state = TASK_FAILED;
+    task->status = status;
+    if (status == I2C_ERROR && task->fd >= 0) {
+        close(task->fd);
+        task->fd = -1;
+    }
+}
+
+/**
+ * Creates the epoll instance and timers. The sensors are set up
+ * lazily by the first round, so a missing sensor does not keep
+ * the others from working.
+ *
+ * @param loop loop to initialize
+ * @return 0 on success, -1 on failure (errno is set)
+ */
+int openSensorLoop(sensorLoop *loop) {
+    memset(loop, 0, sizeof(*loop));
+    loop->openedUs = clockUs(CLOCK_MONOTONIC);
+    loop->openedBootUs = clockUs(CLOCK_BOOTTIME);
+    presetSettings(PRESET_WEATHER, &loop->env);
+    loop->driveMode = CCS811_MODE_1S;
+    loop->airMode = -1;
+    if (boxSensors > LOOP_SENSORS_MAX) {
+        errno = EINVAL;
+        return -1;
+    }
+    loop->sensors = boxSensors;
+    for (int i = 0; i < loop->sensors; i++) {
+        loop->tasks[i].fd = -1;
+        loop->tasks[i].timerFd = -1;
+        loop->tasks[i].startup.openedUs = -1;
+        loop->tasks[i].startup.readyUs = -1;
+        loop->tasks[i].startup.firstValidUs = -1;
+    }
+
+    int channels = 0;
+    for (int i = 0; i < loop->sensors; i++) {
+        channels += boxDrivers[i]->channels;
+    }
+    if (channels > LOOP_CHANNELS_MAX) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    loop->epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (loop->epollFd < 0) {
+        return -1;
+    }
+    for (int i = 0; i < loop->sensors; i++) {
+        sensorTask *task = &loop->tasks[i];
+        task->driver = boxDrivers[i];
+        task->name = task->driver->name;
+        task->address = task->driver->address;
+        task->firstChannel = loop->channels;
+        task->loop = loop;
+        loop->channels += task->driver->channels;
+        task->status = I2C_ERROR;
+
+        task->timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        struct epoll_event event = {EPOLLIN, {.ptr = task}};
+        if (task->timerFd < 0 || epoll_ctl(loop->epollFd, EPOLL_CTL_ADD, task->timerFd, &event) < 0) {
+            int error = errno;
+            closeSensorLoop(loop);
+            errno = error;
+            return -1;
+        }
+    }
+
+    /* The sensor taking the longest to its first sample is set up first, equal ones in the order of boxDrivers */
+    for (int i = 0; i < loop->sensors; i++) {
+        int j = i;
+        for (; j > 0 && boxDrivers[loop->startOrder[j - 1]]->startupUs < boxDrivers[i]->startupUs; j--) {
+            loop->startOrder[j] = loop->startOrder[j - 1];
+        }
+        loop->startOrder[j] = i;
+    }
+    return 0;
+}
+
+/**
+ * Triggers the conversion of a set up sensor.
+ *
+ * @return 1 if the task waits for its timer, 0 if it failed
+ */
+static int triggerTask(sensorTask *task) {
+    uint32_t waitUs = 0;
+    int status;
+
+    task->triggerUs = clockUs(CLOCK_MONOTONIC);
+    task->sampleUs = 0;
+    if ((status = driverTrigger(task, &waitUs)) != I2C_OK) {
+        failTask(task, status);
+        return 0;
+    }
+    if (armTask(task, waitUs) < 0) {
+        failTask(task, I2C_ERROR);
+        return 0;
+    }
+    task->state = TASK_CONVERTING;
+    return 1;
+}
+
+/**
+ * Closes a sensor whose setup failed, regardless of the breaker
+ * since it is not set up.
+ */
+static void abortSetup(sensorTask *task, int status) {
+    close(task->fd);
+    task->fd = -1;
+    task->state = TASK_FAILED;
+    task->status = status;
+}
+
+/**
+ * Runs the next setup step of a sensor. If the setup is finished,
+ * the first conversion is triggered right away.
+ *
+ * @return 1 if the task waits for its timer, 0 if it failed
+ */
+static int continueSetup(sensorTask *task) {
+    sensorStartup *startup = &task->startup;
+    uint32_t waitUs = 0;
+
+    int64_t start = clockUs(CLOCK_MONOTONIC);
+    int result = driverSetup(task, &waitUs);
+    int64_t end = clockUs(CLOCK_MONOTONIC);
+    if (startup->readyUs < 0) {
+        startup->setupBusyUs += end - start;
+    }
+
+    if (result == 0) {
+        if (armTask(task, waitUs) < 0) {
+            abortSetup(task, I2C_ERROR);
+            return 0;
+        }
+        return 1;
+    }
+    if (result < 0) {
+        abortSetup(task, result);
+        return 0;
+    }
+    if (startup->readyUs < 0) {
+        startup->readyUs = end - task->loop->openedUs;
+    }
+    return triggerTask(task);
+}
+
+/**
+ * Opens and sets up the sensor if needed and triggers its
+ * conversion.
+ *
+ * @return 1 if the task waits for its timer, 0 if it failed
+ */
+static int startTask(sensorTask *task) {
+    task->state = TASK_IDLE;
+    if (task->fd >= 0) {
+        return triggerTask(task);
+    }
+
+    task->fd = i2cSetup(task->address);
+    if (task->fd < 0) {
+        task->state = TASK_FAILED;
+        task->status = I2C_ERROR;
+        return 0;
+    }
+    if (task->startup.openedUs < 0) {
+        task->startup.openedUs = clockUs(CLOCK_MONOTONIC) - task->loop->openedUs;
+    }
+    task->state = TASK_SETUP;
+    task->step = 0;
+    return continueSetup(task);
+}
+
+/**
+ * Runs one round: triggers all sensors, waits for the conversions
+ * to be due and reads the results. Sensors that failed or did not
+ * finish in time have their status set accordingly.
+ *
+ * @param loop opened loop
+ * @param round receives the results
+ * @param timeoutMs maximum duration of the round
+ * @return number of sensors read, -1 if waiting failed
+ */
+int runSensorRound(sensorLoop *loop, sensorRound *round, int timeoutMs) {
+    return runSensors(loop, round, timeoutMs, LOOP_ALL_SENSORS);
+}
+
+/**
+ * Runs a round of some of the sensors, the others are not touched
+ * and have the status LOOP_SKIPPED.
+ *
+ * @param loop opened loop
+ * @param round receives the results
+ * @param timeoutMs maximum duration of the round
+ * @param sensors bit (1 << LOOP_*) of every sensor to read
+ * @return number of sensors read, -1 if waiting failed
+ */
+int runSensors(sensorLoop *loop, sensorRound *round, int timeoutMs, unsigned int sensors) {
+    sensors &= ~loop->lent;
+    memset(round, 0, sizeof(*round));
+    loop->round = round;
+    round->time = clockUs(CLOCK_REALTIME);
+    int64_t start = clockUs(CLOCK_MONOTONIC);
+    round->startUs = start;
+    int64_t deadline = start + (int64_t) timeoutMs * 1000;
+
+    int pending = 0;
+    for (int i = 0; i < loop->sensors; i++) {
+        if (sensors & (1u << loop->startOrder[i])) {
+            pending += startTask(&loop->tasks[loop->startOrder[i]]);
+        }
+    }
+
+    int failed = 0;
+    while (pending > 0) {
+        int64_t remaining = deadline - clockUs(CLOCK_MONOTONIC);
+        if (remaining <= 0) {
+            break;
+        }
+
+        struct epoll_event events[LOOP_SENSORS_MAX];
+        int ready = epoll_wait(loop->epollFd, events, LOOP_SENSORS_MAX, (int) ((remaining + 999) / 1000));
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            failed = 1;
+            break;
+        }
+
+        for (int i = 0; i < ready; i++) {
+            sensorTask *task = events[i].data.ptr;
+            uint64_t expirations;
+            if (read(task->timerFd, &expirations, sizeof(expirations)) < 0) {
+                continue;
+            }
+            if (task->state == TASK_SETUP) {
+                pending -= !continueSetup(task);
+                continue;
+            }
+            if (task->state != TASK_CONVERTING) {
+                continue;
+            }
+
+            uint32_t waitUs = 0;
+            int result = driverCollect(task, &waitUs);
+            if (result == 0 && armTask(task, waitUs) == 0) {
+                continue;
+            }
+            if (result == 1) {
+                task->state = TASK_DONE;
+                task->status = I2C_OK;
+                task->doneUs = task->sampleUs > 0 ? task->sampleUs : clockUs(CLOCK_MONOTONIC);
+                if (task->startup.firstValidUs < 0) {
+                    task->startup.firstValidUs = task->doneUs - loop->openedUs;
+                }
+            } else {
+                failTask(task, result < 0 ? result : I2C_ERROR);
+            }
+            pending--;
+        }
+    }
+
+    int done = 0;
+    for (int i = 0; i < loop->sensors; i++) {
+        sensorTask *task = &loop->tasks[i];
+        if (!(sensors & (1u << i))) {
+            round->status[i] = LOOP_SKIPPED;
+            continue;
+        }
+        if (task->state == TASK_CONVERTING) {
+            disarmTask(task);
+            task->state = TASK_FAILED;
+            task->status = LOOP_TIMEOUT;
+        } else if (task->state == TASK_SETUP) {
+            disarmTask(task);
+            abortSetup(task, LOOP_TIMEOUT);
+        }
+        round->status[i] = task->status;
+        if (task->state == TASK_DONE) {
+            round->latencyUs[i] = task->doneUs - start;
+            done++;
+        }
+    }
+    round->durationUs = clockUs(CLOCK_MONOTONIC) - start;
+    loop->round = NULL;
+    return failed ? -1 : done;
+}
+
+/**
+ * Changes the measurement settings of the BME280. A sensor that is
+ * set up gets them at once, otherwise with its setup. Must not be
+ * called while a round runs.
+ *
+ * @param loop opened loop
+ * @param settings new settings
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN if the
+ *         settings could not be written, they are written again by
+ *         the setup after the sensor failed
+ */
+int setEnvSettings(sensorLoop *loop, const envSettings *settings) {
+    sensorTask *task = &loop->tasks[LOOP_BME280];
+    loop->env = *settings;
+    if (task->fd < 0 || task->state == TASK_SETUP) {
+        return I2C_OK;
+    }
+    return applySettings(task->fd, &loop->env);
+}
+
+/**
+ * Changes the drive mode of the CCS811. A sensor that is set up is
+ * switched at once, otherwise with its setup. Must not be called
+ * while a round runs.
+ *
+ * @param loop opened loop
+ * @param driveMode one of the CCS811_MODE_* values
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN if the
+ *         mode could not be set now, it is retried by the next round
+ */
+int setAirDriveMode(sensorLoop *loop, int driveMode) {
+    sensorTask *task = &loop->tasks[LOOP_CCS811];
+    loop->driveMode = driveMode;
+    if (task->fd < 0 || task->state == TASK_SETUP || loop->airMode == driveMode) {
+        return I2C_OK;
+    }
+    int status = setDriveMode(task->fd, driveMode);
+    if (status == I2C_OK) {
+        loop->airMode = driveMode;
+    }
+    return status;
+}
+
+/**
+ * Lends a sensor to a stream driving it on its own (i. e. in auto
+ * run): the sensor is closed and skipped by the rounds, with the
+ * status LOOP_SKIPPED, until it is returned. Must not be called
+ * while a round runs.
+ *
+ * @param loop opened loop
+ * @param sensor LOOP_* index of the sensor
+ */
+void lendSensor(sensorLoop *loop, int sensor) {
+    sensorTask *task = &loop->tasks[sensor];
+    if (task->fd >= 0) {
+        close(task->fd);
+        task->fd = -1;
+    }
+    task->state = TASK_IDLE;
+    loop->lent |= 1u << sensor;
+}
+
+/**
+ * Takes a lent sensor back. The next round sets it up from the
+ * start, whatever the stream left it in. Must not be called while
+ * a round runs.
+ *
+ * @param loop opened loop
+ * @param sensor LOOP_* index of the sensor
+ */
+void returnSensor(sensorLoop *loop, int sensor) {
+    loop->lent &= ~(1u << sensor);
+}
+
+/**
+ * Closes all sensors and timers of the loop.
+ *
+ * @param loop opened loop
+ */
+void closeSensorLoop(sensorLoop *loop) {
+    for (int i = 0; i < loop->sensors; i++) {
+        sensorTask *task = &loop->tasks[i];
+        if (task->fd >= 0) {
+            close(task->fd);
+            task->fd = -1;
+        }
+        if (task->timerFd >= 0) {
+            close(task->timerFd);
+            task->timerFd = -1;
+        }
+    }
+    if (loop->epollFd >= 0) {
+        close(loop->epollFd);
+        loop->epollFd = -1;
+    }
+}
+
+#ifndef SENSOR_NO_PYTHON
+/* Loop kept open between calls */
+static sensorLoop loop;
+static int loopOpen = 0;
+
+/**
+ * Adds the value of a sensor to the dict, None if the sensor
+ * failed in this round.
+ */
+static void setValue(PyObject *dict, const char *key, PyObject *value, int valid) {
+    if (!valid) {
+        Py_DECREF(value);
+        Py_INCREF(Py_None);
+        value = Py_None;
+    }
+    PyDict_SetItemString(dict, key, value);
+    Py_DECREF(value);
+}
+
+/**
+ * Read all sensors in one round with overlapping conversions.
+ *
+ * @param self python instance the method is called on
+ * @param args optional timeout of the round in ms
+ * @return dict with the values (None if a sensor failed), the
+ *         status and latency of every sensor and the round duration
+ */
+static PyObject *read_round(PyObject *self, PyObject *args) {
+    int timeoutMs = LOOP_ROUND_TIMEOUT_MS;
+    if (!PyArg_ParseTuple(args, "|i", &timeoutMs)) {
+        return NULL;
+    }
+    if (!loopOpen) {
+        if (openSensorLoop(&loop) < 0) {
+            printf("sensor loop could not be opened!\n");
+            Py_RETURN_NONE;
+        }
+        loopOpen = 1;
+    }
+
+    sensorRound round;
+    int result;
+    Py_BEGIN_ALLOW_THREADS
+    result = runSensorRound(&loop, &round, timeoutMs);
+    Py_END_ALLOW_THREADS
+    if (result < 0) {
+        Py_RETURN_NONE;
+    }
+
+    PyObject *dict = PyDict_New();
+    setValue(dict, "time", PyFloat_FromDouble(round.time / 1e6), 1);
+    setValue(dict, "round_ms", PyFloat_FromDouble(round.durationUs / 1000.0), 1);
+    for (int i = 0; i < loop.channels; i++) {
+        const driverChannel *channel = boxChannel(i, NULL);
+        PyObject *value = channel->integer ? PyInt_FromLong((long) round.value[i]) : PyFloat_FromDouble(round.value[i]);
+        setValue(dict, channel->name, value, (round.valid >> i) & 1);
+    }
+
+    PyObject *status = PyDict_New();
+    PyObject *latency = PyDict_New();
+    for (int i = 0; i < loop.sensors; i++) {
+        setValue(status, loop.tasks[i].name, PyInt_FromLong(round.status[i]), 1);
+        setValue(latency, loop.tasks[i].name, PyFloat_FromDouble(round.latencyUs[i] / 1000.0),
+                 round.status[i] == I2C_OK);
+    }
+    setValue(dict, "status", status, 1);
+    setValue(dict, "latency_ms", latency, 1);
+    return dict;
+}
+
+/**
+ * Method definitions that are visible in Python afterwards
+ */
+static PyMethodDef sensorLoop_methods[] = {
+        {"read_round", read_round, METH_VARARGS},
+        {NULL, NULL, 0, NULL} /* Sentinel */
+};
+
+/**
+ * Initializes the module and methods that can be called
+ * from python.
+ */
+void initsensorLoop(void) {
+    PyImport_AddModule("sensorLoop");
+    Py_InitModule("sensorLoop", sensorLoop_methods);
+}
+#endif
@@ -0,0 +1,237 @@
+/**
+ * <Program>
+ * SensorLoop.h
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ * Header file for the sensor loop, which reads all sensors of the
+ * box in one round. Every sensor is driven by a small state
+ * machine: the conversion is triggered, then a timerfd expires
+ * when the result is due and the result is read. All timers are
+ * waited for with one epoll instance, so the conversion times
+ * overlap and a round takes about as long as the slowest sensor
+ * instead of the sum of all of them.
+ *
+ *      BME280  trigger forced mode -> wait measurement time -> read
+ *      SI1145  trigger ALS force   -> wait ~5ms             -> read
+ *      CCS811  check DATA_READY    -> poll until ready      -> read
+ *
+ * A sensor that is not finished when its timer expires is polled
+ * again shortly after. A sensor that fails is set up again in the
+ * next round. The state machine is generic, what a sensor does in
+ * every state is taken from its driver descriptor (see
+ * SensorDriver.h).
+ *
+ * The setup is part of the state machine as well, so the sensors
+ * are initialized in parallel during the first round: while the
+ * SI1145 restarts after its reset and the CCS811 starts its
+ * application, the others use the bus.
+ *
+ *      BME280  read calibration, configure
+ *      SI1145  reset -> wait 10ms -> unlock, configure
+ *      CCS811  check, start application -> wait 1ms -> set drive mode,
+ *              restore the saved baseline
+ *
+ * Every stage of the cold start is timed per sensor, up to the
+ * first valid sample.
+ *
+ * The drive mode of the CCS811 can be changed at runtime. In the
+ * 10s and 60s modes a round does not wait for the next result, it
+ * returns the last one with the time it was read as long as it is
+ * current. In the 250ms mode only RAW_DATA is read, see AirStream.h
+ * for sampling it at the full rate.
+ */
+
+#ifndef SRC_SENSORLOOP_H
+#define SRC_SENSORLOOP_H
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include "BME280_TempSensor.h"
+#include "SI1145_LightSensor.h"
+#include "CCS811_AirSensor.h"
+#include "AirBaseline.h"
+
+/* --- Sensors, indices in boxDrivers for the settings and streams of a sensor --- */
+#define LOOP_BME280  0
+#define LOOP_SI1145  1
+#define LOOP_CCS811  2
+#define LOOP_SENSORS_MAX  4  /* the loop runs as many sensors as boxDrivers lists, up to this */
+#define LOOP_ALL_SENSORS  ((1u << LOOP_SENSORS_MAX) - 1)
+#define LOOP_CHANNELS_MAX 16
+
+/* --- States of a sensor --- */
+#define TASK_IDLE       0  /* not triggered in this round */
+#define TASK_CONVERTING 1  /* conversion triggered, waiting for the timer */
+#define TASK_DONE       2  /* result read in this round */
+#define TASK_FAILED     3  /* setup, trigger or read failed */
+#define TASK_SETUP      4  /* setup started, waiting for the timer */
+
+/* Status of a sensor that did not finish in time or was not read, besides the I2C_* codes */
+#define LOOP_TIMEOUT -3
+#define LOOP_SKIPPED -4
+
+/* --- Timing --- */
+#define LOOP_ROUND_TIMEOUT_MS 1500   /* CCS811 has a new result every second */
+#define LOOP_POLL_US          1000   /* re-check of a conversion that is late */
+#define LOOP_CCS811_POLL_US   50000  /* interval DATA_READY is checked in */
+
+struct sensorLoop;
+struct sensorDriver;
+
+/* Used to time the cold start of a sensor, us since the loop was opened, -1 until reached */
+typedef struct {
+    int64_t openedUs;      /* device opened */
+    int64_t readyUs;       /* setup finished */
+    int64_t setupBusyUs;   /* time spent in setup steps, without the waits in between */
+    int64_t firstValidUs;  /* time to the first valid sample */
+} sensorStartup;
+
+/* Used to drive a single sensor through a round */
+typedef struct sensorTask {
+    const char *name;
+    int address;
+    int fd;            /* I2C file descriptor, -1 if not set up */
+    int timerFd;
+    int state;
+    int status;        /* I2C_OK or the error of the last step */
+    int64_t triggerUs; /* monotonic time the conversion was triggered */
+    int64_t doneUs;    /* monotonic time the result was read */
+    int64_t sampleUs;  /* set by collect to the monotonic time of an older result it returns */
+    int step;          /* next step of the init sequence */
+    sensorStartup startup;
+
+    const struct sensorDriver *driver; /* descriptor the task runs, see SensorDriver.h */
+    int firstChannel;  /* number of the first channel of the sensor in the loop */
+    struct sensorLoop *loop;
+} sensorTask;
+
+/* Used to hold the result of a round */
+typedef struct {
+    int64_t time;       /* start of the round, us since epoch */
+    int64_t startUs;    /* start of the round on the monotonic clock, for schedules */
+    int64_t durationUs;
+
+    int64_t raw[LOOP_CHANNELS_MAX];  /* raw values of all channels as decoded, see driverKeepRaw */
+    double value[LOOP_CHANNELS_MAX]; /* values of all channels in their unit */
+    unsigned int valid;              /* bit (1 << channel) of every value that was read */
+
+    int status[LOOP_SENSORS_MAX];
+    int64_t latencyUs[LOOP_SENSORS_MAX]; /* round start to result */
+} sensorRound;
+
+/* Used to hold the sensors and the epoll instance */
+typedef struct sensorLoop {
+    int epollFd;
+    int64_t openedUs;     /* monotonic time the loop was opened */
+    int64_t openedBootUs; /* time since the box was powered up when the loop was opened */
+    int sensors;          /* drivers in boxDrivers */
+    sensorTask tasks[LOOP_SENSORS_MAX];
+    int startOrder[LOOP_SENSORS_MAX]; /* sensors by their startupUs, the slowest first */
+    int channels;         /* channels of all drivers */
+
+    /* BME280 */
+    compParam comp;
+    envSettings env;    /* in normal mode a round reads the latest measurement */
+
+    /* CCS811 */
+    int driveMode;      /* requested drive mode */
+    int airMode;        /* drive mode the sensor runs in, -1 until set */
+    airData lastAir;    /* last algorithm result and when it was read, raw is kept in the 250ms mode as well */
+    int64_t lastAirUs;
+    airBaselineStore baseline; /* path is NULL unless set by the caller */
+
+    int noWait;         /* timers expire at once, used to replay traces */
+    unsigned int lent;  /* bit (1 << LOOP_*) of every sensor lent to a stream, skipped by the rounds */
+
+    sensorRound *round; /* round in progress */
+} sensorLoop;
+
+/* METHODS */
+
+/**
+ * Creates the epoll instance and timers. The sensors are set up
+ * lazily by the first round, so a missing sensor does not keep
+ * the others from working.
+ *
+ * @param loop loop to initialize
+ * @return 0 on success, -1 on failure (errno is set)
+ */
+int openSensorLoop(sensorLoop *loop);
+/**
+ * Runs one round: triggers all sensors, waits for the conversions
+ * to be due and reads the results. Sensors that failed or did not
+ * finish in time have their status set accordingly.
+ *
+ * @param loop opened loop
+ * @param round receives the results
+ * @param timeoutMs maximum duration of the round
+ * @return number of sensors read, -1 if waiting failed
+ */
+int runSensorRound(sensorLoop *loop, sensorRound *round, int timeoutMs);
+/**
+ * Runs a round of some of the sensors, the others are not touched
+ * and have the status LOOP_SKIPPED.
+ *
+ * @param loop opened loop
+ * @param round receives the results
+ * @param timeoutMs maximum duration of the round
+ * @param sensors bit (1 << LOOP_*) of every sensor to read
+ * @return number of sensors read, -1 if waiting failed
+ */
+int runSensors(sensorLoop *loop, sensorRound *round, int timeoutMs, unsigned int sensors);
+/**
+ * Changes the measurement settings of the BME280. A sensor that is
+ * set up gets them at once, otherwise with its setup. Must not be
+ * called while a round runs.
+ *
+ * @param loop opened loop
+ * @param settings new settings
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN if the
+ *         settings could not be written, they are written again by
+ *         the setup after the sensor failed
+ */
+int setEnvSettings(sensorLoop *loop, const envSettings *settings);
+/**
+ * Changes the drive mode of the CCS811. A sensor that is set up is
+ * switched at once, otherwise with its setup. Must not be called
+ * while a round runs.
+ *
+ * @param loop opened loop
+ * @param driveMode one of the CCS811_MODE_* values
+ * @return I2C_OK on success, I2C_ERROR or I2C_BREAKER_OPEN if the
+ *         mode could not be set now, it is retried by the next round
+ */
+int setAirDriveMode(sensorLoop *loop, int driveMode);
+/**
+ * Lends a sensor to a stream driving it on its own (i. e. in auto
+ * run): the sensor is closed and skipped by the rounds, with the
+ * status LOOP_SKIPPED, until it is returned. Must not be called
+ * while a round runs.
+ *
+ * @param loop opened loop
+ * @param sensor LOOP_* index of the sensor
+ */
+void lendSensor(sensorLoop *loop, int sensor);
+/**
+ * Takes a lent sensor back. The next round sets it up from the
+ * start, whatever the stream left it in. Must not be called while
+ * a round runs.
+ *
+ * @param loop opened loop
+ * @param sensor LOOP_* index of the sensor
+ */
+void returnSensor(sensorLoop *loop, int sensor);
+/**
+ * Closes all sensors and timers of the loop.
+ *
+ * @param loop opened loop
+ */
+void closeSensorLoop(sensorLoop *loop);
+
+#endif //SRC_SENSORLOOP_H
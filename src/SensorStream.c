@@ -0,0 +1,171 @@
+/**
+ * <Program>
+ * SensorStream.c
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ *  Engine running the streams of the sensors: the thread waits for
+ * the event source or the timer and calls the hooks of the
+ * descriptor, which read the sensor into the ring buffer. The timer
+ * is armed even with an event source, so a failing one is given up
+ * for it without a restart.
+ *
+ * <Sources>
+ * Accessed on 18.10.2026 - timerfd_create(2):
+ *      https://man7.org/linux/man-pages/man2/timerfd_create.2.html
+ * Accessed on 18.10.2026 - poll(2):
+ *      https://man7.org/linux/man-pages/man2/poll.2.html
+ */
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+#include "SensorStream.h"
+
+/**
+ * Waits for the event source, or the timer without one, and runs the
+ * hooks until the stream is stopped.
+ */
+static void *runStream(void *argument) {
+    sensorStream *stream = argument;
+    const streamDriver *driver = stream->driver;
+    uint64_t expirations;
+
+    while (__atomic_load_n(&stream->running, __ATOMIC_ACQUIRE)) {
+        if (stream->event.fd >= 0) {
+            struct pollfd descriptor = {stream->event.fd, POLLIN | POLLPRI, 0};
+            int ready = poll(&descriptor, 1, stream->timeoutMs);
+            if (ready < 0 && errno == EINTR) {
+                continue;
+            }
+            int failed = ready < 0;
+            if (ready > 0) {
+                /* The writing end of the event source is gone or its events can not be read */
+                failed = ((descriptor.revents & (POLLHUP | POLLERR | POLLNVAL)) && !(descriptor.revents & POLLIN)) ||
+                         stream->event.consume(&stream->event) < 0;
+            }
+            if (failed) {
+                streamError(stream);
+                stream->event.close(&stream->event);
+                continue;
+            }
+            if (ready > 0 && driver->signalled != NULL) {
+                driver->signalled(stream);
+                continue;
+            }
+        } else if (read(stream->timerFd, &expirations, sizeof(expirations)) < 0) {
+            continue;
+        }
+        driver->due(stream);
+    }
+    return NULL;
+}
+
+/**
+ * Opens the sensor, runs the start hook of the descriptor and starts
+ * the thread. The ring buffer is allocated with the first start.
+ *
+ * @param stream stream to start
+ * @param driver descriptor of the stream
+ * @param owner state of the stream, passed to the hooks
+ * @param event event source of the sensor, taken over by the
+ *        stream and closed by stopSensorStream, NULL to use the
+ *        timer. It stays with the caller if the stream does not
+ *        start.
+ * @return 0 on success, -1 on failure
+ */
+int startSensorStream(sensorStream *stream, const streamDriver *driver, void *owner, const sampleEvent *event) {
+    if (stream->ring.records == NULL && openRing(&stream->ring, driver->recordSize, driver->capacity) < 0) {
+        return -1;
+    }
+
+    stream->fd = i2cSetup(driver->address);
+    if (stream->fd < 0) {
+        return -1;
+    }
+    stream->driver = driver;
+    stream->owner = owner;
+    stream->event.fd = -1;
+    stream->timerFd = -1;
+    stream->periodUs = 0;
+    stream->timeoutMs = -1;
+    if (driver->start(stream) == I2C_OK) {
+        stream->timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+        struct itimerspec timer;
+        memset(&timer, 0, sizeof(timer));
+        timer.it_value.tv_sec = stream->periodUs / 1000000;
+        timer.it_value.tv_nsec = stream->periodUs % 1000000 * 1000L;
+        timer.it_interval = timer.it_value;
+        if (stream->timerFd >= 0 && stream->periodUs > 0 && timerfd_settime(stream->timerFd, 0, &timer, NULL) == 0) {
+            if (event != NULL) {
+                stream->event = *event;
+            }
+            __atomic_store_n(&stream->running, 1, __ATOMIC_RELEASE);
+            if (pthread_create(&stream->thread, NULL, runStream, stream) == 0) {
+                return 0;
+            }
+            __atomic_store_n(&stream->running, 0, __ATOMIC_RELEASE);
+            stream->event.fd = -1;
+        }
+        if (driver->stop != NULL) {
+            driver->stop(stream);
+        }
+    }
+
+    if (stream->timerFd >= 0) {
+        close(stream->timerFd);
+    }
+    close(stream->fd);
+    stream->fd = -1;
+    return -1;
+}
+
+/**
+ * Stops the thread, runs the stop hook and closes the sensor. The
+ * records stay readable, a stream started again appends to them.
+ *
+ * @param stream started stream
+ */
+void stopSensorStream(sensorStream *stream) {
+    __atomic_store_n(&stream->running, 0, __ATOMIC_RELEASE);
+    pthread_join(stream->thread, NULL);
+    if (stream->event.fd >= 0) {
+        stream->event.close(&stream->event);
+    }
+    if (stream->driver->stop != NULL) {
+        stream->driver->stop(stream);
+    }
+    close(stream->timerFd);
+    close(stream->fd);
+    stream->fd = -1;
+}
+
+/**
+ * Counts a failed read of a hook.
+ *
+ * @param stream running stream
+ */
+void streamError(sensorStream *stream) {
+    __atomic_fetch_add(&stream->errors, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * Returns the time of a clock in microseconds, for the timestamps
+ * of the records.
+ *
+ * @param clock i. e. CLOCK_REALTIME
+ * @return time in us
+ */
+int64_t streamClockUs(clockid_t clock) {
+    struct timespec now;
+    clock_gettime(clock, &now);
+    return (int64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
@@ -0,0 +1,120 @@
+/**
+ * <Program>
+ * SensorStream.h
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ * Header file for the streams of the sensors, the counterpart of
+ * the driver descriptors (see SensorDriver.h) for sampling a sensor
+ * faster than the rounds of the sensor loop. A stream is a thread
+ * reading the sensor on its own file descriptor into a ring buffer.
+ * What a stream does is described by a descriptor, the engine runs
+ * the thread:
+ *
+ *      start     configures the sensor for streaming and sets the
+ *                period of the timer and the timeout of the event
+ *      signalled the event source of the sensor (i. e. INT) fired
+ *      due       the timer expired, or with an event source nothing
+ *                came for the timeout, the sensor is checked on the
+ *                bus
+ *      stop      puts the sensor to sleep when the stream ends
+ *
+ * The thread sleeps on the event source if there is one, otherwise
+ * on a periodic timerfd. An event source that fails is closed and
+ * the stream goes on with the timer, so a stream never stalls on a
+ * broken GPIO line.
+ *
+ * The streams of the box and their descriptors:
+ *
+ *      AirStream.h     CCS811 RAW_DATA every 250ms
+ *      EnvStream.h     BME280 pressure and temperature in normal mode
+ *      AccelStream.h   ADXL345 FIFO drained on the watermark
+ *      FlickerStream.h SI1145 VIS and IR in auto run, analyzed
+ */
+
+#ifndef SRC_SENSORSTREAM_H
+#define SRC_SENSORSTREAM_H
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <time.h>
+#include "SI1145_LightSensor.h"
+#include "RingBuffer.h"
+
+struct sensorStream;
+
+/* Used to describe a stream */
+typedef struct {
+    const char *name;
+    int address;
+    size_t recordSize;  /* size of a record of the ring buffer */
+    size_t capacity;    /* records kept */
+    /* Configures the sensor, sets periodUs and timeoutMs. Returns I2C_OK or an I2C_* code */
+    int (*start)(struct sensorStream *stream);
+    /* Called when the event source fired, NULL to call due */
+    void (*signalled)(struct sensorStream *stream);
+    /* Called on every expiration of the timer and if the event source was silent for timeoutMs */
+    void (*due)(struct sensorStream *stream);
+    /* Puts the sensor to sleep, NULL to leave it measuring */
+    void (*stop)(struct sensorStream *stream);
+} streamDriver;
+
+/* Used to hold the thread of a stream and its records */
+typedef struct sensorStream {
+    const streamDriver *driver;
+    void *owner;          /* state of the stream the hooks work on, i. e. its accelStream */
+    int fd;               /* I2C file descriptor of the stream */
+    int timerFd;          /* wakes the thread if there is no event source */
+    sampleEvent event;    /* fd is -1 without an event source */
+    pthread_t thread;
+    int running;          /* accessed atomically */
+    uint32_t periodUs;    /* period of the timer */
+    int timeoutMs;        /* longest wait for the event source */
+    uint32_t errors;      /* failed reads and event sources, accessed atomically */
+    ringBuffer ring;
+} sensorStream;
+
+/* METHODS */
+
+/**
+ * Opens the sensor, runs the start hook of the descriptor and starts
+ * the thread. The ring buffer is allocated with the first start.
+ *
+ * @param stream stream to start
+ * @param driver descriptor of the stream
+ * @param owner state of the stream, passed to the hooks
+ * @param event event source of the sensor, taken over by the
+ *        stream and closed by stopSensorStream, NULL to use the
+ *        timer. It stays with the caller if the stream does not
+ *        start.
+ * @return 0 on success, -1 on failure
+ */
+int startSensorStream(sensorStream *stream, const streamDriver *driver, void *owner, const sampleEvent *event);
+/**
+ * Stops the thread, runs the stop hook and closes the sensor. The
+ * records stay readable, a stream started again appends to them.
+ *
+ * @param stream started stream
+ */
+void stopSensorStream(sensorStream *stream);
+/**
+ * Counts a failed read of a hook.
+ *
+ * @param stream running stream
+ */
+void streamError(sensorStream *stream);
+/**
+ * Returns the time of a clock in microseconds, for the timestamps
+ * of the records.
+ *
+ * @param clock i. e. CLOCK_REALTIME
+ * @return time in us
+ */
+int64_t streamClockUs(clockid_t clock);
+
+#endif //SRC_SENSORSTREAM_H
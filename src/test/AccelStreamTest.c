@@ -0,0 +1,200 @@
+/**
+ * <Program>
+ * AccelStreamTest.c
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ *  Checks the acceleration stream against the simulated ADXL345 (see
+ * AccelSimulator.h), whose x axis numbers the samples. At 1600Hz and
+ * a watermark of WATERMARK the stream has to read every sample, on
+ * INT1 and polled: no gap in the sample numbers, no overrun, nothing
+ * lost in the simulated FIFO.
+ *  Then the stream thread is stalled for STALL_MS by a signal, so the
+ * FIFO overruns. The samples missing in the numbers have to be the
+ * ones the simulator overwrote, and the loss the stream estimates
+ * from the time since its last drain has to be within
+ * DROP_TOLERANCE of that exact count.
+ *  Exits with 0 if all checks passed, the failed ones are printed.
+ *
+ * <Sources>
+ * Accessed on 18.10.2026 - ADXL345 Datasheet:
+ *      https://www.analog.com/media/en/technical-documentation/data-sheets/ADXL345.pdf
+ * Accessed on 18.10.2026 - pthread_kill(3):
+ *      https://man7.org/linux/man-pages/man3/pthread_kill.3.html
+ */
+
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "../AccelStream.h"
+#include "../AccelSimulator.h"
+
+#define RUN_US         2000000  /* length of a clean run */
+#define READ_US        100000   /* the ring buffer is read every 100ms */
+#define STALL_MS       80       /* about 4 FIFOs at 1600Hz */
+#define DROP_TOLERANCE 2        /* samples the estimate may be off */
+/* 28 samples or 17.5ms of slack in the FIFO, a loaded host with one CPU
+ * oversleeps by more than the 10ms ACCEL_STREAM_WATERMARK leaves */
+#define WATERMARK      4
+
+/* Used to hold what was read from the ring buffer */
+typedef struct {
+    uint64_t cursor;
+    uint64_t samples;
+    uint64_t lost;      /* overwritten in the ring buffer */
+    uint64_t gaps;      /* missing sample numbers */
+    int first;
+    uint16_t lastX;
+} readerState;
+
+static int failures = 0;
+
+/**
+ * Counts and prints a failed check.
+ */
+static void check(int passed, const char *what) {
+    if (!passed) {
+        printf("FAILED: %s\n", what);
+        failures++;
+    }
+}
+
+/**
+ * Keeps the stream thread from draining the FIFO, nanosleep is safe
+ * in a signal handler.
+ */
+static void stall(int number) {
+    struct timespec pause = {0, STALL_MS * 1000000L};
+    nanosleep(&pause, NULL);
+}
+
+/**
+ * Reads the new samples and counts the gaps in their numbers.
+ */
+static void readSamples(accelStream *stream, readerState *state) {
+    static accelSample samples[4096];
+    size_t count;
+    do {
+        uint64_t lost;
+        count = readRing(&stream->stream.ring, &state->cursor, samples, 4096, &lost);
+        state->lost += lost;
+        for (size_t i = 0; i < count; i++) {
+            uint16_t x = (uint16_t) samples[i].data.x;
+            if (!state->first) {
+                state->gaps += (uint16_t) (x - state->lastX - 1);
+            }
+            state->first = 0;
+            state->lastX = x;
+        }
+        state->samples += count;
+    } while (count == 4096);
+}
+
+/**
+ * Runs the stream at 1600Hz for runUs, stalling its thread once
+ * after half of it if asked to.
+ *
+ * @return 0 if the stream ran, -1 if it could not be started
+ */
+static int runStream(accelStream *stream, readerState *state, int withEvent, int stalled) {
+    sampleEvent event;
+    memset(stream, 0, sizeof(*stream));
+    memset(state, 0, sizeof(*state));
+    state->first = 1;
+    if (startAccelSimulator() < 0) {
+        return -1;
+    }
+    if (withEvent && openFdEvent(&event, accelSimulatorEvent()) < 0) {
+        stopAccelSimulator();
+        return -1;
+    }
+    if (startAccelStream(stream, ACCEL_STREAM_RATE, WATERMARK, withEvent ? &event : NULL) < 0) {
+        if (withEvent) {
+            event.close(&event);
+        }
+        stopAccelSimulator();
+        return -1;
+    }
+    for (int elapsed = 0; elapsed < RUN_US; elapsed += READ_US) {
+        usleep(READ_US);
+        if (stalled && elapsed == RUN_US / 2) {
+            pthread_kill(stream->stream.thread, SIGUSR1);
+        }
+        readSamples(stream, state);
+    }
+    stopAccelStream(stream);
+    readSamples(stream, state);
+    return 0;
+}
+
+/**
+ * Every sample is read at 1600Hz, on INT1 or polled.
+ */
+static void testClean(int withEvent) {
+    accelStream stream;
+    readerState state;
+    char what[128];
+    const char *mode = withEvent ? "INT1" : "polled";
+    snprintf(what, sizeof(what), "%s: stream started", mode);
+    check(runStream(&stream, &state, withEvent, 0) == 0, what);
+    uint64_t lost = accelSimulatorLost();
+    stopAccelSimulator();
+
+    uint64_t expected = (uint64_t) (accelRateHz(ACCEL_STREAM_RATE) * RUN_US / 1e6);
+    snprintf(what, sizeof(what), "%s: %" PRIu64 " samples read, about %" PRIu64 " expected", mode, state.samples,
+             expected);
+    check(state.samples > expected * 9 / 10, what);
+    snprintf(what, sizeof(what), "%s: %" PRIu64 " gaps, %" PRIu64 " overwritten by the simulator", mode, state.gaps,
+             lost);
+    check(state.gaps == 0 && lost == 0, what);
+    snprintf(what, sizeof(what), "%s: %" PRIu64 " overruns, %" PRIu64 " dropped, %" PRIu32 " errors", mode,
+             stream.overruns, stream.dropped, stream.stream.errors);
+    check(stream.overruns == 0 && stream.dropped == 0 && stream.stream.errors == 0, what);
+    snprintf(what, sizeof(what), "%s: %" PRIu64 " lost in the ring buffer", mode, state.lost);
+    check(state.lost == 0, what);
+}
+
+/**
+ * A stalled thread lets the FIFO overrun, the stream estimates the
+ * loss the simulator counted exactly.
+ */
+static void testOverrun(void) {
+    accelStream stream;
+    readerState state;
+    char what[160];
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = stall;
+    sigaction(SIGUSR1, &action, NULL);
+
+    check(runStream(&stream, &state, 1, 1) == 0, "overrun: stream started");
+    uint64_t lost = accelSimulatorLost();
+    stopAccelSimulator();
+
+    snprintf(what, sizeof(what), "overrun: %" PRIu64 " overruns, %" PRIu64 " overwritten by the simulator",
+             stream.overruns, lost);
+    check(stream.overruns > 0 && lost > 0, what);
+    snprintf(what, sizeof(what), "overrun: %" PRIu64 " gaps, %" PRIu64 " overwritten by the simulator", state.gaps,
+             lost);
+    check(state.gaps == lost, what);
+    snprintf(what, sizeof(what), "overrun: %" PRIu64 " dropped estimated, %" PRIu64 " overwritten by the simulator",
+             stream.dropped, lost);
+    check(stream.dropped + DROP_TOLERANCE >= lost && stream.dropped <= lost + DROP_TOLERANCE, what);
+    printf("overrun: %" PRIu64 " samples overwritten, %" PRIu64 " estimated\n", lost, stream.dropped);
+}
+
+int main(int argc, char **argv) {
+    testClean(1);
+    testClean(0);
+    testOverrun();
+
+    printf("%s\n", failures == 0 ? "all checks passed" : "checks failed");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,19 @@
+# Runs loganalytics on the same inputs with one and with four workers,
+# the tables have to be the same byte for byte.
+# cmake -DANALYTICS=<loganalytics> -DINPUT=<directory> -DOUTPUT=<directory> -P AnalyticsRuns.cmake
+foreach (THREADS 1 4)
+    file(REMOVE_RECURSE ${OUTPUT}/j${THREADS})
+    file(MAKE_DIRECTORY ${OUTPUT}/j${THREADS})
+    execute_process(COMMAND ${ANALYTICS} -j ${THREADS} -c 2 -o ${OUTPUT}/j${THREADS} ${INPUT}
+            RESULT_VARIABLE RESULT OUTPUT_QUIET)
+    if (NOT RESULT EQUAL 0)
+        message(FATAL_ERROR "loganalytics -j ${THREADS} failed: ${RESULT}")
+    endif ()
+endforeach ()
+foreach (TABLE hourly daily correlation histogram)
+    execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files
+            ${OUTPUT}/j1/analytics_${TABLE}.csv ${OUTPUT}/j4/analytics_${TABLE}.csv RESULT_VARIABLE RESULT)
+    if (NOT RESULT EQUAL 0)
+        message(FATAL_ERROR "analytics_${TABLE}.csv differs between -j 1 and -j 4")
+    endif ()
+endforeach ()
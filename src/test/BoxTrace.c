@@ -0,0 +1,326 @@
+/**
+ * <Program>
+ * BoxTrace.c
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ *  Records an I2C trace of the sensor loop reading simulated
+ * sensors, to make the trace fixtures of the replay tests (see
+ * I2CReplay.c) on a PC. The simulator is a backend of the I2C layer
+ * answering like the BME280, SI1145 and CCS811 of the box:
+ *
+ *      BME280  calibration of the datasheet example, a forced
+ *              measurement takes 8ms, every 5th 11ms so the status
+ *              is polled
+ *      SI1145  command and response registers, a forced measurement
+ *              sets the ALS bit of IRQSTAT after 3ms, every 4th after
+ *              6ms; every 23rd transaction fails once (-f), so the
+ *              trace has retries
+ *      CCS811  application start, a result every 25ms instead of
+ *              every second in the 1s drive mode, so a trace takes
+ *              seconds to record
+ *
+ * The values change from measurement to measurement by fixed steps,
+ * so they do not depend on the timing of the recording. Only the
+ * number of status polls does.
+ * A trace without failures (-f 0) has the same transactions
+ * whichever way a driver retries, test/traces/preport.i2ct is one
+ * recorded before the drivers became descriptors (see
+ * SensorDriver.h), so the replay test holds the engine to the bus
+ * sequence of the hand-written state machines.
+ *  Usage: boxtrace [-n rounds] [-f failing] trace
+ *
+ * <Sources>
+ * Accessed on 11.01.2018 - BME280 Datasheet:
+ *      https://ae-bst.resource.bosch.com/media/_tech/media/datasheets/BST-BME280_DS001-12.pdf
+ * Accessed on 11.01.2018 - SI1145 Datasheet:
+ *      https://www.silabs.com/documents/public/data-sheets/Si1145-46-47.pdf
+ * Accessed on 18.10.2026 - CCS811 Datasheet:
+ *      https://cdn.sparkfun.com/assets/learn_tutorials/1/4/3/CCS811_Datasheet-DS000459.pdf
+ */
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "../I2CTrace.h"
+#include "../SensorLoop.h"
+
+#define SIMULATED_DEVICES 3
+#define CCS811_RESULT_US  25000
+
+/* Used to hold the state of a simulated sensor */
+typedef struct {
+    int address;
+    uint8_t registers[256];
+    uint32_t measurements;
+    int64_t readyUs;        /* monotonic time the running measurement is done */
+    uint32_t transactions;
+} simulatedSensor;
+
+static simulatedSensor sensors[SIMULATED_DEVICES] = {
+        {BME280_ADDRESS}, {SI1145_ADDRESS}, {CCS811_ADDRESS}
+};
+static simulatedSensor *sensorByFd[I2C_FD_MAX];
+static uint32_t failingTransaction = 23; /* every n-th transaction of the SI1145 fails, 0 for none */
+
+/**
+ * Returns the monotonic time in microseconds.
+ */
+static int64_t monotonicUs(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/**
+ * Returns the sensor of an fd, NULL if the transaction fails. Every
+ * failingTransaction-th transaction of the SI1145 fails.
+ */
+static simulatedSensor *transaction(int fd) {
+    simulatedSensor *sensor = fd >= 0 && fd < I2C_FD_MAX ? sensorByFd[fd] : NULL;
+    if (sensor != NULL && ++sensor->transactions % (failingTransaction > 0 ? failingTransaction : UINT32_MAX) == 0 &&
+        sensor->address == SI1145_ADDRESS) {
+        return NULL;
+    }
+    return sensor;
+}
+
+/**
+ * Starts a forced measurement of the BME280, the raw values change
+ * by a few LSB every time.
+ */
+static void measureBME280(simulatedSensor *sensor) {
+    uint32_t n = sensor->measurements++;
+    uint32_t pressure = 415148 + n * 13;
+    uint32_t temperature = 519888 + n * 37 % 200;
+    uint32_t humidity = 0x6600 + n * 7 % 64;
+    uint8_t *data = &sensor->registers[PRESSUREDATA];
+    data[0] = (uint8_t) (pressure >> 12);
+    data[1] = (uint8_t) (pressure >> 4);
+    data[2] = (uint8_t) ((pressure & 0xF) << 4);
+    data[3] = (uint8_t) (temperature >> 12);
+    data[4] = (uint8_t) (temperature >> 4);
+    data[5] = (uint8_t) ((temperature & 0xF) << 4);
+    data[6] = (uint8_t) (humidity >> 8);
+    data[7] = (uint8_t) humidity;
+    sensor->readyUs = monotonicUs() + (n % 5 == 4 ? 11000 : 8000);
+}
+
+/**
+ * Runs a command of the SI1145, the response counts the commands.
+ */
+static void commandSI1145(simulatedSensor *sensor, int command) {
+    uint8_t *registers = sensor->registers;
+    if (command == 0x00) {
+        registers[SI1145_REG_RESPONSE] = 0;
+        return;
+    }
+    registers[SI1145_REG_RESPONSE] = (uint8_t) ((registers[SI1145_REG_RESPONSE] + 1) & 0x0F);
+    if (command == SI1145_ALS_FORCE) {
+        uint32_t n = sensor->measurements++;
+        uint16_t values[6] = {
+                (uint16_t) (260 + n % 40), (uint16_t) (250 + n * 3 % 90), 0, 0, 0, (uint16_t) (n * 5 % 300)
+        };
+        for (int i = 0; i < 6; i++) {
+            registers[VISDATA + 2 * i] = (uint8_t) values[i];
+            registers[VISDATA + 2 * i + 1] = (uint8_t) (values[i] >> 8);
+        }
+        sensor->readyUs = monotonicUs() + (n % 4 == 3 ? 6000 : 3000);
+    }
+}
+
+/**
+ * Finishes a result of the CCS811 every CCS811_RESULT_US.
+ */
+static void resultCCS811(simulatedSensor *sensor) {
+    uint32_t n = sensor->measurements++;
+    uint16_t eCO2 = (uint16_t) (400 + n * 3 % 200);
+    uint16_t tvoc = (uint16_t) (n % 50);
+    uint8_t *result = &sensor->registers[CCS811_ALG_RESULT_DATA];
+    result[0] = (uint8_t) (eCO2 >> 8);
+    result[1] = (uint8_t) eCO2;
+    result[2] = (uint8_t) (tvoc >> 8);
+    result[3] = (uint8_t) tvoc;
+    result[4] = CCS811_STATUS_FW_MODE | CCS811_STATUS_APP_VALID | CCS811_STATUS_DATA_READY;
+    result[5] = 0;
+    result[6] = (uint8_t) (21 << 2);
+    result[7] = (uint8_t) n;
+    sensor->readyUs = monotonicUs() + CCS811_RESULT_US;
+}
+
+/**
+ * Returns a register, status registers are updated from the time.
+ */
+static int readRegister(simulatedSensor *sensor, int reg) {
+    uint8_t *registers = sensor->registers;
+    int done = monotonicUs() >= sensor->readyUs;
+    if (sensor->address == BME280_ADDRESS && reg == STATUS) {
+        return done ? 0 : STATUS_MEASURING;
+    }
+    if (sensor->address == SI1145_ADDRESS && reg == SI1145_REG_IRQSTAT) {
+        return done && sensor->measurements > 0 ? registers[reg] | SI1145_REG_IRQSTAT_ALS : registers[reg];
+    }
+    if (sensor->address == CCS811_ADDRESS && reg == CCS811_STATUS) {
+        return registers[reg] | (done && registers[CCS811_MEAS_MODE] != 0 ? CCS811_STATUS_DATA_READY : 0);
+    }
+    return registers[reg & 0xFF];
+}
+
+static int simulatedSetup(int devId) {
+    for (int i = 0; i < SIMULATED_DEVICES; i++) {
+        if (sensors[i].address == devId) {
+            int fd = open("/dev/null", O_RDWR | O_CLOEXEC);
+            if (fd >= 0 && fd < I2C_FD_MAX) {
+                sensorByFd[fd] = &sensors[i];
+            }
+            return fd;
+        }
+    }
+    return -1;
+}
+
+static int simulatedRead(int fd) {
+    return -1;
+}
+
+static int simulatedReadReg8(int fd, int reg) {
+    simulatedSensor *sensor = transaction(fd);
+    return sensor != NULL ? readRegister(sensor, reg) : -1;
+}
+
+static int simulatedReadReg16(int fd, int reg) {
+    simulatedSensor *sensor = transaction(fd);
+    return sensor != NULL ? sensor->registers[reg & 0xFF] | sensor->registers[(reg + 1) & 0xFF] << 8 : -1;
+}
+
+static int simulatedWrite(int fd, int data) {
+    simulatedSensor *sensor = transaction(fd);
+    if (sensor == NULL) {
+        return -1;
+    }
+    if (sensor->address == CCS811_ADDRESS && data == CCS811_APP_START) {
+        sensor->registers[CCS811_STATUS] |= CCS811_STATUS_FW_MODE;
+    }
+    return 0;
+}
+
+static int simulatedWriteReg8(int fd, int reg, int data) {
+    simulatedSensor *sensor = transaction(fd);
+    if (sensor == NULL) {
+        return -1;
+    }
+    uint8_t *registers = sensor->registers;
+    if (sensor->address == BME280_ADDRESS && reg == CONTROL_MEAS && (data & 0x3) == MODE_FORCED) {
+        measureBME280(sensor);
+    } else if (sensor->address == SI1145_ADDRESS && reg == SI1145_REG_COMMAND) {
+        commandSI1145(sensor, data);
+        return 0;
+    } else if (sensor->address == SI1145_ADDRESS && reg == SI1145_REG_IRQSTAT) {
+        /* Writing 1 clears the bit, a new measurement sets it again */
+        sensor->readyUs = INT64_MAX;
+        return 0;
+    } else if (sensor->address == CCS811_ADDRESS && reg == CCS811_MEAS_MODE) {
+        sensor->readyUs = monotonicUs() + CCS811_RESULT_US;
+    }
+    registers[reg & 0xFF] = (uint8_t) data;
+    return 0;
+}
+
+static int simulatedWriteReg16(int fd, int reg, int data) {
+    simulatedSensor *sensor = transaction(fd);
+    return sensor != NULL ? 0 : -1;
+}
+
+static int simulatedReadBlock(int fd, int reg, uint8_t *buffer, int length) {
+    simulatedSensor *sensor = transaction(fd);
+    if (sensor == NULL) {
+        return -1;
+    }
+    if (sensor->address == CCS811_ADDRESS && reg == CCS811_ALG_RESULT_DATA) {
+        resultCCS811(sensor);
+    }
+    for (int i = 0; i < length; i++) {
+        buffer[i] = sensor->registers[(reg + i) & 0xFF];
+    }
+    return length;
+}
+
+static const i2cBackend simulator = {
+        simulatedSetup, simulatedRead, simulatedReadReg8, simulatedReadReg16,
+        simulatedWrite, simulatedWriteReg8, simulatedWriteReg16, simulatedReadBlock
+};
+
+/**
+ * Puts the identification and calibration into the registers.
+ */
+static void initSensors(void) {
+    static const uint16_t calibration[] = {
+            27504, 26435, (uint16_t) -1000, 36477, (uint16_t) -10685, 3024, 2855, 140, (uint16_t) -7,
+            15500, (uint16_t) -14600, 6000
+    };
+    uint8_t *bme280 = sensors[0].registers;
+    for (int i = 0; i < 12; i++) {
+        bme280[DIG_T1 + 2 * i] = (uint8_t) calibration[i];
+        bme280[DIG_T1 + 2 * i + 1] = (uint8_t) (calibration[i] >> 8);
+    }
+    bme280[DIG_H1] = 75;
+    static const uint8_t humidity[] = {0x6A, 0x01, 0x00, 0x13, 0x25, 0x03, 0x1E};
+    memcpy(&bme280[DIG_H2], humidity, sizeof(humidity));
+    bme280[CHIPID] = 0x60;
+
+    sensors[2].registers[CCS811_HW_ID] = CCS811_HW_ID_CODE;
+    sensors[2].registers[CCS811_STATUS] = CCS811_STATUS_APP_VALID;
+    for (int i = 0; i < SIMULATED_DEVICES; i++) {
+        sensors[i].readyUs = INT64_MAX;
+    }
+}
+
+int main(int argc, char **argv) {
+    int rounds = 40;
+    int option;
+    while ((option = getopt(argc, argv, "n:f:")) != -1) {
+        if (option == 'n') {
+            rounds = atoi(optarg);
+        } else if (option == 'f') {
+            failingTransaction = (uint32_t) atoi(optarg);
+        } else {
+            fprintf(stderr, "usage: %s [-n rounds] [-f failing] trace\n", argv[0]);
+            return 1;
+        }
+    }
+    if (optind != argc - 1 || rounds < 1) {
+        fprintf(stderr, "usage: %s [-n rounds] [-f failing] trace\n", argv[0]);
+        return 1;
+    }
+
+    initSensors();
+    i2cSetBackend(&simulator);
+    if (i2cStartTrace(argv[optind]) < 0) {
+        perror(argv[optind]);
+        return 1;
+    }
+    sensorLoop loop;
+    sensorRound round;
+    if (openSensorLoop(&loop) < 0) {
+        perror("sensor loop");
+        return 1;
+    }
+    int failed = 0;
+    for (int i = 0; i < rounds; i++) {
+        if (runSensorRound(&loop, &round, LOOP_ROUND_TIMEOUT_MS) < 0) {
+            failed++;
+        }
+    }
+    closeSensorLoop(&loop);
+    long records = i2cStopTrace();
+    printf("recorded %ld transactions in %d rounds, %d failed\n", records, rounds, failed);
+    return records < 0;
+}
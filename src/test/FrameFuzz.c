@@ -0,0 +1,197 @@
+/**
+ * <Program>
+ * FrameFuzz.c
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ *  Fuzz target of the frame decoder (see SensorFrame.h). Every input
+ * is decoded as it is and, since random bytes hardly ever have the
+ * right CRC, a second time with the CRC of its bytes in the last 4,
+ * so the fuzzer gets past the CRC into the decoder. A frame that is
+ * accepted has to come out of encodeFrame byte for byte the same and
+ * has to be rejected with its last byte cut off (truncated) or one
+ * byte added (oversize). Any other outcome than a rejected frame or
+ * a successful check aborts.
+ *  Built with -DFUZZ=ON the target is linked with libFuzzer (clang
+ * only). Otherwise it has a main running the files and directories
+ * given as arguments once, which is the ctest and works with AFL:
+ *
+ *      afl-fuzz -i test/corpus/frame -o findings -- ./framefuzz @@
+ *
+ * The corpus holds frames written by encodeFrame (one sample, many,
+ * the limits of every channel and 256 samples) and a few invalid
+ * ones (truncated, oversize, a wrong CRC).
+ *
+ * <Sources>
+ * Accessed on 18.10.2026 - libFuzzer:
+ *      https://llvm.org/docs/LibFuzzer.html
+ * Accessed on 18.10.2026 - american fuzzy lop:
+ *      https://lcamtuf.coredump.cx/afl/
+ * Accessed on 18.10.2026 - RFC 3720, appendix B.4 (CRC32C):
+ *      https://www.rfc-editor.org/rfc/rfc3720#appendix-B.4
+ */
+
+#include <dirent.h>
+#include <stdio.h>
+#include <string.h>
+#include "../SensorFrame.h"
+
+/* Frames checked so far, reported by main */
+static uint64_t accepted = 0;
+static uint64_t rejected = 0;
+
+/**
+ * Aborts with a message, the fuzzer keeps the input as crash.
+ */
+static void fail(const char *what) {
+    fprintf(stderr, "FAILED: %s\n", what);
+    abort();
+}
+
+/**
+ * Writes the CRC of all bytes but the last 4 into them.
+ */
+static void sealFrame(uint8_t *frame, size_t length) {
+    uint32_t crc = crc32c(0, frame, length - sizeof(uint32_t));
+    for (size_t i = 0; i < sizeof(uint32_t); i++) {
+        frame[length - sizeof(uint32_t) + i] = (uint8_t) (crc >> (8 * i));
+    }
+}
+
+/**
+ * Decodes a frame. An accepted frame has to be written again by
+ * encodeFrame exactly as it is and its box ID has to be found by
+ * peekFrameBox.
+ *
+ * @return number of samples, -1 if the frame was rejected
+ */
+static long checkFrame(const uint8_t *data, size_t length) {
+    static frameSample samples[FRAME_SAMPLES_MAX];
+    static uint8_t encoded[FRAME_BYTES_MAX];
+    frameHeader header;
+    uint32_t boxId;
+
+    long count = decodeFrame(data, length, &header, samples);
+    if (count < 0) {
+        rejected++;
+        return -1;
+    }
+    accepted++;
+    if (count != header.count || count < 1 || count > FRAME_SAMPLES_MAX) {
+        fail("number of samples");
+    }
+    if (peekFrameBox(data, length, &boxId) < 0 || boxId != header.boxId) {
+        fail("box ID of an accepted frame");
+    }
+    long written = encodeFrame(encoded, sizeof(encoded), header.boxId, samples, (size_t) count);
+    if (written != (long) length || memcmp(encoded, data, length) != 0) {
+        fail("accepted frame is not what encodeFrame writes");
+    }
+    return count;
+}
+
+/**
+ * Entry point of libFuzzer, called with every input.
+ */
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    static uint8_t frame[FRAME_BYTES_MAX + 1];
+
+    checkFrame(data, size);
+    if (size < FRAME_BYTES_MIN || size > FRAME_BYTES_MAX) {
+        return 0;
+    }
+
+    memcpy(frame, data, size);
+    sealFrame(frame, size);
+    if (checkFrame(frame, size) < 0) {
+        return 0;
+    }
+
+    /* Truncated: the last byte of the samples is missing */
+    memcpy(frame, data, size - sizeof(uint32_t) - 1);
+    sealFrame(frame, size - 1);
+    if (checkFrame(frame, size - 1) >= 0) {
+        fail("truncated frame accepted");
+    }
+
+    /* Oversize: a byte left over after the samples */
+    memcpy(frame, data, size - sizeof(uint32_t));
+    frame[size - sizeof(uint32_t)] = 0;
+    sealFrame(frame, size + 1);
+    if (checkFrame(frame, size + 1) >= 0) {
+        fail("oversize frame accepted");
+    }
+    return 0;
+}
+
+#ifndef SENSOR_FUZZ_LIBFUZZER
+/**
+ * Runs a single input file.
+ *
+ * @return 0 on success, -1 if it could not be read
+ */
+static int runFile(const char *path) {
+    static uint8_t data[FRAME_BYTES_MAX * 2];
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return -1;
+    }
+    size_t size = fread(data, 1, sizeof(data), file);
+    int failed = ferror(file);
+    fclose(file);
+    if (failed) {
+        return -1;
+    }
+    LLVMFuzzerTestOneInput(data, size);
+    return 0;
+}
+
+/**
+ * Runs every file of a directory, or the path itself if it is no
+ * directory.
+ *
+ * @return number of files run, -1 on failure
+ */
+static int runPath(const char *path) {
+    DIR *directory = opendir(path);
+    if (directory == NULL) {
+        return runFile(path) < 0 ? -1 : 1;
+    }
+    int files = 0;
+    struct dirent *entry;
+    char name[4096];
+    while (files >= 0 && (entry = readdir(directory)) != NULL) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+        snprintf(name, sizeof(name), "%s/%s", path, entry->d_name);
+        files = runFile(name) < 0 ? -1 : files + 1;
+    }
+    closedir(directory);
+    return files;
+}
+
+int main(int argc, char **argv) {
+    /* Check value of CRC32C (RFC 3720, B.4), the same on every CPU */
+    if (crc32c(0, "123456789", 9) != 0xE3069283) {
+        fail("CRC32C check value");
+    }
+
+    int files = 0;
+    for (int i = 1; i < argc; i++) {
+        int run = runPath(argv[i]);
+        if (run < 0) {
+            fprintf(stderr, "can not read %s\n", argv[i]);
+            return 1;
+        }
+        files += run;
+    }
+    printf("%d inputs, %" PRIu64 " frames accepted, %" PRIu64 " rejected\n", files, accepted, rejected);
+    return 0;
+}
+#endif
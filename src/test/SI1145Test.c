@@ -0,0 +1,233 @@
+/**
+ * <Program>
+ * SI1145Test.c
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ *  Checks the SI1145 driver against a fake sensor, a backend of the
+ * I2C layer holding the registers of the sensor. Writing 1 to a bit
+ * of IRQSTAT clears it like on the sensor (see p. 39), every command
+ * but the NOP increments RESPONSE (see p. 22). Instead of INT an
+ * eventfd or a pipe is used as event source of waitForSample. The
+ * command register can be made to fail every write, like a dead
+ * sensor, to check that it opens the circuit breaker.
+ *  Exits with 0 if all checks passed, the failed ones are printed.
+ *
+ * <Sources>
+ * Accessed on 18.10.2026 - Si1145/46/47 Datasheet:
+ *      https://www.silabs.com/documents/public/data-sheets/Si1145-46-47.pdf
+ * Accessed on 18.10.2026 - eventfd(2):
+ *      https://man7.org/linux/man-pages/man2/eventfd.2.html
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include "../SI1145_LightSensor.h"
+
+/* Registers of the fake sensor and the number of writes clearing IRQSTAT */
+static uint8_t registers[256];
+static int irqClears = 0;
+/* Commands run since the last NOP, the most of them and command writes failing after they ran */
+static int commandRuns = 0;
+static int mostCommandRuns = 0;
+static int lostCommandAcks = 0;
+/* Command writes reaching the sensor and whether they all fail, like a dead sensor */
+static int commandWrites = 0;
+static int deadCommand = 0;
+static int failures = 0;
+
+static int fakeSetup(int devId) {
+    return devId == SI1145_ADDRESS ? open("/dev/null", O_RDWR) : -1;
+}
+
+static int fakeRead(int fd) {
+    return -1;
+}
+
+static int fakeReadReg8(int fd, int reg) {
+    return registers[reg];
+}
+
+static int fakeReadReg16(int fd, int reg) {
+    return registers[reg] | registers[(reg + 1) & 0xFF] << 8;
+}
+
+static int fakeWrite(int fd, int data) {
+    return -1;
+}
+
+static int fakeWriteReg8(int fd, int reg, int data) {
+    if (reg == SI1145_REG_COMMAND) {
+        commandWrites++;
+        if (deadCommand) {
+            return -1;
+        }
+    }
+    if (reg == SI1145_REG_IRQSTAT) {
+        registers[reg] &= (uint8_t) ~data;
+        irqClears++;
+    } else if (reg == SI1145_REG_COMMAND && data == 0x00) {
+        registers[SI1145_REG_RESPONSE] = 0x00;
+        commandRuns = 0;
+    } else if (reg == SI1145_REG_COMMAND) {
+        registers[SI1145_REG_RESPONSE] = (uint8_t) ((registers[SI1145_REG_RESPONSE] + 1) & 0x0F);
+        if (++commandRuns > mostCommandRuns) {
+            mostCommandRuns = commandRuns;
+        }
+        if (lostCommandAcks > 0) {
+            lostCommandAcks--;
+            return -1;
+        }
+    } else {
+        registers[reg] = (uint8_t) data;
+    }
+    return 0;
+}
+
+static int fakeWriteReg16(int fd, int reg, int data) {
+    return -1;
+}
+
+static int fakeReadBlock(int fd, int reg, uint8_t *buffer, int length) {
+    for (int i = 0; i < length; i++) {
+        buffer[i] = registers[(reg + i) & 0xFF];
+    }
+    return length;
+}
+
+static const i2cBackend fakeSensor = {
+        fakeSetup, fakeRead, fakeReadReg8, fakeReadReg16,
+        fakeWrite, fakeWriteReg8, fakeWriteReg16, fakeReadBlock
+};
+
+/**
+ * Counts and prints a failed check.
+ */
+static void check(int passed, const char *what) {
+    if (!passed) {
+        printf("FAILED: %s\n", what);
+        failures++;
+    }
+}
+
+/**
+ * Lets the fake sensor finish a measurement: new values in the data
+ * registers and the ALS bit of IRQSTAT set.
+ */
+static void finishMeasurement(uint16_t vis, uint16_t ir, uint16_t uv) {
+    registers[VISDATA] = (uint8_t) vis;
+    registers[VISDATA + 1] = (uint8_t) (vis >> 8);
+    registers[IRDATA] = (uint8_t) ir;
+    registers[IRDATA + 1] = (uint8_t) (ir >> 8);
+    registers[UVDATA] = (uint8_t) uv;
+    registers[UVDATA + 1] = (uint8_t) (uv >> 8);
+    registers[SI1145_REG_IRQSTAT] |= SI1145_REG_IRQSTAT_ALS;
+}
+
+/**
+ * A signalled eventfd makes waitForSample read the sample and clear
+ * IRQSTAT, the eventfd is drained.
+ */
+static void testEventfdSample(int sensor) {
+    sampleEvent event;
+    lightData data;
+    uint64_t count;
+    int fd = eventfd(0, 0);
+    check(fd >= 0 && openFdEvent(&event, fd) == 0, "eventfd opened as event source");
+
+    finishMeasurement(0x1234, 0x0567, 0x0089);
+    irqClears = 0;
+    count = 1;
+    check(write(fd, &count, sizeof(count)) == sizeof(count), "eventfd signalled");
+    memset(&data, 0, sizeof(data));
+    check(waitForSample(sensor, &event, 1000, &data) == 1, "eventfd: sample read");
+    check(data.vis == 0x1234 && data.ir == 0x0567 && data.uv == 0x0089, "eventfd: values of the sample");
+    check(irqClears == 1 && (registers[SI1145_REG_IRQSTAT] & SI1145_REG_IRQSTAT_ALS) == 0, "eventfd: IRQSTAT cleared");
+    check(read(fd, &count, sizeof(count)) < 0, "eventfd drained");
+
+    /* An event without a finished measurement is ignored until the timeout */
+    count = 1;
+    check(write(fd, &count, sizeof(count)) == sizeof(count), "eventfd signalled again");
+    irqClears = 0;
+    check(waitForSample(sensor, &event, 50, &data) == 0, "eventfd: spurious event times out");
+    check(irqClears == 1, "eventfd: IRQSTAT cleared on timeout to re-arm INT");
+
+    event.close(&event);
+    check(event.fd == -1, "eventfd forgotten by the event source");
+    close(fd);
+}
+
+/**
+ * Every write to a pipe counts as an edge, closing its writing end
+ * fails the wait instead of sleeping forever.
+ */
+static void testPipeSample(int sensor) {
+    sampleEvent event;
+    lightData data;
+    int ends[2];
+    check(pipe(ends) == 0 && openFdEvent(&event, ends[0]) == 0, "pipe opened as event source");
+
+    finishMeasurement(100, 200, 3);
+    check(write(ends[1], "ab", 2) == 2, "pipe signalled twice");
+    check(waitForSample(sensor, &event, 1000, &data) == 1, "pipe: sample read");
+    check(data.vis == 100 && data.ir == 200 && data.uv == 3, "pipe: values of the sample");
+    check((registers[SI1145_REG_IRQSTAT] & SI1145_REG_IRQSTAT_ALS) == 0, "pipe: IRQSTAT cleared");
+
+    close(ends[1]);
+    check(waitForSample(sensor, &event, 1000, &data) == -1, "pipe: closed writing end fails the wait");
+    close(ends[0]);
+}
+
+/**
+ * A command write that fails after the sensor took it is not
+ * retried on its own, the command runs again only after a NOP.
+ */
+static void testCommandNotRepeated(int sensor) {
+    commandRuns = 0;
+    mostCommandRuns = 0;
+    lostCommandAcks = 1;
+    check(startForcedMeas(sensor) == I2C_OK, "command: sent after a lost ACK");
+    check(lostCommandAcks == 0, "command: lost ACK happened");
+    check(mostCommandRuns == 1, "command: never run twice without a NOP in between");
+}
+
+/**
+ * Failed command writes count towards the circuit breaker, once it
+ * is open the command register is not written any more.
+ */
+static void testCommandBreaker(int sensor) {
+    deadCommand = 1;
+    commandWrites = 0;
+    check(startForcedMeas(sensor) == I2C_BREAKER_OPEN, "breaker: opened by the failed command writes");
+    check(commandWrites == I2C_BREAKER_THRESHOLD, "breaker: every command write tried once until it opened");
+    commandWrites = 0;
+    check(startForcedMeas(sensor) == I2C_BREAKER_OPEN, "breaker: open breaker rejects the command");
+    check(commandWrites == 0, "breaker: nothing written while it is open");
+    deadCommand = 0;
+    i2cCloseBreakers();
+}
+
+int main(int argc, char **argv) {
+    i2cSetBackend(&fakeSensor);
+    int sensor = i2cSetup(SI1145_ADDRESS);
+    check(sensor >= 0, "fake sensor set up");
+    if (sensor >= 0) {
+        testEventfdSample(sensor);
+        testPipeSample(sensor);
+        testCommandNotRepeated(sensor);
+        testCommandBreaker(sensor);
+        close(sensor);
+    }
+    i2cSetBackend(NULL);
+
+    printf("%s\n", failures == 0 ? "all checks passed" : "checks failed");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,163 @@
+/**
+ * <Program>
+ * ScheduleTest.c
+ *
+ * <Started>
+ * October 2026
+ *
+ * <Author>
+ * Peter Klosowski
+ *
+ * <Description>
+ *  Checks the sleep of the sampling loops (sleepUntilScheduled in
+ * ScheduleStats.h): a SIGTERM in the middle of a long sleep ends it
+ * at once if the callback says so, like CosyBox does when Python is
+ * stopped, any other signal lets it sleep on until the due time.
+ *  The percentiles of the lateness must not show above its maximum,
+ * although they are the upper bounds of their histogram buckets.
+ *  Exits with 0 if all checks passed, the failed ones are printed.
+ *
+ * <Sources>
+ * Accessed on 18.10.2026 - clock_nanosleep(2):
+ *      https://man7.org/linux/man-pages/man2/clock_nanosleep.2.html
+ * Accessed on 18.10.2026 - pthread_kill(3):
+ *      https://man7.org/linux/man-pages/man3/pthread_kill.3.html
+ */
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "../ScheduleStats.h"
+
+#define LONG_SLEEP_US  5000000  /* sleep a stop has to cut short */
+#define SHORT_SLEEP_US 300000   /* sleep a signal must not cut short */
+#define SIGNAL_US      100000   /* the signal comes after this time */
+#define STOP_US        100000   /* most a stopped sleep may go on after the signal */
+
+static volatile sig_atomic_t stopSignal = 0;
+static int interruptions = 0;
+static int failures = 0;
+
+/**
+ * Counts and prints a failed check.
+ */
+static void check(int passed, const char *what) {
+    if (!passed) {
+        printf("FAILED: %s\n", what);
+        failures++;
+    }
+}
+
+static void onSignal(int number) {
+    if (number == SIGTERM) {
+        stopSignal = number;
+    }
+}
+
+/**
+ * Ends the sleep once SIGTERM came, like handleSleepSignal in
+ * CosyBox.c running the stop queued by its handler.
+ */
+static int interrupted(void *context) {
+    interruptions++;
+    return stopSignal != 0 ? 1 : 0;
+}
+
+/* Used to send a signal to a thread after SIGNAL_US */
+typedef struct {
+    pthread_t target;
+    int number;
+} delayedSignal;
+
+static void *sendSignal(void *argument) {
+    delayedSignal *signal = argument;
+    usleep(SIGNAL_US);
+    pthread_kill(signal->target, signal->number);
+    return NULL;
+}
+
+/**
+ * Sleeps for sleepUs while another thread sends a signal to this one.
+ *
+ * @return time slept in us
+ */
+static int64_t sleepSignalled(int number, int64_t sleepUs, int *result) {
+    delayedSignal signal = {pthread_self(), number};
+    pthread_t thread;
+    stopSignal = 0;
+    interruptions = 0;
+    int64_t start = scheduleClockUs();
+    if (pthread_create(&thread, NULL, sendSignal, &signal) != 0) {
+        *result = -1;
+        return 0;
+    }
+    *result = sleepUntilScheduled(start + sleepUs, interrupted, NULL);
+    int64_t slept = scheduleClockUs() - start;
+    pthread_join(thread, NULL);
+    return slept;
+}
+
+/**
+ * SIGTERM in the middle of a long sleep ends it right away.
+ */
+static void testStopEndsSleep(void) {
+    char what[128];
+    int result;
+    int64_t slept = sleepSignalled(SIGTERM, LONG_SLEEP_US, &result);
+    check(result == 1, "stop: sleep ended by the callback");
+    check(interruptions == 1, "stop: callback called once");
+    snprintf(what, sizeof(what), "stop: slept %" PRId64 "us, at most %d expected", slept, SIGNAL_US + STOP_US);
+    check(slept < SIGNAL_US + STOP_US, what);
+}
+
+/**
+ * Another signal is handled and the sleep goes on until it is due.
+ */
+static void testSignalKeepsSleeping(void) {
+    char what[128];
+    int result;
+    int64_t slept = sleepSignalled(SIGUSR1, SHORT_SLEEP_US, &result);
+    check(result == 0, "signal: sleep reached its time");
+    check(interruptions == 1, "signal: callback called once");
+    snprintf(what, sizeof(what), "signal: slept %" PRId64 "us, at least %d expected", slept, SHORT_SLEEP_US);
+    check(slept >= SHORT_SLEEP_US, what);
+}
+
+/**
+ * Lateness between 112us and 169us falls into a bucket bounded above
+ * the longest run, the percentiles are clamped to it.
+ */
+static void testPercentileBelowMax(void) {
+    char what[128];
+    scheduleStats stats;
+    openScheduleStats(&stats);
+    int channel = addScheduleChannel(&stats, "test");
+    for (int64_t i = 0; i < 100; i++) {
+        int64_t intendedUs = (i + 1) * 1000000;
+        recordScheduledRun(&stats, channel, intendedUs, intendedUs + 112 + i * 57 / 99, 1000000, 1000);
+    }
+    const scheduleChannel *c = &stats.channel[channel];
+    uint64_t p50 = schedulePercentile(c->lateHistogram, c->maxLateUs, 50);
+    uint64_t p99 = schedulePercentile(c->lateHistogram, c->maxLateUs, 99);
+    snprintf(what, sizeof(what), "percentile: late p50 %" PRIu64 "us p99 %" PRIu64 "us max %" PRId64 "us", p50, p99,
+             c->maxLateUs);
+    check(c->maxLateUs == 169 && p50 >= 112 && p50 <= p99 && p99 <= 169, what);
+}
+
+int main(int argc, char **argv) {
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = onSignal;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGTERM, &action, NULL);
+    sigaction(SIGUSR1, &action, NULL);
+
+    testStopEndsSleep();
+    testSignalKeepsSleeping();
+    testPercentileBelowMax();
+
+    printf("%s\n", failures == 0 ? "all checks passed" : "checks failed");
+    return failures == 0 ? 0 : 1;
+}